@@ -22,11 +22,15 @@
 #include "e_basis.h"
 #include "e_checks.h"
 #include "e_hover.h"
+#include "e_incidence.h"
+#include "e_journal.h"
 #include "e_linedef.h"
 #include "e_objects.h"
 #include "e_sector.h"
+#include "e_spatial.h"
 #include "e_vertex.h"
 #include "LineDef.h"
+#include "ObjectPool.h"
 #include "Vertex.h"
 #include <memory>
 
@@ -43,11 +47,11 @@ private:
 	Instance &inst;	// make this private because we don't want to access it from Document
 public:
 
-	std::vector<std::shared_ptr<Thing>> things;
-	std::vector<std::shared_ptr<Vertex>> vertices;
-	std::vector<std::shared_ptr<Sector>> sectors;
-	std::vector<std::shared_ptr<SideDef>> sidedefs;
-	std::vector<std::shared_ptr<LineDef>> linedefs;
+	ObjectPool<Thing> things;
+	ObjectPool<Vertex> vertices;
+	ObjectPool<Sector> sectors;
+	ObjectPool<SideDef> sidedefs;
+	ObjectPool<LineDef> linedefs;
 
 	std::vector<byte> headerData;
 	std::vector<byte> behaviorData;
@@ -65,13 +69,17 @@ public:
 	VertexModule vertmod;
 	SectorModule secmod;
 	ObjectsModule objects;
+	VertexIncidence incidence;
+	SpatialIndex spatial;
+	EditJournal journal;
 
 	explicit Document(Instance &inst) : inst(inst), basis(*this), checks(*this), hover(*this),
-	linemod(*this), vertmod(*this), secmod(*this), objects(*this)
+	linemod(*this), vertmod(*this), secmod(*this), objects(*this), incidence(*this), spatial(*this),
+	journal(*this)
 	{
 	}
 	
-	Document(Document &&other) noexcept : inst(other.inst), basis(*this), checks(*this), hover(*this), linemod(*this), vertmod(*this), secmod(*this), objects(*this) 
+	Document(Document &&other) noexcept : inst(other.inst), basis(*this), checks(*this), hover(*this), linemod(*this), vertmod(*this), secmod(*this), objects(*this), incidence(*this), spatial(*this), journal(*this)
 	{
 		*this = std::move(other);
 	}
@@ -91,6 +99,10 @@ public:
 		MadeChanges = other.MadeChanges;
 		// TODO: basis
 		basis = std::move(other.basis);
+		incidence.invalidate();
+		spatial.invalidate();
+		// the level it was keeping is gone
+		journal.discard();
 		return *this;
 	}
 
@@ -42,6 +42,7 @@ class Lump_c;
 class UI_NodeDialog;
 class UI_ProjectSetup;
 struct BadCount;
+struct background_build_t;
 struct NewDocument;
 struct v2double_t;
 struct v2int_t;
@@ -285,9 +286,13 @@ public:
 	bool MissingIWAD_Dialog();
 	bool M_SaveMap(bool inhibit_node_build);
 	void refreshViewAfterLoad(const BadCount& bad, const Wad_file* wad, const SString& map_name, bool new_resources);
+	void recoverJournal(const Wad_file *wad);
 
 	// M_NODES
 	void BuildNodesAfterSave(int lev_idx, const LoadingData& loading, Wad_file &wad);
+	void PollBackgroundNodes();
+	void FinishBackgroundNodes();
+	int BuildNodesFromCommandLine();
 	void GB_PrintMsg(EUR_FORMAT_STRING(const char *str), ...) EUR_PRINTF(2, 3);
 
 	// M_TESTMAP
@@ -439,6 +444,7 @@ private:
 
 	// M_NODES
 	build_result_e BuildAllNodes(nodebuildinfo_t *info);
+	build_result_e BuildAllNodesParallel(nodebuildinfo_t *info);
 
 	// R_GRID
 
@@ -500,6 +506,10 @@ public:	// will be private when we encapsulate everything
 	int last_given_file = 0;
 	tl::optional<UI_NodeDialog> nodeialog;
 	nodebuildinfo_t *nb_info = nullptr;
+	// partitions of the last build after a save, for the next one
+	bsp_history_t nodeHistory;
+	// the nodes being built after a save, while editing goes on
+	std::shared_ptr<background_build_t> nodeBuild;
 	
 	int tagInMemory = 0;
 
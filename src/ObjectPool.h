@@ -0,0 +1,300 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef ObjectPool_h
+#define ObjectPool_h
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+//
+// The map objects of one type, in index order, stored in big chunks
+// instead of one allocation each. Indexing gives a plain pointer, so
+// looping over a level touches no reference counts. Like the shared
+// pointers this replaced, a const pool still gives changeable objects.
+//
+// Adding objects at the end never moves the others, so a pointer stays
+// good across Basis::addNew(). Inserting or removing an object moves
+// the ones after it down or up by one place.
+//
+template<typename T>
+class ObjectPool
+{
+	enum
+	{
+		CHUNK_SHIFT = 10,
+		CHUNK_SIZE = 1 << CHUNK_SHIFT,
+		CHUNK_MASK = CHUNK_SIZE - 1
+	};
+
+public:
+	class iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = T *;
+		using difference_type = std::ptrdiff_t;
+		using pointer = T *const *;
+		using reference = T *;
+
+		iterator(const ObjectPool *pool, int index) : pool(pool), index(index)
+		{
+		}
+
+		T *operator * () const
+		{
+			return (*pool)[index];
+		}
+		iterator &operator ++ ()
+		{
+			++index;
+			return *this;
+		}
+		iterator operator ++ (int)
+		{
+			iterator old = *this;
+			++index;
+			return old;
+		}
+		bool operator == (const iterator &other) const
+		{
+			return index == other.index;
+		}
+		bool operator != (const iterator &other) const
+		{
+			return index != other.index;
+		}
+
+	private:
+		const ObjectPool *pool;
+		int index;
+	};
+
+	ObjectPool() = default;
+	ObjectPool(ObjectPool &&other) noexcept
+	{
+		*this = std::move(other);
+	}
+	ObjectPool &operator = (ObjectPool &&other) noexcept
+	{
+		chunks = std::move(other.chunks);
+		count = other.count;
+		other.count = 0;
+		return *this;
+	}
+
+	T *operator [] (int index) const
+	{
+		return &chunks[index >> CHUNK_SHIFT][index & CHUNK_MASK];
+	}
+
+	size_t size() const
+	{
+		return static_cast<size_t>(count);
+	}
+	bool empty() const
+	{
+		return count == 0;
+	}
+
+	iterator begin() const
+	{
+		return iterator(this, 0);
+	}
+	iterator end() const
+	{
+		return iterator(this, count);
+	}
+
+	T *back() const
+	{
+		return (*this)[count - 1];
+	}
+
+	//
+	// Adds a new default object at the end and returns it
+	//
+	T *append()
+	{
+		reserve(count + 1);
+		return (*this)[count++];
+	}
+
+	void push_back(T &&object)
+	{
+		*append() = std::move(object);
+	}
+	void push_back(const T &object)
+	{
+		*append() = object;
+	}
+
+	//
+	// Puts the object at the index, moving the ones from there up
+	//
+	void insert(int index, T &&object)
+	{
+		append();
+		for(int n = count - 1; n > index; --n)
+			at(n) = std::move(at(n - 1));
+		at(index) = std::move(object);
+	}
+
+	//
+	// Takes the object at the index out, moving the ones after it down
+	//
+	T take(int index)
+	{
+		T object = std::move(at(index));
+		for(int n = index; n < count - 1; ++n)
+			at(n) = std::move(at(n + 1));
+		pop_back();
+		return object;
+	}
+
+	void pop_back()
+	{
+		at(--count) = T();
+	}
+
+	void resize(int newCount)
+	{
+		while(count > newCount)
+			pop_back();
+		reserve(newCount);
+		count = newCount;
+	}
+
+	void reserve(int capacity)
+	{
+		while(static_cast<int>(chunks.size()) * CHUNK_SIZE < capacity)
+			chunks.push_back(std::make_unique<T[]>(CHUNK_SIZE));
+	}
+
+	void clear()
+	{
+		chunks.clear();
+		count = 0;
+	}
+
+private:
+	T &at(int index)
+	{
+		return *(*this)[index];
+	}
+
+	// all the objects past the count are in their default state
+	std::vector<std::unique_ptr<T[]>> chunks;
+	int count = 0;
+};
+
+//
+// Numbered places for objects which are out of the document, like the
+// deleted ones the undo history keeps. They are stored side by side
+// and the places of those given back get used again.
+//
+template<typename T>
+class ObjectStash
+{
+public:
+	int put(T &&object)
+	{
+		if(freeSlots.empty())
+		{
+			objects.push_back(std::move(object));
+			return static_cast<int>(objects.size()) - 1;
+		}
+		int slot = freeSlots.back();
+		freeSlots.pop_back();
+		objects[slot] = std::move(object);
+		return slot;
+	}
+
+	const T &operator [] (int slot) const
+	{
+		return objects[slot];
+	}
+	T &operator [] (int slot)
+	{
+		return objects[slot];
+	}
+
+	T take(int slot)
+	{
+		T object = std::move(objects[slot]);
+		release(slot);
+		return object;
+	}
+
+	void release(int slot)
+	{
+		objects[slot] = T();
+		freeSlots.push_back(slot);
+
+		// all given back
+		if(freeSlots.size() == objects.size())
+			clear();
+	}
+
+	//
+	// Number of objects held
+	//
+	size_t size() const
+	{
+		return objects.size() - freeSlots.size();
+	}
+
+	void clear()
+	{
+		objects.clear();
+		freeSlots.clear();
+	}
+
+	//
+	// Give back the memory of the free places at the end, and use the
+	// lowest free places first from now on, so more end up there
+	//
+	void trim()
+	{
+		std::sort(freeSlots.begin(), freeSlots.end(), std::greater<int>());
+
+		size_t dropped = 0;
+		while(dropped < freeSlots.size() && freeSlots[dropped] == static_cast<int>(objects.size()) - 1)
+		{
+			objects.pop_back();
+			dropped++;
+		}
+		freeSlots.erase(freeSlots.begin(), freeSlots.begin() + dropped);
+
+		if(objects.capacity() > 2 * objects.size())
+			objects.shrink_to_fit();
+	}
+
+private:
+	std::vector<T> objects;
+	std::vector<int> freeSlots;
+};
+
+#endif /* ObjectPool_h */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
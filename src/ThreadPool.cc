@@ -0,0 +1,232 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include <chrono>
+
+// which pool (and which of its queues) the current thread works for
+static thread_local ThreadPool *tPool = nullptr;
+static thread_local int tIndex = -1;
+
+ThreadPool::ThreadPool(int numThreads)
+{
+	if(numThreads < 0)
+		numThreads = 0;
+
+	for(int i = 0; i <= numThreads; ++i)
+		mQueues.push_back(std::make_unique<Queue>());
+
+	for(int i = 0; i < numThreads; ++i)
+		mThreads.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+		mQuit = true;
+	}
+	mWake.notify_all();
+
+	for(std::thread &thread : mThreads)
+		thread.join();
+}
+
+//
+// Queue a task. From a worker it goes to that worker's own queue.
+//
+void ThreadPool::submit(Task &&task)
+{
+	int index = tPool == this ? tIndex : (int)mQueues.size() - 1;
+
+	{
+		std::lock_guard<std::mutex> lock(mQueues[index]->mutex);
+		mQueues[index]->tasks.push_back(std::move(task));
+	}
+	++mQueued;
+
+	{
+		std::lock_guard<std::mutex> lock(mSleepMutex);
+	}
+	mWake.notify_one();
+}
+
+bool ThreadPool::runPending()
+{
+	Task task;
+	if(!takeTask(tPool == this ? tIndex : -1, task))
+		return false;
+	task();
+	return true;
+}
+
+//
+// Get a task: the newest from our own queue, else the oldest from the
+// shared queue, else steal the oldest from another worker.
+//
+bool ThreadPool::takeTask(int index, Task &task)
+{
+	if(mQueued.load() == 0)
+		return false;
+
+	int count = (int)mQueues.size();
+
+	if(index >= 0)
+	{
+		Queue &own = *mQueues[index];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(!own.tasks.empty())
+		{
+			task = std::move(own.tasks.back());
+			own.tasks.pop_back();
+			--mQueued;
+			return true;
+		}
+	}
+
+	for(int i = 0; i < count; ++i)
+	{
+		// the shared queue comes first, then the neighbours
+		int victim = i == 0 ? count - 1 : (index + i + count - 1) % (count - 1);
+		if(victim == index)
+			continue;
+
+		Queue &queue = *mQueues[victim];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if(!queue.tasks.empty())
+		{
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+			--mQueued;
+			return true;
+		}
+	}
+	return false;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+	tPool = this;
+	tIndex = index;
+
+	for(;;)
+	{
+		Task task;
+		if(takeTask(index, task))
+		{
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(mSleepMutex);
+		mWake.wait(lock, [this]
+		{
+			return mQuit || mQueued.load() > 0;
+		});
+		if(mQuit && mQueued.load() == 0)
+			return;
+	}
+}
+
+int ThreadPool::hardwareThreads()
+{
+	unsigned count = std::thread::hardware_concurrency();
+	return count > 0 ? (int)count : 1;
+}
+
+ThreadPool &ThreadPool::shared()
+{
+	static ThreadPool pool(hardwareThreads() - 1);
+	return pool;
+}
+
+//------------------------------------------------------------------------
+
+TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch(...)
+	{
+	}
+}
+
+//
+// Queue a task of this group. Once a task has failed, the rest are
+// skipped.
+//
+void TaskGroup::run(ThreadPool::Task &&task)
+{
+	++mOutstanding;
+	mPool.submit([this, task = std::move(task)]()
+	{
+		try
+		{
+			if(!failed())
+				task();
+		}
+		catch(...)
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if(!mError)
+				mError = std::current_exception();
+			mFailed = true;
+		}
+		finishOne();
+	});
+}
+
+void TaskGroup::finishOne()
+{
+	// notify while locked, so wait() can't return (and the group go
+	// away) until we are done with it
+	std::lock_guard<std::mutex> lock(mMutex);
+	if(--mOutstanding == 0)
+		mDone.notify_all();
+}
+
+//
+// Wait for all tasks of the group, helping out with queued work in the
+// meantime.
+//
+void TaskGroup::wait()
+{
+	while(mOutstanding.load() > 0)
+	{
+		if(mPool.runPending())
+			continue;
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait_for(lock, std::chrono::milliseconds(1), [this]
+		{
+			return mOutstanding.load() == 0;
+		});
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		error = mError;
+		mError = nullptr;
+	}
+	if(error)
+		std::rethrow_exception(error);
+}
@@ -0,0 +1,129 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef ThreadPool_h
+#define ThreadPool_h
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//
+// Work-stealing pool of worker threads. Each worker owns a queue: tasks
+// submitted from a worker go to its own queue and are taken back newest
+// first, while idle workers steal the oldest tasks of the others. Tasks
+// submitted from outside go to a shared queue.
+//
+// Threads waiting on a TaskGroup help running queued tasks, so a pool
+// with no worker threads at all still makes progress (serially).
+//
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	explicit ThreadPool(int numThreads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &other) = delete;
+	ThreadPool &operator = (const ThreadPool &other) = delete;
+
+	int numThreads() const
+	{
+		return (int)mThreads.size();
+	}
+
+	void submit(Task &&task);
+
+	// runs one queued task on the calling thread, returns false if none
+	bool runPending();
+
+	// number of threads worth using on this machine, at least 1
+	static int hardwareThreads();
+
+	// process-wide pool, with one worker less than there are cores
+	// (the waiting thread takes part too)
+	static ThreadPool &shared();
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	void workerLoop(int index);
+	bool takeTask(int index, Task &task);
+
+	std::vector<std::unique_ptr<Queue>> mQueues;	// last one is the shared one
+	std::vector<std::thread> mThreads;
+
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+	std::atomic<int> mQueued = 0;
+	bool mQuit = false;
+};
+
+//
+// A set of tasks which can be waited on together. The first exception
+// thrown by any of the tasks is passed on by wait().
+//
+class TaskGroup
+{
+public:
+	explicit TaskGroup(ThreadPool &pool) : mPool(pool)
+	{
+	}
+	~TaskGroup();
+
+	TaskGroup(const TaskGroup &other) = delete;
+	TaskGroup &operator = (const TaskGroup &other) = delete;
+
+	void run(ThreadPool::Task &&task);
+	void wait();
+
+	bool failed() const
+	{
+		return mFailed.load(std::memory_order_relaxed);
+	}
+
+	ThreadPool &pool() const
+	{
+		return mPool;
+	}
+
+private:
+	void finishOne();
+
+	ThreadPool &mPool;
+
+	std::atomic<int> mOutstanding = 0;
+	std::atomic<bool> mFailed = false;
+
+	std::mutex mMutex;
+	std::condition_variable mDone;
+	std::exception_ptr mError;
+};
+
+#endif /* ThreadPool_h */
@@ -21,12 +21,17 @@
 #ifndef __EUREKA_BSP_H__
 #define __EUREKA_BSP_H__
 
+#include "bsp_kernel.h"
 #include "lib_util.h"
 #include "m_strings.h"
 #include "sys_type.h"
 #include "Thing.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <memory>
 #include <vector>
 
 struct ConfigData;
@@ -37,6 +42,8 @@ enum class Side;
 struct Document;
 class Wad_file;
 struct LoadingData;
+class TaskGroup;
+class ThreadPool;
 
 // Node Build Information Structure
 //
@@ -47,6 +54,124 @@ struct LoadingData;
 //
 #define DEFAULT_FACTOR  11
 
+//
+// The partitions an earlier build of a level chose, so building it again
+// after an edit only needs to pick new ones where the map changed (see
+// nodebuildinfo_t::history).  Partitions away from the changes are used
+// again as long as they still divide their segs properly.  The result is
+// always a valid BSP tree, but not necessarily the one a full build would
+// give.
+//
+struct bsp_history_t
+{
+	struct partition_t
+	{
+		// the seg used as the partition, with its exact coordinates
+		double x1, y1, x2, y2;
+
+		// bounding box of all the segs of the node
+		int minx, miny, maxx, maxy;
+
+		// child partitions, or -1 for a subsector
+		int right, left;
+	};
+
+	// depth-first, the root comes first
+	std::vector<partition_t> nodes;
+
+	// start and end of every seg made from a linedef, sorted
+	std::vector<std::array<double, 4>> segs;
+
+	// which level, and the options which make a difference
+	SString level;
+	MapFormat format = MapFormat::doom;
+	int factor = 0;
+	bool fast = false;
+
+	// how long building the nodes took, in seconds, the last time it
+	// was done from scratch
+	double full_time = 0;
+
+	// how the last build went: partitions used again or picked anew
+	bool incremental = false;
+	int reused = 0;
+	int picked = 0;
+
+	void Clear()
+	{
+		nodes.clear();
+		segs.clear();
+		level.clear();
+		incremental = false;
+		reused = picked = 0;
+	}
+};
+
+//
+// The parts of building a level which are timed
+//
+enum build_phase_e
+{
+	PHASE_Load = 0,		// reading the level, finding its limits
+	PHASE_Segs,			// creating the initial segs
+	PHASE_Nodes,		// building the tree
+	PHASE_Clockwise,	// sorting the segs of each subsector
+	PHASE_RoundOff,		// rounding the vertices for the classic formats
+	PHASE_ZNodes,		// writing (and compressing) ZDoom format nodes
+	PHASE_Blockmap,
+	PHASE_Reject,
+
+	NUM_BUILD_PHASES
+};
+
+const char *BuildPhaseName(build_phase_e phase);
+
+// roughly how far building a level has got, in percent, when a phase begins
+int BuildPhaseProgress(build_phase_e phase);
+
+//
+// What building a level made, for reports
+//
+struct build_stats_t
+{
+	int nodes = 0;
+	int subsecs = 0;
+	int segs = 0;
+	int vertices = 0;
+
+	// the formats of the nodes, and whether the limits of the normal
+	// formats made the builder use them
+	bool gl_v5 = false;
+	bool xnod = false;
+	bool xgl3 = false;
+	bool forced_v5 = false;
+	bool forced_xnod = false;
+
+	// the LIMIT_XXX flags of the lumps which overflowed
+	int overflows = 0;
+
+	int splits = 0;		// of segs from linedefs, by the partitions
+	int height = 0;		// of the tree
+
+	int64_t partitions = 0;	// calls of EvalPartition
+	int minisegs = 0;
+	int64_t quadtrees = 0;	// boxes of the quadtrees of segs
+
+	// bytes given to zlib, and what came out of how many blocks, in
+	// how many seconds
+	size_t compress_in = 0;
+	size_t compress_out = 0;
+	int compress_blocks = 0;
+	double compress_time = 0;
+
+	// seconds spent in each phase, and for the whole level
+	double phase_time[NUM_BUILD_PHASES] = {};
+	double time = 0;
+
+	// bytes the node builder allocated for the level
+	size_t memory = 0;
+};
+
 struct nodebuildinfo_t
 {
 	int factor = DEFAULT_FACTOR;
@@ -57,6 +182,11 @@ struct nodebuildinfo_t
 	bool do_blockmap = true;
 	bool do_reject = true;
 
+	// try the blockmap origins up to one block back from the corner of
+	// the map, keeping the one giving the smallest lump.  Without this
+	// they are only tried when the blockmap at the corner overflows.
+	bool blockmap_search = false;
+
 	bool fast = false;
 	bool warnings = false;
 
@@ -64,12 +194,100 @@ struct nodebuildinfo_t
 	bool force_xnod = false;
 	bool force_compress = false;
 
+	// work out which sectors can see each other through the two-sided
+	// linedefs for the REJECT lump, instead of only finding the groups
+	// of sectors which are not connected at all.  Sectors not done
+	// within 'reject_time' seconds (0 for no limit) only get the latter.
+	bool full_reject = false;
+	int reject_time = 30;
+
+	// number of threads used to build the nodes of a level: 1 builds
+	// serially, 0 uses one per CPU core.  Subtrees are handed out as
+	// separate tasks down to 'task_depth', when they have at least
+	// 'task_min_segs' segs.  The result is the same in every case.
+	int jobs = 1;
+	int task_depth = 16;
+	int task_min_segs = 64;
+
+	// nodes with at least this many real segs have their partition
+	// candidates scored by all the threads (when 'jobs' is not 1).
+	int pick_min_segs = 1000;
+
+	// when not 0, at most about this many partition candidates are
+	// scored at a node, sampled evenly over its segs (plus the best
+	// axis-aligned ones).  The number grows with the depth, where the
+	// nodes are smaller.  This sits between 'fast' and trying every seg.
+	// When 'pick_time' is not 0, the number shrinks as the building of
+	// the nodes takes up those seconds, so the tree then depends on the
+	// speed of the machine.
+	int pick_budget = 0;
+	int pick_time = 0;
+
+	// when not empty, the level is built with each of these split
+	// factors, using both normal and fast partition picking, and the
+	// best tree is kept: first one which fits the limits of the normal
+	// formats, then the fewest segs (or the lowest height when
+	// 'portfolio_height' is set).  The builds are done at the same time,
+	// each on its own copy of the level (see m_nodes.cc).
+	std::vector<int> portfolio;
+	bool portfolio_height = false;
+
+	// when set, the threads of this pool are used instead of a new pool
+	// (only 'jobs' being 1 or not matters then).
+	ThreadPool *pool = NULL;
+
+	// when set, the partitions kept here from an earlier build of the
+	// same level are used again where possible, and afterwards it holds
+	// those of this build.  Only for building a single level.
+	bsp_history_t *history = NULL;
+
 	// the GUI can set this to tell the node builder to stop
-	bool cancelled = false;
+	std::atomic<bool> cancelled = false;
+
+	// how far building the level has got, in percent, for the GUI to
+	// show while it waits
+	std::atomic<int> progress = 0;
 
 	// from here on, various bits of internal state
 	int total_failed_maps = 0;
 	int total_warnings = 0;
+
+	// of the last level built
+	build_stats_t stats;
+
+public:
+	// copy all the options from another info (not the state)
+	void CopyOptions(const nodebuildinfo_t &other)
+	{
+		factor   = other.factor;
+		gl_nodes = other.gl_nodes;
+
+		do_blockmap = other.do_blockmap;
+		do_reject   = other.do_reject;
+
+		blockmap_search = other.blockmap_search;
+
+		fast     = other.fast;
+		warnings = other.warnings;
+
+		force_v5       = other.force_v5;
+		force_xnod     = other.force_xnod;
+		force_compress = other.force_compress;
+
+		full_reject = other.full_reject;
+		reject_time = other.reject_time;
+
+		jobs          = other.jobs;
+		task_depth    = other.task_depth;
+		task_min_segs = other.task_min_segs;
+		pick_min_segs = other.pick_min_segs;
+		pick_budget   = other.pick_budget;
+		pick_time     = other.pick_time;
+		pool          = other.pool;
+
+		portfolio        = other.portfolio;
+		portfolio_height = other.portfolio_height;
+	}
 };
 
 
@@ -91,6 +309,24 @@ enum build_result_e
 
 build_result_e AJBSP_BuildLevel(nodebuildinfo_t *info, int lev_idx, Instance &inst, const Document &doc, const LoadingData& loading, Wad_file &wad);
 
+//
+// A lump written by the node builder, kept so it can be put back into
+// a level without building its nodes again (see m_nodecache.h).
+//
+struct node_lump_t
+{
+	SString name;
+	std::vector<byte> data;
+};
+
+// the lumps the node builder made for a level, in wad order
+std::vector<node_lump_t> AJBSP_GetNodeLumps(const Wad_file &wad, int lev_idx, MapFormat format);
+
+// puts those lumps into the freshly saved level, which then ends up just
+// as if its nodes had been built.
+build_result_e AJBSP_PutNodeLumps(nodebuildinfo_t *info, int lev_idx, Instance &inst, const Document &doc,
+		const LoadingData& loading, Wad_file &wad, const std::vector<node_lump_t> &lumps);
+
 
 //======================================================================
 //
@@ -109,13 +345,16 @@ namespace ajbsp
 typedef double angle_g;  // degrees, 0 is E, 90 is N
 
 
+// flags of the linedefs kept by the node builder itself (in the
+// 'line_flags' of LevelData), since several builds may share a level.
+
 // prefer not to split
-#define MLF_IS_PRECIOUS  0x40000000
+#define MLF_IS_PRECIOUS  0x01
 
 // this is flag set when a linedef directly overlaps an earlier
 // one (a rarely-used trick to create higher mid-masked textures).
 // No segs should be created for these overlapping linedefs.
-#define MLF_IS_OVERLAP   0x20000000
+#define MLF_IS_OVERLAP   0x02
 
 
 //------------------------------------------------------------------------
@@ -124,6 +363,29 @@ typedef double angle_g;  // degrees, 0 is E, 90 is N
 
 void PrintDetail(const char *fmt, ...);
 
+// calls func(0 .. count-1), on the threads of the build when it has any
+void RunParallel(const nodebuildinfo_t *info, int count, const std::function<void(int)> &func);
+
+//
+// Adds the time from its creation until it goes out of scope to a phase
+// of the level being built.
+//
+class phase_timer_c
+{
+public:
+	phase_timer_c(nodebuildinfo_t *info, build_phase_e phase);
+	~phase_timer_c();
+
+	phase_timer_c(const phase_timer_c &other) = delete;
+	phase_timer_c &operator = (const phase_timer_c &other) = delete;
+
+private:
+	nodebuildinfo_t *info;
+	build_phase_e phase;
+
+	std::chrono::steady_clock::time_point start;
+};
+
 
 // allocate and clear some memory.  guaranteed not to fail.
 void *UtilCalloc(int size);
@@ -165,6 +427,7 @@ int CheckLinedefInsideBox(int xmin, int ymin, int xmax, int ymax,
 struct node_t;
 
 class quadtree_c;
+template<typename T> class arena_c;
 
 
 // a wall-tip is where a wall meets a vertex
@@ -236,10 +499,6 @@ struct seg_t
 	// won't be any of these when writing the V2 GL_SEGS lump].
 	bool is_degenerate;
 
-	// the quad-tree node that contains this seg, or NULL if the seg
-	// is now in a subsector.
-	quadtree_c *quad;
-
 	// precomputed data for faster calculations
 	double psx, psy;
 	double pex, pey;
@@ -257,6 +516,10 @@ struct seg_t
 	// this only used by ClockwiseOrder()
 	angle_g cmp_angle;
 
+	// only used when building in parallel: the task which has our partner
+	// in its seg list, and cannot start until we are in a subsector.
+	struct build_task_t *waiter;
+
 public:
 	// compute the seg private info (psx/y, pex/y, pdx/y, etc).
 	void Recompute();
@@ -340,6 +603,10 @@ struct node_t
 	double x, y;     // starting point
 	double dx, dy;   // offset to ending point
 
+	// the partition seg itself, kept for the next build (see
+	// bsp_history_t)
+	double psx, psy, pex, pey;
+
 	// right & left children
 	child_t r;
 	child_t l;
@@ -353,53 +620,326 @@ public:
 };
 
 
+//
+// The segs of one BuildNodes() call, sorted into a tree of boxes.  Each
+// box is cut in half across its longer side, down to boxes of 320 units
+// or less, and a seg goes into the smallest box it fits in.
+//
+// The boxes are kept in one array, where the two halves of box 'b' are
+// boxes 2b+1 (the lower coordinates) and 2b+2.  The segs are kept in the
+// seg block, so that those of a box and of all its halves are one run:
+// its own segs first, then those of each half.  Build() fills it all in
+// again, re-using the memory of the last time.
+//
 class quadtree_c
 {
 public:
-	// coordinates on map for this block, from lower-left corner to
-	// upper-right corner.  Fully inclusive, i.e (x,y) is inside this
-	// block when x1 < x < x2 and y1 < y < y2.
-	int x1, y1;
-	int x2, y2;
+	struct box_t
+	{
+		// coordinates on map for this box, from lower-left corner to
+		// upper-right corner.  Fully inclusive, i.e (x,y) is inside this
+		// box when x1 < x < x2 and y1 < y < y2.
+		int x1, y1;
+		int x2, y2;
+
+		// count of real/mini segs contained in this box AND ALL HALVES.
+		int real_num;
+		int mini_num;
+
+		// the segs of this box itself are 'count' segs of the block
+		// from 'first', those of the halves follow up to 'end'.
+		int first;
+		int count;
+		int end;
+
+		// where the next seg goes while building
+		int fill;
+
+		bool leaf;
+	};
 
-	// sub-trees.  NULL for leaf nodes.
-	// [0] has the lower coordinates, and [1] has the higher coordinates.
-	// Division of a square always occurs horizontally (e.g. 512x512 -> 256x512).
-	quadtree_c *subs[2];
+	std::vector<box_t> boxes;
 
-	// count of real/mini segs contained in this node AND ALL CHILDREN.
-	int real_num;
-	int mini_num;
+	seg_block_t block;
 
-	// list of segs contained in this node itself.
-	seg_t *list;
+	// boxes made by the last Build()
+	int num_boxes = 0;
 
 public:
-	quadtree_c(int _x1, int _y1, int _x2, int _y2);
-	~quadtree_c();
+	void Build(seg_t *list, const bbox_t *bounds);
 
-	void AddSeg(seg_t *seg);
-	void AddList(seg_t *list);
+	static inline int Sub(int box, int c)
+	{
+		return 2 * box + 1 + c;
+	}
 
-	inline bool Empty() const
+	inline bool Empty(int box) const
 	{
-		return (real_num + mini_num) == 0;
+		return (boxes[box].real_num + boxes[box].mini_num) == 0;
 	}
 
-	void ConvertToList(seg_t **list);
+	// whether half 'c' of the box has any segs
+	inline bool HasSub(int box, int c) const
+	{
+		return ! boxes[box].leaf && ! Empty(Sub(box, c));
+	}
+
+	inline int RealNum() const
+	{
+		return boxes[0].real_num;
+	}
+
+	// puts all the segs into the list, leaving the tree alone
+	void ConvertToList(seg_t **list) const;
 
 	// check relationship between this box and the partition line.
 	// returns SIDE_LEFT or SIDE_RIGHT if box is definitively on a
 	// particular side, or 0 if the line intersects/touches the box.
 	//
-	Side OnLineSide(const seg_t *part) const;
+	Side OnLineSide(int box, const seg_t *part) const;
+
+private:
+	void InitBox(int box, int x1, int y1, int x2, int y2);
+	int LayoutBox(int box, int first);
+
+	// scratch space for Build()
+	std::vector<int> seg_boxes;
+	std::vector<seg_t *> placed;
 };
 
 
+/* ----- Allocation ----------------------- */
+
+//
+// Hands out zeroed objects of one type, carved from big blocks.  An
+// object can be given back with Free() to be handed out again, but the
+// memory itself is only released by Clear(), all at once.  Nothing is
+// ever constructed or destructed here.
+//
+template<typename T>
+class arena_c
+{
+public:
+	arena_c() = default;
+	~arena_c()
+	{
+		Clear();
+	}
+
+	arena_c(const arena_c &other) = delete;
+	arena_c &operator = (const arena_c &other) = delete;
+
+	T *Alloc()
+	{
+		num_allocs++;
+
+		if (free_list)
+		{
+			T *obj = reinterpret_cast<T *>(free_list);
+			free_list = free_list->next;
+
+			memset((void *) obj, 0, sizeof(T));
+			num_reused++;
+			return obj;
+		}
+
+		if (cur_used == cur_size)
+			NewBlock();
+
+		return cur_block + cur_used++;
+	}
+
+	void Free(T *obj)
+	{
+		static_assert(sizeof(T) >= sizeof(free_t), "arena_c objects too small");
+
+		free_t *f = reinterpret_cast<free_t *>(obj);
+		f->next = free_list;
+		free_list = f;
+	}
+
+	// take over all the memory of another arena, which becomes empty
+	void Adopt(arena_c &other)
+	{
+		blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+
+		num_allocs += other.num_allocs;
+		num_reused += other.num_reused;
+		num_bytes  += other.num_bytes;
+
+		other.blocks.clear();
+		other.Reset();
+	}
+
+	void Clear()
+	{
+		for (T *block : blocks)
+			free(block);
+
+		blocks.clear();
+		Reset();
+	}
+
+	// statistics
+	size_t NumAllocs() const { return num_allocs; }
+	size_t NumReused() const { return num_reused; }
+	size_t NumBlocks() const { return blocks.size(); }
+	size_t NumBytes()  const { return num_bytes; }
+
+private:
+	struct free_t
+	{
+		free_t *next;
+	};
+
+	// blocks start small (every task of a parallel build has its own
+	// arenas) and grow up to this many objects
+	static constexpr int MAX_BLOCK = 1024;
+
+	void NewBlock()
+	{
+		cur_size  = std::min(std::max(cur_size * 2, 16), MAX_BLOCK);
+		cur_block = (T *) calloc(cur_size, sizeof(T));
+
+		if (! cur_block)
+			throw std::bad_alloc();
+
+		blocks.push_back(cur_block);
+		cur_used = 0;
+
+		num_bytes += cur_size * sizeof(T);
+	}
+
+	void Reset()
+	{
+		cur_block = NULL;
+		cur_size  = 0;
+		cur_used  = 0;
+		free_list = NULL;
+
+		num_allocs = num_reused = num_bytes = 0;
+	}
+
+	std::vector<T *> blocks;
+
+	T *cur_block = NULL;
+	int cur_size = 0;
+	int cur_used = 0;
+
+	free_t *free_list = NULL;
+
+	size_t num_allocs = 0;
+	size_t num_reused = 0;
+	size_t num_bytes  = 0;
+};
+
+
+struct intersection_t;
+
+//
+// All the arenas of a level (or of one task of a parallel build).
+//
+struct level_arenas_t
+{
+	arena_c<vertex_t>   vertices;
+	arena_c<seg_t>      segs;
+	arena_c<subsec_t>   subsecs;
+	arena_c<node_t>     nodes;
+	arena_c<walltip_t>  walltips;
+
+	arena_c<intersection_t> cuts;
+
+	void Adopt(level_arenas_t &other)
+	{
+		vertices.Adopt(other.vertices);
+		segs.Adopt(other.segs);
+		subsecs.Adopt(other.subsecs);
+		nodes.Adopt(other.nodes);
+		walltips.Adopt(other.walltips);
+		cuts.Adopt(other.cuts);
+	}
+
+	void Clear()
+	{
+		vertices.Clear();
+		segs.Clear();
+		subsecs.Clear();
+		nodes.Clear();
+		walltips.Clear();
+		cuts.Clear();
+	}
+};
+
+
+/* ----- Parallel node building ----------------------- */
+
+//
+// A subtree built as a separate task.  Everything it allocates is kept
+// here, and merged into the LevelData afterwards in the order a serial
+// build would have created it (which decides the vertex and subsector
+// numbering).
+//
+// A subtree is independent of the others, except for segs whose partner
+// lies in another subtree: splitting one splits the other.  In a serial
+// build the left side is finished before the right side begins, so the
+// right task does not start until all such segs on the left have reached
+// a subsector (see 'blockers').
+//
+struct build_task_t
+{
+	// what to build, and where the result goes
+	seg_t *list = NULL;
+	bbox_t *bounds = NULL;
+	node_t **N = NULL;
+	subsec_t **S = NULL;
+	int depth = 0;
+	int reuse = -1;
+
+	// segs elsewhere which must reach a subsector before we start
+	std::atomic<int> blockers = 0;
+
+	// too small to be a task, unless the left side makes some (it then
+	// holds one of the blockers until it has been built)
+	bool held = false;
+
+	bool started = false;
+	build_result_e result = BUILD_OK;
+
+	std::vector<vertex_t *>  vertices;
+	std::vector<subsec_t *>  subsecs;
+	std::vector<seg_t *>     segs;
+	std::vector<node_t *>    nodes;
+	std::vector<walltip_t *> walltips;
+
+	std::vector<SString> messages;
+	int warnings = 0;
+
+	level_arenas_t arenas;
+	quadtree_c quadtree;
+
+	// tasks started from this one (including from its inline subtrees)
+	std::vector<std::unique_ptr<build_task_t>> spawned;
+
+	// where their output goes, relative to ours, in serial order
+	struct mark_t
+	{
+		build_task_t *task;
+
+		size_t num_vertices;
+		size_t num_subsecs;
+		size_t num_messages;
+	};
+
+	std::vector<mark_t> marks;
+};
+
+// the task the current thread is working on, or NULL
+extern thread_local build_task_t *cur_build_task;
+
+
 /* ----- Level data arrays ----------------------- */
 
 class ZLibContext;
-struct intersection_t;
 struct eval_info_t;
 class LevelData
 {
@@ -432,13 +972,26 @@ public:
 	
 	// MAIN STUFF
 	build_result_e BuildLevel(nodebuildinfo_t *info, int lev_idx);
+
+	// writes node lumps saved from an earlier build instead
+	build_result_e PutNodeLumps(nodebuildinfo_t *info, int lev_idx,
+								const std::vector<node_lump_t> &lumps);
 	
 	void Warning(EUR_FORMAT_STRING(const char *fmt), ...) EUR_PRINTF(2, 3);
 	
 private:
 	struct Block
 	{
-		void CreateMap(const Document &doc);
+		struct line_t
+		{
+			int index;
+			int x1, y1, x2, y2;
+		};
+
+		static void FindLines(const Document &doc, std::vector<line_t> &lines);
+
+		void SetOrigin(int x, int y);
+		void CreateMap(const std::vector<line_t> &lines);
 		void CompressMap();
 		void InitMap(const Document &doc);
 		void FreeMap();
@@ -448,16 +1001,26 @@ private:
 		int block_w = 0;
 		int block_h = 0;
 		int block_count = 0;
-		uint16_t ** block_lines = nullptr;
-		uint16_t *block_ptrs = nullptr;
-		uint16_t *block_dups = nullptr;
+
+		// the line lists of block N are block_lines[block_starts[N] .. block_starts[N+1]-1]
+		std::vector<uint32_t> block_starts;
+		std::vector<uint16_t> block_lines;
+
+		// where each block's list is in the lump, and the blocks whose
+		// lists are written (in lump order)
+		std::vector<uint16_t> block_ptrs;
+		std::vector<int> block_order;
+
+		int lump_size = 0;
 		int compression = 0;
 		int overflowed = 0;
+
+		int map_maxx = 0;
+		int map_maxy = 0;
 		
 	private:
-		void Add(int blk_num, int line_index);
-		void AddLine(int line_index, const Document &doc);
-		int Compare(const void *p1, const void *p2) const;
+		template<typename F>
+		void ForEachBlock(const line_t &line, F &&func) const;
 	};
 	
 	struct Reject
@@ -466,6 +1029,7 @@ private:
 		void Free();
 		void GroupSectors(const Document &doc);
 		void ProcessSectors(const Document &doc);
+		int ProcessSight(const Document &doc, const nodebuildinfo_t *info);
 		
 		uint8_t *rej_matrix = nullptr;
 		int   rej_total_size = 0;	// in bytes
@@ -489,6 +1053,19 @@ private:
 	node_t    *NewNode();
 	walltip_t *NewWallTip();
 	
+	// the arenas to allocate from: those of the current task, if any
+	inline level_arenas_t &Arenas()
+	{
+		return cur_build_task ? cur_build_task->arenas : arenas;
+	}
+
+	// the quadtree of the BuildNodes() call in progress.  Only one per
+	// task is in use at any time.
+	inline quadtree_c &Quadtree()
+	{
+		return cur_build_task ? cur_build_task->quadtree : quadtree;
+	}
+	
 	/* ----- free routines ---------------------------- */
 	void FreeVertices();
 	void FreeSegs();
@@ -522,7 +1099,7 @@ private:
 	void SortSegs();
 	
 	/* ----- ZDoom format writing --------------------------- */
-	void putZItems(std::vector<byte>& lumpData, node_t* root_node, bool do_xgl3);
+	void putZItems(std::vector<byte>& lumpData, node_t* root_node, bool do_xgl3, bool compress);
 	void PutZVertices(ZLibContext &zcontext) const noexcept(false);
 	void PutZSubsecs(ZLibContext &zcontext) const noexcept(false);
 	void PutZSegs(ZLibContext &zcontext) const noexcept(false);
@@ -535,10 +1112,17 @@ private:
 	/* ----- whole-level routines --------------------------- */
 	void LoadLevel();
 	void FreeLevel();
+	void LogArenas() const;
+	void LogStats() const;
 	uint32_t CalcGLChecksum() const;
 	inline SString CalcOptionsString() const
 	{
-		return SString::printf("--cost %d%s", cur_info->factor, cur_info->fast ? " --fast" : "");
+		SString options = SString::printf("--cost %d%s", cur_info->factor, cur_info->fast ? " --fast" : "");
+
+		if (cur_info->pick_budget > 0)
+			options += SString::printf(" --budget %d", cur_info->pick_budget);
+
+		return options;
 	}
 	void UpdateGLMarker(Lump_c *marker) const;
 	void AddMissingLump(const char *name, const char *after);
@@ -549,13 +1133,14 @@ private:
 	Lump_c * FindLevelLump(const char *name) const noexcept;
 	Lump_c & CreateLevelLump(const char *name) const;
 	Lump_c & CreateGLMarker() const;
+	SString GLMarkerName() const;
 	
 	// NODES
 	seg_t * SplitSeg(seg_t *old_seg, double x, double y);
 	void DivideOneSeg(seg_t *seg, seg_t *part,
 					  seg_t **left_list, seg_t **right_list,
 					  intersection_t ** cut_list);
-	void SeparateSegs(quadtree_c *tree, seg_t *part,
+	void SeparateSegs(const quadtree_c *tree, seg_t *part,
 					  seg_t **left_list, seg_t **right_list,
 					  intersection_t ** cut_list);
 	void AddMinisegs(intersection_t *cut_list, seg_t *part,
@@ -567,15 +1152,18 @@ private:
 	// and '*N' is the new node (and '*S' is set to NULL).  Normally
 	// returns BUILD_OK, or BUILD_Cancelled if user stopped it.
 	//
+	// 'reuse' is the partition of the earlier build at this place in the
+	// tree (an index into prev_history.nodes), or -1.
+	//
 	build_result_e BuildNodes(seg_t *list, bbox_t *bounds /* output */,
-		node_t ** N, subsec_t ** S, int depth);
+		node_t ** N, subsec_t ** S, int depth, int reuse = -1);
 	seg_t *CreateOneSeg(int line, vertex_t *start, vertex_t *end,
 						int sidedef, int what_side /* 0 or 1 */);
 	// scan all the linedef of the level and convert each sidedef into a
 	// seg (or seg pair).  Returns the list of segs.
 	//
 	seg_t *CreateSegs();
-	subsec_t *CreateSubsector(quadtree_c *tree);
+	subsec_t *CreateSubsector(const quadtree_c *tree);
 	// put all the segs in each subsector into clockwise order, and renumber
 	// the seg indices.
 	//
@@ -600,20 +1188,40 @@ private:
 
 	// detection routines
 	void DetectOverlappingVertices() const;
+	void DetectOverlappingLines();
 	void DetectPolyobjSectors();
+	void MarkPolyobjSector(int sector);
 	
-	int EvalPartitionWorker(quadtree_c *tree, seg_t *part,
+	int EvalPartitionWorker(const quadtree_c *tree, int box, seg_t *part,
 								   int best_cost, eval_info_t *info);
-	int EvalPartition(quadtree_c *tree, seg_t *part, int best_cost);
-	seg_t *FindFastSeg(quadtree_c *tree);
-	bool PickNodeWorker(quadtree_c *part_list,
-						quadtree_c *tree, seg_t ** best, int *best_cost);
+	int EvalPartition(const quadtree_c *tree, seg_t *part, int best_cost);
+	seg_t *FindFastSeg(const quadtree_c *tree);
+	bool PickNodeWorker(const quadtree_c *tree, seg_t ** best, int *best_cost);
+	seg_t *PickNodeParallel(const quadtree_c *tree, const std::vector<seg_t *>& candidates,
+							int *best_cost);
+	int PickBudget(int depth) const;
 	// scan all the segs in the list, and choose the best seg to use as a
 	// partition line, returning it.  If no seg can be used, returns NULL.
 	// The 'depth' parameter is the current depth in the tree, used for
 	// computing the current progress.
 	//
-	seg_t *PickNode(quadtree_c *tree, int depth);
+	seg_t *PickNode(const quadtree_c *tree, int depth);
+
+	// incremental building
+	void PrepareHistory(seg_t *list);
+	void RecordHistory(node_t *root, double build_time);
+	seg_t *ReusePartition(const quadtree_c *tree, const bbox_t *bounds, int reuse);
+
+	// parallel node building
+	build_result_e BuildNodesParallel(seg_t *list, bbox_t *bounds,
+		node_t ** N, subsec_t ** S);
+	build_task_t *SpawnBuildTask(seg_t *lefts, seg_t *rights, child_t *child, int depth,
+		int reuse);
+	void StartBuildTask(build_task_t *task);
+	void RunBuildTask(build_task_t *task);
+	void FinishSubsector(subsec_t *sub);
+	build_result_e CheckBuildTask(const build_task_t *task) const;
+	void MergeBuildTask(build_task_t *task, bool in_order);
 	
 	/* ----- vertex routines ------------------------------- */
 	void VertexAddWallTip(vertex_t *vert, double dx, double dy,
@@ -641,6 +1249,9 @@ private:
 	int num_new_vert = 0;
 	int num_real_lines = 0;
 	int node_cur_index = 0;
+
+	// the MLF_IS_XXX flags of each linedef
+	std::vector<uint8_t> line_flags;
 	
 	std::vector<vertex_t *>  vertices;
 	std::vector<subsec_t *>  subsecs;
@@ -648,9 +1259,37 @@ private:
 	std::vector<node_t *>    nodes;
 	std::vector<walltip_t *> walltips;
 	
+	// where all of the above (and more) live, freed by FreeLevel()
+	level_arenas_t arenas;
+	quadtree_c quadtree;
+	
 	// internal storage of node building parameters
 	nodebuildinfo_t * cur_info = NULL;
 
+	// tasks of a parallel build
+	TaskGroup * build_group = NULL;
+
+	// when the building of the nodes began, for 'pick_time'
+	std::chrono::steady_clock::time_point nodes_start;
+
+	// what the earlier build chose, and the boxes around the segs which
+	// have been added or removed since (see bsp_history_t)
+	bsp_history_t prev_history;
+	std::vector<bbox_t> changed_boxes;
+	std::vector<std::array<double, 4>> cur_segs;
+	std::atomic<int> parts_reused = 0;
+	std::atomic<int> parts_picked = 0;
+
+	std::atomic<int> seg_splits = 0;
+	std::atomic<int> minisegs_made = 0;
+
+	// real segs before building the nodes, and those in a subsector so far
+	int initial_segs = 0;
+	std::atomic<int> segs_placed = 0;
+
+	std::atomic<int64_t> partitions_tried = 0;
+	std::atomic<int64_t> quad_boxes = 0;
+
 	const MapFormat format;
 	Wad_file& wad;
 	const Document& doc;
@@ -677,16 +1316,14 @@ private:
 #define LIMIT_GL_SSECT     0x000400
 #define LIMIT_GL_NODES     0x000800
 
+#define LIMIT_BLOCKMAP     0x001000
+
 
 //------------------------------------------------------------------------
 // ANALYZE : Analyzing level structures
 //------------------------------------------------------------------------
 
 
-// detection routines
-
-void DetectOverlappingLines(const Document &doc);
-
 // check whether a line with the given delta coordinates from this
 // vertex is open or closed.  If there exists a walltip at same
 // angle, it is closed, likewise if line is in void space.
@@ -770,8 +1407,6 @@ void AddMinisegs(seg_t *part,
     quadtree_c *left_quad, quadtree_c *right_list,
     intersection_t *cut_list);
 
-// free the quick allocation cut list
-void FreeQuickAllocCuts(void);
 
 
 //------------------------------------------------------------------------
@@ -781,9 +1416,6 @@ void FreeQuickAllocCuts(void);
 
 
 
-quadtree_c *TreeFromSegList(seg_t *list);
-
-
 // compute the height of the bsp tree, starting at 'node'.
 int ComputeBspHeight(node_t *node);
 
@@ -0,0 +1,368 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+//
+// The vector versions must give exactly the results of the scalar one
+// (which is the same as seg_t::PerpDist), otherwise the chosen nodes
+// would depend on the machine.  They only use IEEE multiply, subtract,
+// add and divide in the same order, and the build keeps the compiler
+// from fusing them (-ffp-contract=off on the BSP sources).
+//
+
+#include "bsp.h"
+#include "bsp_kernel.h"
+#include "Errors.h"
+#include "sys_debug.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__))
+#define SEG_KERNEL_SSE2  1
+#include <emmintrin.h>
+#endif
+
+#if defined(SEG_KERNEL_SSE2) && defined(__GNUC__)
+#define SEG_KERNEL_AVX2  1
+#include <immintrin.h>
+#endif
+
+
+namespace ajbsp
+{
+
+void seg_block_t::Clear()
+{
+	sx.clear();
+	sy.clear();
+	ex.clear();
+	ey.clear();
+	source_line.clear();
+	real.clear();
+	segs.clear();
+}
+
+
+void seg_block_t::Add(seg_t *seg, double _sx, double _sy, double _ex, double _ey,
+					  int _source_line, bool is_real)
+{
+	int index = Size();
+
+	if (index % 64 == 0)
+		real.push_back(0);
+
+	if (is_real)
+		real.back() |= (uint64_t)1 << (index % 64);
+
+	sx.push_back(_sx);
+	sy.push_back(_sy);
+	ex.push_back(_ex);
+	ey.push_back(_ey);
+	source_line.push_back(_source_line);
+	segs.push_back(seg);
+}
+
+
+uint64_t seg_block_t::RealBits(int first, int count) const
+{
+	int word  = first / 64;
+	int shift = first % 64;
+
+	uint64_t bits = real[word] >> shift;
+
+	if (shift > 0 && shift + count > 64)
+		bits |= real[word + 1] << (64 - shift);
+
+	if (count < 64)
+		bits &= ((uint64_t)1 << count) - 1;
+
+	return bits;
+}
+
+
+/* ----- scalar version ----------------------- */
+
+static inline void ClassifyOne(const seg_block_t &block, int i,
+							   const partition_line_t &part, double *a, double *b,
+							   uint64_t *right, uint64_t *left, int bit)
+{
+	double da = 0;
+	double db = 0;
+
+	if (block.source_line[i] != part.source_line)
+	{
+		da = (block.sx[i] * part.pdy - block.sy[i] * part.pdx + part.p_perp) / part.p_length;
+		db = (block.ex[i] * part.pdy - block.ey[i] * part.pdx + part.p_perp) / part.p_length;
+	}
+
+	a[bit] = da;
+	b[bit] = db;
+
+	if (da >= IFFY_LEN && db >= IFFY_LEN)
+		*right |= (uint64_t)1 << bit;
+	else if (da <= -IFFY_LEN && db <= -IFFY_LEN)
+		*left |= (uint64_t)1 << bit;
+}
+
+
+static void ClassifySegs_Scalar(const seg_block_t &block, int first, int count,
+								const partition_line_t &part, double *a, double *b,
+								uint64_t *right, uint64_t *left)
+{
+	*right = 0;
+	*left  = 0;
+
+	for (int k = 0 ; k < count ; k++)
+		ClassifyOne(block, first + k, part, a, b, right, left, k);
+}
+
+
+/* ----- SSE2 version (two segs at a time) ----------------------- */
+
+#ifdef SEG_KERNEL_SSE2
+
+static void ClassifySegs_SSE2(const seg_block_t &block, int first, int count,
+							  const partition_line_t &part, double *a, double *b,
+							  uint64_t *right, uint64_t *left)
+{
+	const __m128d pdx  = _mm_set1_pd(part.pdx);
+	const __m128d pdy  = _mm_set1_pd(part.pdy);
+	const __m128d perp = _mm_set1_pd(part.p_perp);
+	const __m128d len  = _mm_set1_pd(part.p_length);
+
+	const __m128d iffy     = _mm_set1_pd(IFFY_LEN);
+	const __m128d neg_iffy = _mm_set1_pd(-IFFY_LEN);
+
+	const int *source = &block.source_line[first];
+
+	uint64_t r_mask = 0;
+	uint64_t l_mask = 0;
+
+	int k = 0;
+
+	for ( ; k + 2 <= count ; k += 2)
+	{
+		int i = first + k;
+
+		__m128d x1 = _mm_loadu_pd(&block.sx[i]);
+		__m128d y1 = _mm_loadu_pd(&block.sy[i]);
+		__m128d x2 = _mm_loadu_pd(&block.ex[i]);
+		__m128d y2 = _mm_loadu_pd(&block.ey[i]);
+
+		__m128d va = _mm_div_pd(_mm_add_pd(_mm_sub_pd(_mm_mul_pd(x1, pdy), _mm_mul_pd(y1, pdx)), perp), len);
+		__m128d vb = _mm_div_pd(_mm_add_pd(_mm_sub_pd(_mm_mul_pd(x2, pdy), _mm_mul_pd(y2, pdx)), perp), len);
+
+		// segs of the partition's own linedef count as lying on it
+		__m128d same = _mm_castsi128_pd(_mm_set_epi64x(
+				-(int64_t)(source[k + 1] == part.source_line),
+				-(int64_t)(source[k]     == part.source_line)));
+
+		va = _mm_andnot_pd(same, va);
+		vb = _mm_andnot_pd(same, vb);
+
+		_mm_storeu_pd(&a[k], va);
+		_mm_storeu_pd(&b[k], vb);
+
+		int r = _mm_movemask_pd(_mm_and_pd(_mm_cmpge_pd(va, iffy), _mm_cmpge_pd(vb, iffy)));
+		int l = _mm_movemask_pd(_mm_and_pd(_mm_cmple_pd(va, neg_iffy), _mm_cmple_pd(vb, neg_iffy)));
+
+		r_mask |= (uint64_t)r << k;
+		l_mask |= (uint64_t)l << k;
+	}
+
+	*right = r_mask;
+	*left  = l_mask;
+
+	for ( ; k < count ; k++)
+		ClassifyOne(block, first + k, part, a, b, right, left, k);
+}
+
+#endif
+
+
+/* ----- AVX2 version (four segs at a time) ----------------------- */
+
+#ifdef SEG_KERNEL_AVX2
+
+__attribute__((target("avx2")))
+static void ClassifySegs_AVX2(const seg_block_t &block, int first, int count,
+							  const partition_line_t &part, double *a, double *b,
+							  uint64_t *right, uint64_t *left)
+{
+	const __m256d pdx  = _mm256_set1_pd(part.pdx);
+	const __m256d pdy  = _mm256_set1_pd(part.pdy);
+	const __m256d perp = _mm256_set1_pd(part.p_perp);
+	const __m256d len  = _mm256_set1_pd(part.p_length);
+
+	const __m256d iffy     = _mm256_set1_pd(IFFY_LEN);
+	const __m256d neg_iffy = _mm256_set1_pd(-IFFY_LEN);
+
+	const __m128i part_line = _mm_set1_epi32(part.source_line);
+
+	uint64_t r_mask = 0;
+	uint64_t l_mask = 0;
+
+	int k = 0;
+
+	for ( ; k + 4 <= count ; k += 4)
+	{
+		int i = first + k;
+
+		__m256d x1 = _mm256_loadu_pd(&block.sx[i]);
+		__m256d y1 = _mm256_loadu_pd(&block.sy[i]);
+		__m256d x2 = _mm256_loadu_pd(&block.ex[i]);
+		__m256d y2 = _mm256_loadu_pd(&block.ey[i]);
+
+		__m256d va = _mm256_div_pd(_mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(x1, pdy), _mm256_mul_pd(y1, pdx)), perp), len);
+		__m256d vb = _mm256_div_pd(_mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(x2, pdy), _mm256_mul_pd(y2, pdx)), perp), len);
+
+		// segs of the partition's own linedef count as lying on it
+		__m128i source = _mm_loadu_si128((const __m128i *)&block.source_line[i]);
+		__m256d same = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(_mm_cmpeq_epi32(source, part_line)));
+
+		va = _mm256_andnot_pd(same, va);
+		vb = _mm256_andnot_pd(same, vb);
+
+		_mm256_storeu_pd(&a[k], va);
+		_mm256_storeu_pd(&b[k], vb);
+
+		int r = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(va, iffy, _CMP_GE_OQ),
+												 _mm256_cmp_pd(vb, iffy, _CMP_GE_OQ)));
+		int l = _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(va, neg_iffy, _CMP_LE_OQ),
+												 _mm256_cmp_pd(vb, neg_iffy, _CMP_LE_OQ)));
+
+		r_mask |= (uint64_t)r << k;
+		l_mask |= (uint64_t)l << k;
+	}
+
+	*right = r_mask;
+	*left  = l_mask;
+
+	for ( ; k < count ; k++)
+		ClassifyOne(block, first + k, part, a, b, right, left, k);
+}
+
+#endif
+
+
+/* ----- dispatch ----------------------- */
+
+bool SegKernelSupported(seg_kernel_e kernel)
+{
+	switch (kernel)
+	{
+	case seg_kernel_e::scalar:
+		return true;
+
+	case seg_kernel_e::sse2:
+#ifdef SEG_KERNEL_SSE2
+		return true;
+#else
+		return false;
+#endif
+
+	case seg_kernel_e::avx2:
+#ifdef SEG_KERNEL_AVX2
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+
+	return false;
+}
+
+
+static seg_kernel_e BestSegKernel()
+{
+	if (SegKernelSupported(seg_kernel_e::avx2))
+		return seg_kernel_e::avx2;
+
+	if (SegKernelSupported(seg_kernel_e::sse2))
+		return seg_kernel_e::sse2;
+
+	return seg_kernel_e::scalar;
+}
+
+
+seg_kernel_e SegKernelInUse()
+{
+	static const seg_kernel_e best = BestSegKernel();
+
+	return best;
+}
+
+
+const char *SegKernelName(seg_kernel_e kernel)
+{
+	switch (kernel)
+	{
+	case seg_kernel_e::scalar: return "scalar";
+	case seg_kernel_e::sse2:   return "SSE2";
+	case seg_kernel_e::avx2:   return "AVX2";
+	}
+
+	return "?";
+}
+
+
+static inline void RunSegKernel(seg_kernel_e kernel, const seg_block_t &block, int first, int count,
+								const partition_line_t &part, double *a, double *b,
+								uint64_t *right, uint64_t *left)
+{
+	switch (kernel)
+	{
+#ifdef SEG_KERNEL_AVX2
+	case seg_kernel_e::avx2:
+		ClassifySegs_AVX2(block, first, count, part, a, b, right, left);
+		return;
+#endif
+
+#ifdef SEG_KERNEL_SSE2
+	case seg_kernel_e::sse2:
+		ClassifySegs_SSE2(block, first, count, part, a, b, right, left);
+		return;
+#endif
+
+	default:
+		ClassifySegs_Scalar(block, first, count, part, a, b, right, left);
+		return;
+	}
+}
+
+
+void ClassifySegs(seg_kernel_e kernel, const seg_block_t &block, int first, int count,
+				  const partition_line_t &part, double *a, double *b,
+				  uint64_t *right, uint64_t *left)
+{
+	SYS_ASSERT(count <= SEG_KERNEL_BATCH);
+	SYS_ASSERT(SegKernelSupported(kernel));
+
+	RunSegKernel(kernel, block, first, count, part, a, b, right, left);
+}
+
+
+void ClassifySegs(const seg_block_t &block, int first, int count,
+				  const partition_line_t &part, double *a, double *b,
+				  uint64_t *right, uint64_t *left)
+{
+	static const seg_kernel_e kernel = SegKernelInUse();
+
+	RunSegKernel(kernel, block, first, count, part, a, b, right, left);
+}
+
+}  // namespace ajbsp
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -0,0 +1,142 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_BSP_KERNEL_H__
+#define __EUREKA_BSP_KERNEL_H__
+
+#include <stdint.h>
+#include <vector>
+
+namespace ajbsp
+{
+
+struct seg_t;
+
+//
+// The segs of a quadtree, stored as a structure of arrays so a
+// partition candidate can be checked against several of them at once.
+// Each quadtree node owns a run of consecutive entries (its own seg
+// list, in list order).
+//
+struct seg_block_t
+{
+	std::vector<double> sx, sy;
+	std::vector<double> ex, ey;
+	std::vector<int> source_line;
+
+	// one bit per seg, set when the seg comes from a linedef
+	std::vector<uint64_t> real;
+
+	std::vector<seg_t *> segs;
+
+	int Size() const
+	{
+		return (int)segs.size();
+	}
+
+	void Clear();
+	void Add(seg_t *seg, double _sx, double _sy, double _ex, double _ey,
+			 int _source_line, bool is_real);
+
+	// real bits of 'count' (at most 64) segs from 'first'
+	uint64_t RealBits(int first, int count) const;
+};
+
+//
+// What the classifier needs to know about a partition line.  The
+// fields match those of seg_t.
+//
+struct partition_line_t
+{
+	double pdx, pdy;
+	double p_perp;
+	double p_length;
+
+	int source_line;
+};
+
+enum class seg_kernel_e
+{
+	scalar,
+	sse2,
+	avx2
+};
+
+// the most segs ClassifySegs() can handle in one call
+static constexpr int SEG_KERNEL_BATCH = 64;
+
+//
+// Classifies 'count' (at most SEG_KERNEL_BATCH) segs of the block from
+// 'first' against the partition.  Stores their perpendicular distances
+// in 'a' and 'b' (as seg_t::PerpDist() computes them, or zero for segs
+// of the partition's own linedef), and returns in 'right' and 'left'
+// the bit masks of the segs lying at least IFFY_LEN clear of it.  Those
+// need nothing more than a left/right count; all others still have to
+// go through the full checks.
+//
+void ClassifySegs(const seg_block_t &block, int first, int count,
+				  const partition_line_t &part, double *a, double *b,
+				  uint64_t *right, uint64_t *left);
+
+// same, using a specific implementation (for testing)
+void ClassifySegs(seg_kernel_e kernel, const seg_block_t &block, int first, int count,
+				  const partition_line_t &part, double *a, double *b,
+				  uint64_t *right, uint64_t *left);
+
+// whether that implementation can be used on this machine
+bool SegKernelSupported(seg_kernel_e kernel);
+
+// the implementation ClassifySegs() picked, and its name
+seg_kernel_e SegKernelInUse();
+const char *SegKernelName(seg_kernel_e kernel);
+
+inline int CountBits(uint64_t bits)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(bits);
+#else
+	int total = 0;
+
+	for ( ; bits ; bits &= bits - 1)
+		total++;
+
+	return total;
+#endif
+}
+
+// index of the lowest set bit, which must exist
+inline int FirstBit(uint64_t bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(bits);
+#else
+	int k = 0;
+
+	while (! (bits & ((uint64_t)1 << k)))
+		k++;
+
+	return k;
+#endif
+}
+
+} // namespace ajbsp
+
+#endif /* __EUREKA_BSP_KERNEL_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
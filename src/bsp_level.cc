@@ -22,6 +22,10 @@
 #include "Instance.h"
 #include "w_rawdef.h"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
 #include <zlib.h>
 
 
@@ -35,7 +39,9 @@ namespace ajbsp
 
 #define BLOCK_LIMIT  16000
 
-#define DUMMY_DUP  0xFFFF
+// the blockmap origins tried, moving back from the map's corner
+#define BLOCK_ORIGIN_RANGE  128
+#define BLOCK_ORIGIN_STEP   8
 
 
 int CheckLinedefInsideBox(int xmin, int ymin, int xmax, int ymax,
@@ -111,57 +117,44 @@ int CheckLinedefInsideBox(int xmin, int ymin, int xmax, int ymax,
 
 /* ----- create blockmap ------------------------------------ */
 
-#define BK_NUM    0
-#define BK_MAX    1
-#define BK_XOR    2
-#define BK_FIRST  3
-
-#define BK_QUANTUM  32
-
-void LevelData::Block::Add(int blk_num, int line_index)
+//
+// The lines which go into the blockmap, with the coordinates it uses
+//
+void LevelData::Block::FindLines(const Document &doc, std::vector<line_t> &lines)
 {
-	uint16_t *cur = block_lines[blk_num];
+	lines.clear();
 
-# if DEBUG_BLOCKMAP
-	gLog.debugPrintf("Block %d has line %d\n", blk_num, line_index);
-# endif
-
-	if (blk_num < 0 || blk_num >= block_count)
-		BugError("BlockAdd: bad block number %d\n", blk_num);
-
-	if (! cur)
+	for (int i=0 ; i < doc.numLinedefs() ; i++)
 	{
-		// create empty block
-		block_lines[blk_num] = cur = (uint16_t *)UtilCalloc(BK_QUANTUM * sizeof(uint16_t));
-		cur[BK_NUM] = 0;
-		cur[BK_MAX] = BK_QUANTUM;
-		cur[BK_XOR] = 0x1234;
-	}
+		const auto L = doc.linedefs[i];
 
-	if (BK_FIRST + cur[BK_NUM] == cur[BK_MAX])
-	{
-		// no more room, so allocate some more...
-		cur[BK_MAX] += BK_QUANTUM;
+		// ignore zero-length lines
+		if (doc.isZeroLength(*L))
+			continue;
 
-		block_lines[blk_num] = cur = (uint16_t *)UtilRealloc(cur, cur[BK_MAX] * sizeof(uint16_t));
-	}
+		line_t line;
 
-	// compute new checksum
-	cur[BK_XOR] = static_cast<uint16_t>(((cur[BK_XOR] << 4) | (cur[BK_XOR] >> 12)) ^ line_index);
+		line.index = i;
+		line.x1 = (int) doc.getStart(*L).x();
+		line.y1 = (int) doc.getStart(*L).y();
+		line.x2 = (int) doc.getEnd(*L).x();
+		line.y2 = (int) doc.getEnd(*L).y();
 
-	cur[BK_FIRST + cur[BK_NUM]] = LE_U16(line_index);
-	cur[BK_NUM]++;
+		lines.push_back(line);
+	}
 }
 
 
-void LevelData::Block::AddLine(int line_index, const Document &doc)
+//
+// Calls func(blk_num) for every block the line touches
+//
+template<typename F>
+void LevelData::Block::ForEachBlock(const line_t &line, F &&func) const
 {
-	const auto L = doc.linedefs[line_index];
-
-	int x1 = (int) doc.getStart(*L).x();
-	int y1 = (int) doc.getStart(*L).y();
-	int x2 = (int) doc.getEnd(*L).x();
-	int y2 = (int) doc.getEnd(*L).y();
+	int x1 = line.x1;
+	int y1 = line.y1;
+	int x2 = line.x2;
+	int y2 = line.y2;
 
 	int bx1 = (std::min(x1,x2) - block_x) / 128;
 	int by1 = (std::min(y1,y2) - block_y) / 128;
@@ -171,7 +164,7 @@ void LevelData::Block::AddLine(int line_index, const Document &doc)
 	int bx, by;
 
 # if DEBUG_BLOCKMAP
-	gLog.debugPrintf("BlockAddLine: %d (%d,%d) -> (%d,%d)\n", line_index,
+	gLog.debugPrintf("BlockAddLine: %d (%d,%d) -> (%d,%d)\n", line.index,
 			x1, y1, x2, y2);
 # endif
 
@@ -188,10 +181,7 @@ void LevelData::Block::AddLine(int line_index, const Document &doc)
 	if (by1 == by2)
 	{
 		for (bx=bx1 ; bx <= bx2 ; bx++)
-		{
-			int blk_num = by1 * block_w + bx;
-			Add(blk_num, line_index);
-		}
+			func(by1 * block_w + bx);
 		return;
 	}
 
@@ -199,10 +189,7 @@ void LevelData::Block::AddLine(int line_index, const Document &doc)
 	if (bx1 == bx2)
 	{
 		for (by=by1 ; by <= by2 ; by++)
-		{
-			int blk_num = by * block_w + bx1;
-			Add(blk_num, line_index);
-		}
+			func(by * block_w + bx1);
 		return;
 	}
 
@@ -211,160 +198,154 @@ void LevelData::Block::AddLine(int line_index, const Document &doc)
 	for (by=by1 ; by <= by2 ; by++)
 	for (bx=bx1 ; bx <= bx2 ; bx++)
 	{
-		int blk_num = by * block_w + bx;
-
 		int minx = block_x + bx * 128;
 		int miny = block_y + by * 128;
 		int maxx = minx + 127;
 		int maxy = miny + 127;
 
 		if (CheckLinedefInsideBox(minx, miny, maxx, maxy, x1, y1, x2, y2))
-		{
-			Add(blk_num, line_index);
-		}
+			func(by * block_w + bx);
 	}
 }
 
 
-void LevelData::Block::CreateMap(const Document &doc)
+void LevelData::Block::SetOrigin(int x, int y)
 {
-	block_lines = (uint16_t **) UtilCalloc(block_count * sizeof(uint16_t *));
+	block_x = x;
+	block_y = y;
 
-	for (int i=0 ; i < doc.numLinedefs() ; i++)
-	{
-		// ignore zero-length lines
-		if (doc.isZeroLength(*doc.linedefs[i]))
-			continue;
+	block_w = ((map_maxx - block_x) / 128) + 1;
+	block_h = ((map_maxy - block_y) / 128) + 1;
 
-		AddLine(i, doc);
-	}
+	block_count = block_w * block_h;
 }
 
 
-int LevelData::Block::Compare(const void *p1, const void *p2) const
+//
+// Two passes over the lines: the first counts the lines of each block,
+// which gives where each block list starts, the second fills them in.
+//
+void LevelData::Block::CreateMap(const std::vector<line_t> &lines)
 {
-	int blk_num1 = ((const uint16_t *) p1)[0];
-	int blk_num2 = ((const uint16_t *) p2)[0];
+	block_starts.assign(block_count + 1, 0);
 
-	const uint16_t *A = block_lines[blk_num1];
-	const uint16_t *B = block_lines[blk_num2];
+	for (const line_t &line : lines)
+	{
+		ForEachBlock(line, [this](int blk_num)
+		{
+			block_starts[blk_num + 1]++;
+		});
+	}
 
-	if (A == B)
-		return 0;
+	for (int i=0 ; i < block_count ; i++)
+		block_starts[i + 1] += block_starts[i];
 
-	if (A == NULL) return -1;
-	if (B == NULL) return +1;
+	block_lines.resize(block_starts[block_count]);
 
-	if (A[BK_NUM] != B[BK_NUM])
-	{
-		return A[BK_NUM] - B[BK_NUM];
-	}
+	std::vector<uint32_t> fill(block_starts.begin(), block_starts.end() - 1);
 
-	if (A[BK_XOR] != B[BK_XOR])
+	for (const line_t &line : lines)
 	{
-		return A[BK_XOR] - B[BK_XOR];
+		ForEachBlock(line, [this, &fill, &line](int blk_num)
+		{
+			block_lines[fill[blk_num]++] = static_cast<uint16_t>(line.index);
+		});
 	}
-
-	return memcmp(A+BK_FIRST, B+BK_FIRST, A[BK_NUM] * sizeof(uint16_t));
 }
 
 
+//
+// Find where each block list goes in the lump.  Empty blocks all use
+// the null block, and identical lists are only stored once (they are
+// found with a hash table).  This also detects BLOCKMAP overflow.
+//
 void LevelData::Block::CompressMap()
 {
-	int i;
-	int cur_offset;
-	int dup_count=0;
-   (void)dup_count;
-
-	int orig_size, new_size;
+	block_ptrs.assign(block_count, 0);
+	block_order.clear();
 
-	block_ptrs = (uint16_t *)UtilCalloc(block_count * sizeof(uint16_t));
-	block_dups = (uint16_t *)UtilCalloc(block_count * sizeof(uint16_t));
+	// the hash table has the first block with each list, or -1
+	int table_size = 64;
 
-	// sort duplicate-detecting array.  After the sort, all duplicates
-	// will be next to each other.  The duplicate array gives the order
-	// of the blocklists in the BLOCKMAP lump.
-
-	for (i=0 ; i < block_count ; i++)
-		block_dups[i] = static_cast<uint16_t>(i);
-	
-	std::sort(block_dups, block_dups + block_count, [this](uint16_t a, uint16_t b)
-			  {
-		return Compare(&a, &b) < 0;
-	});
+	while (table_size < block_count * 2)
+		table_size *= 2;
 
-	// scan duplicate array and build up offset array
+	std::vector<int> table(table_size, -1);
+	std::vector<uint32_t> hashes(block_count);
 
-	cur_offset = 4 + block_count + 2;
+	int null_offset = 4 + block_count;
+	int cur_offset  = null_offset + 2;
+	int orig_size   = cur_offset;
 
-	orig_size = 4 + block_count;
-	new_size  = cur_offset;
-
-	for (i=0 ; i < block_count ; i++)
+	for (int blk_num=0 ; blk_num < block_count ; blk_num++)
 	{
-		int blk_num = block_dups[i];
-		int count;
+		uint32_t first = block_starts[blk_num];
+		uint32_t count = block_starts[blk_num + 1] - first;
 
-		// empty block ?
-		if (block_lines[blk_num] == NULL)
+		if (count == 0)
 		{
-			block_ptrs[blk_num] = static_cast<uint16_t>(4 + this->block_count);
-			block_dups[i] = DUMMY_DUP;
-
-			orig_size += 2;
+			block_ptrs[blk_num] = null_offset;
 			continue;
 		}
 
-		count = 2 + block_lines[blk_num][BK_NUM];
+		orig_size += count + 2;
 
-		// duplicate ?  Only the very last one of a sequence of duplicates
-		// will update the current offset value.
+		// 32-bit FNV-1a
+		uint32_t hash = 0x811c9dc5;
 
-		if (i+1 < this->block_count &&
-				Compare(block_dups + i, block_dups + i+1) == 0)
+		for (uint32_t k=0 ; k < count ; k++)
 		{
-			block_ptrs[blk_num] = static_cast<uint16_t>(cur_offset);
-			block_dups[i] = DUMMY_DUP;
+			hash ^= block_lines[first + k];
+			hash *= 0x01000193;
+		}
 
-			// free the memory of the duplicated block
-			UtilFree(block_lines[blk_num]);
-			block_lines[blk_num] = NULL;
+		hashes[blk_num] = hash;
 
-			dup_count++;
+		int slot = (int)(hash & (table_size - 1));
 
-			orig_size += count;
-			continue;
-		}
+		for (;;)
+		{
+			int other = table[slot];
 
-		// OK, this block is either the last of a series of duplicates, or
-		// just a singleton.
+			if (other < 0)
+			{
+				table[slot] = blk_num;
 
-		block_ptrs[blk_num] = static_cast<uint16_t>(cur_offset);
+				block_ptrs[blk_num] = cur_offset;
+				block_order.push_back(blk_num);
 
-		cur_offset += count;
+				cur_offset += count + 2;
+				break;
+			}
 
-		orig_size += count;
-		new_size  += count;
-	}
+			uint32_t other_first = block_starts[other];
 
-	if (cur_offset > 65535)
-	{
-		overflowed = true;
-		return;
+			if (hashes[other] == hash &&
+				block_starts[other + 1] - other_first == count &&
+				std::equal(&block_lines[first], &block_lines[first] + count,
+						   &block_lines[other_first]))
+			{
+				block_ptrs[blk_num] = block_ptrs[other];
+				break;
+			}
+
+			slot = (slot + 1) & (table_size - 1);
+		}
 	}
 
 # if DEBUG_BLOCKMAP
-	gLog.debugPrintf("Blockmap: Last ptr = %d  duplicates = %d\n",
-			cur_offset, dup_count);
+	gLog.debugPrintf("Blockmap: Last ptr = %d  lists = %d\n",
+			cur_offset, (int)block_order.size());
 # endif
 
-	compression = (orig_size - new_size) * 100 / orig_size;
+	lump_size = cur_offset * 2;
 
-	// there's a tiny chance of new_size > orig_size
-	if (compression < 0)
-		compression = 0;
+	overflowed = (cur_offset > 65535);
+
+	compression = (orig_size - cur_offset) * 100 / orig_size;
 }
 
+
 void LevelData::WriteBlockmap() const
 {
 	int i;
@@ -400,19 +381,20 @@ void LevelData::WriteBlockmap() const
 	lump.Write(null_block, sizeof(null_block));
 
 	// handle each block list
-	for (i=0 ; i < block.block_count ; i++)
+	std::vector<uint16_t> list;
+
+	for (int blk_num : block.block_order)
 	{
-		int blk_num = block.block_dups[i];
+		uint32_t first = block.block_starts[blk_num];
+		uint32_t count = block.block_starts[blk_num + 1] - first;
 
-		// ignore duplicate or empty blocks
-		if (blk_num == DUMMY_DUP)
-			continue;
+		list.resize(count);
 
-		uint16_t *blk = block.block_lines[blk_num];
-		SYS_ASSERT(blk);
+		for (uint32_t k=0 ; k < count ; k++)
+			list[k] = LE_U16(block.block_lines[first + k]);
 
 		lump.Write(&m_zero, sizeof(uint16_t));
-		lump.Write(blk + BK_FIRST, blk[BK_NUM] * sizeof(uint16_t));
+		lump.Write(list.data(), count * sizeof(uint16_t));
 		lump.Write(&m_neg1, sizeof(uint16_t));
 	}
 }
@@ -420,15 +402,10 @@ void LevelData::WriteBlockmap() const
 
 void LevelData::Block::FreeMap()
 {
-	for (int i=0 ; i < block_count ; i++)
-	{
-		if (block_lines[i])
-			UtilFree(block_lines[i]);
-	}
-
-	UtilFree(block_lines);
-	UtilFree(block_ptrs);
-	UtilFree(block_dups);
+	block_starts.clear();
+	block_lines.clear();
+	block_ptrs.clear();
+	block_order.clear();
 }
 
 
@@ -480,13 +457,11 @@ void LevelData::Block::InitMap(const Document &doc)
 	PrintDetail("Map goes from (%d,%d) to (%d,%d)\n",
 			map_bbox.minx, map_bbox.miny, map_bbox.maxx, map_bbox.maxy);
 
-	block_x = map_bbox.minx - (map_bbox.minx & 0x7);
-	block_y = map_bbox.miny - (map_bbox.miny & 0x7);
+	map_maxx = map_bbox.maxx;
+	map_maxy = map_bbox.maxy;
 
-	block_w = ((map_bbox.maxx - block_x) / 128) + 1;
-	block_h = ((map_bbox.maxy - block_y) / 128) + 1;
-
-	block_count = block_w * block_h;
+	SetOrigin(map_bbox.minx - (map_bbox.minx & 0x7),
+			  map_bbox.miny - (map_bbox.miny & 0x7));
 }
 
 //
@@ -501,19 +476,71 @@ void LevelData::PutBlockmap()
 		return;
 	}
 
-	block.overflowed = false;
+	std::vector<Block::line_t> lines;
 
-	// initial phase: create internal blockmap containing the index of
-	// all lines in each block.
+	Block::FindLines(doc, lines);
 
-	block.CreateMap(doc);
-
-	// -AJA- second phase: compress the blockmap.  We do this by sorting
-	//       the blocks, which is a typical way to detect duplicates in
-	//       a large list.  This also detects BLOCKMAP overflow.
+	int base_x = block.block_x;
+	int base_y = block.block_y;
 
+	block.CreateMap(lines);
 	block.CompressMap();
 
+	int corner_size = block.overflowed ? INT_MAX : block.lump_size;
+
+	// the origin just below the map's corner is not always the best
+	// one.  Moving it back (by up to one block) changes which lines
+	// share a block, so when asked to, or when the corner overflows,
+	// we try each of those origins and keep the one giving the
+	// smallest lump.
+
+	if (cur_info->blockmap_search || block.overflowed)
+	{
+		const int steps = BLOCK_ORIGIN_RANGE / BLOCK_ORIGIN_STEP;
+
+		std::vector<int> sizes(steps * steps);
+
+		sizes[0] = corner_size;
+
+		RunParallel(cur_info, steps * steps - 1, [this, &lines, &sizes](int k)
+		{
+			int i = k + 1;
+
+			int x = block.block_x - (i % steps) * BLOCK_ORIGIN_STEP;
+			int y = block.block_y - (i / steps) * BLOCK_ORIGIN_STEP;
+
+			sizes[i] = INT_MAX;
+
+			// the header only has room for 16 bits
+			if (x < SHRT_MIN || y < SHRT_MIN)
+				return;
+
+			Block trial;
+
+			trial.map_maxx = block.map_maxx;
+			trial.map_maxy = block.map_maxy;
+
+			trial.SetOrigin(x, y);
+			trial.CreateMap(lines);
+			trial.CompressMap();
+
+			if (! trial.overflowed)
+				sizes[i] = trial.lump_size;
+		});
+
+		// the first smallest one, so the corner wins a tie
+		int best = (int)(std::min_element(sizes.begin(), sizes.end()) - sizes.begin());
+
+		if (best != 0 && sizes[best] != INT_MAX)
+		{
+			block.SetOrigin(base_x - (best % steps) * BLOCK_ORIGIN_STEP,
+							base_y - (best / steps) * BLOCK_ORIGIN_STEP);
+
+			block.CreateMap(lines);
+			block.CompressMap();
+		}
+	}
+
 	// final phase: write it out in the correct format
 
 	if (block.overflowed)
@@ -521,6 +548,8 @@ void LevelData::PutBlockmap()
 		// leave an empty blockmap lump
 		CreateLevelLump("BLOCKMAP");
 
+		cur_info->stats.overflows |= LIMIT_BLOCKMAP;
+
 		Warning("Blockmap overflowed (lump will be empty)\n");
 	}
 	else
@@ -529,9 +558,23 @@ void LevelData::PutBlockmap()
 
 		PrintDetail("Completed blockmap, size %dx%d (compression: %d%%)\n",
 				block.block_w, block.block_h, block.compression);
+
+		if (corner_size == INT_MAX)
+		{
+			PrintMsg("Blockmap origin moved back by (%d,%d) to avoid overflow\n",
+					base_x - block.block_x, base_y - block.block_y);
+		}
+		else if (block.lump_size < corner_size)
+		{
+			PrintMsg("Blockmap origin moved back by (%d,%d), saving %d bytes\n",
+					base_x - block.block_x, base_y - block.block_y, corner_size - block.lump_size);
+		}
 	}
 
 	block.FreeMap();
+
+	// back to the corner, for another build
+	block.SetOrigin(base_x, base_y);
 }
 
 
@@ -663,9 +706,10 @@ void LevelData::Reject_WriteLump() const
 //
 // build the reject table and write it into the REJECT lump
 //
-// For now we only do very basic reject processing, limited to
+// Normally we only do very basic reject processing, limited to
 // determining all isolated groups of sectors (islands that are
-// surrounded by void space).
+// surrounded by void space).  The full processing also finds the
+// sectors which cannot see each other (see bsp_reject.cc).
 //
 void LevelData::PutReject()
 {
@@ -678,7 +722,13 @@ void LevelData::PutReject()
 
 	rej.Init(doc);
 	rej.GroupSectors(doc);
-	rej.ProcessSectors(doc);
+
+	int simple = 0;
+
+	if (cur_info->full_reject)
+		simple = rej.ProcessSight(doc, cur_info);
+	else
+		rej.ProcessSectors(doc);
 
 # if DEBUG_REJECT
 	Reject_DebugGroups();
@@ -687,7 +737,19 @@ void LevelData::PutReject()
 	Reject_WriteLump();
 	rej.Free();
 
-	PrintDetail("Added simple reject lump\n");
+	if (! cur_info->full_reject)
+	{
+		PrintDetail("Added simple reject lump\n");
+	}
+	else if (simple > 0 && ! cur_info->cancelled)
+	{
+		Warning("Reject took too long, %d of %d sectors only got simple processing\n",
+				simple, doc.numSectors());
+	}
+	else
+	{
+		PrintDetail("Added full reject lump\n");
+	}
 }
 
 
@@ -699,86 +761,88 @@ void LevelData::PutReject()
 // Note: ZDoom format support based on code (C) 2002,2003 Randy Heit
 
 
-#define ALLOC_BLKNUM  1024
-
-
 /* ----- allocation routines ---------------------------- */
 
+// [ while building nodes in parallel, these go to the current task
+//   until it is merged, see MergeBuildTask() ]
+
 vertex_t *LevelData::NewVertex()
 {
-	vertex_t *V = (vertex_t *) UtilCalloc(sizeof(vertex_t));
-	vertices.push_back(V);
+	vertex_t *V = Arenas().vertices.Alloc();
+	if (cur_build_task)
+		cur_build_task->vertices.push_back(V);
+	else
+		vertices.push_back(V);
 	return V;
 }
 
 seg_t *LevelData::NewSeg()
 {
-	seg_t *S = (seg_t *) UtilCalloc(sizeof(seg_t));
-	segs.push_back(S);
+	seg_t *S = Arenas().segs.Alloc();
+	if (cur_build_task)
+		cur_build_task->segs.push_back(S);
+	else
+		segs.push_back(S);
 	return S;
 }
 
 subsec_t *LevelData::NewSubsec()
 {
-	subsec_t *S = (subsec_t *) UtilCalloc(sizeof(subsec_t));
-	subsecs.push_back(S);
+	subsec_t *S = Arenas().subsecs.Alloc();
+	if (cur_build_task)
+		cur_build_task->subsecs.push_back(S);
+	else
+		subsecs.push_back(S);
 	return S;
 }
 
 node_t *LevelData::NewNode()
 {
-	node_t *N = (node_t *) UtilCalloc(sizeof(node_t));
-	nodes.push_back(N);
+	node_t *N = Arenas().nodes.Alloc();
+	if (cur_build_task)
+		cur_build_task->nodes.push_back(N);
+	else
+		nodes.push_back(N);
 	return N;
 }
 
 walltip_t *LevelData::NewWallTip()
 {
-	walltip_t *WT = (walltip_t *) UtilCalloc(sizeof(walltip_t));
-	walltips.push_back(WT);
+	walltip_t *WT = Arenas().walltips.Alloc();
+	if (cur_build_task)
+		cur_build_task->walltips.push_back(WT);
+	else
+		walltips.push_back(WT);
 	return WT;
 }
 
 
 /* ----- free routines ---------------------------- */
 
+// [ the memory itself belongs to the arenas, see FreeLevel() ]
+
 void LevelData::FreeVertices()
 {
-	for (unsigned int i = 0 ; i < vertices.size() ; i++)
-		UtilFree((void *) vertices[i]);
-
 	vertices.clear();
 }
 
 void LevelData::FreeSegs()
 {
-	for (unsigned int i = 0 ; i < segs.size() ; i++)
-		UtilFree((void *) segs[i]);
-
 	segs.clear();
 }
 
 void LevelData::FreeSubsecs()
 {
-	for (unsigned int i = 0 ; i < subsecs.size() ; i++)
-		UtilFree((void *) subsecs[i]);
-
 	subsecs.clear();
 }
 
 void LevelData::FreeNodes()
 {
-	for (unsigned int i = 0 ; i < nodes.size() ; i++)
-		UtilFree((void *) nodes[i]);
-
 	nodes.clear();
 }
 
 void LevelData::FreeWallTips()
 {
-	for (unsigned int i = 0 ; i < walltips.size() ; i++)
-		UtilFree((void *) walltips[i]);
-
 	walltips.clear();
 }
 
@@ -854,7 +918,7 @@ static const uint8_t *lev_v5_magic = (uint8_t *) "gNd5";
 
 void LevelData::MarkOverflow(int flags)
 {
-	// flags are ignored
+	cur_info->stats.overflows |= flags;
 
 	overflows++;
 }
@@ -1333,7 +1397,7 @@ void LevelData::SortSegs()
 	// remove unwanted segs
 	while (segs.size() > 0 && segs.back()->index == SEG_IS_GARBAGE)
 	{
-		UtilFree((void *) segs.back());
+		arenas.segs.Free(segs.back());
 		segs.pop_back();
 	}
 }
@@ -1342,6 +1406,18 @@ void LevelData::SortSegs()
 /* ----- ZDoom format writing --------------------------- */
 
 
+//
+// Compressed nodes are deflated in blocks of this many bytes, each on a
+// thread of its own when the build has them (like pigz does).  Every block
+// starts with the 32 kB before it as its dictionary, and they are joined
+// into one ordinary zlib stream.  The blocks, and so the output, do not
+// depend on the number of threads.
+//
+#define ZLIB_BLOCK_SIZE  (128 * 1024)
+
+#define ZLIB_WINDOW_SIZE  (32 * 1024)
+
+
 class ZLibContext
 {
 public:
@@ -1356,7 +1432,9 @@ public:
 			}
 		};
 
-		Compression();
+		// negative window bits give raw deflate data, without the zlib
+		// header and checksum
+		explicit Compression(int window_bits = MAX_WBITS);
 		~Compression();
 		Compression(const Compression& other) = delete;
 		Compression& operator = (const Compression& other) = delete;
@@ -1366,6 +1444,11 @@ public:
 			return ::deflate(&stream, flush);
 		}
 
+		int setDictionary(const Bytef *dict, uInt length)
+		{
+			return ::deflateSetDictionary(&stream, dict, length);
+		}
+
 		void setNextOut(Bytef* out, uInt outSize) noexcept
 		{
 			stream.next_out = out;
@@ -1392,21 +1475,46 @@ public:
 		z_stream stream{};
 	};
 
-	ZLibContext(bool compress, std::vector<byte> &data);
+	// the blocks are shared out to the threads of the build, if any
+	ZLibContext(bool compress, std::vector<byte> &data, const nodebuildinfo_t *info = NULL);
 	
 	void appendLump(const void *data, int length) noexcept(false);
 	void finishLump() noexcept(false);
+
+	size_t bytesIn() const noexcept
+	{
+		return bytes_in;
+	}
+
+	int numBlocks() const noexcept
+	{
+		return num_blocks;
+	}
+
+	// seconds spent deflating
+	double deflateTime() const noexcept
+	{
+		return deflate_time;
+	}
 	
 private:
+	void deflateBlock(size_t start, size_t end, bool last, std::vector<byte> &out) const noexcept(false);
 
 	std::vector<byte> &out_data;
-	tl::optional<Compression> compression;
-	Bytef out_buffer[1024] = {};
+	const nodebuildinfo_t *info;
+	bool compress;
+	size_t bytes_in = 0;
+
+	// everything to be compressed, which happens in finishLump()
+	std::vector<byte> in_data;
+
+	int num_blocks = 0;
+	double deflate_time = 0;
 };
 
-ZLibContext::Compression::Compression()
+ZLibContext::Compression::Compression(int window_bits)
 {
-	int result = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+	int result = deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8, Z_DEFAULT_STRATEGY);
 	if (result != Z_OK)
 		throw Exception(result, "Trouble setting up zlib compression");
 }
@@ -1414,86 +1522,140 @@ ZLibContext::Compression::Compression()
 ZLibContext::Compression::~Compression()
 {
 	int result = deflateEnd(&stream);
-	if (result != Z_OK)
+	if (result != Z_OK && result != Z_DATA_ERROR)
 		gLog.printf("Error ending zlib compression: %d\n", result);
 }
 
-ZLibContext::ZLibContext(bool compress, std::vector<byte> &data) : out_data(data)
+ZLibContext::ZLibContext(bool compress, std::vector<byte> &data, const nodebuildinfo_t *info) :
+	out_data(data), info(info), compress(compress)
 {
-	if(!compress)
-		return;
-	
-	compression.emplace();
-	compression->setNextOut(out_buffer, sizeof(out_buffer));
 }
 
 void ZLibContext::appendLump(const void *data, int length) noexcept(false)
 {
-	if (! compression)
-	{
-		auto bdata = static_cast<const byte *>(data);
+	bytes_in += length;
+
+	auto bdata = static_cast<const byte *>(data);
+
+	if (! compress)
 		out_data.insert(out_data.end(), bdata, bdata + length);
-		return;
-	}
+	else
+		in_data.insert(in_data.end(), bdata, bdata + length);
+}
 
-	compression->setNextIn(const_cast<Bytef*>(static_cast<const Bytef*>(data)), length);
+//
+// Deflates in_data[start, end) as raw deflate data.  All but the last
+// block end on a byte boundary (with a sync flush), so the next block can
+// simply follow on.
+//
+void ZLibContext::deflateBlock(size_t start, size_t end, bool last, std::vector<byte> &out) const noexcept(false)
+{
+	Compression compression(-MAX_WBITS);
 
-	while (compression->getAvailIn() > 0)
+	if (start > 0)
 	{
-		int err = compression->deflate(Z_NO_FLUSH);
+		size_t dict = std::min(start, (size_t)ZLIB_WINDOW_SIZE);
+
+		int err = compression.setDictionary(in_data.data() + start - dict, (uInt)dict);
 		if (err != Z_OK)
-		{
-			throw Compression::Exception(err, SString::printf("Trouble compressing %d bytes (zlib)", length));
-		}
+			throw Compression::Exception(err, "Trouble setting the zlib dictionary");
+	}
 
-		if (compression->getAvailOut() == 0)
-		{
-			out_data.insert(out_data.end(), out_buffer, out_buffer + sizeof(out_buffer));
+	compression.setNextIn(const_cast<Bytef *>(in_data.data() + start), (uInt)(end - start));
 
-			compression->setNextOut(out_buffer, sizeof(out_buffer));
-		}
+	int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+
+	size_t done = 0;
+
+	for (;;)
+	{
+		out.resize(done + (end - start) / 2 + 1024);
+
+		compression.setNextOut(out.data() + done, (uInt)(out.size() - done));
+
+		int err = compression.deflate(flush);
+
+		done = out.size() - compression.getAvailOut();
+
+		if (err == Z_STREAM_END)
+			break;
+
+		if (err != Z_OK && err != Z_BUF_ERROR)
+			throw Compression::Exception(err, SString::printf("Trouble compressing %d bytes (zlib)", (int)(end - start)));
+
+		// a flush is complete when there was room left over
+		if (! last && compression.getAvailIn() == 0 && compression.getAvailOut() > 0)
+			break;
 	}
+
+	out.resize(done);
 }
 
 void ZLibContext::finishLump() noexcept(false)
 {
-	if (! compression)
-	{
+	if (! compress)
 		return;
-	}
 
-	int left_over;
+	auto start_time = std::chrono::steady_clock::now();
 
-	// ASSERT(zout_stream.avail_out > 0)
+	num_blocks = std::max(1, (int)((in_data.size() + ZLIB_BLOCK_SIZE - 1) / ZLIB_BLOCK_SIZE));
 
-	compression->setNextIn(Z_NULL, 0);
+	std::vector<std::vector<byte>> blocks(num_blocks);
+	std::vector<uLong> checks(num_blocks);
+	std::vector<int> errors(num_blocks, Z_OK);
 
-	for (;;)
+	auto deflate_one = [this, &blocks, &checks, &errors](int b)
 	{
-		int err = compression->deflate(Z_FINISH);
+		size_t start = (size_t)b * ZLIB_BLOCK_SIZE;
+		size_t end   = std::min(start + ZLIB_BLOCK_SIZE, in_data.size());
 
-		if (err == Z_STREAM_END)
-			break;
+		checks[b] = adler32(adler32(0, Z_NULL, 0), in_data.data() + start, (uInt)(end - start));
 
-		if (err != Z_OK)
+		try
 		{
-			throw Compression::Exception(err, "Trouble finishing compression (zlib)");
+			deflateBlock(start, end, b == num_blocks - 1, blocks[b]);
 		}
+		catch (const Compression::Exception &)
+		{
+			errors[b] = Z_STREAM_ERROR;
+		}
+	};
 
-		if (compression->getAvailOut() == 0)
+	if (info && num_blocks > 1)
+		RunParallel(info, num_blocks, deflate_one);
+	else
+		for (int b = 0 ; b < num_blocks ; b++)
+			deflate_one(b);
+
+	for (int err : errors)
+		if (err != Z_OK)
+			throw Compression::Exception(err, "Trouble compressing a block (zlib)");
+
+	// the zlib header: deflate with a 32 kB window, default level
+	out_data.push_back(0x78);
+	out_data.push_back(0x9C);
+
+	uLong check = checks[0];
+
+	for (int b = 0 ; b < num_blocks ; b++)
+	{
+		out_data.insert(out_data.end(), blocks[b].begin(), blocks[b].end());
+
+		if (b > 0)
 		{
-			out_data.insert(out_data.end(), out_buffer, out_buffer + sizeof(out_buffer));
+			size_t length = std::min((size_t)ZLIB_BLOCK_SIZE, in_data.size() - (size_t)b * ZLIB_BLOCK_SIZE);
 
-			compression->setNextOut(out_buffer, sizeof(out_buffer));
+			check = adler32_combine(check, checks[b], (z_off_t)length);
 		}
 	}
 
-	left_over = sizeof(out_buffer) - compression->getAvailOut();
+	// and the checksum of it all, big-endian
+	for (int shift = 24 ; shift >= 0 ; shift -= 8)
+		out_data.push_back((byte)(check >> shift));
 
-	if (left_over > 0)
-	{
-		out_data.insert(out_data.end(), out_buffer, out_buffer + left_over);
-	}
+	std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start_time;
+
+	deflate_time = secs.count();
 }
 
 static const uint8_t *lev_XNOD_magic = (uint8_t *) "XNOD";
@@ -1745,8 +1907,10 @@ void LevelData::PutZNodes(ZLibContext &zcontext, node_t *root, bool do_xgl3) noe
 	}
 }
 
-void LevelData::putZItems(std::vector<byte>& lumpData, node_t* root_node, bool do_xgl3)
+void LevelData::putZItems(std::vector<byte>& lumpData, node_t* root_node, bool do_xgl3, bool compress)
 {
+	phase_timer_c timer(cur_info, PHASE_ZNodes);
+
 	auto putTheStuff = [this, root_node, do_xgl3](ZLibContext &zlibContext)
 		{
 			PutZVertices(zlibContext);
@@ -1760,9 +1924,17 @@ void LevelData::putZItems(std::vector<byte>& lumpData, node_t* root_node, bool d
 
 	try
 	{
-		ZLibContext zlibContext(cur_info->force_compress, lumpData);
+		ZLibContext zlibContext(compress, lumpData, cur_info);
 		putTheStuff(zlibContext);
 		zlibContext.finishLump();
+
+		if (compress)
+		{
+			cur_info->stats.compress_in     += zlibContext.bytesIn();
+			cur_info->stats.compress_out    += lumpData.size();
+			cur_info->stats.compress_blocks += zlibContext.numBlocks();
+			cur_info->stats.compress_time   += zlibContext.deflateTime();
+		}
 	}
 	catch (const ZLibContext::Compression::Exception& e)
 	{
@@ -1781,7 +1953,7 @@ void LevelData::SaveZDFormat(node_t *root_node)
 	// the ZLibXXX functions do no compression for XNOD format
 	
 	std::vector<byte> lumpData;
-	putZItems(lumpData, root_node, false);
+	putZItems(lumpData, root_node, false, cur_info->force_compress);
 	
 	// Commit
 	
@@ -1807,11 +1979,9 @@ void LevelData::SaveXGL3Format(node_t *root_node)
 
 	lump.Write(lev_XGL3_magic, 4);
 
-	// disable compression
-	cur_info->force_compress = false;
-
+	// never compressed, not every port reads ZGL3
 	std::vector<byte> lumpData;
-	putZItems(lumpData, root_node, true);
+	putZItems(lumpData, root_node, true, false);
 	
 	lump.Write(lumpData.data(), (int)lumpData.size());
 }
@@ -1833,23 +2003,24 @@ void LevelData::LoadLevel()
 
 	GetVertices();
 
-	for(auto &L : doc.linedefs)
+	line_flags.assign(doc.numLinedefs(), 0);
+
+	for (int i = 0 ; i < doc.numLinedefs() ; i++)
 	{
+		const auto L = doc.linedefs[i];
+
 		if (L->right >= 0 || L->left >= 0)
 			num_real_lines++;
 
-		// init some fake flags
-		L->flags &= ~(MLF_IS_PRECIOUS | MLF_IS_OVERLAP);
-
 		if (L->tag >= 900 && L->tag < 1000)
-			L->flags |= MLF_IS_PRECIOUS;
+			line_flags[i] |= MLF_IS_PRECIOUS;
 	}
 
 	PrintDetail("Loaded %d vertices, %d sectors, %d sides, %d lines, %d things\n",
 			doc.numVertices(), doc.numSectors(), doc.numSidedefs(), doc.numLinedefs(), doc.numThings());
 
 	DetectOverlappingVertices();
-	DetectOverlappingLines(doc);
+	DetectOverlappingLines();
 
 	CalculateWallTips();
 
@@ -1868,6 +2039,69 @@ void LevelData::FreeLevel(void)
 	FreeSubsecs();
 	FreeNodes();
 	FreeWallTips();
+
+	line_flags.clear();
+
+	arenas.Clear();
+}
+
+
+void LevelData::LogArenas() const
+{
+	size_t objects = 0;
+	size_t reused  = 0;
+	size_t blocks  = 0;
+	size_t bytes   = 0;
+
+	auto count = [&](const auto &arena)
+	{
+		objects += arena.NumAllocs();
+		reused  += arena.NumReused();
+		blocks  += arena.NumBlocks();
+		bytes   += arena.NumBytes();
+	};
+
+	count(arenas.vertices);
+	count(arenas.segs);
+	count(arenas.subsecs);
+	count(arenas.nodes);
+	count(arenas.walltips);
+	count(arenas.cuts);
+
+	PrintMsg("Allocated %zu objects (%zu re-used) from %zu blocks, %zu kB\n",
+			objects, reused, blocks, bytes / 1024);
+
+	cur_info->stats.memory = bytes;
+
+	gLog.debugPrintf("BSP: vertices %zu, segs %zu, subsecs %zu, nodes %zu, "
+			"walltips %zu, cuts %zu\n",
+			arenas.vertices.NumAllocs(), arenas.segs.NumAllocs(),
+			arenas.subsecs.NumAllocs(), arenas.nodes.NumAllocs(),
+			arenas.walltips.NumAllocs(), arenas.cuts.NumAllocs());
+}
+
+//
+// Where the time of the build went, and how much work it took
+//
+void LevelData::LogStats() const
+{
+	const build_stats_t &stats = cur_info->stats;
+
+	SString times;
+
+	for (int p = 0 ; p < NUM_BUILD_PHASES ; p++)
+		times += SString::printf("%s%s %1.3f", p ? ", " : "",
+				BuildPhaseName((build_phase_e)p), stats.phase_time[p]);
+
+	PrintMsg("Took %1.3f seconds (%s)\n", stats.time, times.c_str());
+
+	PrintMsg("Tried %lld partitions, %d splits, %d minisegs, %lld quadtree boxes\n",
+			(long long)stats.partitions, stats.splits, stats.minisegs, (long long)stats.quadtrees);
+
+	if (stats.compress_in > 0)
+		PrintMsg("Compressed %zu bytes to %zu in %d blocks, %1.1f MB/s\n",
+				stats.compress_in, stats.compress_out, stats.compress_blocks,
+				stats.compress_in / std::max(stats.compress_time, 1e-6) / 1e6);
 }
 
 uint32_t LevelData::CalcGLChecksum() const
@@ -1966,6 +2200,15 @@ build_result_e LevelData::SaveLevel(node_t *root_node)
 	// this sets the force_xxx vars if certain limits are breached
 	CheckLimits(force_v5, force_xnod);
 
+	if (num_real_lines > 0)
+	{
+		cur_info->stats.gl_v5 = cur_info->gl_nodes && force_v5;
+		cur_info->stats.xnod  = force_xnod;
+
+		cur_info->stats.forced_v5   = cur_info->stats.gl_v5 && !cur_info->force_v5;
+		cur_info->stats.forced_xnod = force_xnod && !cur_info->force_xnod;
+	}
+
 
 	/* --- GL Nodes --- */
 
@@ -2013,7 +2256,11 @@ build_result_e LevelData::SaveLevel(node_t *root_node)
 		// reduce vertex precision for classic DOOM nodes.
 		// some segs can become "degenerate" after this, and these
 		// are removed from subsectors.
-		RoundOffBspTree();
+		{
+			phase_timer_c timer(cur_info, PHASE_RoundOff);
+
+			RoundOffBspTree();
+		}
 
 		// this also removes minisegs and degenerate segs
 		SortSegs();
@@ -2025,8 +2272,19 @@ build_result_e LevelData::SaveLevel(node_t *root_node)
 		PutNodes("NODES", false, root_node);
 	}
 
-	PutBlockmap();
-	PutReject();
+	{
+		phase_timer_c timer(cur_info, PHASE_Blockmap);
+
+		PutBlockmap();
+	}
+	{
+		phase_timer_c timer(cur_info, PHASE_Reject);
+
+		PutReject();
+	}
+
+	if (cur_info->cancelled)
+		return BUILD_Cancelled;
 
 	// keyword support (v5.0 of the specs).
 	// must be done *after* doing normal nodes (for proper checksum).
@@ -2059,6 +2317,8 @@ build_result_e LevelData::SaveUDMF(node_t *root_node)
 			SortSegs();
 
 			SaveXGL3Format(root_node);
+
+			cur_info->stats.xgl3 = true;
 		}
 	}
 	catch (const std::runtime_error& e)
@@ -2116,25 +2376,23 @@ Lump_c & LevelData::CreateLevelLump(const char *name) const
 }
 
 
-Lump_c & LevelData::CreateGLMarker() const
+SString LevelData::GLMarkerName() const
 {
-	SString name_buf;
-
 	if (current_name.length() <= 5)
-	{
-		name_buf = "GL_" + current_name;
-	}
-	else
-	{
-		// names longer than 5 chars use "GL_LEVEL" as marker name
-		name_buf = "GL_LEVEL";
-	}
+		return "GL_" + current_name;
+
+	// names longer than 5 chars use "GL_LEVEL" as marker name
+	return "GL_LEVEL";
+}
 
+
+Lump_c & LevelData::CreateGLMarker() const
+{
 	int last_idx = wad.LevelLastLump(current_idx);
 
 	wad.InsertPoint(last_idx + 1);
 
-	return wad.AddLump(name_buf);
+	return wad.AddLump(GLMarkerName());
 }
 
 
@@ -2153,38 +2411,96 @@ build_result_e LevelData::BuildLevel(nodebuildinfo_t *info, int lev_idx)
 	if (cur_info->cancelled)
 		return BUILD_Cancelled;
 
+	auto start_time = std::chrono::steady_clock::now();
+
+	cur_info->stats = build_stats_t();
+	cur_info->progress = 0;
+
+	seg_splits = 0;
+	segs_placed = 0;
+	minisegs_made = 0;
+	partitions_tried = 0;
+	quad_boxes = 0;
+
 	current_idx   = lev_idx;
 	current_start = wad.LevelHeader(lev_idx);
 
-	LoadLevel();
+	{
+		phase_timer_c timer(cur_info, PHASE_Load);
+
+		LoadLevel();
 
-	block.InitMap(doc);
+		block.InitMap(doc);
+	}
 
 
 	build_result_e ret = BUILD_OK;
 
 	if (num_real_lines > 0)
 	{
+		seg_t *list;
+
 		// create initial segs
-		seg_t *list = CreateSegs();
+		{
+			phase_timer_c timer(cur_info, PHASE_Segs);
+
+			list = CreateSegs();
+
+			initial_segs = 0;
+			for (const seg_t *seg = list ; seg ; seg = seg->next)
+				if (seg->linedef >= 0)
+					initial_segs++;
+
+			if (cur_info->history)
+				PrepareHistory(list);
+		}
 
 		// recursively create nodes
-		ret = BuildNodes(list, &root_bbox, &root_node, &root_sub, 0);
+		{
+			phase_timer_c timer(cur_info, PHASE_Nodes);
+
+			nodes_start = std::chrono::steady_clock::now();
+
+			if (cur_info->jobs != 1)
+				ret = BuildNodesParallel(list, &root_bbox, &root_node, &root_sub);
+			else
+				ret = BuildNodes(list, &root_bbox, &root_node, &root_sub, 0,
+						prev_history.nodes.empty() ? -1 : 0);
+		}
+
+		if (ret == BUILD_OK && cur_info->history)
+			RecordHistory(root_node, cur_info->stats.phase_time[PHASE_Nodes]);
 	}
 
+	// a failed build leaves nothing to go on next time
+	if (ret != BUILD_OK && cur_info->history)
+		cur_info->history->Clear();
+
 	if (ret == BUILD_OK)
 	{
 		PrintDetail("Built %d NODES, %d SSECTORS, %d SEGS, %d VERTEXES\n",
 					(int)nodes.size(), (int)subsecs.size(), (int)segs.size(), num_old_vert + num_new_vert);
 
+		cur_info->stats.nodes    = (int)nodes.size();
+		cur_info->stats.subsecs  = (int)subsecs.size();
+		cur_info->stats.segs     = (int)segs.size();
+		cur_info->stats.vertices = num_old_vert + num_new_vert;
+
 		if (root_node)
 		{
-			PrintDetail("Heights of left and right subtrees = (%d,%d)\n",
-					ComputeBspHeight(root_node->r.node),
-					ComputeBspHeight(root_node->l.node));
+			int right = ComputeBspHeight(root_node->r.node);
+			int left  = ComputeBspHeight(root_node->l.node);
+
+			PrintDetail("Heights of left and right subtrees = (%d,%d)\n", right, left);
+
+			cur_info->stats.height = 1 + std::max(right, left);
 		}
 
-		ClockwiseBspTree();
+		{
+			phase_timer_c timer(cur_info, PHASE_Clockwise);
+
+			ClockwiseBspTree();
+		}
 
 		try
 		{
@@ -2204,19 +2520,118 @@ build_result_e LevelData::BuildLevel(nodebuildinfo_t *info, int lev_idx)
 		/* build was Cancelled by the user */
 	}
 
+	cur_info->stats.splits     = seg_splits;
+	cur_info->stats.minisegs   = minisegs_made;
+	cur_info->stats.partitions = partitions_tried;
+	cur_info->stats.quadtrees  = quad_boxes;
+
+	LogArenas();
+
 	FreeLevel();
-	FreeQuickAllocCuts();
 
-	// clear some fake line flags
-	for(auto &linedef : doc.linedefs)
-		linedef->flags &= ~(MLF_IS_PRECIOUS | MLF_IS_OVERLAP);
+	std::chrono::duration<double> total_time = std::chrono::steady_clock::now() - start_time;
+
+	cur_info->stats.time = total_time.count();
+
+	LogStats();
 
 	return ret;
 }
 
+
+//
+// Same lumps, in the same places, as SaveLevel() or SaveUDMF() would
+// have created them.
+//
+build_result_e LevelData::PutNodeLumps(nodebuildinfo_t *info, int lev_idx,
+									   const std::vector<node_lump_t> &lumps)
+{
+	cur_info = info;
+
+	current_idx   = lev_idx;
+	current_start = wad.LevelHeader(lev_idx);
+	current_name  = wad.GetLump(current_start)->Name();
+
+	if (format == MapFormat::udmf)
+	{
+		wad.RemoveZNodes(current_idx);
+	}
+	else
+	{
+		wad.RemoveGLNodes(current_idx);
+
+		AddMissingLump("SEGS",     "VERTEXES");
+		AddMissingLump("SSECTORS", "SEGS");
+		AddMissingLump("NODES",    "SSECTORS");
+		AddMissingLump("REJECT",   "SECTORS");
+		AddMissingLump("BLOCKMAP", "REJECT");
+	}
+
+	SString marker_name = GLMarkerName();
+
+	for (const node_lump_t &cached : lumps)
+	{
+		Lump_c &lump = cached.name.noCaseEqual(marker_name) ? CreateGLMarker() :
+				CreateLevelLump(cached.name.c_str());
+
+		lump.Write(cached.data.data(), (int)cached.data.size());
+	}
+
+	PrintDetail("Copied %d node lumps of %s\n", (int)lumps.size(), current_name.c_str());
+
+	return BUILD_OK;
+}
+
 }  // namespace ajbsp
 
 
+static bool IsNodeLump(const SString &name, MapFormat format)
+{
+	if (format == MapFormat::udmf)
+		return name.noCaseEqual("ZNODES");
+
+	static const char *const node_lumps[] =
+	{
+		"VERTEXES", "SEGS", "SSECTORS", "NODES", "REJECT", "BLOCKMAP"
+	};
+
+	for (const char *node_lump : node_lumps)
+		if (name.noCaseEqual(node_lump))
+			return true;
+
+	return name.noCaseStartsWith("GL_");
+}
+
+
+std::vector<node_lump_t> AJBSP_GetNodeLumps(const Wad_file &wad, int lev_idx, MapFormat format)
+{
+	std::vector<node_lump_t> lumps;
+
+	int start  = wad.LevelHeader(lev_idx);
+	int finish = wad.LevelLastLump(lev_idx);
+
+	for (int k = start + 1 ; k <= finish ; k++)
+	{
+		const Lump_c *lump = wad.GetLump(k);
+
+		if (IsNodeLump(lump->Name(), format))
+			lumps.push_back({ lump->Name(), lump->getData() });
+	}
+
+	return lumps;
+}
+
+
+build_result_e AJBSP_PutNodeLumps(nodebuildinfo_t *info, int lev_idx, Instance &inst, const Document &doc,
+		const LoadingData& loading, Wad_file &wad, const std::vector<node_lump_t> &lumps)
+{
+	ajbsp::LevelData lev_data(loading.levelFormat, wad, doc, inst.conf, [&inst](const SString &message){
+		inst.GB_PrintMsg("%s", message.c_str());
+	});
+	return lev_data.PutNodeLumps(info, lev_idx, lumps);
+}
+
+
 build_result_e AJBSP_BuildLevel(nodebuildinfo_t *info, int lev_idx, Instance &inst, const Document &doc, const LoadingData& loading, Wad_file& wad)
 {
 	ajbsp::LevelData lev_data(loading.levelFormat, wad, doc, inst.conf, [&inst](const SString &message){
@@ -39,8 +39,16 @@
 
 #include "bsp.h"
 #include "Instance.h"
+#include "ThreadPool.h"
 #include "w_rawdef.h"
 
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <unordered_set>
+
 
 namespace ajbsp
 {
@@ -49,6 +57,9 @@ namespace ajbsp
 
 #define SEG_FAST_THRESHHOLD  200
 
+// fewest partition candidates for a budgeted search, when out of time
+#define PICK_BUDGET_MIN  8
+
 
 #define DEBUG_BUILDER  0
 #define DEBUG_SORTER   0
@@ -63,7 +74,8 @@ namespace ajbsp
 #define DIST_EPSILON  (1.0 / 1024.0)
 
 
-static int current_seg_index;
+// thread-local, since several levels may be built at the same time
+static thread_local int current_seg_index;
 
 
 struct eval_info_t
@@ -97,37 +109,7 @@ public:
 };
 
 
-static intersection_t *quick_alloc_cuts = NULL;
-
-
-static intersection_t *NewIntersection(void)
-{
-	intersection_t *cut;
-
-	if (quick_alloc_cuts)
-	{
-		cut = quick_alloc_cuts;
-		quick_alloc_cuts = cut->next;
-	}
-	else
-	{
-		cut = (intersection_t *) UtilCalloc(sizeof(intersection_t));
-	}
-
-	return cut;
-}
-
-
-void FreeQuickAllocCuts(void)
-{
-	while (quick_alloc_cuts)
-	{
-		intersection_t *cut = quick_alloc_cuts;
-		quick_alloc_cuts = cut->next;
-
-		UtilFree(cut);
-	}
-}
+thread_local build_task_t *cur_build_task = NULL;
 
 
 //
@@ -177,6 +159,9 @@ seg_t * LevelData::SplitSeg(seg_t *old_seg, double x, double y)
 		gLog.debugPrintf("Splitting Miniseg %p at (%1.1f,%1.1f)\n", old_seg, x, y);
 # endif
 
+	if (old_seg->linedef >= 0)
+		seg_splits++;
+
 	new_vert = NewVertexFromSplitSeg(old_seg, x, y);
 	new_seg  = NewSeg();
 
@@ -184,6 +169,12 @@ seg_t * LevelData::SplitSeg(seg_t *old_seg, double x, double y)
 	new_seg[0] = old_seg[0];
 	new_seg->next = NULL;
 
+	// a task waiting for the old seg now waits for both pieces.
+	// [ the partner can never have a waiter, as its own partner is
+	//   the seg we are splitting ]
+	if (new_seg->waiter)
+		new_seg->waiter->blockers++;
+
 	old_seg->end   = new_vert;
 	new_seg->start = new_vert;
 
@@ -268,7 +259,7 @@ static inline void ComputeIntersection(seg_t *seg, seg_t *part,
 }
 
 
-static void AddIntersection(intersection_t ** cut_list,
+static void AddIntersection(arena_c<intersection_t>& cuts, intersection_t ** cut_list,
 		vertex_t *vert, seg_t *part, bool self_ref)
 {
 	bool open_before = VertexCheckOpen(vert, -part->pdx, -part->pdy);
@@ -298,7 +289,7 @@ static void AddIntersection(intersection_t ** cut_list,
 	}
 
 	/* create new intersection */
-	cut = NewIntersection();
+	cut = cuts.Alloc();
 
 	cut->vertex = vert;
 	cut->along_dist = along_dist;
@@ -338,9 +329,11 @@ static void AddIntersection(intersection_t ** cut_list,
 //
 // Returns true if a "bad seg" was found early.
 //
-int LevelData::EvalPartitionWorker(quadtree_c *tree, seg_t *part,
+int LevelData::EvalPartitionWorker(const quadtree_c *tree, int box, seg_t *part,
 		int best_cost, eval_info_t *info)
 {
+	const quadtree_c::box_t &B = tree->boxes[box];
+
 	double qnty;
 	double a, b, fa, fb;
 
@@ -351,17 +344,17 @@ int LevelData::EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 	//       all the segs within it at once.  Only when the partition
 	//       line intercepts the box do we need to go deeper into it.
 
-	switch (tree->OnLineSide(part))
+	switch (tree->OnLineSide(box, part))
 	{
 	case Side::left:
-		info->real_left += tree->real_num;
-		info->mini_left += tree->mini_num;
+		info->real_left += B.real_num;
+		info->mini_left += B.mini_num;
 
 		return false;
 
 	case Side::right:
-		info->real_right += tree->real_num;
-		info->mini_right += tree->mini_num;
+		info->real_right += B.real_num;
+		info->mini_right += B.mini_num;
 
 		return false;
 	default:
@@ -370,150 +363,192 @@ int LevelData::EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 
 	/* check partition against all Segs */
 
-	seg_t *check;
+	// the segs lying well clear of the partition are sorted out in
+	// batches (see bsp_kernel.cc), only the others need a closer look.
+
+	partition_line_t line;
+
+	line.pdx = part->pdx;
+	line.pdy = part->pdy;
+	line.p_perp   = part->p_perp;
+	line.p_length = part->p_length;
+	line.source_line = part->source_line;
+
+	double a_list[SEG_KERNEL_BATCH];
+	double b_list[SEG_KERNEL_BATCH];
 
-	for (check=tree->list ; check ; check=check->next)
+	int block_end = B.first + B.count;
+
+	for (int first = B.first ; first < block_end ; first += SEG_KERNEL_BATCH)
 	{
+		int count = std::min(SEG_KERNEL_BATCH, block_end - first);
+
 		// This is the heart of my pruning idea - it catches
 		// bad segs early on. Killough
+		//
+		// [ only the segs which need a closer look change the cost, so
+		//   checking around those prunes at exactly the same point. ]
 
 		if (info->cost > best_cost)
 			return true;
 
-		/* get state of lines' relation to each other */
-		if (check->source_line == part->source_line)
-		{
-			a = b = fa = fb = 0;
-		}
-		else
+		uint64_t right_bits, left_bits;
+
+		ClassifySegs(tree->block, first, count, line, a_list, b_list, &right_bits, &left_bits);
+
+		uint64_t real_bits = tree->block.RealBits(first, count);
+
+		info->real_right += CountBits(right_bits &  real_bits);
+		info->mini_right += CountBits(right_bits & ~real_bits);
+		info->real_left  += CountBits(left_bits  &  real_bits);
+		info->mini_left  += CountBits(left_bits  & ~real_bits);
+
+		uint64_t all_bits = (count < 64) ? (((uint64_t)1 << count) - 1) : ~(uint64_t)0;
+		uint64_t rest = all_bits & ~(right_bits | left_bits);
+
+		int last = -1;
+
+		for ( ; rest ; rest &= rest - 1)
 		{
-			a = part->PerpDist(check->psx, check->psy);
-			b = part->PerpDist(check->pex, check->pey);
+			int k = FirstBit(rest);
+
+			if (info->cost > best_cost)
+				return true;
+
+			last = k;
+
+			const seg_t *check = tree->block.segs[first + k];
+
+			a = a_list[k];
+			b = b_list[k];
 
 			fa = fabs(a);
 			fb = fabs(b);
-		}
 
-		/* check for being on the same line */
-		if (fa <= DIST_EPSILON && fb <= DIST_EPSILON)
-		{
-			// this seg runs along the same line as the partition.  Check
-			// whether it goes in the same direction or the opposite.
+			/* check for being on the same line */
+			if (fa <= DIST_EPSILON && fb <= DIST_EPSILON)
+			{
+				// this seg runs along the same line as the partition.  Check
+				// whether it goes in the same direction or the opposite.
+
+				if (check->pdx*part->pdx + check->pdy*part->pdy < 0)
+				{
+					info->BumpLeft(check->linedef);
+				}
+				else
+				{
+					info->BumpRight(check->linedef);
+				}
+				continue;
+			}
+
+			// -AJA- check for passing through a vertex.  Normally this is fine
+			//       (even ideal), but the vertex could on a sector that we
+			//       DONT want to split, and the normal linedef-based checks
+			//       may fail to detect the sector being cut in half.  Thanks
+			//       to Janis Legzdinsh for spotting this obscure bug.
 
-			if (check->pdx*part->pdx + check->pdy*part->pdy < 0)
+			if (fa <= DIST_EPSILON || fb <= DIST_EPSILON)
 			{
-				info->BumpLeft(check->linedef);
+				if (check->linedef >= 0 && (line_flags[check->linedef] & MLF_IS_PRECIOUS))
+					info->cost += 40 * factor * PRECIOUS_MULTIPLY;
 			}
-			else
+
+			/* check for right side */
+			if (a > -DIST_EPSILON && b > -DIST_EPSILON)
 			{
 				info->BumpRight(check->linedef);
-			}
-			continue;
-		}
 
-		// -AJA- check for passing through a vertex.  Normally this is fine
-		//       (even ideal), but the vertex could on a sector that we
-		//       DONT want to split, and the normal linedef-based checks
-		//       may fail to detect the sector being cut in half.  Thanks
-		//       to Janis Legzdinsh for spotting this obscure bug.
+				/* check for a near miss */
+				if ((a >= IFFY_LEN && b >= IFFY_LEN) ||
+					(a <= DIST_EPSILON && b >= IFFY_LEN) ||
+					(b <= DIST_EPSILON && a >= IFFY_LEN))
+				{
+					continue;
+				}
 
-		if (fa <= DIST_EPSILON || fb <= DIST_EPSILON)
-		{
-			if (check->linedef >= 0 && (doc.linedefs[check->linedef]->flags & MLF_IS_PRECIOUS))
-				info->cost += 40 * factor * PRECIOUS_MULTIPLY;
-		}
+				info->near_miss++;
 
-		/* check for right side */
-		if (a > -DIST_EPSILON && b > -DIST_EPSILON)
-		{
-			info->BumpRight(check->linedef);
+				// -AJA- near misses are bad, since they have the potential to
+				//       cause really short minisegs to be created in future
+				//       processing.  Thus the closer the near miss, the higher
+				//       the cost.
 
-			/* check for a near miss */
-			if ((a >= IFFY_LEN && b >= IFFY_LEN) ||
-				(a <= DIST_EPSILON && b >= IFFY_LEN) ||
-				(b <= DIST_EPSILON && a >= IFFY_LEN))
-			{
+				if (a <= DIST_EPSILON || b <= DIST_EPSILON)
+					qnty = IFFY_LEN / std::max(a, b);
+				else
+					qnty = IFFY_LEN / std::min(a, b);
+
+				info->cost += (int) (100 * factor * (qnty * qnty - 1.0));
 				continue;
 			}
 
-			info->near_miss++;
-
-			// -AJA- near misses are bad, since they have the potential to
-			//       cause really short minisegs to be created in future
-			//       processing.  Thus the closer the near miss, the higher
-			//       the cost.
+			/* check for left side */
+			if (a < DIST_EPSILON && b < DIST_EPSILON)
+			{
+				info->BumpLeft(check->linedef);
 
-			if (a <= DIST_EPSILON || b <= DIST_EPSILON)
-				qnty = IFFY_LEN / std::max(a, b);
-			else
-				qnty = IFFY_LEN / std::min(a, b);
+				/* check for a near miss */
+				if ((a <= -IFFY_LEN && b <= -IFFY_LEN) ||
+					(a >= -DIST_EPSILON && b <= -IFFY_LEN) ||
+					(b >= -DIST_EPSILON && a <= -IFFY_LEN))
+				{
+					continue;
+				}
 
-			info->cost += (int) (100 * factor * (qnty * qnty - 1.0));
-			continue;
-		}
+				info->near_miss++;
 
-		/* check for left side */
-		if (a < DIST_EPSILON && b < DIST_EPSILON)
-		{
-			info->BumpLeft(check->linedef);
+				// the closer the miss, the higher the cost (see note above)
+				if (a >= -DIST_EPSILON || b >= -DIST_EPSILON)
+					qnty = IFFY_LEN / -std::min(a, b);
+				else
+					qnty = IFFY_LEN / -std::max(a, b);
 
-			/* check for a near miss */
-			if ((a <= -IFFY_LEN && b <= -IFFY_LEN) ||
-				(a >= -DIST_EPSILON && b <= -IFFY_LEN) ||
-				(b >= -DIST_EPSILON && a <= -IFFY_LEN))
-			{
+				info->cost += (int) (70 * factor * (qnty * qnty - 1.0));
 				continue;
 			}
 
-			info->near_miss++;
-
-			// the closer the miss, the higher the cost (see note above)
-			if (a >= -DIST_EPSILON || b >= -DIST_EPSILON)
-				qnty = IFFY_LEN / -std::min(a, b);
-			else
-				qnty = IFFY_LEN / -std::max(a, b);
-
-			info->cost += (int) (70 * factor * (qnty * qnty - 1.0));
-			continue;
-		}
+			// When we reach here, we have a and b non-zero and opposite sign,
+			// hence this seg will be split by the partition line.
 
-		// When we reach here, we have a and b non-zero and opposite sign,
-		// hence this seg will be split by the partition line.
+			info->splits++;
 
-		info->splits++;
+			// If the linedef associated with this seg has a tag >= 900, treat
+			// it as precious; i.e. don't split it unless all other options
+			// are exhausted.  This is used to protect deep water and invisible
+			// lifts/stairs from being messed up accidentally by splits.
 
-		// If the linedef associated with this seg has a tag >= 900, treat
-		// it as precious; i.e. don't split it unless all other options
-		// are exhausted.  This is used to protect deep water and invisible
-		// lifts/stairs from being messed up accidentally by splits.
-
-		if (check->linedef >= 0 && (doc.linedefs[check->linedef]->flags & MLF_IS_PRECIOUS))
-			info->cost += 100 * factor * PRECIOUS_MULTIPLY;
-		else
-			info->cost += 100 * factor;
+			if (check->linedef >= 0 && (line_flags[check->linedef] & MLF_IS_PRECIOUS))
+				info->cost += 100 * factor * PRECIOUS_MULTIPLY;
+			else
+				info->cost += 100 * factor;
 
-		// -AJA- check if the split point is very close to one end, which
-		//       an undesirable situation (producing really short segs).
-		//       This is perhaps _one_ source of those darn slime trails.
-		//       Hence the name "IFFY segs", and a rather hefty surcharge.
+			// -AJA- check if the split point is very close to one end, which
+			//       an undesirable situation (producing really short segs).
+			//       This is perhaps _one_ source of those darn slime trails.
+			//       Hence the name "IFFY segs", and a rather hefty surcharge.
 
-		if (fa < IFFY_LEN || fb < IFFY_LEN)
-		{
-			info->iffy++;
+			if (fa < IFFY_LEN || fb < IFFY_LEN)
+			{
+				info->iffy++;
 
-			// the closer to the end, the higher the cost
-			qnty = IFFY_LEN / std::min(fa, fb);
-			info->cost += (int) (140 * factor * (qnty * qnty - 1.0));
+				// the closer to the end, the higher the cost
+				qnty = IFFY_LEN / std::min(fa, fb);
+				info->cost += (int) (140 * factor * (qnty * qnty - 1.0));
+			}
 		}
+
+		if (last >= 0 && last + 1 < count && info->cost > best_cost)
+			return true;
 	}
 
 	/* handle sub-blocks recursively */
 
 	for (int c=0 ; c < 2 ; c++)
 	{
-		if (tree->subs[c] && !tree->subs[c]->Empty())
+		if (tree->HasSub(box, c))
 		{
-			if (EvalPartitionWorker(tree->subs[c], part, best_cost, info))
+			if (EvalPartitionWorker(tree, quadtree_c::Sub(box, c), part, best_cost, info))
 				return true;
 		}
 	}
@@ -530,10 +565,12 @@ int LevelData::EvalPartitionWorker(quadtree_c *tree, seg_t *part,
 // Returns the computed cost, or a negative value if the seg should be
 // skipped altogether.
 //
-int LevelData::EvalPartition(quadtree_c *tree, seg_t *part, int best_cost)
+int LevelData::EvalPartition(const quadtree_c *tree, seg_t *part, int best_cost)
 {
 	eval_info_t info;
 
+	partitions_tried++;
+
 	/* initialise info structure */
 	info.cost   = 0;
 	info.splits = 0;
@@ -545,7 +582,7 @@ int LevelData::EvalPartition(quadtree_c *tree, seg_t *part, int best_cost)
 	info.mini_left  = 0;
 	info.mini_right = 0;
 
-	if (EvalPartitionWorker(tree, part, best_cost, &info))
+	if (EvalPartitionWorker(tree, 0, part, best_cost, &info))
 		return -1;
 
 	/* make sure there is at least one real seg on each side */
@@ -586,12 +623,10 @@ int LevelData::EvalPartition(quadtree_c *tree, seg_t *part, int best_cost)
 }
 
 
-static void EvaluateFastWorker(quadtree_c *tree,
+static void EvaluateFastWorker(const quadtree_c *tree,
 		seg_t **best_H, seg_t **best_V, int mid_x, int mid_y)
 {
-	seg_t *part;
-
-	for (part=tree->list ; part ; part = part->next)
+	for (seg_t *part : tree->block.segs)
 	{
 		/* ignore minisegs as partition candidates */
 		if (part->linedef < 0)
@@ -630,26 +665,16 @@ static void EvaluateFastWorker(quadtree_c *tree,
 			}
 		}
 	}
-
-	/* handle sub-blocks recursively */
-
-	for (int c=0 ; c < 2 ; c++)
-	{
-		if (tree->subs[c] && !tree->subs[c]->Empty())
-		{
-			EvaluateFastWorker(tree->subs[c], best_H, best_V, mid_x, mid_y);
-		}
-	}
 }
 
 
-seg_t *LevelData::FindFastSeg(quadtree_c *tree)
+seg_t *LevelData::FindFastSeg(const quadtree_c *tree)
 {
 	seg_t *best_H = NULL;
 	seg_t *best_V = NULL;
 
-	int mid_x = (tree->x1 + tree->x2) / 2;
-	int mid_y = (tree->y1 + tree->y2) / 2;
+	int mid_x = (tree->boxes[0].x1 + tree->boxes[0].x2) / 2;
+	int mid_y = (tree->boxes[0].y1 + tree->boxes[0].y2) / 2;
 
 	EvaluateFastWorker(tree, &best_H, &best_V, mid_x, mid_y);
 
@@ -678,11 +703,10 @@ seg_t *LevelData::FindFastSeg(quadtree_c *tree)
 
 
 /* returns false if cancelled */
-bool LevelData::PickNodeWorker(quadtree_c *part_list,
-		quadtree_c *tree, seg_t ** best, int *best_cost)
+bool LevelData::PickNodeWorker(const quadtree_c *tree, seg_t ** best, int *best_cost)
 {
 	// try each partition
-	for (seg_t *part=part_list->list ; part ; part = part->next)
+	for (seg_t *part : tree->block.segs)
 	{
 		if (cur_info->cancelled)
 			return false;
@@ -710,24 +734,186 @@ bool LevelData::PickNodeWorker(quadtree_c *part_list,
 		(*best) = part;
 	}
 
-	/* recursively handle sub-blocks */
+	return true;
+}
+
+
+static void CollectCandidates(const quadtree_c *tree, std::vector<seg_t *>& list)
+{
+	for (seg_t *part : tree->block.segs)
+	{
+		/* ignore minisegs as partition candidates */
+		if (part->linedef >= 0)
+			list.push_back(part);
+	}
+}
+
+
+//
+// Picks about 'count' of the real segs in the quadtree as partition
+// candidates.  Each block gets a share of them as big as its share of
+// the real segs, and takes its own segs at even steps.  The best of the
+// axis-aligned segs which FindFastSeg() would use are added too.
+//
+static void SampleCandidates(const quadtree_c *tree, int box, int count,
+		std::vector<seg_t *>& list)
+{
+	const quadtree_c::box_t &B = tree->boxes[box];
+
+	if (count <= 0 || B.real_num == 0)
+		return;
+
+	if (count >= B.real_num)
+	{
+		for (int i = B.first ; i < B.end ; i++)
+			if (tree->block.segs[i]->linedef >= 0)
+				list.push_back(tree->block.segs[i]);
+		return;
+	}
+
+	int sub_real[2];
 
 	for (int c=0 ; c < 2 ; c++)
+		sub_real[c] = B.leaf ? 0 : tree->boxes[quadtree_c::Sub(box, c)].real_num;
+
+	int own = B.real_num - sub_real[0] - sub_real[1];
+
+	// the shares are rounded so that they add up to 'count'
+	int own_count = (int)((int64_t)count * own / B.real_num);
+	int sub_count = (int)((int64_t)count * (own + sub_real[0]) / B.real_num) - own_count;
+
+	// the middle seg of each of 'own_count' equal runs
+	int index = 0;
+	int taken = 0;
+
+	for (int i = B.first ; i < B.first + B.count && taken < own_count ; i++)
 	{
-		if (part_list->subs[c] && !part_list->subs[c]->Empty())
+		seg_t *part = tree->block.segs[i];
+
+		if (part->linedef < 0)
+			continue;
+
+		if (index == (int)((int64_t)(2 * taken + 1) * own / (2 * own_count)))
 		{
-			PickNodeWorker(part_list->subs[c], tree, best, best_cost);
+			list.push_back(part);
+			taken++;
 		}
+
+		index++;
 	}
 
-	return true;
+	if (! B.leaf)
+	{
+		SampleCandidates(tree, quadtree_c::Sub(box, 0), sub_count, list);
+		SampleCandidates(tree, quadtree_c::Sub(box, 1), count - own_count - sub_count, list);
+	}
+}
+
+
+//
+// How many partition candidates a node at this depth gets, or 0 to
+// try them all.
+//
+int LevelData::PickBudget(int depth) const
+{
+	if (cur_info->pick_budget <= 0)
+		return 0;
+
+	double budget = (double)cur_info->pick_budget * (8 + depth) / 8;
+
+	if (cur_info->pick_time > 0)
+	{
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - nodes_start;
+
+		double left = 1.0 - elapsed.count() / cur_info->pick_time;
+
+		budget = std::max<double>(PICK_BUDGET_MIN, budget * std::max(0.0, left));
+	}
+
+	return (int)std::min<double>(budget, INT_MAX);
+}
+
+
+//
+// Same as PickNodeWorker(), but the candidates are scored by several
+// threads.  Each thread keeps its own best, and a shared bound lets
+// them all prune early.  A seg is only ever pruned when its cost is
+// higher than the bound, so the lowest cost (and among equals, the
+// first seg in the usual order) is still found, which is the same seg
+// PickNodeWorker() would choose.
+//
+seg_t *LevelData::PickNodeParallel(const quadtree_c *tree, const std::vector<seg_t *>& candidates,
+		int *best_cost)
+{
+	// small batches, so the threads finish at about the same time
+	const size_t batch = 8;
+
+	std::atomic<size_t> next_batch = 0;
+	std::atomic<int> bound = *best_cost;
+
+	std::mutex best_mutex;
+	size_t best_index = candidates.size();
+
+	TaskGroup group(build_group->pool());
+
+	int num_tasks = build_group->pool().numThreads() + 1;
+
+	for (int t = 0 ; t < num_tasks ; t++)
+	{
+		group.run([&]()
+		{
+			int    my_cost  = INT_MAX;
+			size_t my_index = candidates.size();
+
+			for (;;)
+			{
+				size_t first = batch * next_batch++;
+
+				if (first >= candidates.size() || cur_info->cancelled)
+					break;
+
+				size_t last = std::min(first + batch, candidates.size());
+
+				for (size_t i = first ; i < last ; i++)
+				{
+					int cost = EvalPartition(tree, candidates[i], std::min(my_cost, bound.load()));
+
+					// batches are taken in order, so this keeps the first of equals
+					if (cost < 0 || cost >= my_cost)
+						continue;
+
+					my_cost  = cost;
+					my_index = i;
+
+					int cur_bound = bound.load();
+					while (cost < cur_bound && !bound.compare_exchange_weak(cur_bound, cost))
+					{ }
+				}
+			}
+
+			std::lock_guard<std::mutex> lock(best_mutex);
+
+			if (my_cost < *best_cost || (my_cost == *best_cost && my_index < best_index))
+			{
+				*best_cost = my_cost;
+				best_index = my_index;
+			}
+		});
+	}
+
+	group.wait();
+
+	if (best_index >= candidates.size())
+		return NULL;
+
+	return candidates[best_index];
 }
 
 
 //
 // Find the best seg in the seg_list to use as a partition line.
 //
-seg_t *LevelData::PickNode(quadtree_c *tree, int depth)
+seg_t *LevelData::PickNode(const quadtree_c *tree, int depth)
 {
 	seg_t *best=NULL;
 
@@ -741,7 +927,7 @@ seg_t *LevelData::PickNode(quadtree_c *tree, int depth)
 	 *       are axis-aligned and roughly divide the current group into
 	 *       two halves.  This can save *heaps* of times on large levels.
 	 */
-	if (cur_info->fast && tree->real_num >= SEG_FAST_THRESHHOLD)
+	if (cur_info->fast && tree->RealNum() >= SEG_FAST_THRESHHOLD)
 	{
 #   if DEBUG_PICKNODE
 		gLog.debugPrintf("PickNode: Looking for Fast node...\n");
@@ -760,7 +946,63 @@ seg_t *LevelData::PickNode(quadtree_c *tree, int depth)
 		}
 	}
 
-	if (! PickNodeWorker(tree, tree, &best, &best_cost))
+	int budget = PickBudget(depth);
+
+	if (budget > 0 && tree->RealNum() > budget)
+	{
+		std::vector<seg_t *> candidates;
+
+		SampleCandidates(tree, 0, budget, candidates);
+
+		// the halving axis-aligned segs, like in fast mode
+		seg_t *best_H = NULL;
+		seg_t *best_V = NULL;
+
+		EvaluateFastWorker(tree, &best_H, &best_V, (tree->boxes[0].x1 + tree->boxes[0].x2) / 2,
+				(tree->boxes[0].y1 + tree->boxes[0].y2) / 2);
+
+		for (seg_t *part : { best_H, best_V })
+			if (part && std::find(candidates.begin(), candidates.end(), part) == candidates.end())
+				candidates.push_back(part);
+
+		if (build_group && tree->RealNum() >= cur_info->pick_min_segs)
+		{
+			best = PickNodeParallel(tree, candidates, &best_cost);
+		}
+		else
+		{
+			for (seg_t *part : candidates)
+			{
+				if (cur_info->cancelled)
+					break;
+
+				int cost = EvalPartition(tree, part, best_cost);
+
+				if (cost >= 0 && cost < best_cost)
+				{
+					best_cost = cost;
+					best = part;
+				}
+			}
+		}
+
+		/* hack here : BuildNodes will detect the cancellation */
+		if (cur_info->cancelled)
+			return NULL;
+	}
+	else if (build_group && tree->RealNum() >= cur_info->pick_min_segs)
+	{
+		std::vector<seg_t *> candidates;
+
+		CollectCandidates(tree, candidates);
+
+		best = PickNodeParallel(tree, candidates, &best_cost);
+
+		/* hack here : BuildNodes will detect the cancellation */
+		if (cur_info->cancelled)
+			return NULL;
+	}
+	else if (! PickNodeWorker(tree, &best, &best_cost))
 	{
 		/* hack here : BuildNodes will detect the cancellation */
 		return NULL;
@@ -814,8 +1056,8 @@ void LevelData::DivideOneSeg(seg_t *seg, seg_t *part,
 	/* check for being on the same line */
 	if (fabs(a) <= DIST_EPSILON && fabs(b) <= DIST_EPSILON)
 	{
-		AddIntersection(cut_list, seg->start, part, self_ref);
-		AddIntersection(cut_list, seg->end,   part, self_ref);
+		AddIntersection(Arenas().cuts, cut_list, seg->start, part, self_ref);
+		AddIntersection(Arenas().cuts, cut_list, seg->end,   part, self_ref);
 
 		// this seg runs along the same line as the partition.  check
 		// whether it goes in the same direction or the opposite.
@@ -836,9 +1078,9 @@ void LevelData::DivideOneSeg(seg_t *seg, seg_t *part,
 	if (a > -DIST_EPSILON && b > -DIST_EPSILON)
 	{
 		if (a < DIST_EPSILON)
-			AddIntersection(cut_list, seg->start, part, self_ref);
+			AddIntersection(Arenas().cuts, cut_list, seg->start, part, self_ref);
 		else if (b < DIST_EPSILON)
-			AddIntersection(cut_list, seg->end, part, self_ref);
+			AddIntersection(Arenas().cuts, cut_list, seg->end, part, self_ref);
 
 		ListAddSeg(right_list, seg);
 		return;
@@ -848,9 +1090,9 @@ void LevelData::DivideOneSeg(seg_t *seg, seg_t *part,
 	if (a < DIST_EPSILON && b < DIST_EPSILON)
 	{
 		if (a > -DIST_EPSILON)
-			AddIntersection(cut_list, seg->start, part, self_ref);
+			AddIntersection(Arenas().cuts, cut_list, seg->start, part, self_ref);
 		else if (b > -DIST_EPSILON)
-			AddIntersection(cut_list, seg->end, part, self_ref);
+			AddIntersection(Arenas().cuts, cut_list, seg->end, part, self_ref);
 
 		ListAddSeg(left_list, seg);
 		return;
@@ -863,7 +1105,7 @@ void LevelData::DivideOneSeg(seg_t *seg, seg_t *part,
 
 	new_seg = SplitSeg(seg, x, y);
 
-	AddIntersection(cut_list, seg->end, part, self_ref);
+	AddIntersection(Arenas().cuts, cut_list, seg->end, part, self_ref);
 
 	if (a < 0)
 	{
@@ -878,28 +1120,23 @@ void LevelData::DivideOneSeg(seg_t *seg, seg_t *part,
 }
 
 
-void LevelData::SeparateSegs(quadtree_c *tree, seg_t *part,
+void LevelData::SeparateSegs(const quadtree_c *tree, seg_t *part,
 		seg_t **left_list, seg_t **right_list,
 		intersection_t ** cut_list)
 {
-	while (tree->list != NULL)
+	for (seg_t *seg : tree->block.segs)
 	{
-		seg_t *seg = tree->list;
-		tree->list = seg->next;
-
-		seg->quad = NULL;
+		// splitting a seg puts the new piece of its partner after the
+		// partner, so those pieces come straight after it.
+		while (seg != NULL)
+		{
+			seg_t *next = seg->next;
 
-		DivideOneSeg(seg, part, left_list, right_list, cut_list);
-	}
+			DivideOneSeg(seg, part, left_list, right_list, cut_list);
 
-	// recursively handle sub-blocks
-	if (tree->subs[0])
-	{
-		SeparateSegs(tree->subs[0], part, left_list, right_list, cut_list);
-		SeparateSegs(tree->subs[1], part, left_list, right_list, cut_list);
+			seg = next;
+		}
 	}
-
-	// this quadtree_c is empty now
 }
 
 
@@ -995,6 +1232,8 @@ void LevelData::AddMinisegs(intersection_t *cut_list, seg_t *part,
 		seg = NewSeg();
 		buddy = NewSeg();
 
+		minisegs_made++;
+
 		seg->partner = buddy;
 		buddy->partner = seg;
 
@@ -1026,14 +1265,15 @@ void LevelData::AddMinisegs(intersection_t *cut_list, seg_t *part,
 #   endif
 	}
 
-	// free intersection structures into quick-alloc list
+	// give the intersection structures back, for re-use
+	arena_c<intersection_t>& cuts = Arenas().cuts;
+
 	while (cut_list)
 	{
 		cur = cut_list;
 		cut_list = cur->next;
 
-		cur->next = quick_alloc_cuts;
-		quick_alloc_cuts = cur;
+		cuts.Free(cur);
 	}
 }
 
@@ -1074,12 +1314,14 @@ Side seg_t::PointOnLineSide(double x, double y) const
 }
 
 
-Side quadtree_c::OnLineSide(const seg_t *part) const
+Side quadtree_c::OnLineSide(int box, const seg_t *part) const
 {
-	double tx1 = (double)x1 - IFFY_LEN;
-	double ty1 = (double)y1 - IFFY_LEN;
-	double tx2 = (double)x2 + IFFY_LEN;
-	double ty2 = (double)y2 + IFFY_LEN;
+	const box_t &B = boxes[box];
+
+	double tx1 = (double)B.x1 - IFFY_LEN;
+	double ty1 = (double)B.y1 - IFFY_LEN;
+	double tx2 = (double)B.x2 + IFFY_LEN;
+	double ty2 = (double)B.y2 + IFFY_LEN;
 
 	Side p1, p2;
 
@@ -1127,19 +1369,18 @@ Side quadtree_c::OnLineSide(const seg_t *part) const
 
 
 #if 0  // DEBUG HELPER
-void quadtree_c::VerifySide(seg_t *part, int side)
+void quadtree_c::VerifySide(int box, seg_t *part, Side side)
 {
-	for (seg_t *seg = list ; seg != NULL ; seg = seg->next)
+	for (int i = boxes[box].first ; i < boxes[box].end ; i++)
 	{
+		const seg_t *seg = block.segs[i];
+
 		Side p1 = part->PointOnLineSide(seg->psx, seg->psy);
 		if (p1 != side) BugError("VerifySide failed.\n");
 
 		Side p2 = part->PointOnLineSide(seg->pex, seg->pey);
 		if (p2 != side) BugError("VerifySide failed.\n");
 	}
-
-	if (subs[0]) subs[0]->VerifySide(part, side);
-	if (subs[1]) subs[1]->VerifySide(part, side);
 }
 #endif
 
@@ -1148,6 +1389,11 @@ void node_t::SetPartition(LevelData &lev_data, const seg_t *part)
 {
 	SYS_ASSERT(part->linedef >= 0);
 
+	psx = part->psx;
+	psy = part->psy;
+	pex = part->pex;
+	pey = part->pey;
+
 	const auto part_L = lev_data.GetDoc().linedefs[part->linedef];
 
 	if (part->side == 0)  /* right side */
@@ -1193,50 +1439,77 @@ void node_t::SetPartition(LevelData &lev_data, const seg_t *part)
 
 /* ----- quad-tree routines ------------------------------------ */
 
-quadtree_c::quadtree_c(int _x1, int _y1, int _x2, int _y2) :
-	x1(_x1), y1(_y1),
-	x2(_x2), y2(_y2),
-	real_num(0), mini_num(0),
-	list(NULL)
+void quadtree_c::InitBox(int box, int x1, int y1, int x2, int y2)
 {
+	if (box >= (int)boxes.size())
+		boxes.resize(box + 1);
+
+	box_t &B = boxes[box];
+
+	B.x1 = x1;
+	B.y1 = y1;
+	B.x2 = x2;
+	B.y2 = y2;
+
+	B.real_num = 0;
+	B.mini_num = 0;
+	B.count = 0;
+
+	num_boxes++;
+
 	int dx = x2 - x1;
 	int dy = y2 - y1;
 
+	B.leaf = (dx <= 320 && dy <= 320);
+
+	// [ no reference to B from here on, the array may move ]
+
 	if (dx <= 320 && dy <= 320)
 	{
-		// leaf node
-		subs[0] = NULL;
-		subs[1] = NULL;
+		// leaf box
 	}
 	else if (dx >= dy)
 	{
-		subs[0] = new quadtree_c(x1, y1, x1 + dx/2, y2);
-		subs[1] = new quadtree_c(x1 + dx/2, y1, x2, y2);
+		InitBox(Sub(box, 0), x1, y1, x1 + dx/2, y2);
+		InitBox(Sub(box, 1), x1 + dx/2, y1, x2, y2);
 	}
 	else
 	{
-		subs[0] = new quadtree_c(x1, y1, x2, y1 + dy/2);
-		subs[1] = new quadtree_c(x1, y1 + dy/2, x2, y2);
+		InitBox(Sub(box, 0), x1, y1, x2, y1 + dy/2);
+		InitBox(Sub(box, 1), x1, y1 + dy/2, x2, y2);
 	}
 }
 
 
-quadtree_c::~quadtree_c()
+int quadtree_c::LayoutBox(int box, int first)
 {
-	if (subs[0] != NULL) delete subs[0];
-	if (subs[1] != NULL) delete subs[1];
+	box_t &B = boxes[box];
+
+	B.first = first;
+	B.fill  = first + B.count;
+	B.end   = B.fill;
+
+	if (! B.leaf)
+	{
+		B.end = LayoutBox(Sub(box, 0), B.end);
+		B.end = LayoutBox(Sub(box, 1), B.end);
+	}
+
+	return B.end;
 }
 
 
-void quadtree_c::AddSeg(seg_t *seg)
+void quadtree_c::Build(seg_t *list, const bbox_t *bounds)
 {
-	// update seg counts
-	if (seg->linedef >= 0)
-		real_num++;
-	else
-		mini_num++;
+	num_boxes = 0;
+
+	InitBox(0, bounds->minx, bounds->miny, bounds->maxx, bounds->maxy);
 
-	if (subs[0] != NULL)
+	// find the box of each seg, counting it there and in all the boxes
+	// it passes through on the way down
+	seg_boxes.clear();
+
+	for (seg_t *seg = list ; seg ; seg = seg->next)
 	{
 		double x_min = std::min(seg->start->x, seg->end->x);
 		double y_min = std::min(seg->start->y, seg->end->y);
@@ -1244,71 +1517,77 @@ void quadtree_c::AddSeg(seg_t *seg)
 		double x_max = std::max(seg->start->x, seg->end->x);
 		double y_max = std::max(seg->start->y, seg->end->y);
 
-		if ((x2 - x1) >= (y2 - y1))
-		{
-			if (x_min > subs[1]->x1)
-			{
-				subs[1]->AddSeg(seg);
-				return;
-			}
-			else if (x_max < subs[0]->x2)
-			{
-				subs[0]->AddSeg(seg);
-				return;
-			}
-		}
-		else
+		int box = 0;
+
+		for (;;)
 		{
-			if (y_min > subs[1]->y1)
+			box_t &B = boxes[box];
+
+			if (seg->linedef >= 0)
+				B.real_num++;
+			else
+				B.mini_num++;
+
+			if (B.leaf)
+				break;
+
+			const box_t &S0 = boxes[Sub(box, 0)];
+			const box_t &S1 = boxes[Sub(box, 1)];
+
+			if ((B.x2 - B.x1) >= (B.y2 - B.y1))
 			{
-				subs[1]->AddSeg(seg);
-				return;
+				if (x_min > S1.x1)
+					box = Sub(box, 1);
+				else if (x_max < S0.x2)
+					box = Sub(box, 0);
+				else
+					break;
 			}
-			else if (y_max < subs[0]->y2)
+			else
 			{
-				subs[0]->AddSeg(seg);
-				return;
+				if (y_min > S1.y1)
+					box = Sub(box, 1);
+				else if (y_max < S0.y2)
+					box = Sub(box, 0);
+				else
+					break;
 			}
 		}
-	}
 
-	// link into this node
+		boxes[box].count++;
 
-	ListAddSeg(&list, seg);
+		seg_boxes.push_back(box);
+	}
 
-	seg->quad = this;
-}
+	int total = LayoutBox(0, 0);
 
+	// the segs of a box go in the opposite order to the list, as they
+	// did when each box had a list of its own
+	placed.resize(total);
 
-void quadtree_c::AddList(seg_t *_list)
-{
-	while (_list != NULL)
-	{
-		seg_t *seg = _list;
-		_list = seg->next;
+	int k = 0;
 
-		AddSeg(seg);
-   }
-}
+	for (seg_t *seg = list ; seg ; seg = seg->next)
+		placed[--boxes[seg_boxes[k++]].fill] = seg;
 
+	block.Clear();
 
-void quadtree_c::ConvertToList(seg_t **_list)
-{
-	while (list != NULL)
+	for (seg_t *seg : placed)
 	{
-		seg_t *seg = list;
-		list = seg->next;
+		block.Add(seg, seg->psx, seg->psy, seg->pex, seg->pey,
+				  seg->source_line, seg->linedef >= 0);
 
-		ListAddSeg(_list, seg);
+		// only the pieces split off a partner are linked to it
+		// (see SplitSeg and SeparateSegs)
+		seg->next = NULL;
 	}
+}
 
-	if (subs[0] != NULL)
-	{
-		subs[0]->ConvertToList(_list);
-		subs[1]->ConvertToList(_list);
-	}
 
-	// this quadtree is empty now
+void quadtree_c::ConvertToList(seg_t **_list) const
+{
+	for (seg_t *seg : block.segs)
+		ListAddSeg(_list, seg);
 }
 
 
@@ -1317,7 +1596,7 @@ seg_t *LevelData::CreateOneSeg(int line, vertex_t *start, vertex_t *end,
 {
 	const SideDef *sd = NULL;
 	if (sidedef >= 0)
-		sd = doc.sidedefs[sidedef].get();
+		sd = doc.sidedefs[sidedef];
 
 	// check for bad sidedef
 	if (sd && !doc.isSector(sd->sector))
@@ -1366,7 +1645,7 @@ seg_t *LevelData::CreateSegs()
 			continue;
 
 		// ignore overlapping lines
-		if (line->flags & MLF_IS_OVERLAP)
+		if (line_flags[i] & MLF_IS_OVERLAP)
 			continue;
 
 		// check for extremely long lines
@@ -1411,20 +1690,10 @@ seg_t *LevelData::CreateSegs()
 }
 
 
-static quadtree_c *TreeFromSegList(seg_t *list, const bbox_t *bounds)
+void subsec_t::DetermineMiddle()
 {
-	quadtree_c *tree = new quadtree_c(bounds->minx, bounds->miny, bounds->maxx, bounds->maxy);
-
-	tree->AddList(list);
-
-	return tree;
-}
-
-
-void subsec_t::DetermineMiddle()
-{
-	mid_x = 0.0;
-	mid_y = 0.0;
+	mid_x = 0.0;
+	mid_y = 0.0;
 
 	int total=0;
 
@@ -1629,12 +1898,14 @@ void subsec_t::RenumberSegs()
 //
 // Create a subsector from a list of segs.
 //
-subsec_t *LevelData::CreateSubsector(quadtree_c *tree)
+subsec_t *LevelData::CreateSubsector(const quadtree_c *tree)
 {
 	subsec_t *sub = NewSubsec();
 
 	// compute subsector's index
-	sub->index = (int)subsecs.size() - 1;
+	// [ a parallel build numbers them when merging the task ]
+	if (! cur_build_task)
+		sub->index = (int)subsecs.size() - 1;
 
 	// copy segs into subsector
 	// [ assumes seg_list field is NULL ]
@@ -1642,6 +1913,20 @@ subsec_t *LevelData::CreateSubsector(quadtree_c *tree)
 
 	sub->DetermineMiddle();
 
+	if (cur_build_task)
+		FinishSubsector(sub);
+
+	// the share of the real segs which have found their subsector
+	{
+		int placed = (segs_placed += tree->RealNum());
+		int total  = std::max(1, initial_segs + seg_splits);
+
+		int first = BuildPhaseProgress(PHASE_Nodes);
+		int last  = BuildPhaseProgress(PHASE_Clockwise);
+
+		cur_info->progress = first + (last - first) * std::min(placed, total) / total;
+	}
+
 # if DEBUG_SUBSEC
 	gLog.debugPrintf("Subsec: Creating %d\n", sub->index);
 # endif
@@ -1682,7 +1967,7 @@ static void DebugShowSegs(seg_t *list)
 
 
 build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
-						  node_t ** N, subsec_t ** S, int depth)
+						  node_t ** N, subsec_t ** S, int depth, int reuse)
 {
 	*N = NULL;
 	*S = NULL;
@@ -1698,11 +1983,33 @@ build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 	// determine bounds of segs
 	FindLimits2(list, bounds);
 
-	quadtree_c *tree = TreeFromSegList(list, bounds);
+	quadtree_c *tree = &Quadtree();
+
+	tree->Build(list, bounds);
+
+	quad_boxes += tree->num_boxes;
 
 
 	/* pick partition line  None indicates convexicity */
-	seg_t *part = PickNode(tree, depth);
+	seg_t *part = NULL;
+
+	if (reuse >= 0)
+		part = ReusePartition(tree, bounds, reuse);
+
+	if (part)
+	{
+		parts_reused++;
+	}
+	else
+	{
+		// nothing below here can be used again either
+		reuse = -1;
+
+		part = PickNode(tree, depth);
+
+		if (part && ! prev_history.nodes.empty())
+			parts_picked++;
+	}
 
 	if (part == NULL)
 	{
@@ -1712,8 +2019,6 @@ build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 
 		*S = CreateSubsector(tree);
 
-		delete tree;
-
 		if (cur_info->cancelled)
 			return BUILD_Cancelled;
 
@@ -1735,7 +2040,7 @@ build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 
 	SeparateSegs(tree, part, &lefts, &rights, &cut_list);
 
-	delete tree;
+	// the tree is built again by the calls below
 	tree = NULL;
 
 	/* sanity checks... */
@@ -1749,12 +2054,56 @@ build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 
 	node->SetPartition(*this, part);
 
+	// when building in parallel, the right side may become a task
+	build_task_t *right_task = NULL;
+	size_t num_spawned = 0;
+
+	if (cur_build_task)
+	{
+		right_task = SpawnBuildTask(lefts, rights, &node->r, depth+1,
+				(reuse >= 0) ? prev_history.nodes[reuse].right : -1);
+
+		num_spawned = cur_build_task->spawned.size();
+	}
+
 # if DEBUG_BUILDER
 	gLog.debugPrintf("Build: Going LEFT\n");
 # endif
 
 	build_result_e ret;
-	ret = BuildNodes(lefts, &node->l.bounds, &node->l.node, &node->l.subsec, depth+1);
+	ret = BuildNodes(lefts, &node->l.bounds, &node->l.node, &node->l.subsec, depth+1,
+			(reuse >= 0) ? prev_history.nodes[reuse].left : -1);
+
+	if (right_task && right_task->held)
+	{
+		if (cur_build_task->spawned.size() == num_spawned)
+		{
+			// every seg it waited for is in a subsector by now
+			SYS_ASSERT(right_task->blockers == 1);
+
+			cur_build_task->spawned.pop_back();
+			right_task = NULL;
+		}
+		else if (--right_task->blockers == 0)
+		{
+			StartBuildTask(right_task);
+		}
+	}
+
+	if (right_task)
+	{
+		// its output goes after everything from the left side
+		build_task_t::mark_t mark;
+
+		mark.task = right_task;
+		mark.num_vertices = cur_build_task->vertices.size();
+		mark.num_subsecs  = cur_build_task->subsecs.size();
+		mark.num_messages = cur_build_task->messages.size();
+
+		cur_build_task->marks.push_back(mark);
+
+		return ret;
+	}
 
 	if (ret != BUILD_OK)
 		return ret;
@@ -1763,7 +2112,8 @@ build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 	gLog.debugPrintf("Build: Going RIGHT\n");
 # endif
 
-	ret = BuildNodes(rights, &node->r.bounds, &node->r.node, &node->r.subsec, depth+1);
+	ret = BuildNodes(rights, &node->r.bounds, &node->r.node, &node->r.subsec, depth+1,
+			(reuse >= 0) ? prev_history.nodes[reuse].right : -1);
 
 # if DEBUG_BUILDER
 	gLog.debugPrintf("Build: DONE\n");
@@ -1773,6 +2123,487 @@ build_result_e LevelData::BuildNodes(seg_t *list, bbox_t *bounds /* output */,
 }
 
 
+//------------------------------------------------------------------------
+// PARALLEL : Build independent subtrees as separate tasks.
+//------------------------------------------------------------------------
+
+
+//
+// Build the nodes with the work spread over several threads.  Each task
+// builds its left side itself, and may hand the right side over to a new
+// task (see SpawnBuildTask).  The output is exactly the same as from the
+// serial BuildNodes().
+//
+build_result_e LevelData::BuildNodesParallel(seg_t *list, bbox_t *bounds,
+		node_t ** N, subsec_t ** S)
+{
+	// a specific number of threads gets a pool of its own
+	std::unique_ptr<ThreadPool> own_pool;
+
+	ThreadPool *pool = cur_info->pool;
+
+	if (! pool)
+	{
+		if (cur_info->jobs > 1)
+			own_pool = std::make_unique<ThreadPool>(cur_info->jobs - 1);
+
+		pool = own_pool ? own_pool.get() : &ThreadPool::shared();
+	}
+
+	TaskGroup group(*pool);
+
+	build_task_t root;
+
+	root.list   = list;
+	root.bounds = bounds;
+	root.N = N;
+	root.S = S;
+	root.reuse = prev_history.nodes.empty() ? -1 : 0;
+
+	build_result_e ret;
+
+	build_group = &group;
+
+	try
+	{
+		StartBuildTask(&root);
+		group.wait();
+
+		ret = CheckBuildTask(&root);
+	}
+	catch (...)
+	{
+		// still need all the allocations, so they get freed
+		build_group = NULL;
+		MergeBuildTask(&root, false);
+		throw;
+	}
+
+	build_group = NULL;
+
+	MergeBuildTask(&root, ret == BUILD_OK);
+
+	return ret;
+}
+
+
+//
+// Decide whether the right side of a node becomes a task of its own, and
+// set it up when so.  Its start is held back until every seg on the left
+// side which has a partner on the right side is in a subsector.
+//
+// A right side with too few segs is only held, since it is a task only
+// when the left side hands some of its own subtrees to tasks: those may
+// split the partners of its segs after the left side has returned.
+//
+build_task_t *LevelData::SpawnBuildTask(seg_t *lefts, seg_t *rights,
+		child_t *child, int depth, int reuse)
+{
+	if (depth > cur_info->task_depth)
+		return NULL;
+
+	int count = 0;
+
+	for (seg_t *seg = rights ; seg ; seg = seg->next)
+		count++;
+
+	std::unordered_set<const seg_t *> right_segs;
+
+	right_segs.reserve(count);
+
+	for (seg_t *seg = rights ; seg ; seg = seg->next)
+		right_segs.insert(seg);
+
+	build_task_t *task = new build_task_t;
+
+	cur_build_task->spawned.emplace_back(task);
+
+	task->list   = rights;
+	task->bounds = &child->bounds;
+	task->N = &child->node;
+	task->S = &child->subsec;
+	task->depth = depth;
+	task->reuse = reuse;
+
+	int blockers = 0;
+
+	for (seg_t *seg = lefts ; seg ; seg = seg->next)
+	{
+		if (seg->partner && right_segs.count(seg->partner) > 0)
+		{
+			SYS_ASSERT(seg->waiter == NULL);
+
+			seg->waiter = task;
+			blockers++;
+		}
+	}
+
+	if (count < cur_info->task_min_segs)
+	{
+		task->held = true;
+		blockers++;
+	}
+
+	task->blockers = blockers;
+
+	if (blockers == 0)
+		StartBuildTask(task);
+
+	return task;
+}
+
+
+void LevelData::StartBuildTask(build_task_t *task)
+{
+	build_group->run([this, task]()
+	{
+		RunBuildTask(task);
+	});
+}
+
+
+void LevelData::RunBuildTask(build_task_t *task)
+{
+	// this thread may be helping out while waiting for another task
+	build_task_t *saved_task = cur_build_task;
+
+	cur_build_task = task;
+	task->started = true;
+
+	try
+	{
+		task->result = BuildNodes(task->list, task->bounds, task->N, task->S, task->depth,
+				task->reuse);
+	}
+	catch (...)
+	{
+		cur_build_task = saved_task;
+		throw;
+	}
+
+	cur_build_task = saved_task;
+}
+
+
+//
+// A subsector was created: start any task waiting on the last of its segs.
+// They are started after going through the list, since a task which
+// splits the partner of one of these segs adds the new piece to it.
+//
+void LevelData::FinishSubsector(subsec_t *sub)
+{
+	std::vector<build_task_t *> ready;
+
+	for (seg_t *seg = sub->seg_list ; seg ; seg = seg->next)
+	{
+		build_task_t *task = seg->waiter;
+
+		if (task == NULL)
+			continue;
+
+		seg->waiter = NULL;
+
+		if (--task->blockers == 0)
+			ready.push_back(task);
+	}
+
+	for (build_task_t *task : ready)
+		StartBuildTask(task);
+}
+
+
+build_result_e LevelData::CheckBuildTask(const build_task_t *task) const
+{
+	if (! task->started)
+	{
+		// a cancelled task leaves the ones waiting on it hanging
+		if (cur_info->cancelled)
+			return BUILD_Cancelled;
+
+		BugError("Node building task never started\n");
+	}
+
+	if (task->result != BUILD_OK)
+		return task->result;
+
+	for (const auto &child : task->spawned)
+	{
+		build_result_e ret = CheckBuildTask(child.get());
+
+		if (ret != BUILD_OK)
+			return ret;
+	}
+
+	return BUILD_OK;
+}
+
+
+//
+// Move everything a task allocated into the level, numbering the new
+// vertices and the subsectors.  When 'in_order' is false (the build has
+// failed) the order does not matter, it all just needs to be freed.
+//
+void LevelData::MergeBuildTask(build_task_t *task, bool in_order)
+{
+	size_t num_vertices = 0;
+	size_t num_subsecs  = 0;
+	size_t num_messages = 0;
+
+	auto take_upto = [&](size_t vertex_end, size_t subsec_end, size_t message_end)
+	{
+		for ( ; num_vertices < vertex_end ; num_vertices++)
+		{
+			vertex_t *vert = task->vertices[num_vertices];
+
+			vert->index = num_new_vert;
+			num_new_vert++;
+
+			vertices.push_back(vert);
+		}
+
+		for ( ; num_subsecs < subsec_end ; num_subsecs++)
+		{
+			subsec_t *sub = task->subsecs[num_subsecs];
+
+			sub->index = (int)subsecs.size();
+
+			subsecs.push_back(sub);
+		}
+
+		for ( ; num_messages < message_end ; num_messages++)
+			if (reportLog)
+				reportLog(task->messages[num_messages]);
+	};
+
+	if (in_order)
+	{
+		for (const build_task_t::mark_t &mark : task->marks)
+		{
+			take_upto(mark.num_vertices, mark.num_subsecs, mark.num_messages);
+
+			MergeBuildTask(mark.task, true);
+		}
+	}
+
+	take_upto(task->vertices.size(), task->subsecs.size(), task->messages.size());
+
+	if (! in_order)
+	{
+		for (const auto &child : task->spawned)
+			MergeBuildTask(child.get(), false);
+	}
+
+	segs.insert(segs.end(), task->segs.begin(), task->segs.end());
+	nodes.insert(nodes.end(), task->nodes.begin(), task->nodes.end());
+	walltips.insert(walltips.end(), task->walltips.begin(), task->walltips.end());
+
+	cur_info->total_warnings += task->warnings;
+
+	arenas.Adopt(task->arenas);
+}
+
+
+//------------------------------------------------------------------------
+// INCREMENTAL : Use the partitions of an earlier build again.
+//------------------------------------------------------------------------
+
+
+//
+// Remember the segs of the level, and when the history is from an
+// earlier build of it, find what changed since.  The old partitions
+// are only looked at after that (see ReusePartition).
+//
+void LevelData::PrepareHistory(seg_t *list)
+{
+	bsp_history_t *history = cur_info->history;
+
+	cur_segs.clear();
+
+	for (seg_t *seg = list ; seg ; seg = seg->next)
+		cur_segs.push_back({ seg->psx, seg->psy, seg->pex, seg->pey });
+
+	std::sort(cur_segs.begin(), cur_segs.end());
+
+	if (history->nodes.empty() || history->level != current_name ||
+		history->format != format || history->factor != cur_info->factor ||
+		history->fast != cur_info->fast)
+	{
+		return;
+	}
+
+	std::vector<std::array<double, 4>> changed;
+
+	std::set_symmetric_difference(history->segs.begin(), history->segs.end(),
+			cur_segs.begin(), cur_segs.end(), std::back_inserter(changed));
+
+	// with most of the level changed, a full build is hardly slower
+	if (changed.size() * 2 > cur_segs.size())
+	{
+		PrintMsg("Too many changes (%d segs) to keep the partitions\n", (int)changed.size());
+		return;
+	}
+
+	changed_boxes.clear();
+
+	for (const auto &seg : changed)
+	{
+		bbox_t box;
+
+		box.minx = (int)floor(std::min(seg[0], seg[2]));
+		box.miny = (int)floor(std::min(seg[1], seg[3]));
+		box.maxx = (int)ceil(std::max(seg[0], seg[2]));
+		box.maxy = (int)ceil(std::max(seg[1], seg[3]));
+
+		changed_boxes.push_back(box);
+	}
+
+	prev_history = std::move(*history);
+}
+
+
+static seg_t *FindPartitionSeg(const quadtree_c *tree, const bsp_history_t::partition_t &P)
+{
+	for (seg_t *seg : tree->block.segs)
+	{
+		if (seg->linedef >= 0 &&
+			seg->psx == P.x1 && seg->psy == P.y1 &&
+			seg->pex == P.x2 && seg->pey == P.y2)
+		{
+			return seg;
+		}
+	}
+
+	return NULL;
+}
+
+
+//
+// Returns the seg the earlier build used as the partition here, when it
+// is still there, does not pass through any of the changes, and still
+// has real segs on both sides.  Otherwise returns NULL, and a partition
+// must be picked.
+//
+seg_t *LevelData::ReusePartition(const quadtree_c *tree, const bbox_t *bounds, int reuse)
+{
+	const bsp_history_t::partition_t &P = prev_history.nodes[reuse];
+
+	// the segs here now, and those which were here before
+	int minx = std::min(bounds->minx, P.minx);
+	int miny = std::min(bounds->miny, P.miny);
+	int maxx = std::max(bounds->maxx, P.maxx);
+	int maxy = std::max(bounds->maxy, P.maxy);
+
+	double dx  = P.x2 - P.x1;
+	double dy  = P.y2 - P.y1;
+	double len = hypot(dx, dy);
+
+	for (const bbox_t &box : changed_boxes)
+	{
+		if (box.maxx < minx || box.minx > maxx ||
+			box.maxy < miny || box.miny > maxy)
+		{
+			continue;
+		}
+
+		// is the box on both sides of the partition, or close to it?
+		double lo =  1e30;
+		double hi = -1e30;
+
+		for (int c=0 ; c < 4 ; c++)
+		{
+			double x = (c & 1) ? box.maxx : box.minx;
+			double y = (c & 2) ? box.maxy : box.miny;
+
+			double dist = ((x - P.x1) * dy - (y - P.y1) * dx) / len;
+
+			lo = std::min(lo, dist);
+			hi = std::max(hi, dist);
+		}
+
+		if (lo < IFFY_LEN && hi > -IFFY_LEN)
+			return NULL;
+	}
+
+	seg_t *part = FindPartitionSeg(tree, P);
+
+	if (part == NULL)
+		return NULL;
+
+	if (EvalPartition(tree, part, INT_MAX) < 0)
+		return NULL;
+
+	return part;
+}
+
+
+static int RecordPartition(std::vector<bsp_history_t::partition_t> &list, const node_t *node)
+{
+	int index = (int)list.size();
+
+	bsp_history_t::partition_t P;
+
+	P.x1 = node->psx;
+	P.y1 = node->psy;
+	P.x2 = node->pex;
+	P.y2 = node->pey;
+
+	P.minx = std::min(node->r.bounds.minx, node->l.bounds.minx);
+	P.miny = std::min(node->r.bounds.miny, node->l.bounds.miny);
+	P.maxx = std::max(node->r.bounds.maxx, node->l.bounds.maxx);
+	P.maxy = std::max(node->r.bounds.maxy, node->l.bounds.maxy);
+
+	list.push_back(P);
+
+	int right = node->r.node ? RecordPartition(list, node->r.node) : -1;
+	int left  = node->l.node ? RecordPartition(list, node->l.node) : -1;
+
+	list[index].right = right;
+	list[index].left  = left;
+
+	return index;
+}
+
+
+//
+// Keep the partitions of this build for the next one, and show how
+// the time compares with building from scratch.
+//
+void LevelData::RecordHistory(node_t *root, double build_time)
+{
+	bsp_history_t *history = cur_info->history;
+
+	bool incremental = ! prev_history.nodes.empty();
+
+	history->Clear();
+
+	history->level  = current_name;
+	history->format = format;
+	history->factor = cur_info->factor;
+	history->fast   = cur_info->fast;
+	history->segs   = std::move(cur_segs);
+
+	if (root)
+		RecordPartition(history->nodes, root);
+
+	if (! incremental)
+	{
+		history->full_time = build_time;
+		return;
+	}
+
+	history->full_time   = prev_history.full_time;
+	history->incremental = true;
+	history->reused      = parts_reused;
+	history->picked      = parts_picked;
+
+	PrintMsg("Incremental build: %d segs changed, %d partitions kept, %d picked\n",
+			(int)changed_boxes.size(), history->reused, history->picked);
+
+	PrintMsg("Nodes built in %1.3f sec (the last full build took %1.3f sec)\n",
+			build_time, history->full_time);
+}
+
+
 void LevelData::ClockwiseBspTree()
 {
 	current_seg_index = 0;
@@ -0,0 +1,615 @@
+//------------------------------------------------------------------------
+//  REJECT : Sector to sector visibility
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+//
+// A line of sight from one sector to another crosses a chain of two-sided
+// linedefs (portals), each leading into the sector the next one belongs
+// to.  Starting from every portal of a sector, we follow those chains,
+// keeping only the parts of each portal which a straight line through
+// the first portal and the last one can still reach (the same clipping
+// to separating lines as a Quake style "vis" tool).
+//
+// Everything is done conservatively: heights are ignored (doors open),
+// points near a clipping line are kept, and a sector which is not closed
+// by its linedefs, or which could not be finished within the time limit,
+// is taken to see every sector it is connected to.  Sight is symmetric,
+// so a pair is only rejected when neither sector can see the other.
+//
+
+#include "bsp.h"
+#include "Document.h"
+#include "Errors.h"
+#include "sys_debug.h"
+
+#include <algorithm>
+#include <chrono>
+
+
+namespace ajbsp
+{
+
+// points this close to a clipping line are kept
+#define SIGHT_EPSILON  (1.0 / 16.0)
+
+// how often the flow looks at the clock and the cancel flag
+#define SIGHT_CHECK_STEPS  1024
+
+
+struct sight_seg_t
+{
+	double x1, y1;
+	double x2, y2;
+};
+
+
+struct sight_portal_t
+{
+	sight_seg_t seg;
+
+	// crossing the line leads from 'from' into 'to', which is in front
+	int from, to;
+
+	// the same linedef crossed the other way
+	int reverse;
+
+	// unit normal pointing into 'to', and distance from the origin
+	double nx, ny, dist;
+};
+
+
+//
+// Keeps the part of the seg where  x * nx + y * ny >= dist  (give or
+// take the epsilon).  Returns false when nothing is left.
+//
+static bool ClipSightSeg(sight_seg_t &seg, double nx, double ny, double dist)
+{
+	double d1 = seg.x1 * nx + seg.y1 * ny - dist;
+	double d2 = seg.x2 * nx + seg.y2 * ny - dist;
+
+	if (d1 < -SIGHT_EPSILON && d2 < -SIGHT_EPSILON)
+		return false;
+
+	if (d1 >= -SIGHT_EPSILON && d2 >= -SIGHT_EPSILON)
+		return true;
+
+	double t = (d1 + SIGHT_EPSILON) / (d1 - d2);
+
+	double x = seg.x1 + t * (seg.x2 - seg.x1);
+	double y = seg.y1 + t * (seg.y2 - seg.y1);
+
+	if (d1 < -SIGHT_EPSILON)
+	{
+		seg.x1 = x;
+		seg.y1 = y;
+	}
+	else
+	{
+		seg.x2 = x;
+		seg.y2 = y;
+	}
+
+	return true;
+}
+
+
+//
+// Clips 'target' to the part which a line through both 'src' and 'pass'
+// can reach.  Such lines lie between the separating lines, which go
+// through an end of each seg and have the other ends on opposite sides.
+// Returns false when nothing is left.
+//
+static bool ClipToSeparators(const sight_seg_t &src, const sight_seg_t &pass,
+		sight_seg_t &target)
+{
+	const double sp[2][2] = { { src.x1,  src.y1  }, { src.x2,  src.y2  } };
+	const double pp[2][2] = { { pass.x1, pass.y1 }, { pass.x2, pass.y2 } };
+
+	for (int i = 0 ; i < 2 ; i++)
+	for (int k = 0 ; k < 2 ; k++)
+	{
+		double dx = pp[k][0] - sp[i][0];
+		double dy = pp[k][1] - sp[i][1];
+
+		double len = hypot(dx, dy);
+
+		if (len < SIGHT_EPSILON)
+			continue;
+
+		double nx = -dy / len;
+		double ny =  dx / len;
+
+		double dist = sp[i][0] * nx + sp[i][1] * ny;
+
+		double d_src  = sp[1-i][0] * nx + sp[1-i][1] * ny - dist;
+		double d_pass = pp[1-k][0] * nx + pp[1-k][1] * ny - dist;
+
+		// keep the side the rest of the pass seg is on
+		if (d_src < -SIGHT_EPSILON && d_pass > SIGHT_EPSILON)
+		{
+			if (! ClipSightSeg(target, nx, ny, dist))
+				return false;
+		}
+		else if (d_src > SIGHT_EPSILON && d_pass < -SIGHT_EPSILON)
+		{
+			if (! ClipSightSeg(target, -nx, -ny, -dist))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+
+class sight_graph_c
+{
+public:
+	sight_graph_c(const Document &doc, const std::vector<int> &groups,
+			const nodebuildinfo_t *info);
+
+	// works out the visibility rows, returns the number of sectors
+	// which got the simple treatment because time ran out.
+	int Process();
+
+	// whether sector 'view' can see sector 'target' (either way round)
+	bool CanSee(int view, int target) const
+	{
+		return TestBit(&rows[(size_t)view * words], target) ||
+			TestBit(&rows[(size_t)target * words], view);
+	}
+
+private:
+	struct flow_t
+	{
+		uint64_t *visible;
+
+		// portals seen so far
+		std::vector<uint64_t> seen;
+
+		// portals on the current chain
+		std::vector<uint8_t> in_use;
+
+		// portals which might be seen further along the chain, for
+		// each step of it
+		std::vector<std::vector<uint64_t>> might;
+
+		int steps = 0;
+		bool stopped = false;
+	};
+
+	static inline bool TestBit(const uint64_t *row, int bit)
+	{
+		return (row[bit >> 6] >> (bit & 63)) & 1;
+	}
+
+	static inline void SetBit(uint64_t *row, int bit)
+	{
+		row[bit >> 6] |= (uint64_t)1 << (bit & 63);
+	}
+
+	void CreatePortals();
+	void FindOpenSectors();
+	void GroupRow(int sector);
+	void MightSee(int portal, std::vector<int> &stack);
+	bool FlowFrom(int sector, flow_t &flow);
+	void Flow(flow_t &flow, int depth, const sight_seg_t &src, const sight_portal_t &pass_portal,
+			const sight_seg_t &pass);
+	bool OutOfTime(flow_t &flow);
+
+	const Document &doc;
+	const std::vector<int> &groups;
+	const nodebuildinfo_t *info;
+
+	int num_sectors;
+	int words;
+
+	std::vector<sight_portal_t> portals;
+	std::vector<std::vector<int>> sector_portals;
+	int portal_words = 0;
+
+	// sectors not closed by their own linedefs
+	std::vector<uint8_t> open_sectors;
+
+	// the portals which might be seen through each portal (a quick
+	// superset, used to stop following chains which cannot add any)
+	std::vector<uint64_t> might_see;
+
+	// which sectors each sector can see
+	std::vector<uint64_t> rows;
+
+	std::chrono::steady_clock::time_point deadline;
+	bool has_deadline = false;
+};
+
+
+sight_graph_c::sight_graph_c(const Document &doc, const std::vector<int> &groups,
+		const nodebuildinfo_t *info) :
+	doc(doc), groups(groups), info(info)
+{
+	num_sectors = doc.numSectors();
+	words = (num_sectors + 63) / 64;
+
+	rows.assign((size_t)num_sectors * words, 0);
+}
+
+
+void sight_graph_c::CreatePortals()
+{
+	sector_portals.resize(num_sectors);
+
+	for (const auto &L : doc.linedefs)
+	{
+		if (L->right < 0 || L->left < 0)
+			continue;
+
+		int right = doc.getRight(*L)->sector;
+		int left  = doc.getLeft(*L)->sector;
+
+		if (right < 0 || left < 0 || right >= num_sectors || left >= num_sectors)
+			continue;
+
+		const Vertex &start = *doc.vertices[L->start];
+		const Vertex &end   = *doc.vertices[L->end];
+
+		double len = hypot(end.x() - start.x(), end.y() - start.y());
+
+		if (len < SIGHT_EPSILON)
+			continue;
+
+		int first = (int)portals.size();
+
+		for (int side = 0 ; side < 2 ; side++)
+		{
+			sight_portal_t P;
+
+			// the sector in front is on the left of the seg
+			const Vertex &v1 = side ? end : start;
+			const Vertex &v2 = side ? start : end;
+
+			P.seg = { v1.x(), v1.y(), v2.x(), v2.y() };
+
+			P.from = side ? left : right;
+			P.to   = side ? right : left;
+
+			P.reverse = first + 1 - side;
+
+			P.nx = -(v2.y() - v1.y()) / len;
+			P.ny =  (v2.x() - v1.x()) / len;
+
+			P.dist = v1.x() * P.nx + v1.y() * P.ny;
+
+			sector_portals[P.from].push_back((int)portals.size());
+			portals.push_back(P);
+		}
+	}
+}
+
+
+//
+// A sector whose linedefs do not form closed loops may have parts which
+// are not behind any of its portals, so it gets the simple treatment.
+//
+void sight_graph_c::FindOpenSectors()
+{
+	open_sectors.assign(num_sectors, 0);
+
+	// how often each vertex is used by the linedefs of each sector
+	std::vector<std::pair<int, int>> ends;
+
+	for (const auto &L : doc.linedefs)
+	{
+		int right = L->right >= 0 ? doc.getRight(*L)->sector : -1;
+		int left  = L->left  >= 0 ? doc.getLeft(*L)->sector  : -1;
+
+		for (int sector : { right, left })
+		{
+			if (sector < 0 || sector >= num_sectors)
+				continue;
+
+			ends.emplace_back(sector, L->start);
+			ends.emplace_back(sector, L->end);
+		}
+	}
+
+	std::sort(ends.begin(), ends.end());
+
+	for (size_t i = 0 ; i < ends.size() ; )
+	{
+		size_t k = i;
+
+		while (k < ends.size() && ends[k] == ends[i])
+			k++;
+
+		if ((k - i) & 1)
+			open_sectors[ends[i].first] = 1;
+
+		i = k;
+	}
+}
+
+
+//
+// Everything connected to the sector by two-sided linedefs.
+//
+void sight_graph_c::GroupRow(int sector)
+{
+	uint64_t *row = &rows[(size_t)sector * words];
+
+	for (int k = 0 ; k < num_sectors ; k++)
+		if (groups[k] == groups[sector])
+			SetBit(row, k);
+}
+
+
+//
+// Flood from the portal into every portal which is partly in front of
+// it, and which has the portal partly behind it.  A line of sight
+// through the portal can never get anywhere else.
+//
+void sight_graph_c::MightSee(int portal, std::vector<int> &stack)
+{
+	const sight_portal_t &P = portals[portal];
+
+	uint64_t *row = &might_see[(size_t)portal * portal_words];
+
+	stack.clear();
+	stack.push_back(portal);
+
+	while (! stack.empty())
+	{
+		int cur = stack.back();
+		stack.pop_back();
+
+		for (int next : sector_portals[portals[cur].to])
+		{
+			if (TestBit(row, next))
+				continue;
+
+			const sight_portal_t &Q = portals[next];
+
+			double d1 = Q.seg.x1 * P.nx + Q.seg.y1 * P.ny - P.dist;
+			double d2 = Q.seg.x2 * P.nx + Q.seg.y2 * P.ny - P.dist;
+
+			if (d1 <= SIGHT_EPSILON && d2 <= SIGHT_EPSILON)
+				continue;
+
+			d1 = P.seg.x1 * Q.nx + P.seg.y1 * Q.ny - Q.dist;
+			d2 = P.seg.x2 * Q.nx + P.seg.y2 * Q.ny - Q.dist;
+
+			if (d1 >= -SIGHT_EPSILON && d2 >= -SIGHT_EPSILON)
+				continue;
+
+			SetBit(row, next);
+
+			stack.push_back(next);
+		}
+	}
+}
+
+
+bool sight_graph_c::OutOfTime(flow_t &flow)
+{
+	if (flow.stopped)
+		return true;
+
+	if (++flow.steps < SIGHT_CHECK_STEPS)
+		return false;
+
+	flow.steps = 0;
+
+	if (info->cancelled || (has_deadline && std::chrono::steady_clock::now() > deadline))
+		flow.stopped = true;
+
+	return flow.stopped;
+}
+
+
+//
+// Follow the chains which go through 'src' and then 'pass' (the part of
+// 'pass_portal' still in sight), into the sector behind it.  The portals
+// they might still see are in flow.might[depth].
+//
+void sight_graph_c::Flow(flow_t &flow, int depth, const sight_seg_t &src,
+		const sight_portal_t &pass_portal, const sight_seg_t &pass)
+{
+	if (flow.might.size() <= (size_t)depth + 1)
+		flow.might.resize(depth + 2);
+
+	const uint64_t *might = flow.might[depth].data();
+
+	std::vector<uint64_t> &next_might = flow.might[depth + 1];
+
+	next_might.resize(portal_words);
+
+	for (int next : sector_portals[pass_portal.to])
+	{
+		if (flow.in_use[next] || ! TestBit(might, next) || OutOfTime(flow))
+			continue;
+
+		// stop when nothing new can be found further on (as qvis does)
+		const uint64_t *test = &might_see[(size_t)next * portal_words];
+
+		bool more = false;
+
+		for (int w = 0 ; w < portal_words ; w++)
+		{
+			next_might[w] = might[w] & test[w];
+
+			if (next_might[w] & ~flow.seen[w])
+				more = true;
+		}
+
+		if (! more && TestBit(flow.seen.data(), next))
+			continue;
+
+		const sight_portal_t &Q = portals[next];
+
+		sight_seg_t target = Q.seg;
+
+		// it must be beyond the pass portal, and in reach through both
+		if (! ClipSightSeg(target, pass_portal.nx, pass_portal.ny, pass_portal.dist))
+			continue;
+
+		if (! ClipToSeparators(src, pass, target))
+			continue;
+
+		SetBit(flow.seen.data(), next);
+		SetBit(flow.visible, Q.to);
+
+		if (! more)
+			continue;
+
+		// only the part of the source which can see the target matters now
+		sight_seg_t new_src = src;
+
+		if (! ClipToSeparators(target, pass, new_src))
+			continue;
+
+		flow.in_use[next] = 1;
+
+		Flow(flow, depth + 1, new_src, Q, target);
+
+		flow.in_use[next] = 0;
+	}
+}
+
+
+//
+// Fills in the row of one sector, returns false when it could not be
+// finished.
+//
+bool sight_graph_c::FlowFrom(int sector, flow_t &flow)
+{
+	flow.visible = &rows[(size_t)sector * words];
+
+	SetBit(flow.visible, sector);
+
+	if (open_sectors[sector])
+		return false;
+
+	flow.seen.assign(portal_words, 0);
+	flow.in_use.assign(portals.size(), 0);
+
+	if (flow.might.empty())
+		flow.might.resize(1);
+
+	for (int first : sector_portals[sector])
+	{
+		const sight_portal_t &P = portals[first];
+
+		SetBit(flow.seen.data(), first);
+		SetBit(flow.visible, P.to);
+
+		// a sight line from the sector can reach all of the portals
+		// behind this one which are in front of it.
+		const uint64_t *start = &might_see[(size_t)first * portal_words];
+
+		flow.might[0].assign(start, start + portal_words);
+
+		flow.in_use[first] = 1;
+
+		Flow(flow, 0, P.seg, P, P.seg);
+
+		flow.in_use[first] = 0;
+	}
+
+	return ! flow.stopped;
+}
+
+
+int sight_graph_c::Process()
+{
+	if (info->reject_time > 0)
+	{
+		has_deadline = true;
+		deadline = std::chrono::steady_clock::now() + std::chrono::seconds(info->reject_time);
+	}
+
+	CreatePortals();
+	FindOpenSectors();
+
+	portal_words = ((int)portals.size() + 63) / 64;
+
+	might_see.assign(portals.size() * portal_words, 0);
+
+	// in batches, each with its own scratch space
+	const int batch = 64;
+
+	RunParallel(info, ((int)portals.size() + batch - 1) / batch, [this, batch](int b)
+	{
+		std::vector<int> stack;
+
+		int last = std::min((int)portals.size(), (b + 1) * batch);
+
+		for (int p = b * batch ; p < last ; p++)
+			MightSee(p, stack);
+	});
+
+	std::vector<uint8_t> finished(num_sectors, 0);
+
+	RunParallel(info, num_sectors, [this, &finished](int sector)
+	{
+		flow_t flow;
+
+		finished[sector] = FlowFrom(sector, flow);
+	});
+
+	int simple = 0;
+
+	for (int s = 0 ; s < num_sectors ; s++)
+	{
+		if (! finished[s])
+		{
+			GroupRow(s);
+			simple++;
+		}
+	}
+
+	return simple;
+}
+
+
+int LevelData::Reject::ProcessSight(const Document &doc, const nodebuildinfo_t *info)
+{
+	sight_graph_c graph(doc, rej_sector_groups, info);
+
+	int simple = graph.Process();
+
+	int num_sectors = doc.numSectors();
+
+	for (int view=0 ; view < num_sectors ; view++)
+	{
+		for (int target=0 ; target < num_sectors ; target++)
+		{
+			if (graph.CanSee(view, target))
+				continue;
+
+			int p = view * num_sectors + target;
+
+			rej_matrix[p >> 3] |= (1 << (p & 7));
+		}
+	}
+
+	return simple;
+}
+
+
+}  // namespace ajbsp
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -20,6 +20,7 @@
 
 #include "bsp.h"
 #include "Instance.h"
+#include "ThreadPool.h"
 
 struct ConfigData;
 
@@ -51,7 +52,10 @@ void LevelData::Failure(EUR_FORMAT_STRING(const char *fmt), ...)
 	if (cur_info->warnings)
 		PrintMsg("Failure: %s", message.c_str());
 
-	cur_info->total_warnings++;
+	if (cur_build_task)
+		cur_build_task->warnings++;
+	else
+		cur_info->total_warnings++;
 
 #if DEBUG_ENABLED
 	gLog.debugPrintf("Failure: %s", message.c_str());
@@ -65,8 +69,14 @@ void LevelData::PrintMsg(EUR_FORMAT_STRING(const char *format), ...) const
 	{
 		va_list ap;
 		va_start(ap, format);
-		reportLog(SString::vprintf(format, ap));
+		SString message = SString::vprintf(format, ap);
 		va_end(ap);
+
+		// messages of a parallel build are shown once it is merged
+		if(cur_build_task)
+			cur_build_task->messages.push_back(message);
+		else
+			reportLog(message);
 	}
 }
 
@@ -82,7 +92,10 @@ void LevelData::Warning(EUR_FORMAT_STRING(const char *fmt), ...)
 	if (cur_info->warnings)
 		PrintMsg("Warning: %s", message.c_str());
 
-	cur_info->total_warnings++;
+	if (cur_build_task)
+		cur_build_task->warnings++;
+	else
+		cur_info->total_warnings++;
 
 #if DEBUG_ENABLED
 	gLog.debugPrintf("Warning: %s", message.c_str());
@@ -99,6 +112,58 @@ void LevelData::Warning(EUR_FORMAT_STRING(const char *fmt), ...)
 #endif
 
 
+phase_timer_c::phase_timer_c(nodebuildinfo_t *info, build_phase_e phase) :
+	info(info), phase(phase), start(std::chrono::steady_clock::now())
+{
+	if (info->progress < BuildPhaseProgress(phase))
+		info->progress = BuildPhaseProgress(phase);
+}
+
+
+phase_timer_c::~phase_timer_c()
+{
+	std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+
+	info->stats.phase_time[phase] += secs.count();
+}
+
+
+void RunParallel(const nodebuildinfo_t *info, int count, const std::function<void(int)> &func)
+{
+	if (info->jobs == 1)
+	{
+		for (int i = 0 ; i < count ; i++)
+			func(i);
+		return;
+	}
+
+	// a specific number of threads gets a pool of its own
+	std::unique_ptr<ThreadPool> own_pool;
+
+	ThreadPool *pool = info->pool;
+
+	if (! pool)
+	{
+		if (info->jobs > 1)
+			own_pool = std::make_unique<ThreadPool>(info->jobs - 1);
+
+		pool = own_pool ? own_pool.get() : &ThreadPool::shared();
+	}
+
+	TaskGroup group(*pool);
+
+	for (int i = 0 ; i < count ; i++)
+	{
+		group.run([&func, i]()
+		{
+			func(i);
+		});
+	}
+
+	group.wait();
+}
+
+
 //
 // Allocate memory with error checking.  Zeros the memory.
 //
@@ -174,20 +239,20 @@ SString UtilTimeString(void)
 #else // LINUX or MACOSX
 
 	time_t epoch_time;
-	struct tm *calend_time;
+	struct tm calend_time;
 
 	if (time(&epoch_time) == (time_t)-1)
 		return NULL;
 
-	calend_time = localtime(&epoch_time);
-	if (! calend_time)
+	// the builds of a portfolio may get here at the same time
+	if (! localtime_r(&epoch_time, &calend_time))
 		return NULL;
 
 	return SString::printf("%04d-%02d-%02d %02d:%02d:%02d.%04d",
-			calend_time->tm_year + 1900, calend_time->tm_mon + 1,
-			calend_time->tm_mday,
-			calend_time->tm_hour, calend_time->tm_min,
-			calend_time->tm_sec,  0);
+			calend_time.tm_year + 1900, calend_time.tm_mon + 1,
+			calend_time.tm_mday,
+			calend_time.tm_hour, calend_time.tm_min,
+			calend_time.tm_sec,  0);
 #endif
 }
 
@@ -231,7 +296,7 @@ void Adler32_Finish(uint32_t *crc)
 
 /* ----- polyobj handling ----------------------------- */
 
-static void MarkPolyobjSector(int sector, const Document &doc)
+void LevelData::MarkPolyobjSector(int sector)
 {
 	int i;
 
@@ -249,7 +314,7 @@ static void MarkPolyobjSector(int sector, const Document &doc)
 		if ((L->right >= 0 && doc.getRight(*L)->sector == sector) ||
 			(L->left  >= 0 && doc.getLeft(*L)->sector  == sector))
 		{
-			L->flags |= MLF_IS_PRECIOUS;
+			line_flags[i] |= MLF_IS_PRECIOUS;
 		}
 	}
 }
@@ -290,10 +355,10 @@ void LevelData::MarkPolyobjPoint(double x, double y)
 #     endif
 
 			if (L->left >= 0)
-				MarkPolyobjSector(doc.getLeft(*L)->sector, doc);
+				MarkPolyobjSector(doc.getLeft(*L)->sector);
 
 			if (L->right >= 0)
-				MarkPolyobjSector(doc.getRight(*L)->sector, doc);
+				MarkPolyobjSector(doc.getRight(*L)->sector);
 
 			inside_count++;
 		}
@@ -380,7 +445,7 @@ void LevelData::MarkPolyobjPoint(double x, double y)
 		return;
 	}
 
-	MarkPolyobjSector(sector, doc);
+	MarkPolyobjSector(sector);
 }
 
 
@@ -517,8 +582,8 @@ static FFixedPoint LineStartCompare(const Document &doc, const void *p1, const v
 	const auto B = doc.linedefs[line2];
 
 	// determine left-most vertex of each line
-	const Vertex *C = LineVertexLowest(doc, A.get()) ? &doc.getEnd(*A) : &doc.getStart(*A);
-	const Vertex *D = LineVertexLowest(doc, B.get()) ? &doc.getEnd(*B) : &doc.getStart(*B);
+	const Vertex *C = LineVertexLowest(doc, A) ? &doc.getEnd(*A) : &doc.getStart(*A);
+	const Vertex *D = LineVertexLowest(doc, B) ? &doc.getEnd(*B) : &doc.getStart(*B);
 
 	if (C->raw_x != D->raw_x)
 		return C->raw_x - D->raw_x;
@@ -538,8 +603,8 @@ static FFixedPoint LineEndCompare(const Document &doc, const void *p1, const voi
 	const auto B = doc.linedefs[line2];
 
 	// determine right-most vertex of each line
-	const Vertex * C = LineVertexLowest(doc, A.get()) ? &doc.getStart(*A) : &doc.getEnd(*A);
-	const Vertex * D = LineVertexLowest(doc, B.get()) ? &doc.getStart(*B) : &doc.getEnd(*B);
+	const Vertex * C = LineVertexLowest(doc, A) ? &doc.getStart(*A) : &doc.getEnd(*A);
+	const Vertex * D = LineVertexLowest(doc, B) ? &doc.getStart(*B) : &doc.getEnd(*B);
 
 	if (C->raw_x != D->raw_x)
 		return C->raw_x - D->raw_x;
@@ -548,7 +613,7 @@ static FFixedPoint LineEndCompare(const Document &doc, const void *p1, const voi
 }
 
 
-void DetectOverlappingLines(const Document &doc)
+void LevelData::DetectOverlappingLines()
 {
 	// Algorithm:
 	//   Sort all lines by left-most vertex.
@@ -563,7 +628,7 @@ void DetectOverlappingLines(const Document &doc)
 	for (i=0 ; i < doc.numLinedefs(); i++)
 		array[i] = i;
 
-	std::sort(array, array + doc.numLinedefs(), [&doc](int left, int right)
+	std::sort(array, array + doc.numLinedefs(), [this](int left, int right)
 		{
 			return LineStartCompare(doc, &left, &right).raw() < 0;
 		});
@@ -581,8 +646,7 @@ void DetectOverlappingLines(const Document &doc)
 			{
 				// found an overlap !
 
-				auto L = doc.linedefs[array[j]];
-				L->flags |= MLF_IS_OVERLAP;
+				line_flags[array[j]] |= MLF_IS_OVERLAP;
 				count++;
 			}
 		}
@@ -651,7 +715,7 @@ void LevelData::CalculateWallTips()
 	{
 		const auto L = doc.linedefs[i];
 
-		if ((L->flags & MLF_IS_OVERLAP) || doc.isZeroLength(*L))
+		if ((line_flags[i] & MLF_IS_OVERLAP) || doc.isZeroLength(*L))
 			continue;
 
 		double x1 = doc.getStart(*L).x();
@@ -691,8 +755,12 @@ vertex_t *LevelData::NewVertexFromSplitSeg(seg_t *seg, double x, double y)
 	vert->y = y;
 	vert->is_new = true;
 
-	vert->index = num_new_vert;
-	num_new_vert++;
+	// [ a parallel build numbers them when merging the task ]
+	if (! cur_build_task)
+	{
+		vert->index = num_new_vert;
+		num_new_vert++;
+	}
 
 	// compute wall-tip info
 	if (seg->linedef < 0 || doc.linedefs[seg->linedef]->TwoSided())
@@ -805,5 +873,43 @@ bool VertexCheckOpen(vertex_t *vert, double dx, double dy)
 
 }  // namespace ajbsp
 
+
+const char *BuildPhaseName(build_phase_e phase)
+{
+	switch (phase)
+	{
+		case PHASE_Load:      return "load";
+		case PHASE_Segs:      return "segs";
+		case PHASE_Nodes:     return "nodes";
+		case PHASE_Clockwise: return "clockwise";
+		case PHASE_RoundOff:  return "roundoff";
+		case PHASE_ZNodes:    return "znodes";
+		case PHASE_Blockmap:  return "blockmap";
+		case PHASE_Reject:    return "reject";
+
+		default: return "?";
+	}
+}
+
+
+int BuildPhaseProgress(build_phase_e phase)
+{
+	// the nodes take most of the time, the reject can take a while
+	switch (phase)
+	{
+		case PHASE_Load:      return 0;
+		case PHASE_Segs:      return 2;
+		case PHASE_Nodes:     return 5;
+		case PHASE_Clockwise: return 85;
+		case PHASE_RoundOff:  return 87;
+		case PHASE_ZNodes:    return 87;
+		case PHASE_Blockmap:  return 90;
+		case PHASE_Reject:    return 93;
+
+		default: return 0;
+	}
+}
+
+
 //--- editor settings ---
 // vi:ts=4:sw=4:noexpandtab
@@ -30,6 +30,8 @@
 #include "Instance.h"
 #include "LineDef.h"
 #include "main.h"
+#include "m_config.h"
+#include "m_select.h"
 #include "Sector.h"
 #include "SideDef.h"
 #include "Thing.h"
@@ -38,10 +40,20 @@
 // need these for the XXX_Notify() prototypes
 #include "r_render.h"
 
+#include <algorithm>
+#include <string.h>
+#include <type_traits>
+#include <zlib.h>
+
 int global::default_floor_h		=   0;
 int global::default_ceil_h		= 128;
 int global::default_light_level	= 176;
 
+int config::undo_max_space = 200;  // MB
+
+// how many of the latest undo (or redo) steps are never packed
+static const int UNPACKED_STEPS = 4;
+
 static StringTable basis_strtab;
 
 const char *NameForObjectType(ObjType type, bool plural)
@@ -98,7 +110,11 @@ void Basis::begin()
 	if(mCurrentGroup.isActive())
 		BugError("Basis::begin called twice without Basis::end\n");
 	while(!mRedoFuture.empty())
-		mRedoFuture.pop();
+	{
+		mHistoryMemory -= mRedoFuture.back().getMemory();
+		mRedoFuture.back().release(*this);
+		mRedoFuture.pop_back();
+	}
 	mCurrentGroup.activate();
 	doClearChangeStatus();
 }
@@ -118,7 +134,12 @@ void Basis::end()
 	{
 		SString message = mCurrentGroup.getMessage();
 		SString menuDetail = mCurrentGroup.getMenuName();
-		mUndoHistory.push(std::move(mCurrentGroup));
+		mCurrentGroup.measure(*this);
+		mHistoryMemory += mCurrentGroup.getMemory();
+		mUndoHistory.push_back(std::move(mCurrentGroup));
+		trimHistory();
+		packDeep(mUndoHistory);
+		doc.journal.commit(message, false);
 		if(inst.main_win)
 		{
 			Fl_Sys_Menu_Bar *bar = inst.main_win->menu_bar;
@@ -145,7 +166,8 @@ void Basis::abort(bool keepChanges)
 	if(!keepChanges && !mCurrentGroup.isEmpty())
 		mCurrentGroup.reapply(*this);
 
-	mCurrentGroup.reset();
+	doc.journal.commit(mCurrentGroup.getMessage(), true);
+	mCurrentGroup.release(*this);
 	mDidMakeChanges = false;
 	doProcessChangeStatus();
 }
@@ -254,28 +276,11 @@ int Basis::addNew(ObjType type)
 	switch(type)
 	{
 	case ObjType::things:
-		op.objnum = doc.numThings();
-		op.thing = std::make_shared<Thing>();
-		break;
-
 	case ObjType::vertices:
-		op.objnum = doc.numVertices();
-		op.vertex = std::make_shared<Vertex>();
-		break;
-
 	case ObjType::sidedefs:
-		op.objnum = doc.numSidedefs();
-		op.sidedef = std::make_shared<SideDef>();
-		break;
-
 	case ObjType::linedefs:
-		op.objnum = doc.numLinedefs();
-		op.linedef = std::make_shared<LineDef>();
-		break;
-
 	case ObjType::sectors:
-		op.objnum = doc.numSectors();
-		op.sector = std::make_shared<Sector>();
+		op.objnum = doc.numObjects(type);
 		break;
 
 	default:
@@ -321,14 +326,11 @@ void Basis::del(ObjType type, int objnum)
 	}
 	else if(type == ObjType::vertices)
 	{
-		// delete any linedefs bound to this vertex
-		for(int n = doc.numLinedefs() - 1; n >= 0; n--)
-		{
-			const auto L = doc.linedefs[n];
+		// delete any linedefs bound to this vertex, last ones first
+		const std::vector<int> bound = doc.incidence.linedefsAt(objnum);
 
-			if(L->start == objnum || L->end == objnum)
-				del(ObjType::linedefs, n);
-		}
+		for(auto it = bound.rbegin(); it != bound.rend(); ++it)
+			del(ObjType::linedefs, *it);
 	}
 	else if(type == ObjType::sectors)
 	{
@@ -343,6 +345,85 @@ void Basis::del(ObjType type, int objnum)
 	mCurrentGroup.addApply(std::move(op), *this);
 }
 
+//
+// deletes all the objects in the list together, with the same
+// bound objects as del() would.  The arrays get compacted once
+// and the references fixed in a single pass, instead of once per
+// deleted object.
+//
+void Basis::del(const selection_c &list)
+{
+	SYS_ASSERT(mCurrentGroup.isActive());
+
+	ObjType type = list.what_type();
+
+	DeletedSet set;
+
+	for(sel_iter_c it(list); !it.done(); it.next())
+		set.objnums.push_back(*it);
+
+	if(set.objnums.empty())
+		return;
+
+	if(set.objnums.size() == 1)
+	{
+		del(type, set.objnums[0]);
+		return;
+	}
+
+	std::sort(set.objnums.begin(), set.objnums.end());
+	set.objnums.erase(std::unique(set.objnums.begin(), set.objnums.end()), set.objnums.end());
+
+	SYS_ASSERT(set.objnums.front() >= 0 && set.objnums.back() < doc.numObjects(type));
+
+	// like del(), deal with the bound objects first
+	if(type == ObjType::sidedefs)
+	{
+		for(int n = doc.numLinedefs() - 1; n >= 0; n--)
+		{
+			const auto L = doc.linedefs[n];
+
+			if(L->right >= 0 && list.get(L->right))
+				changeLinedef(n, LineDef::F_RIGHT, -1);
+
+			if(L->left >= 0 && list.get(L->left))
+				changeLinedef(n, LineDef::F_LEFT, -1);
+		}
+	}
+	else if(type == ObjType::vertices)
+	{
+		selection_c bound(ObjType::linedefs);
+
+		for(int n = 0; n < doc.numLinedefs(); n++)
+		{
+			const auto L = doc.linedefs[n];
+
+			if(list.get(L->start) || list.get(L->end))
+				bound.set(n);
+		}
+
+		del(bound);
+	}
+	else if(type == ObjType::sectors)
+	{
+		selection_c bound(ObjType::sidedefs);
+
+		for(int n = 0; n < doc.numSidedefs(); n++)
+			if(list.get(doc.sidedefs[n]->sector))
+				bound.set(n);
+
+		del(bound);
+	}
+
+	EditUnit op;
+
+	op.action = EditType::delMany;
+	op.objtype = type;
+	op.slot = mDeletedSets.put(std::move(set));
+
+	mCurrentGroup.addApply(std::move(op), *this);
+}
+
 //
 // change a field of an existing object.  If the value was the
 // same as before, nothing happens and false is returned.
@@ -443,6 +524,56 @@ bool Basis::changeLinedef(int line, byte field, int value)
 	return change(ObjType::linedefs, line, field, value);
 }
 
+//
+// drop the oldest undo steps while the history takes more memory than
+// the user allows. The latest step is always kept.
+//
+void Basis::trimHistory()
+{
+	if(config::undo_max_space <= 0)
+		return;
+
+	const size_t limit = (size_t)config::undo_max_space << 20;
+
+	while(mHistoryMemory > limit && mUndoHistory.size() > 1)
+	{
+		mHistoryMemory -= mUndoHistory.front().getMemory();
+		mUndoHistory.front().release(*this);
+		mUndoHistory.pop_front();
+	}
+}
+
+//
+// pack the group which has just become UNPACKED_STEPS steps deep
+//
+void Basis::packDeep(std::deque<UndoGroup> &groups)
+{
+	if((int)groups.size() <= UNPACKED_STEPS)
+		return;
+
+	UndoGroup &grp = groups[groups.size() - 1 - UNPACKED_STEPS];
+
+	if(grp.isPacked())
+		return;
+
+	mHistoryMemory -= grp.getMemory();
+	grp.pack(*this);
+	mHistoryMemory += grp.getMemory();
+}
+
+//
+// get a group ready for undoing or redoing
+//
+void Basis::unpackGroup(UndoGroup &grp)
+{
+	if(!grp.isPacked())
+		return;
+
+	mHistoryMemory -= grp.getMemory();
+	grp.unpack(*this);
+	mHistoryMemory += grp.getMemory();
+}
+
 //
 // attempt to undo the last normal or redo operation.  Returns
 // false if the undo history is empty.
@@ -454,8 +585,9 @@ bool Basis::undo()
 
 	doClearChangeStatus();
 
-	UndoGroup grp = std::move(mUndoHistory.top());
-	mUndoHistory.pop();
+	UndoGroup grp = std::move(mUndoHistory.back());
+	mUndoHistory.pop_back();
+	unpackGroup(grp);
 
 	inst.Status_Set("UNDO: %s", grp.getMessage().c_str());
 	if(inst.main_win)
@@ -464,13 +596,15 @@ bool Basis::undo()
 		if(bar)
 		{
 			menu::setRedoDetail(bar, grp.getMenuName());
-			menu::setUndoDetail(bar, mUndoHistory.empty() ? "" : mUndoHistory.top().getMenuName());
+			menu::setUndoDetail(bar, mUndoHistory.empty() ? "" : mUndoHistory.back().getMenuName());
 		}
 	}
 
 	grp.reapply(*this);
+	doc.journal.commit(grp.getMessage(), false);
 
-	mRedoFuture.push(std::move(grp));
+	mRedoFuture.push_back(std::move(grp));
+	packDeep(mRedoFuture);
 
 	doProcessChangeStatus();
 	return true;
@@ -487,8 +621,9 @@ bool Basis::redo()
 
 	doClearChangeStatus();
 
-	UndoGroup grp = std::move(mRedoFuture.top());
-	mRedoFuture.pop();
+	UndoGroup grp = std::move(mRedoFuture.back());
+	mRedoFuture.pop_back();
+	unpackGroup(grp);
 
 	inst.Status_Set("Redo: %s", grp.getMessage().c_str());
 	
@@ -498,13 +633,15 @@ bool Basis::redo()
 		if(bar)
 		{
 			menu::setUndoDetail(bar, grp.getMenuName());
-			menu::setRedoDetail(bar, mRedoFuture.empty() ? "" : mRedoFuture.top().getMenuName());
+			menu::setRedoDetail(bar, mRedoFuture.empty() ? "" : mRedoFuture.back().getMenuName());
 		}
 	}
 
 	grp.reapply(*this);
+	doc.journal.commit(grp.getMessage(), false);
 
-	mUndoHistory.push(std::move(grp));
+	mUndoHistory.push_back(std::move(grp));
+	packDeep(mUndoHistory);
 
 	doProcessChangeStatus();
 	return true;
@@ -512,10 +649,16 @@ bool Basis::redo()
 
 void Basis::clear()
 {
-	while(!mUndoHistory.empty())
-		mUndoHistory.pop();
-	while(!mRedoFuture.empty())
-		mRedoFuture.pop();
+	mUndoHistory.clear();
+	mRedoFuture.clear();
+	mHistoryMemory = 0;
+
+	mDeletedThings.clear();
+	mDeletedVertices.clear();
+	mDeletedSectors.clear();
+	mDeletedSidedefs.clear();
+	mDeletedLinedefs.clear();
+	mDeletedSets.clear();
 	
 	if(inst.main_win)
 	{
@@ -536,16 +679,32 @@ void Basis::EditUnit::apply(Basis &basis)
 	switch(action)
 	{
 	case EditType::change:
+		basis.doc.journal.changed(objtype, objnum, field, value);
 		rawChange(basis);
 		return;
 	case EditType::del:
+		basis.doc.journal.deleted(objtype, objnum);
 		rawDelete(basis);
 		action = EditType::insert;	// reverse the operation
 		return;
 	case EditType::insert:
+	{
+		bool fresh = slot < 0;
 		rawInsert(basis);
+		basis.doc.journal.inserted(objtype, objnum, fresh);
 		action = EditType::del;	// reverse the operation
 		return;
+	}
+	case EditType::delMany:
+		basis.doc.journal.deletedMany(objtype, basis.mDeletedSets[slot].objnums);
+		rawDeleteMany(basis);
+		action = EditType::insertMany;
+		return;
+	case EditType::insertMany:
+		rawInsertMany(basis);
+		basis.doc.journal.insertedMany(objtype, basis.mDeletedSets[slot].objnums);
+		action = EditType::delMany;
+		return;
 	default:
 		BugError("Basis::EditOperation::apply\n");
 	}
@@ -554,15 +713,19 @@ void Basis::EditUnit::apply(Basis &basis)
 //
 // Destroy an inst.inst.edit operation
 //
-void Basis::EditUnit::destroy()
+void Basis::EditUnit::destroy(Basis &basis)
 {
 	switch(action)
 	{
 	case EditType::insert:
-		deleteFinally();
+	case EditType::insertMany:
+		deleteFinally(basis);
 		break;
 	case EditType::del:
 		break;
+	case EditType::delMany:
+		basis.mDeletedSets.release(slot);
+		break;
 	default:
 		break;
 	}
@@ -578,23 +741,23 @@ void Basis::EditUnit::rawChange(Basis &basis)
 	{
 	case ObjType::things:
 		SYS_ASSERT(0 <= objnum && objnum < basis.doc.numThings());
-		pos = reinterpret_cast<int *>(basis.doc.things[objnum].get());
+		pos = reinterpret_cast<int *>(basis.doc.things[objnum]);
 		break;
 	case ObjType::vertices:
 		SYS_ASSERT(0 <= objnum && objnum < basis.doc.numVertices());
-		pos = reinterpret_cast<int *>(basis.doc.vertices[objnum].get());
+		pos = reinterpret_cast<int *>(basis.doc.vertices[objnum]);
 		break;
 	case ObjType::sectors:
 		SYS_ASSERT(0 <= objnum && objnum < basis.doc.numSectors());
-		pos = reinterpret_cast<int *>(basis.doc.sectors[objnum].get());
+		pos = reinterpret_cast<int *>(basis.doc.sectors[objnum]);
 		break;
 	case ObjType::sidedefs:
 		SYS_ASSERT(0 <= objnum && objnum < basis.doc.numSidedefs());
-		pos = reinterpret_cast<int *>(basis.doc.sidedefs[objnum].get());
+		pos = reinterpret_cast<int *>(basis.doc.sidedefs[objnum]);
 		break;
 	case ObjType::linedefs:
 		SYS_ASSERT(0 <= objnum && objnum < basis.doc.numLinedefs());
-		pos = reinterpret_cast<int *>(basis.doc.linedefs[objnum].get());
+		pos = reinterpret_cast<int *>(basis.doc.linedefs[objnum]);
 		break;
 	default:
 		BugError("Basis::EditOperation::rawChange: bad objtype %u\n", (unsigned)objtype);
@@ -604,6 +767,10 @@ void Basis::EditUnit::rawChange(Basis &basis)
 	std::swap(pos[field], value);
 	basis.mDidMakeChanges = true;
 
+	// the old value is in 'value' now
+	if(objtype == ObjType::linedefs && (field == LineDef::F_START || field == LineDef::F_END))
+		basis.doc.incidence.linedefMoved(objnum, value);
+
 	// TODO: their modules
 	Clipboard_NotifyChange(objtype, objnum, field);
 	Selection_NotifyChange(objtype, objnum, field);
@@ -623,29 +790,29 @@ void Basis::EditUnit::rawDelete(Basis &basis)
 	Clipboard_NotifyDelete(objtype, objnum);
 	basis.inst.Selection_NotifyDelete(objtype, objnum);
 	basis.inst.MapStuff_NotifyDelete(objtype, objnum);
-	Render3D_NotifyDelete(basis.doc, objtype, objnum);
+	Render3D_NotifyDelete(basis.inst, objtype, objnum);
 	basis.inst.ObjectBox_NotifyDelete(objtype, objnum);
 
 	switch(objtype)
 	{
 	case ObjType::things:
-		thing = rawDeleteThing(basis.doc);
+		slot = basis.mDeletedThings.put(rawDeleteThing(basis.doc));
 		return;
 
 	case ObjType::vertices:
-		vertex = rawDeleteVertex(basis.doc);
+		slot = basis.mDeletedVertices.put(rawDeleteVertex(basis.doc));
 		return;
 
 	case ObjType::sectors:
-		sector = rawDeleteSector(basis.doc);
+		slot = basis.mDeletedSectors.put(rawDeleteSector(basis.doc));
 		return;
 
 	case ObjType::sidedefs:
-		sidedef = rawDeleteSidedef(basis.doc);
+		slot = basis.mDeletedSidedefs.put(rawDeleteSidedef(basis.doc));
 		return;
 
 	case ObjType::linedefs:
-		linedef = rawDeleteLinedef(basis.doc);
+		slot = basis.mDeletedLinedefs.put(rawDeleteLinedef(basis.doc));
 		return;
 
 	default:
@@ -657,12 +824,11 @@ void Basis::EditUnit::rawDelete(Basis &basis)
 //
 // Thing deletion
 //
-std::shared_ptr<Thing> Basis::EditUnit::rawDeleteThing(Document &doc) const
+Thing Basis::EditUnit::rawDeleteThing(Document &doc) const
 {
 	SYS_ASSERT(0 <= objnum && objnum < doc.numThings());
 
-	auto result = std::move(doc.things[objnum]);
-	doc.things.erase(doc.things.begin() + objnum);
+	Thing result = doc.things.take(objnum);
 
 	return result;
 }
@@ -670,12 +836,11 @@ std::shared_ptr<Thing> Basis::EditUnit::rawDeleteThing(Document &doc) const
 //
 // Vertex deletion (and update linedef refs)
 //
-std::shared_ptr<Vertex> Basis::EditUnit::rawDeleteVertex(Document &doc) const
+Vertex Basis::EditUnit::rawDeleteVertex(Document &doc) const
 {
 	SYS_ASSERT(0 <= objnum && objnum < doc.numVertices());
 
-	auto result = std::move(doc.vertices[objnum]);
-	doc.vertices.erase(doc.vertices.begin() + objnum);
+	Vertex result = doc.vertices.take(objnum);
 
 	// fix the linedef references
 
@@ -693,18 +858,19 @@ std::shared_ptr<Vertex> Basis::EditUnit::rawDeleteVertex(Document &doc) const
 		}
 	}
 
+	doc.incidence.vertexDeleted(objnum);
+
 	return result;
 }
 
 //
 // Raw delete sector (and update sidedef refs)
 //
-std::shared_ptr<Sector> Basis::EditUnit::rawDeleteSector(Document &doc) const
+Sector Basis::EditUnit::rawDeleteSector(Document &doc) const
 {
 	SYS_ASSERT(0 <= objnum && objnum < doc.numSectors());
 
-	auto result = std::move(doc.sectors[objnum]);
-	doc.sectors.erase(doc.sectors.begin() + objnum);
+	Sector result = doc.sectors.take(objnum);
 
 	// fix sidedef references
 
@@ -725,12 +891,11 @@ std::shared_ptr<Sector> Basis::EditUnit::rawDeleteSector(Document &doc) const
 //
 // Delete sidedef (and update linedef references)
 //
-std::shared_ptr<SideDef> Basis::EditUnit::rawDeleteSidedef(Document &doc) const
+SideDef Basis::EditUnit::rawDeleteSidedef(Document &doc) const
 {
 	SYS_ASSERT(0 <= objnum && objnum < doc.numSidedefs());
 
-	auto result = std::move(doc.sidedefs[objnum]);
-	doc.sidedefs.erase(doc.sidedefs.begin() + objnum);
+	SideDef result = doc.sidedefs.take(objnum);
 
 	// fix the linedefs references
 
@@ -754,12 +919,13 @@ std::shared_ptr<SideDef> Basis::EditUnit::rawDeleteSidedef(Document &doc) const
 //
 // Raw delete linedef
 //
-std::shared_ptr<LineDef> Basis::EditUnit::rawDeleteLinedef(Document &doc) const
+LineDef Basis::EditUnit::rawDeleteLinedef(Document &doc) const
 {
 	SYS_ASSERT(0 <= objnum && objnum < doc.numLinedefs());
 
-	auto result = std::move(doc.linedefs[objnum]);
-	doc.linedefs.erase(doc.linedefs.begin() + objnum);
+	doc.incidence.linedefDeleting(objnum);
+
+	LineDef result = doc.linedefs.take(objnum);
 
 	return result;
 }
@@ -775,57 +941,53 @@ void Basis::EditUnit::rawInsert(Basis &basis)
 	Clipboard_NotifyInsert(basis.doc, objtype, objnum);
 	basis.inst.Selection_NotifyInsert(objtype, objnum);
 	basis.inst.MapStuff_NotifyInsert(objtype, objnum);
-	Render3D_NotifyInsert(objtype, objnum);
+	Render3D_NotifyInsert(basis.inst, objtype, objnum);
 	basis.inst.ObjectBox_NotifyInsert(objtype, objnum);
 
 	switch(objtype)
 	{
 	case ObjType::things:
-		rawInsertThing(basis.doc);
-		thing.reset();	// normally already reset
+		rawInsertThing(basis.doc, slot < 0 ? Thing() : basis.mDeletedThings.take(slot));
 		break;
 
 	case ObjType::vertices:
-		rawInsertVertex(basis.doc);
-		vertex.reset();
+		rawInsertVertex(basis.doc, slot < 0 ? Vertex() : basis.mDeletedVertices.take(slot));
 		break;
 
 	case ObjType::sidedefs:
-		rawInsertSidedef(basis.doc);
-		sidedef.reset();
+		rawInsertSidedef(basis.doc, slot < 0 ? SideDef() : basis.mDeletedSidedefs.take(slot));
 		break;
 
 	case ObjType::sectors:
-		rawInsertSector(basis.doc);
-		sector.reset();
+		rawInsertSector(basis.doc, slot < 0 ? Sector() : basis.mDeletedSectors.take(slot));
 		break;
 
 	case ObjType::linedefs:
-		rawInsertLinedef(basis.doc);
-		linedef.reset();
+		rawInsertLinedef(basis.doc, slot < 0 ? LineDef() : basis.mDeletedLinedefs.take(slot));
 		break;
 
 	default:
 		BugError("Basis::EditOperation::rawInsert: bad objtype %u\n", (unsigned)objtype);
 	}
+	slot = -1;
 }
 
 //
 // Thing insertion
 //
-void Basis::EditUnit::rawInsertThing(Document &doc)
+void Basis::EditUnit::rawInsertThing(Document &doc, Thing &&thing)
 {
 	SYS_ASSERT(0 <= objnum && objnum <= doc.numThings());
-	doc.things.insert(doc.things.begin() + objnum, std::move(thing));
+	doc.things.insert(objnum, std::move(thing));
 }
 
 //
 // Vertex insertion
 //
-void Basis::EditUnit::rawInsertVertex(Document &doc)
+void Basis::EditUnit::rawInsertVertex(Document &doc, Vertex &&vertex)
 {
 	SYS_ASSERT(0 <= objnum && objnum <= doc.numVertices());
-	doc.vertices.insert(doc.vertices.begin() + objnum, std::move(vertex));
+	doc.vertices.insert(objnum, std::move(vertex));
 
 	// fix references in linedefs
 
@@ -842,15 +1004,17 @@ void Basis::EditUnit::rawInsertVertex(Document &doc)
 				L->end++;
 		}
 	}
+
+	doc.incidence.vertexInserted(objnum);
 }
 
 //
 // Sector insertion
 //
-void Basis::EditUnit::rawInsertSector(Document &doc)
+void Basis::EditUnit::rawInsertSector(Document &doc, Sector &&sector)
 {
 	SYS_ASSERT(0 <= objnum && objnum <= doc.numSectors());
-	doc.sectors.insert(doc.sectors.begin() + objnum, std::move(sector));
+	doc.sectors.insert(objnum, std::move(sector));
 
 	// fix all sidedef references
 
@@ -869,10 +1033,10 @@ void Basis::EditUnit::rawInsertSector(Document &doc)
 //
 // Sidedef insertion
 //
-void Basis::EditUnit::rawInsertSidedef(Document &doc)
+void Basis::EditUnit::rawInsertSidedef(Document &doc, SideDef &&sidedef)
 {
 	SYS_ASSERT(0 <= objnum && objnum <= doc.numSidedefs());
-	doc.sidedefs.insert(doc.sidedefs.begin() + objnum, std::move(sidedef));
+	doc.sidedefs.insert(objnum, std::move(sidedef));
 
 	// fix the linedefs references
 
@@ -894,24 +1058,256 @@ void Basis::EditUnit::rawInsertSidedef(Document &doc)
 //
 // Linedef insertion
 //
-void Basis::EditUnit::rawInsertLinedef(Document &doc)
+void Basis::EditUnit::rawInsertLinedef(Document &doc, LineDef &&linedef)
 {
 	SYS_ASSERT(0 <= objnum && objnum <= doc.numLinedefs());
-	doc.linedefs.insert(doc.linedefs.begin() + objnum, std::move(linedef));
+	doc.linedefs.insert(objnum, std::move(linedef));
+
+	doc.incidence.linedefInserted(objnum);
+}
+
+//
+// Takes the objects out of the pool into the stash, moving the
+// others down to close the gaps
+//
+template<typename T>
+static void compactOut(ObjectPool<T> &pool, ObjectStash<T> &stash, const std::vector<int> &objnums,
+					   std::vector<int> &slots)
+{
+	slots.clear();
+	slots.reserve(objnums.size());
+
+	size_t next = 0;
+	int write = objnums.front();
+
+	for(int read = write; read < (int)pool.size(); read++)
+	{
+		if(next < objnums.size() && objnums[next] == read)
+		{
+			slots.push_back(stash.put(std::move(*pool[read])));
+			next++;
+		}
+		else
+			*pool[write++] = std::move(*pool[read]);
+	}
+
+	pool.resize(write);
+}
+
+//
+// Puts the objects back from the stash at their old numbers
+//
+template<typename T>
+static void expandIn(ObjectPool<T> &pool, ObjectStash<T> &stash, const std::vector<int> &objnums,
+					 const std::vector<int> &slots)
+{
+	int read = (int)pool.size() - 1;
+	size_t next = objnums.size();
+
+	pool.resize((int)pool.size() + (int)objnums.size());
+
+	for(int write = (int)pool.size() - 1; next > 0; write--)
+	{
+		if(objnums[next - 1] == write)
+		{
+			*pool[write] = stash.take(slots[next - 1]);
+			next--;
+		}
+		else
+			*pool[write] = std::move(*pool[read--]);
+	}
+}
+
+//
+// Renumbers the references to objects of the given type, with the
+// new number of each old one in the table
+//
+static void remapReferences(Document &doc, ObjType type, const std::vector<int> &table)
+{
+	auto remap = [&table](int &ref)
+	{
+		if(ref >= 0 && ref < (int)table.size())
+			ref = table[ref];
+	};
+
+	switch(type)
+	{
+	case ObjType::vertices:
+		for(LineDef *L : doc.linedefs)
+		{
+			remap(L->start);
+			remap(L->end);
+		}
+		break;
+
+	case ObjType::sectors:
+		for(SideDef *S : doc.sidedefs)
+			remap(S->sector);
+		break;
+
+	case ObjType::sidedefs:
+		for(LineDef *L : doc.linedefs)
+		{
+			remap(L->right);
+			remap(L->left);
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+//
+// Bulk deletion
+//
+void Basis::EditUnit::rawDeleteMany(Basis &basis)
+{
+	DeletedSet &set = basis.mDeletedSets[slot];
+	const std::vector<int> &objnums = set.objnums;
+
+	basis.mDidMakeChanges = true;
+
+	// same order as deleting them one by one
+	for(auto it = objnums.rbegin(); it != objnums.rend(); ++it)
+	{
+		Clipboard_NotifyDelete(objtype, *it);
+		basis.inst.Selection_NotifyDelete(objtype, *it);
+		basis.inst.MapStuff_NotifyDelete(objtype, *it);
+		Render3D_NotifyDelete(basis.inst, objtype, *it);
+		basis.inst.ObjectBox_NotifyDelete(objtype, *it);
+	}
+
+	Document &doc = basis.doc;
+
+	// the new number of each old object
+	std::vector<int> table(doc.numObjects(objtype));
+	size_t below = 0;
+	for(int n = 0; n < (int)table.size(); n++)
+	{
+		while(below < objnums.size() && objnums[below] < n)
+			below++;
+		table[n] = n - (int)below;
+	}
+
+	switch(objtype)
+	{
+	case ObjType::things:
+		compactOut(doc.things, basis.mDeletedThings, objnums, set.slots);
+		break;
+	case ObjType::vertices:
+		compactOut(doc.vertices, basis.mDeletedVertices, objnums, set.slots);
+		doc.incidence.invalidate();
+		break;
+	case ObjType::sectors:
+		compactOut(doc.sectors, basis.mDeletedSectors, objnums, set.slots);
+		break;
+	case ObjType::sidedefs:
+		compactOut(doc.sidedefs, basis.mDeletedSidedefs, objnums, set.slots);
+		break;
+	case ObjType::linedefs:
+		compactOut(doc.linedefs, basis.mDeletedLinedefs, objnums, set.slots);
+		doc.incidence.invalidate();
+		break;
+	default:
+		BugError("Basis::EditOperation::rawDeleteMany: bad objtype %u\n", (unsigned)objtype);
+		return; /* NOT REACHED */
+	}
+
+	remapReferences(doc, objtype, table);
+}
+
+//
+// Undoing a bulk deletion
+//
+void Basis::EditUnit::rawInsertMany(Basis &basis)
+{
+	DeletedSet &set = basis.mDeletedSets[slot];
+	const std::vector<int> &objnums = set.objnums;
+
+	basis.mDidMakeChanges = true;
+
+	for(int objnum : objnums)
+	{
+		Clipboard_NotifyInsert(basis.doc, objtype, objnum);
+		basis.inst.Selection_NotifyInsert(objtype, objnum);
+		basis.inst.MapStuff_NotifyInsert(objtype, objnum);
+		Render3D_NotifyInsert(basis.inst, objtype, objnum);
+		basis.inst.ObjectBox_NotifyInsert(objtype, objnum);
+	}
+
+	Document &doc = basis.doc;
+
+	// the old number of each remaining object
+	std::vector<int> table(doc.numObjects(objtype));
+	size_t below = 0;
+	for(int n = 0; n < (int)table.size(); n++)
+	{
+		while(below < objnums.size() && objnums[below] <= n + (int)below)
+			below++;
+		table[n] = n + (int)below;
+	}
+
+	remapReferences(doc, objtype, table);
+
+	switch(objtype)
+	{
+	case ObjType::things:
+		expandIn(doc.things, basis.mDeletedThings, objnums, set.slots);
+		break;
+	case ObjType::vertices:
+		expandIn(doc.vertices, basis.mDeletedVertices, objnums, set.slots);
+		doc.incidence.invalidate();
+		break;
+	case ObjType::sectors:
+		expandIn(doc.sectors, basis.mDeletedSectors, objnums, set.slots);
+		break;
+	case ObjType::sidedefs:
+		expandIn(doc.sidedefs, basis.mDeletedSidedefs, objnums, set.slots);
+		break;
+	case ObjType::linedefs:
+		expandIn(doc.linedefs, basis.mDeletedLinedefs, objnums, set.slots);
+		doc.incidence.invalidate();
+		break;
+	default:
+		BugError("Basis::EditOperation::rawInsertMany: bad objtype %u\n", (unsigned)objtype);
+		return; /* NOT REACHED */
+	}
+
+	set.slots.clear();
 }
 
 //
 // Action to do on destruction of insert operation
 //
-void Basis::EditUnit::deleteFinally()
+void Basis::EditUnit::deleteFinally(Basis &basis)
+{
+	if(slot < 0)
+		return;
+
+	if(action == EditType::insertMany)
+	{
+		const DeletedSet set = basis.mDeletedSets.take(slot);
+
+		for(int each : set.slots)
+			releaseDeleted(basis, objtype, each);
+	}
+	else
+		releaseDeleted(basis, objtype, slot);
+}
+
+//
+// Free a place in the stash of deleted objects
+//
+void Basis::EditUnit::releaseDeleted(Basis &basis, ObjType objtype, int slot)
 {
 	switch(objtype)
 	{
-	case ObjType::things:   thing.reset(); break;
-	case ObjType::vertices: vertex.reset(); break;
-	case ObjType::sectors:  sector.reset(); break;
-	case ObjType::sidedefs: sidedef.reset(); break;
-	case ObjType::linedefs: linedef.reset(); break;
+	case ObjType::things:   basis.mDeletedThings.release(slot); break;
+	case ObjType::vertices: basis.mDeletedVertices.release(slot); break;
+	case ObjType::sectors:  basis.mDeletedSectors.release(slot); break;
+	case ObjType::sidedefs: basis.mDeletedSidedefs.release(slot); break;
+	case ObjType::linedefs: basis.mDeletedLinedefs.release(slot); break;
 
 	default:
 		BugError("DeleteFinally: bad objtype %d\n", (int)objtype);
@@ -927,6 +1323,11 @@ Basis::UndoGroup &Basis::UndoGroup::operator = (UndoGroup &&other) noexcept
 	mDir = other.mDir;
 	mMessage = std::move(other.mMessage);
 	mMenuName = std::move(other.mMenuName);
+	mChangedFields = std::move(other.mChangedFields);
+	mMemory = other.mMemory;
+	mPacked = std::move(other.mPacked);
+	mUnpackedSize = other.mUnpackedSize;
+	mIsPacked = other.mIsPacked;
 
 	other.reset();	// ensure the other goes into the default state
 	return *this;
@@ -940,6 +1341,21 @@ void Basis::UndoGroup::reset()
 	mOps.clear();
 	mDir = 0;
 	mMessage = DEFAULT_UNDO_GROUP_MESSAGE;
+	mChangedFields.clear();
+	mMemory = 0;
+	mPacked.clear();
+	mUnpackedSize = 0;
+	mIsPacked = false;
+}
+
+//
+// Give back the deleted objects it holds, then reset
+//
+void Basis::UndoGroup::release(Basis &basis)
+{
+	for(auto it = mOps.rbegin(); it != mOps.rend(); ++it)
+		it->destroy(basis);
+	reset();
 }
 
 //
@@ -947,10 +1363,392 @@ void Basis::UndoGroup::reset()
 //
 void Basis::UndoGroup::addApply(EditUnit &&op, Basis &basis)
 {
+	if(op.action == EditType::change)
+	{
+		// a field changed again: the first change already holds the
+		// value to undo back to, so this one needn't be kept
+		uint64_t key = (uint64_t)op.objtype << 40 | (uint64_t)op.field << 32 | (uint32_t)op.objnum;
+
+		if(!mChangedFields.insert(key).second)
+		{
+			op.apply(basis);
+			return;
+		}
+	}
+	else
+	{
+		// the objects may get renumbered
+		mChangedFields.clear();
+	}
+
 	mOps.push_back(std::move(op));
 	mOps.back().apply(basis);
 }
 
+//
+// Work out roughly how much memory the finished group holds, along
+// with the deleted objects it keeps
+//
+void Basis::UndoGroup::measure(Basis &basis)
+{
+	mOps.shrink_to_fit();
+
+	mMemory = sizeof(UndoGroup) + mOps.capacity() * sizeof(EditUnit) + mPacked.capacity() +
+			  mMessage.length() + mMenuName.length();
+
+	for(const EditUnit &op : mOps)
+	{
+		int objects;
+
+		switch(op.action)
+		{
+		case EditType::insert:
+		case EditType::del:
+			objects = 1;
+			break;
+		case EditType::insertMany:
+		case EditType::delMany:
+		{
+			const DeletedSet &set = basis.mDeletedSets[op.slot];
+			objects = (int)set.objnums.size();
+			mMemory += (set.objnums.capacity() + set.slots.capacity()) * sizeof(int);
+			break;
+		}
+		default:
+			continue;
+		}
+
+		switch(op.objtype)
+		{
+		case ObjType::things:   mMemory += objects * sizeof(Thing); break;
+		case ObjType::vertices: mMemory += objects * sizeof(Vertex); break;
+		case ObjType::sectors:  mMemory += objects * sizeof(Sector); break;
+		case ObjType::sidedefs: mMemory += objects * sizeof(SideDef); break;
+		case ObjType::linedefs: mMemory += objects * sizeof(LineDef); break;
+		default: break;
+		}
+	}
+}
+
+//
+// Packing old groups
+//
+// The units are written one after the other, with the object numbers
+// as the difference from the previous unit's. The deleted objects a
+// group keeps are taken out of the stashes and written field by field,
+// as the difference from the previous object of the same type, since
+// most fields are the same from one object to the next. Everything is
+// written as variable-length numbers, and when long enough, deflated.
+//
+
+// smallest packed data worth deflating
+static const size_t DEFLATE_MIN_SIZE = 256;
+
+static void putNumber(std::vector<byte> &data, unsigned int value)
+{
+	while(value >= 0x80)
+	{
+		data.push_back((byte)(value | 0x80));
+		value >>= 7;
+	}
+	data.push_back((byte)value);
+}
+
+static void putSigned(std::vector<byte> &data, int value)
+{
+	// small negative numbers get small codes too
+	putNumber(data, ((unsigned int)value << 1) ^ (unsigned int)(value >> 31));
+}
+
+namespace
+{
+struct PackReader
+{
+	const byte *pos;
+	const byte *end;
+
+	byte getByte()
+	{
+		if(pos >= end)
+			BugError("Packed undo data is cut short\n");
+		return *pos++;
+	}
+
+	unsigned int getNumber()
+	{
+		unsigned int value = 0;
+		for(int shift = 0; ; shift += 7)
+		{
+			byte b = getByte();
+			value |= (unsigned int)(b & 0x7f) << shift;
+			if(!(b & 0x80))
+				return value;
+		}
+	}
+
+	int getSigned()
+	{
+		unsigned int value = getNumber();
+		return (int)(value >> 1) ^ -(int)(value & 1);
+	}
+};
+
+//
+// The last object of each type written or read, which the next one is
+// stored against
+//
+struct PackPrevious
+{
+	Thing thing;
+	Vertex vertex;
+	Sector sector;
+	SideDef sidedef;
+	LineDef linedef;
+};
+}
+
+template<typename T>
+static void packObject(ObjectStash<T> &stash, int slot, T &previous, std::vector<byte> &data)
+{
+	static_assert(std::is_trivially_copyable<T>::value && sizeof(T) % sizeof(int) == 0,
+				  "objects must be made of plain ints");
+
+	const T object = stash.take(slot);
+
+	int fields[sizeof(T) / sizeof(int)];
+	int before[sizeof(T) / sizeof(int)];
+	memcpy(fields, &object, sizeof(T));
+	memcpy(before, &previous, sizeof(T));
+
+	for(size_t i = 0; i < sizeof(T) / sizeof(int); i++)
+		putSigned(data, (int)((unsigned int)fields[i] - (unsigned int)before[i]));
+
+	previous = object;
+}
+
+template<typename T>
+static int unpackObject(ObjectStash<T> &stash, T &previous, PackReader &reader)
+{
+	int fields[sizeof(T) / sizeof(int)];
+	memcpy(fields, &previous, sizeof(T));
+
+	for(size_t i = 0; i < sizeof(T) / sizeof(int); i++)
+		fields[i] = (int)((unsigned int)fields[i] + (unsigned int)reader.getSigned());
+
+	T object;
+	memcpy(&object, fields, sizeof(T));
+
+	previous = object;
+	return stash.put(std::move(object));
+}
+
+//
+// Pack the units, and the deleted objects they keep, in a compact form.
+// Only done for finished groups which are not the next to be undone
+// or redone.
+//
+void Basis::UndoGroup::pack(Basis &basis)
+{
+	if(mIsPacked)
+		return;
+
+	std::vector<byte> data;
+	PackPrevious previous;
+	int last_objnum = 0;
+
+	auto packDeleted = [&basis, &previous, &data](ObjType objtype, int slot)
+	{
+		switch(objtype)
+		{
+		case ObjType::things:   packObject(basis.mDeletedThings, slot, previous.thing, data); break;
+		case ObjType::vertices: packObject(basis.mDeletedVertices, slot, previous.vertex, data); break;
+		case ObjType::sectors:  packObject(basis.mDeletedSectors, slot, previous.sector, data); break;
+		case ObjType::sidedefs: packObject(basis.mDeletedSidedefs, slot, previous.sidedef, data); break;
+		case ObjType::linedefs: packObject(basis.mDeletedLinedefs, slot, previous.linedef, data); break;
+
+		default:
+			BugError("Basis::UndoGroup::pack: bad objtype %d\n", (int)objtype);
+		}
+	};
+
+	putNumber(data, (unsigned int)mOps.size());
+
+	for(const EditUnit &op : mOps)
+	{
+		data.push_back((byte)op.action);
+		data.push_back((byte)op.objtype);
+		data.push_back(op.field);
+		putSigned(data, op.objnum - last_objnum);
+		last_objnum = op.objnum;
+
+		switch(op.action)
+		{
+		case EditType::change:
+			putSigned(data, op.value);
+			break;
+
+		case EditType::insert:
+		case EditType::del:
+			data.push_back(op.slot >= 0);
+			if(op.slot >= 0)
+				packDeleted(op.objtype, op.slot);
+			break;
+
+		case EditType::insertMany:
+		case EditType::delMany:
+		{
+			const DeletedSet set = basis.mDeletedSets.take(op.slot);
+
+			putNumber(data, (unsigned int)set.objnums.size());
+			int last = 0;
+			for(int objnum : set.objnums)
+			{
+				putNumber(data, (unsigned int)(objnum - last));
+				last = objnum;
+			}
+
+			// only while the objects are out of the level
+			putNumber(data, (unsigned int)set.slots.size());
+			for(int each : set.slots)
+				packDeleted(op.objtype, each);
+			break;
+		}
+
+		default:
+			BugError("Basis::UndoGroup::pack: bad unit\n");
+		}
+	}
+
+	std::vector<EditUnit>().swap(mOps);
+
+	mUnpackedSize = 0;
+
+	if(data.size() >= DEFLATE_MIN_SIZE)
+	{
+		uLongf size = compressBound((uLong)data.size());
+		std::vector<byte> deflated(size);
+
+		if(compress2(deflated.data(), &size, data.data(), (uLong)data.size(), Z_BEST_SPEED) == Z_OK &&
+		   size < data.size())
+		{
+			deflated.resize(size);
+			mUnpackedSize = data.size();
+			data = std::move(deflated);
+		}
+	}
+
+	data.shrink_to_fit();
+	mPacked = std::move(data);
+	mIsPacked = true;
+
+	basis.mDeletedThings.trim();
+	basis.mDeletedVertices.trim();
+	basis.mDeletedSectors.trim();
+	basis.mDeletedSidedefs.trim();
+	basis.mDeletedLinedefs.trim();
+	basis.mDeletedSets.trim();
+
+	measure(basis);
+}
+
+//
+// Get the units back, with the deleted objects in the stashes again
+//
+void Basis::UndoGroup::unpack(Basis &basis)
+{
+	if(!mIsPacked)
+		return;
+
+	std::vector<byte> data;
+
+	if(mUnpackedSize > 0)
+	{
+		data.resize(mUnpackedSize);
+		uLongf size = (uLongf)mUnpackedSize;
+
+		if(uncompress(data.data(), &size, mPacked.data(), (uLong)mPacked.size()) != Z_OK ||
+		   size != mUnpackedSize)
+		{
+			BugError("Packed undo data failed to inflate\n");
+		}
+	}
+	else
+		data = std::move(mPacked);
+
+	PackReader reader = { data.data(), data.data() + data.size() };
+	PackPrevious previous;
+	int last_objnum = 0;
+
+	auto unpackDeleted = [&basis, &previous, &reader](ObjType objtype) -> int
+	{
+		switch(objtype)
+		{
+		case ObjType::things:   return unpackObject(basis.mDeletedThings, previous.thing, reader);
+		case ObjType::vertices: return unpackObject(basis.mDeletedVertices, previous.vertex, reader);
+		case ObjType::sectors:  return unpackObject(basis.mDeletedSectors, previous.sector, reader);
+		case ObjType::sidedefs: return unpackObject(basis.mDeletedSidedefs, previous.sidedef, reader);
+		case ObjType::linedefs: return unpackObject(basis.mDeletedLinedefs, previous.linedef, reader);
+
+		default:
+			BugError("Basis::UndoGroup::unpack: bad objtype %d\n", (int)objtype);
+			return -1; /* NOT REACHED */
+		}
+	};
+
+	mOps.resize(reader.getNumber());
+
+	for(EditUnit &op : mOps)
+	{
+		op.action = (EditType)reader.getByte();
+		op.objtype = (ObjType)reader.getByte();
+		op.field = reader.getByte();
+		op.objnum = last_objnum + reader.getSigned();
+		last_objnum = op.objnum;
+
+		switch(op.action)
+		{
+		case EditType::change:
+			op.value = reader.getSigned();
+			break;
+
+		case EditType::insert:
+		case EditType::del:
+			op.slot = reader.getByte() ? unpackDeleted(op.objtype) : -1;
+			break;
+
+		case EditType::insertMany:
+		case EditType::delMany:
+		{
+			DeletedSet set;
+
+			set.objnums.resize(reader.getNumber());
+			int last = 0;
+			for(int &objnum : set.objnums)
+			{
+				objnum = last + (int)reader.getNumber();
+				last = objnum;
+			}
+
+			set.slots.resize(reader.getNumber());
+			for(int &each : set.slots)
+				each = unpackDeleted(op.objtype);
+
+			op.slot = basis.mDeletedSets.put(std::move(set));
+			break;
+		}
+
+		default:
+			BugError("Basis::UndoGroup::unpack: bad unit\n");
+		}
+	}
+
+	std::vector<byte>().swap(mPacked);
+	mUnpackedSize = 0;
+	mIsPacked = false;
+
+	measure(basis);
+}
+
 //
 // Reapply
 //
@@ -30,13 +30,15 @@
 #include "DocumentModule.h"
 #include "LineDef.h"
 #include "m_strings.h"
+#include "ObjectPool.h"
 #include "objid.h"
 #include "Sector.h"
 #include "SideDef.h"
 #include "Thing.h"
 #include "Vertex.h"
+#include <deque>
 #include <memory>
-#include <stack>
+#include <unordered_set>
 
 #define DEFAULT_UNDO_GROUP_MESSAGE "[something]"
 
@@ -86,12 +88,32 @@ public:
 	bool undo();
 	bool redo();
 	void clear();
+
+	//
+	// Rough amount of memory the undo and redo steps take, in bytes
+	//
+	size_t getHistoryMemory() const
+	{
+		return mHistoryMemory;
+	}
+
+	int getUndoCount() const
+	{
+		return (int)mUndoHistory.size();
+	}
 	
 	Basis &operator = (Basis &&other) noexcept
 	{
 		mCurrentGroup = std::move(other.mCurrentGroup);
 		mUndoHistory = std::move(other.mUndoHistory);
 		mRedoFuture = std::move(other.mRedoFuture);
+		mHistoryMemory = other.mHistoryMemory;
+		mDeletedThings = std::move(other.mDeletedThings);
+		mDeletedVertices = std::move(other.mDeletedVertices);
+		mDeletedSectors = std::move(other.mDeletedSectors);
+		mDeletedSidedefs = std::move(other.mDeletedSidedefs);
+		mDeletedLinedefs = std::move(other.mDeletedLinedefs);
+		mDeletedSets = std::move(other.mDeletedSets);
 		mDidMakeChanges = other.mDidMakeChanges;
 		return *this;
 	}
@@ -105,7 +127,10 @@ private:
 		none,	// initial state (invalid)
 		change,
 		insert,
-		del
+		del,
+		// a sorted set of objects of one type, in a single pass
+		insertMany,
+		delMany
 	};
 
 	//
@@ -117,37 +142,41 @@ private:
 		ObjType objtype = ObjType::things;
 		byte field = 0;
 		int objnum = 0;
-		std::shared_ptr<Thing> thing;
-		std::shared_ptr<Vertex> vertex;
-		std::shared_ptr<Sector> sector;
-		std::shared_ptr<SideDef> sidedef;
-		std::shared_ptr<LineDef> linedef;
+		// place of the deleted object in the basis stash, -1 for none
+		// (inserting then adds a new default object). For the "many"
+		// actions, the place of the DeletedSet instead.
+		int slot = -1;
 		int value = 0;
 
 		void apply(Basis &basis);
-		void destroy();
+		void destroy(Basis &basis);
 
 	private:
 		void rawChange(Basis &basis);
 
 		void rawDelete(Basis &basis);
-		std::shared_ptr<Thing> rawDeleteThing(Document &doc) const;
-		std::shared_ptr<Vertex> rawDeleteVertex(Document &doc) const;
-		std::shared_ptr<Sector> rawDeleteSector(Document &doc) const;
-		std::shared_ptr<SideDef> rawDeleteSidedef(Document &doc) const;
-		std::shared_ptr<LineDef> rawDeleteLinedef(Document &doc) const;
+		Thing rawDeleteThing(Document &doc) const;
+		Vertex rawDeleteVertex(Document &doc) const;
+		Sector rawDeleteSector(Document &doc) const;
+		SideDef rawDeleteSidedef(Document &doc) const;
+		LineDef rawDeleteLinedef(Document &doc) const;
 
 		void rawInsert(Basis &basis);
-		void rawInsertThing(Document &doc);
-		void rawInsertVertex(Document &doc);
-		void rawInsertSector(Document &doc);
-		void rawInsertSidedef(Document &doc);
-		void rawInsertLinedef(Document &doc);
+		void rawInsertThing(Document &doc, Thing &&thing);
+		void rawInsertVertex(Document &doc, Vertex &&vertex);
+		void rawInsertSector(Document &doc, Sector &&sector);
+		void rawInsertSidedef(Document &doc, SideDef &&sidedef);
+		void rawInsertLinedef(Document &doc, LineDef &&linedef);
 
-		void deleteFinally();
+		void rawDeleteMany(Basis &basis);
+		void rawInsertMany(Basis &basis);
+
+		void deleteFinally(Basis &basis);
+		static void releaseDeleted(Basis &basis, ObjType objtype, int slot);
 	};
 
 	friend class EditOperation;
+	friend class EditJournal;
 	friend struct EditUnit;
 
 	//
@@ -157,11 +186,6 @@ private:
 	{
 	public:
 		UndoGroup() = default;
-		~UndoGroup()
-		{
-			for(auto it = mOps.rbegin(); it != mOps.rend(); ++it)
-				it->destroy();
-		}
 
 		// Ensure we only use move semantics
 		UndoGroup(const UndoGroup &other) = delete;
@@ -177,6 +201,7 @@ private:
 		UndoGroup &operator = (UndoGroup &&other) noexcept;
 
 		void reset();
+		void release(Basis &basis);
 
 		//
 		// Mark if active and ready to use
@@ -210,6 +235,26 @@ private:
 		void end()
 		{
 			mDir = -1;
+			// only needed while adding
+			std::unordered_set<uint64_t>().swap(mChangedFields);
+		}
+
+		void measure(Basis &basis);
+
+		void pack(Basis &basis);
+		void unpack(Basis &basis);
+
+		bool isPacked() const
+		{
+			return mIsPacked;
+		}
+
+		//
+		// Memory taken by the group, once measured
+		//
+		size_t getMemory() const
+		{
+			return mMemory;
 		}
 
 		void reapply(Basis &basis);
@@ -245,6 +290,18 @@ private:
 		SString mMessage = DEFAULT_UNDO_GROUP_MESSAGE;
 		SString mMenuName;
 		int mDir = 0;	// dir must be +1 or -1 if active
+
+		// the fields changed since the last insert or delete, whose
+		// first change already holds the value to go back to
+		std::unordered_set<uint64_t> mChangedFields;
+
+		size_t mMemory = 0;
+
+		// old groups get their units and the deleted objects they keep
+		// packed in here, see pack()
+		std::vector<byte> mPacked;
+		size_t mUnpackedSize = 0;	// when mPacked is compressed, else 0
+		bool mIsPacked = false;
 	};
 
 	// Called exclusively from friend class
@@ -262,16 +319,40 @@ private:
 	bool changeSidedef(int side, SideDef::StringIDAddress field, StringID value);
 	bool changeLinedef(int line, byte field, int value);
 	void del(ObjType type, int objnum);
+	void del(const selection_c &list);
 	void end();
 	void abort(bool keepChanges);
 
 	void doClearChangeStatus();
 	void doProcessChangeStatus() const;
 
+	void trimHistory();
+	void packDeep(std::deque<UndoGroup> &groups);
+	void unpackGroup(UndoGroup &grp);
+
 	UndoGroup mCurrentGroup;
-	// FIXME: use a better data type here
-	std::stack<UndoGroup> mUndoHistory;
-	std::stack<UndoGroup> mRedoFuture;
+	// oldest first, so the oldest can be dropped when over the limit
+	std::deque<UndoGroup> mUndoHistory;
+	// the next redo at the back
+	std::deque<UndoGroup> mRedoFuture;
+	size_t mHistoryMemory = 0;	// of both of the above
+
+	// the objects deleted by the groups above, kept for undoing
+	ObjectStash<Thing> mDeletedThings;
+	ObjectStash<Vertex> mDeletedVertices;
+	ObjectStash<Sector> mDeletedSectors;
+	ObjectStash<SideDef> mDeletedSidedefs;
+	ObjectStash<LineDef> mDeletedLinedefs;
+
+	//
+	// The objects taken out by one bulk deletion
+	//
+	struct DeletedSet
+	{
+		std::vector<int> objnums;	// ascending
+		std::vector<int> slots;		// in the stash of their type, while deleted
+	};
+	ObjectStash<DeletedSet> mDeletedSets;
 
 	bool mDidMakeChanges = false;
 };
@@ -352,6 +433,10 @@ public:
 	{
 		basis.del(type, objnum);
 	}
+	void del(const selection_c &list)
+	{
+		basis.del(list);
+	}
 
 	void setAbort(bool keepChanges)
 	{
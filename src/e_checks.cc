@@ -1784,7 +1784,7 @@ static bool ThingStuckInWall(const Thing *T, int r, char group, const Document &
 	{
 		const auto L = doc.linedefs[n];
 
-		if (! LD_is_blocking(L.get(), doc))
+		if (! LD_is_blocking(L, doc))
 			continue;
 
 		if (doc.objects.lineTouchesBox(n, x1, y1, x2, y2))
@@ -1810,7 +1810,7 @@ static void Things_FindStuckies(selection_c& list, const Instance &inst)
 
 		const thingtype_t &info = inst.conf.getThingType(T->type);
 
-		if (ThingStuckInWall(T.get(), info.radius, info.group, inst.level))
+		if (ThingStuckInWall(T, info.radius, info.group, inst.level))
 			list.set(blockers[n]);
 
 		for (int n2 = n + 1 ; n2 < (int)blockers.size() ; n2++)
@@ -1819,7 +1819,7 @@ static void Things_FindStuckies(selection_c& list, const Instance &inst)
 
 			const thingtype_t &info2 = inst.conf.getThingType(T2->type);
 
-			if (ThingStuckInThing(inst, T.get(), &info, T2.get(), &info2))
+			if (ThingStuckInThing(inst, T, &info, T2, &info2))
 				list.set(blockers[n]);
 		}
 	}
@@ -3136,7 +3136,7 @@ static void Tags_FindUnmatchedLineDefs(selection_c& lines, const Document &doc,
 			continue;
 
 		SpecialTagInfo info = {};
-		bool hasinfo = getSpecialTagInfo(ObjType::linedefs, n, L->type, L.get(), config, info);
+		bool hasinfo = getSpecialTagInfo(ObjType::linedefs, n, L->type, L, config, info);
 		
 		if(!hasinfo)
 			continue;
@@ -1333,6 +1333,9 @@ void Instance::CMD_OnlineDocs()
 void Instance::CMD_AboutDialog()
 {
 	DLG_AboutText();
+
+	Status_Set("Undo history: %d steps, %.1f MB", level.basis.getUndoCount(),
+			   level.basis.getHistoryMemory() / 1048576.0);
 }
 
 
@@ -983,8 +983,8 @@ static bool DeleteVertex_MergeLineDefs(Document &doc, int v_num)
 	SYS_ASSERT(ld1 >= 0);
 	SYS_ASSERT(ld2 >= 0);
 
-	const LineDef *L1 = doc.linedefs[ld1].get();
-	const LineDef *L2 = doc.linedefs[ld2].get();
+	const LineDef *L1 = doc.linedefs[ld1];
+	const LineDef *L2 = doc.linedefs[ld2];
 
 	// we merge L2 into L1, unless L1 is significantly shorter
 	if (doc.calcLength(*L1) < doc.calcLength(*L2) * 0.7)
@@ -338,6 +338,12 @@ Objid hover::getNearbyObject(ObjType type, const Document &doc, const ConfigData
 	}
 }
 
+// past this far, the casts look along the whole row or column
+static const double MAX_CAST_REACH = 1 << 20;
+
+// slack for rounding in where the casts cross a linedef
+static const double CAST_MARGIN = 1.0;
+
 //
 // Get the closest line, by casting horizontally
 //
@@ -350,40 +356,57 @@ int hover::getClosestLine_CastingHoriz(const Document &doc, v2double_t pos, Side
 	// avoid hitting vertices.
 	pos.y += 0.04;
 
-	for(int n = 0; n < doc.numLinedefs(); n++)
+	// look at the lines crossing the row near the point first, then
+	// further out until none left out can be closer than the best one
+	for(double reach = doc.spatial.cellSize(ObjType::linedefs);; reach *= 4)
 	{
-		v2double_t lpos1, lpos2;
-		lpos1.y = doc.getStart(*doc.linedefs[n]).y();
-		lpos2.y = doc.getEnd(*doc.linedefs[n]).y();
+		bool whole_row = reach > MAX_CAST_REACH;
 
-		// ignore purely horizontal lines
-		if(lpos1.y == lpos2.y)
-			continue;
+		const v2double_t lpos(whole_row ? -HUGE_VAL : pos.x - reach, pos.y);
+		const v2double_t hpos(whole_row ? HUGE_VAL : pos.x + reach, pos.y);
 
-		// does the linedef cross the horizontal ray?
-		if(std::min(lpos1.y, lpos2.y) >= pos.y || std::max(lpos1.y, lpos2.y) <= pos.y)
-			continue;
+		best_match = -1;
+		best_dist = 9e9;
 
-		lpos1.x = doc.getStart(*doc.linedefs[n]).x();
-		lpos2.x = doc.getEnd(*doc.linedefs[n]).x();
+		for(int n : doc.spatial.query(ObjType::linedefs, lpos, hpos))
+		{
+			v2double_t lpos1, lpos2;
+			lpos1.y = doc.getStart(*doc.linedefs[n]).y();
+			lpos2.y = doc.getEnd(*doc.linedefs[n]).y();
 
-		double dist = lpos1.x - pos.x + (lpos2.x - lpos1.x) * (pos.y - lpos1.y) / (lpos2.y - lpos1.y);
+			// ignore purely horizontal lines
+			if(lpos1.y == lpos2.y)
+				continue;
 
-		if(fabs(dist) < best_dist)
-		{
-			best_match = n;
-			best_dist = fabs(dist);
+			// does the linedef cross the horizontal ray?
+			if(std::min(lpos1.y, lpos2.y) >= pos.y || std::max(lpos1.y, lpos2.y) <= pos.y)
+				continue;
+
+			lpos1.x = doc.getStart(*doc.linedefs[n]).x();
+			lpos2.x = doc.getEnd(*doc.linedefs[n]).x();
+
+			double dist = lpos1.x - pos.x + (lpos2.x - lpos1.x) * (pos.y - lpos1.y) / (lpos2.y - lpos1.y);
 
-			if(side)
+			if(fabs(dist) < best_dist)
 			{
-				if(best_dist < 0.01)
-					*side = Side::neither;  // on the line
-				else if((lpos1.y > lpos2.y) == (dist > 0))
-					*side = Side::right;  // right side
-				else
-					*side = Side::left; // left side
+				best_match = n;
+				best_dist = fabs(dist);
+
+				if(side)
+				{
+					if(best_dist < 0.01)
+						*side = Side::neither;  // on the line
+					else if((lpos1.y > lpos2.y) == (dist > 0))
+						*side = Side::right;  // right side
+					else
+						*side = Side::left; // left side
+				}
 			}
 		}
+
+		// the lines not looked at cross the ray further than reach away
+		if(whole_row || best_dist < reach - CAST_MARGIN)
+			break;
 	}
 
 	return best_match;
@@ -401,40 +424,55 @@ static int getClosestLine_CastingVert(const Document &doc, v2double_t pos, Side
 	// avoid hitting vertices.
 	pos.x += 0.04;
 
-	for(int n = 0; n < doc.numLinedefs(); n++)
+	for(double reach = doc.spatial.cellSize(ObjType::linedefs);; reach *= 4)
 	{
-		v2double_t lpos1, lpos2;
-		lpos1.x = doc.getStart(*doc.linedefs[n]).x();
-		lpos2.x = doc.getEnd(*doc.linedefs[n]).x();
+		bool whole_column = reach > MAX_CAST_REACH;
 
-		// ignore purely vertical lines
-		if(lpos1.x == lpos2.x)
-			continue;
+		const v2double_t lpos(pos.x, whole_column ? -HUGE_VAL : pos.y - reach);
+		const v2double_t hpos(pos.x, whole_column ? HUGE_VAL : pos.y + reach);
 
-		// does the linedef cross the vertical ray?
-		if(std::min(lpos1.x, lpos2.x) >= pos.x || std::max(lpos1.x, lpos2.x) <= pos.x)
-			continue;
+		best_match = -1;
+		best_dist = 9e9;
 
-		lpos1.y = doc.getStart(*doc.linedefs[n]).y();
-		lpos2.y = doc.getEnd(*doc.linedefs[n]).y();
+		for(int n : doc.spatial.query(ObjType::linedefs, lpos, hpos))
+		{
+			v2double_t lpos1, lpos2;
+			lpos1.x = doc.getStart(*doc.linedefs[n]).x();
+			lpos2.x = doc.getEnd(*doc.linedefs[n]).x();
 
-		double dist = lpos1.y - pos.y + (lpos2.y - lpos1.y) * (pos.x - lpos1.x) / (lpos2.x - lpos1.x);
+			// ignore purely vertical lines
+			if(lpos1.x == lpos2.x)
+				continue;
 
-		if(fabs(dist) < best_dist)
-		{
-			best_match = n;
-			best_dist = fabs(dist);
+			// does the linedef cross the vertical ray?
+			if(std::min(lpos1.x, lpos2.x) >= pos.x || std::max(lpos1.x, lpos2.x) <= pos.x)
+				continue;
+
+			lpos1.y = doc.getStart(*doc.linedefs[n]).y();
+			lpos2.y = doc.getEnd(*doc.linedefs[n]).y();
 
-			if(side)
+			double dist = lpos1.y - pos.y + (lpos2.y - lpos1.y) * (pos.x - lpos1.x) / (lpos2.x - lpos1.x);
+
+			if(fabs(dist) < best_dist)
 			{
-				if(best_dist < 0.01)
-					*side = Side::neither;  // on the line
-				else if((lpos1.x > lpos2.x) == (dist < 0))
-					*side = Side::right;  // right side
-				else
-					*side = Side::left; // left side
+				best_match = n;
+				best_dist = fabs(dist);
+
+				if(side)
+				{
+					if(best_dist < 0.01)
+						*side = Side::neither;  // on the line
+					else if((lpos1.x > lpos2.x) == (dist < 0))
+						*side = Side::right;  // right side
+					else
+						*side = Side::left; // left side
+				}
 			}
 		}
+
+		// the lines not looked at cross the ray further than reach away
+		if(whole_column || best_dist < reach - CAST_MARGIN)
+			break;
 	}
 
 	return best_match;
@@ -763,7 +801,7 @@ static Objid getNearestThing(const Document &doc, const ConfigData &config,
 	int best = -1;
 	thing_comparer_t best_comp;
 
-	for(int n = 0; n < doc.numThings(); n++)
+	for(int n : doc.spatial.query(ObjType::things, lpos, hpos))
 	{
 		const auto thing = doc.things[n];
 		v2double_t tpos = thing->xy();
@@ -820,7 +858,7 @@ static Objid getNearestVertex(const Document &doc, const grid::State &grid, cons
 	int    best = -1;
 	double best_dist = 9e9;
 
-	for(int n = 0; n < doc.numVertices(); n++)
+	for(int n : doc.spatial.query(ObjType::vertices, lpos, hpos))
 	{
 		v2double_t vpos = doc.vertices[n]->xy();
 
@@ -865,7 +903,7 @@ static Objid getNearestLinedef(const Document &doc, const grid::State &grid, con
 	int    best = -1;
 	double best_dist = 9e9;
 
-	for(int n = 0; n < doc.numLinedefs(); n++)
+	for(int n : doc.spatial.query(ObjType::linedefs, lpos, hpos))
 	{
 		v2double_t pos1 = doc.getStart(*doc.linedefs[n]).xy();
 		v2double_t pos2 = doc.getEnd(*doc.linedefs[n]).xy();
@@ -1004,7 +1042,7 @@ static Objid getNearestSplitLine(const Document &doc, MapFormat format, const gr
 
 	double too_small = (format == MapFormat::udmf) ? 0.2 : 4.0;
 
-	for(int n = 0; n < doc.numLinedefs(); n++)
+	for(int n : doc.spatial.query(ObjType::linedefs, lpos, hpos))
 	{
 		const auto L = doc.linedefs[n];
 
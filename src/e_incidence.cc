@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------
+//  VERTEX INCIDENCE
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_incidence.h"
+
+#include "Document.h"
+#include "LineDef.h"
+
+#include <algorithm>
+
+//
+// The linedefs touching the vertex, without repeats
+//
+const std::vector<int> &VertexIncidence::linedefsAt(int v_num) const
+{
+	static const std::vector<int> none;
+
+	update();
+
+	if (v_num < 0 || v_num >= (int)lines.size())
+		return none;
+
+	return lines[v_num];
+}
+
+
+void VertexIncidence::invalidate()
+{
+	lines.clear();
+	indexed = -1;
+}
+
+
+//
+// Build the index, or add the linedefs which are new since last time
+//
+void VertexIncidence::update() const
+{
+	// some were removed without the Basis (like loading a level)
+	if (indexed > doc.numLinedefs())
+		indexed = -1;
+
+	if (indexed < 0)
+	{
+		lines.clear();
+		indexed = 0;
+	}
+
+	if ((int)lines.size() < doc.numVertices())
+		lines.resize(doc.numVertices());
+
+	for ( ; indexed < doc.numLinedefs() ; indexed++)
+	{
+		const auto L = doc.linedefs[indexed];
+
+		add(L->start, indexed);
+		add(L->end,   indexed);
+	}
+}
+
+
+void VertexIncidence::add(int v_num, int ld) const
+{
+	if (v_num < 0)
+		return;
+
+	if (v_num >= (int)lines.size())
+		lines.resize(v_num + 1);
+
+	std::vector<int> &list = lines[v_num];
+
+	// nearly always a new linedef, which goes last
+	if (list.empty() || list.back() < ld)
+	{
+		list.push_back(ld);
+		return;
+	}
+
+	auto pos = std::lower_bound(list.begin(), list.end(), ld);
+	if (*pos != ld)
+		list.insert(pos, ld);
+}
+
+
+void VertexIncidence::remove(int v_num, int ld)
+{
+	if (v_num < 0 || v_num >= (int)lines.size())
+		return;
+
+	std::vector<int> &list = lines[v_num];
+
+	auto pos = std::lower_bound(list.begin(), list.end(), ld);
+	if (pos != list.end() && *pos == ld)
+		list.erase(pos);
+}
+
+
+//
+// Move the numbers of the linedefs from 'ld' on by 'delta'
+//
+void VertexIncidence::renumber(int ld, int delta)
+{
+	for (std::vector<int> &list : lines)
+	{
+		// the lists are sorted, so only their ends change
+		for (auto it = std::lower_bound(list.begin(), list.end(), ld) ; it != list.end() ; ++it)
+			*it += delta;
+	}
+}
+
+
+void VertexIncidence::vertexInserted(int v_num)
+{
+	if (indexed < 0)
+		return;
+
+	if (v_num <= (int)lines.size())
+		lines.insert(lines.begin() + v_num, std::vector<int>());
+}
+
+
+void VertexIncidence::vertexDeleted(int v_num)
+{
+	if (indexed < 0 || v_num >= (int)lines.size())
+		return;
+
+	// linedefs still using it are broken, start again
+	if (! lines[v_num].empty())
+	{
+		invalidate();
+		return;
+	}
+
+	lines.erase(lines.begin() + v_num);
+}
+
+
+void VertexIncidence::linedefInserted(int ld)
+{
+	// a new one at the end gets picked up by the next query
+	if (indexed < 0 || ld >= indexed)
+		return;
+
+	renumber(ld, +1);
+	indexed++;
+
+	const auto L = doc.linedefs[ld];
+
+	add(L->start, ld);
+	add(L->end,   ld);
+}
+
+
+//
+// Called while the linedef is still in the level
+//
+void VertexIncidence::linedefDeleting(int ld)
+{
+	if (indexed < 0 || ld >= indexed)
+		return;
+
+	const auto L = doc.linedefs[ld];
+
+	remove(L->start, ld);
+	remove(L->end,   ld);
+
+	renumber(ld + 1, -1);
+	indexed--;
+}
+
+
+//
+// The start or end of the linedef has changed from 'old_vert'
+//
+void VertexIncidence::linedefMoved(int ld, int old_vert)
+{
+	if (indexed < 0 || ld >= indexed)
+		return;
+
+	const auto L = doc.linedefs[ld];
+
+	if (! L->TouchesVertex(old_vert))
+		remove(old_vert, ld);
+
+	add(L->start, ld);
+	add(L->end,   ld);
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------
+//  VERTEX INCIDENCE
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_E_INCIDENCE_H__
+#define __EUREKA_E_INCIDENCE_H__
+
+#include "DocumentModule.h"
+
+#include <vector>
+
+//
+// For each vertex, the linedefs which start or end at it, in index
+// order. It is built when first asked for, and the Basis keeps it up
+// to date as the level gets edited.
+//
+// The linedefs added since then are only looked at on the next query,
+// because their vertices are normally set right after Basis::addNew()
+// without going through the Basis.
+//
+class VertexIncidence : public DocumentModule
+{
+public:
+	VertexIncidence(Document &doc) : DocumentModule(doc)
+	{
+	}
+
+	const std::vector<int> &linedefsAt(int v_num) const;
+
+	void invalidate();
+
+	// called by the Basis after changing the level
+	void vertexInserted(int v_num);
+	void vertexDeleted(int v_num);
+	void linedefInserted(int ld);
+	void linedefDeleting(int ld);
+	void linedefMoved(int ld, int old_vert);
+
+private:
+	void update() const;
+	void add(int v_num, int ld) const;
+	void remove(int v_num, int ld);
+	void renumber(int ld, int delta);
+
+	mutable std::vector<std::vector<int>> lines;
+
+	// linedefs from this one on are not in the lists yet,
+	// and -1 when the whole index is to be built
+	mutable int indexed = -1;
+};
+
+#endif  /* __EUREKA_E_INCIDENCE_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
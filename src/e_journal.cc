@@ -0,0 +1,1526 @@
+//------------------------------------------------------------------------
+//  EDIT JOURNAL
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_journal.h"
+
+#include "Document.h"
+#include "Errors.h"
+#include "lib_file.h"
+#include "lib_util.h"
+#include "LineDef.h"
+#include "m_config.h"
+#include "Sector.h"
+#include "SideDef.h"
+#include "sys_debug.h"
+#include "Thing.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string.h>
+#include <thread>
+#include <zlib.h>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+bool config::edit_journal = true;
+int config::edit_journal_sync = 5;	// seconds
+int config::edit_journal_checkpoint = 1000;
+
+// bump this whenever the format changes
+static const uint32_t JOURNAL_VERSION = 1;
+
+static const char JOURNAL_MAGIC[4] = { 'E', 'J', 'N', 'L' };
+
+//
+// The file is made of blocks, each [size] [crc32] [payload], whose
+// payload starts with the kind of block
+//
+enum class JournalBlock : byte
+{
+	header = 1,
+	level,		// the whole level, then the edits made after it
+	edit,
+	aborted		// an edit which got cancelled
+};
+
+//
+// The records of the level and edit blocks
+//
+enum class JournalRecord : byte
+{
+	string = 1,		// the text of a string number used by the records after it
+	objects,		// all the objects of one type, in the level block
+	change,
+	insertNew,		// an object added by Basis::addNew()
+	insert,
+	del,
+	insertMany,
+	delMany,
+	fill,			// the fields of an object added by this edit
+	end				// with the edit message, last in each edit block
+};
+
+static const size_t BLOCK_HEADER_SIZE = 8;
+
+static const ObjType LEVEL_TYPES[] =
+{
+	ObjType::things, ObjType::vertices, ObjType::sectors, ObjType::sidedefs, ObjType::linedefs
+};
+
+
+namespace
+{
+
+class Writer
+{
+public:
+	explicit Writer(std::vector<byte> &out) : out(out)
+	{
+	}
+
+	void u8(byte value)
+	{
+		out.push_back(value);
+	}
+
+	void u32(uint32_t value)
+	{
+		for (int i = 0 ; i < 4 ; i++)
+			out.push_back(static_cast<byte>(value >> (i * 8)));
+	}
+
+	void s32(int value)
+	{
+		u32(static_cast<uint32_t>(value));
+	}
+
+	void u64(uint64_t value)
+	{
+		u32(static_cast<uint32_t>(value));
+		u32(static_cast<uint32_t>(value >> 32));
+	}
+
+	void bytes(const void *data, size_t size)
+	{
+		const byte *p = static_cast<const byte *>(data);
+		out.insert(out.end(), p, p + size);
+	}
+
+	void string(const SString &str)
+	{
+		u32(static_cast<uint32_t>(str.size()));
+		bytes(str.c_str(), str.size());
+	}
+
+private:
+	std::vector<byte> &out;
+};
+
+class Reader
+{
+public:
+	Reader(const byte *data, size_t size) : data(data), size(size)
+	{
+	}
+
+	bool u8(byte &value)
+	{
+		if (pos + 1 > size)
+			return false;
+
+		value = data[pos++];
+		return true;
+	}
+
+	bool u32(uint32_t &value)
+	{
+		if (pos + 4 > size)
+			return false;
+
+		value = 0;
+		for (int i = 0 ; i < 4 ; i++)
+			value |= static_cast<uint32_t>(data[pos++]) << (i * 8);
+		return true;
+	}
+
+	bool s32(int &value)
+	{
+		uint32_t raw;
+		if (! u32(raw))
+			return false;
+
+		value = static_cast<int>(raw);
+		return true;
+	}
+
+	bool u64(uint64_t &value)
+	{
+		uint32_t low, high;
+		if (! u32(low) || ! u32(high))
+			return false;
+
+		value = (static_cast<uint64_t>(high) << 32) | low;
+		return true;
+	}
+
+	bool string(SString &str)
+	{
+		uint32_t length;
+		if (! u32(length) || length > size - pos)
+			return false;
+
+		str = SString(reinterpret_cast<const char *>(data + pos), (int)length);
+		pos += length;
+		return true;
+	}
+
+	bool atEnd() const
+	{
+		return pos == size;
+	}
+
+private:
+	const byte *data;
+	size_t size;
+	size_t pos = 0;
+};
+
+//
+// The place and size of a block's payload in the file
+//
+struct BlockSpan
+{
+	size_t offset;
+	size_t size;
+};
+
+}
+
+
+static int fieldCount(ObjType type)
+{
+	switch (type)
+	{
+	case ObjType::things:	return sizeof(Thing) / sizeof(int);
+	case ObjType::vertices:	return sizeof(Vertex) / sizeof(int);
+	case ObjType::sectors:	return sizeof(Sector) / sizeof(int);
+	case ObjType::sidedefs:	return sizeof(SideDef) / sizeof(int);
+	case ObjType::linedefs:	return sizeof(LineDef) / sizeof(int);
+	default:
+		return 0;
+	}
+}
+
+static bool isStringField(ObjType type, int field)
+{
+	if (type == ObjType::sectors)
+		return field == Sector::F_FLOOR_TEX || field == Sector::F_CEIL_TEX;
+
+	if (type == ObjType::sidedefs)
+		return field == SideDef::F_UPPER_TEX || field == SideDef::F_MID_TEX ||
+				field == SideDef::F_LOWER_TEX;
+
+	return false;
+}
+
+//
+// The fields of an object as plain ints, like Basis does for changes
+//
+static int *objectFields(Document &doc, ObjType type, int objnum)
+{
+	switch (type)
+	{
+	case ObjType::things:	return reinterpret_cast<int *>(doc.things[objnum]);
+	case ObjType::vertices:	return reinterpret_cast<int *>(doc.vertices[objnum]);
+	case ObjType::sectors:	return reinterpret_cast<int *>(doc.sectors[objnum]);
+	case ObjType::sidedefs:	return reinterpret_cast<int *>(doc.sidedefs[objnum]);
+	case ObjType::linedefs:	return reinterpret_cast<int *>(doc.linedefs[objnum]);
+	default:
+		BugError("EditJournal: bad objtype %u\n", (unsigned)type);
+		return nullptr; /* NOT REACHED */
+	}
+}
+
+static bool readFile(const fs::path &path, std::vector<byte> &data)
+{
+	FILE *fp = fopen(path.u8string().c_str(), "rb");
+	if (! fp)
+		return false;
+
+	byte buffer[65536];
+	size_t got;
+	while ((got = fread(buffer, 1, sizeof(buffer), fp)) > 0)
+		data.insert(data.end(), buffer, buffer + got);
+
+	bool ok = ! ferror(fp);
+	fclose(fp);
+	return ok;
+}
+
+//
+// Finds the blocks which were completely written, stopping at the
+// first one which wasn't. Returns where that one starts.
+//
+static size_t splitBlocks(const std::vector<byte> &data, std::vector<BlockSpan> &blocks)
+{
+	size_t pos = 0;
+
+	while (data.size() - pos >= BLOCK_HEADER_SIZE)
+	{
+		Reader r(data.data() + pos, BLOCK_HEADER_SIZE);
+		uint32_t size, crc;
+		r.u32(size);
+		r.u32(crc);
+
+		if (size == 0 || size > data.size() - pos - BLOCK_HEADER_SIZE)
+			break;
+
+		const byte *payload = data.data() + pos + BLOCK_HEADER_SIZE;
+		if (crc32(0, payload, size) != crc)
+			break;
+
+		blocks.push_back({ pos + BLOCK_HEADER_SIZE, size });
+		pos += BLOCK_HEADER_SIZE + size;
+	}
+
+	return pos;
+}
+
+static void wadStamp(const fs::path &wadPath, uint64_t &size, int64_t &time)
+{
+	std::error_code err;
+
+	size = fs::file_size(wadPath, err);
+	if (err)
+		size = 0;
+
+	fs::file_time_type stamp = fs::last_write_time(wadPath, err);
+	time = err ? 0 : static_cast<int64_t>(stamp.time_since_epoch().count());
+}
+
+//
+// Checks the first two blocks: the header matching the wad as it
+// is now, then the level
+//
+static bool checkStart(const std::vector<byte> &data, const std::vector<BlockSpan> &blocks,
+		const fs::path &wadPath, const SString &mapName)
+{
+	if (blocks.size() < 2)
+		return false;
+
+	Reader r(data.data() + blocks[0].offset, blocks[0].size);
+
+	byte kind;
+	char magic[4];
+	uint32_t version;
+	SString name;
+	uint64_t size;
+	uint64_t time;
+
+	if (! r.u8(kind) || kind != (byte)JournalBlock::header)
+		return false;
+
+	for (char &c : magic)
+		if (! r.u8(reinterpret_cast<byte &>(c)))
+			return false;
+
+	if (memcmp(magic, JOURNAL_MAGIC, 4) != 0 || ! r.u32(version) || version != JOURNAL_VERSION)
+		return false;
+
+	if (! r.string(name) || ! r.u64(size) || ! r.u64(time))
+		return false;
+
+	uint64_t wadSize;
+	int64_t wadTime;
+	wadStamp(wadPath, wadSize, wadTime);
+
+	if (name != mapName.asUpper() || size != wadSize || static_cast<int64_t>(time) != wadTime)
+		return false;
+
+	return data[blocks[1].offset] == (byte)JournalBlock::level;
+}
+
+
+//------------------------------------------------------------------------
+//  WRITING
+//------------------------------------------------------------------------
+
+//
+// Writes the blocks into the file on a thread of its own, in the order
+// they were handed over. Filling in the block sizes and checksums, the
+// new copies of the level and forcing the file onto the disk are all
+// done there.
+//
+class EditJournal::Output
+{
+public:
+	explicit Output(const fs::path &path);
+	~Output();
+
+	Output(const Output &other) = delete;
+	Output &operator = (const Output &other) = delete;
+
+	// a new file with these blocks, which replaces the old one once it
+	// is on the disk
+	void restart(std::vector<std::vector<byte>> &&blocks);
+	void append(std::vector<byte> &&block);
+	void sync();
+
+	void flush();
+
+	// forgets what wasn't written yet, as the file is not wanted anymore
+	void abandon();
+
+	bool failed() const
+	{
+		return mFailed;
+	}
+
+private:
+	enum class JobKind
+	{
+		restart,
+		append,
+		sync
+	};
+
+	struct Job
+	{
+		JobKind kind;
+		std::vector<std::vector<byte>> blocks;
+	};
+
+	void push(JobKind kind, std::vector<std::vector<byte>> &&blocks);
+	void run();
+
+	bool doRestart(std::vector<std::vector<byte>> &blocks);
+	bool doAppend(std::vector<byte> &block);
+	bool write(FILE *fp, const fs::path &path, std::vector<byte> &block);
+
+	const fs::path mPath;
+	FILE *mFile = nullptr;	// only used by the thread
+
+	std::mutex mMutex;
+	std::condition_variable mWake;	// a job to do, or stopping
+	std::condition_variable mIdle;	// all the jobs are done
+	std::deque<Job> mJobs;
+	bool mBusy = false;
+	bool mStopping = false;
+	std::atomic<bool> mFailed = false;
+
+	std::thread mThread;
+};
+
+static void cannotWrite(const fs::path &path)
+{
+	gLog.printf("Edit journal: cannot write %s: %s\n", path.u8string().c_str(),
+			GetErrorMessage(errno).c_str());
+}
+
+//
+// Makes sure what was written is on the disk, for surviving the whole
+// system going down too
+//
+static bool syncFile(FILE *fp)
+{
+#ifdef WIN32
+	return _commit(_fileno(fp)) == 0;
+#else
+	return fsync(fileno(fp)) == 0;
+#endif
+}
+
+EditJournal::Output::Output(const fs::path &path) : mPath(path)
+{
+	mThread = std::thread([this]()
+	{
+		run();
+	});
+}
+
+//
+// Waits for everything still to do to be written
+//
+EditJournal::Output::~Output()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWake.notify_one();
+
+	mThread.join();
+}
+
+void EditJournal::Output::restart(std::vector<std::vector<byte>> &&blocks)
+{
+	push(JobKind::restart, std::move(blocks));
+}
+
+void EditJournal::Output::append(std::vector<byte> &&block)
+{
+	std::vector<std::vector<byte>> blocks;
+	blocks.push_back(std::move(block));
+
+	push(JobKind::append, std::move(blocks));
+}
+
+void EditJournal::Output::sync()
+{
+	push(JobKind::sync, {});
+}
+
+void EditJournal::Output::flush()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+	mIdle.wait(lock, [this]()
+	{
+		return mJobs.empty() && ! mBusy;
+	});
+}
+
+void EditJournal::Output::abandon()
+{
+	std::lock_guard<std::mutex> lock(mMutex);
+	mJobs.clear();
+}
+
+void EditJournal::Output::push(JobKind kind, std::vector<std::vector<byte>> &&blocks)
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back({ kind, std::move(blocks) });
+	}
+	mWake.notify_one();
+}
+
+void EditJournal::Output::run()
+{
+	std::unique_lock<std::mutex> lock(mMutex);
+
+	for (;;)
+	{
+		mWake.wait(lock, [this]()
+		{
+			return mStopping || ! mJobs.empty();
+		});
+
+		if (mJobs.empty())
+			break;
+
+		Job job = std::move(mJobs.front());
+		mJobs.pop_front();
+		mBusy = true;
+
+		lock.unlock();
+
+		// after a failure the journal is of no use, so nothing more
+		// gets written
+		if (! mFailed)
+		{
+			bool ok = true;
+
+			switch (job.kind)
+			{
+			case JobKind::restart:
+				ok = doRestart(job.blocks);
+				break;
+
+			case JobKind::append:
+				ok = doAppend(job.blocks[0]);
+				break;
+
+			case JobKind::sync:
+				if (mFile)
+					syncFile(mFile);
+				break;
+			}
+
+			if (! ok)
+				mFailed = true;
+		}
+
+		lock.lock();
+		mBusy = false;
+
+		if (mJobs.empty())
+			mIdle.notify_all();
+	}
+
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+	}
+}
+
+bool EditJournal::Output::doRestart(std::vector<std::vector<byte>> &blocks)
+{
+	if (mFile)
+	{
+		fclose(mFile);
+		mFile = nullptr;
+	}
+
+	fs::path temp_path = mPath;
+	temp_path += ".tmp";
+
+	FILE *fp = fopen(temp_path.u8string().c_str(), "wb");
+	if (! fp)
+	{
+		cannotWrite(temp_path);
+		return false;
+	}
+
+	bool ok = true;
+	for (std::vector<byte> &block : blocks)
+		ok = ok && write(fp, temp_path, block);
+
+	if (ok)
+		syncFile(fp);
+
+	if (fclose(fp) != 0)
+		ok = false;
+
+	std::error_code err;
+	if (ok)
+	{
+		fs::rename(temp_path, mPath, err);
+		if (err)
+			ok = false;
+	}
+
+	if (ok)
+		mFile = fopen(mPath.u8string().c_str(), "ab");
+
+	if (! mFile)
+	{
+		cannotWrite(mPath);
+		FileDelete(temp_path);
+		return false;
+	}
+
+	return true;
+}
+
+bool EditJournal::Output::doAppend(std::vector<byte> &block)
+{
+	// going on with a journal which was replayed
+	if (! mFile)
+		mFile = fopen(mPath.u8string().c_str(), "ab");
+
+	if (! mFile)
+	{
+		cannotWrite(mPath);
+		return false;
+	}
+
+	return write(mFile, mPath, block);
+}
+
+//
+// Fills in the size and checksum of the block, then writes it at once
+//
+bool EditJournal::Output::write(FILE *fp, const fs::path &path, std::vector<byte> &block)
+{
+	size_t size = block.size() - BLOCK_HEADER_SIZE;
+	uint32_t crc = static_cast<uint32_t>(crc32(0, block.data() + BLOCK_HEADER_SIZE,
+			static_cast<uInt>(size)));
+
+	std::vector<byte> head;
+	Writer w(head);
+	w.u32(static_cast<uint32_t>(size));
+	w.u32(crc);
+	std::copy(head.begin(), head.end(), block.begin());
+
+	// handed to the system right away, so it survives the editor crashing
+	if (fwrite(block.data(), 1, block.size(), fp) != block.size() || fflush(fp) != 0)
+	{
+		cannotWrite(path);
+		return false;
+	}
+
+	return true;
+}
+
+
+//------------------------------------------------------------------------
+//  KEEPING
+//------------------------------------------------------------------------
+
+EditJournal::EditJournal(Document &doc) : DocumentModule(doc)
+{
+}
+
+EditJournal::~EditJournal()
+{
+	close();
+}
+
+fs::path EditJournal::pathFor(const fs::path &wadPath, const SString &mapName)
+{
+	fs::path path = wadPath;
+	path += SString::printf(".%s.journal", mapName.asUpper().c_str()).c_str();
+	return path;
+}
+
+//
+// Begins a new journal for the level as it is now, which is what was
+// just loaded from or saved to the wad
+//
+void EditJournal::start(const fs::path &wadPath, const SString &mapName)
+{
+	discard();
+
+	fs::path path = pathFor(wadPath, mapName);
+
+	// any older one is out of date now
+	if (FileExists(path))
+		FileDelete(path);
+
+	if (! config::edit_journal)
+		return;
+
+	mPath = path;
+	mMapName = mapName.asUpper();
+	wadStamp(wadPath, mWadSize, mWadTime);
+	mTotalEdits = 0;
+
+	mOutput = std::make_unique<Output>(mPath);
+	writeCheckpoint();
+}
+
+int EditJournal::countEdits(const fs::path &wadPath, const SString &mapName)
+{
+	std::vector<byte> data;
+	if (! readFile(pathFor(wadPath, mapName), data))
+		return -1;
+
+	std::vector<BlockSpan> blocks;
+	splitBlocks(data, blocks);
+
+	if (! checkStart(data, blocks, wadPath, mapName))
+		return -1;
+
+	Reader r(data.data() + blocks[1].offset, blocks[1].size);
+	byte kind;
+	uint32_t earlier;
+	if (! r.u8(kind) || ! r.u32(earlier))
+		return -1;
+
+	int count = (int)earlier;
+	for (size_t i = 2 ; i < blocks.size() ; i++)
+		if (data[blocks[i].offset] == (byte)JournalBlock::edit)
+			count++;
+
+	return count;
+}
+
+void EditJournal::restamp(const fs::path &wadPath, const SString &mapName)
+{
+	if (! mOutput || pathFor(wadPath, mMapName) != mPath)
+		return;
+
+	fs::path path = pathFor(wadPath, mapName);
+
+	if (path != mPath)
+	{
+		// the file is complete once the thread is done with it
+		mOutput.reset();
+
+		std::error_code err;
+		fs::rename(mPath, path, err);
+		if (err)
+		{
+			gLog.printf("Edit journal: cannot rename %s: %s\n", mPath.u8string().c_str(),
+					err.message().c_str());
+			close();
+			return;
+		}
+
+		mPath = path;
+		mMapName = mapName.asUpper();
+		mOutput = std::make_unique<Output>(mPath);
+	}
+
+	wadStamp(wadPath, mWadSize, mWadTime);
+	writeCheckpoint();
+}
+
+//
+// Stops writing the journal, leaving the file in place
+//
+void EditJournal::close()
+{
+	if (mOutput)
+	{
+		if (mUnsynced)
+			sync();
+
+		// waits for the rest to be written
+		mOutput.reset();
+	}
+
+	mPath.clear();
+	mRecords.clear();
+	mFresh.clear();
+}
+
+//
+// Stops writing the journal and removes it, once its edits are not
+// needed anymore (saved or thrown away)
+//
+void EditJournal::discard()
+{
+	if (! mOutput)
+		return;
+
+	fs::path path = mPath;
+
+	mOutput->abandon();
+	mUnsynced = false;
+
+	close();
+	FileDelete(path);
+}
+
+void EditJournal::flush()
+{
+	if (mOutput)
+		mOutput->flush();
+}
+
+//
+// Hands a copy of the whole level to the thread, which puts it in a
+// new file replacing the journal
+//
+void EditJournal::writeCheckpoint()
+{
+	std::vector<std::vector<byte>> blocks;
+
+	mRecords.assign(BLOCK_HEADER_SIZE, 0);
+	Writer w(mRecords);
+
+	w.u8((byte)JournalBlock::header);
+	w.bytes(JOURNAL_MAGIC, 4);
+	w.u32(JOURNAL_VERSION);
+	w.string(mMapName);
+	w.u64(mWadSize);
+	w.u64(static_cast<uint64_t>(mWadTime));
+
+	blocks.push_back(std::move(mRecords));
+
+	mWrittenStrings.clear();
+
+	mRecords.assign(BLOCK_HEADER_SIZE, 0);
+	w.u8((byte)JournalBlock::level);
+	w.u32(static_cast<uint32_t>(mTotalEdits));
+
+	for (ObjType type : LEVEL_TYPES)
+	{
+		int count = doc.numObjects(type);
+		int fields = fieldCount(type);
+
+		for (int n = 0 ; n < count ; n++)
+			putStrings(type, objectFields(doc, type, n));
+
+		w.u8((byte)JournalRecord::objects);
+		w.u8((byte)type);
+		w.u32(static_cast<uint32_t>(count));
+		for (int n = 0 ; n < count ; n++)
+			w.bytes(objectFields(doc, type, n), fields * sizeof(int));
+	}
+
+	blocks.push_back(std::move(mRecords));
+	mRecords.clear();
+
+	mOutput->restart(std::move(blocks));
+
+	// the new file goes onto the disk as a whole
+	mEdits = 0;
+	mUnsynced = false;
+	mLastSync = std::chrono::steady_clock::now();
+}
+
+//
+// Has the written blocks forced onto the disk
+//
+void EditJournal::sync()
+{
+	mOutput->sync();
+
+	mUnsynced = false;
+	mLastSync = std::chrono::steady_clock::now();
+}
+
+//
+// Starts the next record of the current edit
+//
+void EditJournal::putRecord(JournalRecord record)
+{
+	if (mRecords.empty())
+	{
+		mRecords.assign(BLOCK_HEADER_SIZE, 0);
+		mRecords.push_back((byte)JournalBlock::edit);
+	}
+	mRecords.push_back((byte)record);
+}
+
+//
+// Writes the text of the strings in the fields the first time each
+// is used, since their numbers are different in each run
+//
+void EditJournal::putStrings(ObjType type, const int *fields)
+{
+	if (type == ObjType::sectors)
+	{
+		putString(fields[Sector::F_FLOOR_TEX]);
+		putString(fields[Sector::F_CEIL_TEX]);
+	}
+	else if (type == ObjType::sidedefs)
+	{
+		putString(fields[SideDef::F_UPPER_TEX]);
+		putString(fields[SideDef::F_MID_TEX]);
+		putString(fields[SideDef::F_LOWER_TEX]);
+	}
+}
+
+void EditJournal::putString(int id)
+{
+	if (id < 0)
+		return;
+
+	if (id >= (int)mWrittenStrings.size())
+		mWrittenStrings.resize(id + 1);
+	else if (mWrittenStrings[id])
+		return;
+
+	mWrittenStrings[id] = true;
+
+	putRecord(JournalRecord::string);
+	Writer w(mRecords);
+	w.s32(id);
+	w.string(BA_GetString(StringID(id)));
+}
+
+void EditJournal::putObject(ObjType type, int objnum)
+{
+	const int *fields = objectFields(doc, type, objnum);
+	Writer(mRecords).bytes(fields, fieldCount(type) * sizeof(int));
+}
+
+void EditJournal::changed(ObjType type, int objnum, int field, int value)
+{
+	if (! mOutput || mReplaying)
+		return;
+
+	if (isStringField(type, field))
+		putString(value);
+
+	putRecord(JournalRecord::change);
+	Writer w(mRecords);
+	w.u8((byte)type);
+	w.u8(static_cast<byte>(field));
+	w.s32(objnum);
+	w.s32(value);
+}
+
+void EditJournal::inserted(ObjType type, int objnum, bool fresh)
+{
+	if (! mOutput || mReplaying)
+		return;
+
+	for (auto &entry : mFresh)
+		if (entry.first == type && entry.second >= objnum)
+			entry.second++;
+
+	if (fresh)
+	{
+		mFresh.emplace_back(type, objnum);
+
+		putRecord(JournalRecord::insertNew);
+		Writer w(mRecords);
+		w.u8((byte)type);
+		w.s32(objnum);
+		return;
+	}
+
+	putStrings(type, objectFields(doc, type, objnum));
+
+	putRecord(JournalRecord::insert);
+	Writer w(mRecords);
+	w.u8((byte)type);
+	w.s32(objnum);
+	putObject(type, objnum);
+}
+
+void EditJournal::deleted(ObjType type, int objnum)
+{
+	if (! mOutput || mReplaying)
+		return;
+
+	for (auto it = mFresh.begin() ; it != mFresh.end() ; )
+	{
+		if (it->first == type && it->second == objnum)
+		{
+			it = mFresh.erase(it);
+			continue;
+		}
+		if (it->first == type && it->second > objnum)
+			it->second--;
+		++it;
+	}
+
+	putRecord(JournalRecord::del);
+	Writer w(mRecords);
+	w.u8((byte)type);
+	w.s32(objnum);
+}
+
+void EditJournal::insertedMany(ObjType type, const std::vector<int> &objnums)
+{
+	if (! mOutput || mReplaying)
+		return;
+
+	// objnums are where the objects are now, lowest first
+	for (auto &entry : mFresh)
+	{
+		if (entry.first != type)
+			continue;
+
+		for (int objnum : objnums)
+			if (objnum <= entry.second)
+				entry.second++;
+	}
+
+	for (int objnum : objnums)
+		putStrings(type, objectFields(doc, type, objnum));
+
+	putRecord(JournalRecord::insertMany);
+	Writer w(mRecords);
+	w.u8((byte)type);
+	w.u32(static_cast<uint32_t>(objnums.size()));
+	for (int objnum : objnums)
+	{
+		w.s32(objnum);
+		putObject(type, objnum);
+	}
+}
+
+void EditJournal::deletedMany(ObjType type, const std::vector<int> &objnums)
+{
+	if (! mOutput || mReplaying)
+		return;
+
+	for (auto it = mFresh.begin() ; it != mFresh.end() ; )
+	{
+		if (it->first == type)
+		{
+			auto below = std::lower_bound(objnums.begin(), objnums.end(), it->second);
+			if (below != objnums.end() && *below == it->second)
+			{
+				it = mFresh.erase(it);
+				continue;
+			}
+			it->second -= (int)(below - objnums.begin());
+		}
+		++it;
+	}
+
+	putRecord(JournalRecord::delMany);
+	Writer w(mRecords);
+	w.u8((byte)type);
+	w.u32(static_cast<uint32_t>(objnums.size()));
+	for (int objnum : objnums)
+		w.s32(objnum);
+}
+
+//
+// Appends the edit which just ended
+//
+void EditJournal::commit(const SString &message, bool aborted)
+{
+	// the thread could not write it
+	if (mOutput && mOutput->failed())
+		close();
+
+	if (! mOutput || mReplaying || mRecords.empty())
+	{
+		mRecords.clear();
+		mFresh.clear();
+		return;
+	}
+
+	for (const auto &entry : mFresh)
+	{
+		putStrings(entry.first, objectFields(doc, entry.first, entry.second));
+
+		putRecord(JournalRecord::fill);
+		Writer w(mRecords);
+		w.u8((byte)entry.first);
+		w.s32(entry.second);
+		putObject(entry.first, entry.second);
+	}
+	mFresh.clear();
+
+	putRecord(JournalRecord::end);
+	Writer(mRecords).string(message);
+
+	if (aborted)
+		mRecords[BLOCK_HEADER_SIZE] = (byte)JournalBlock::aborted;
+
+	mOutput->append(std::move(mRecords));
+	mRecords.clear();
+	mUnsynced = true;
+
+	if (! aborted)
+	{
+		mEdits++;
+		mTotalEdits++;
+	}
+
+	if (config::edit_journal_checkpoint > 0 && mEdits >= config::edit_journal_checkpoint)
+	{
+		writeCheckpoint();
+		return;
+	}
+
+	if (config::edit_journal_sync == 0 ||
+		(config::edit_journal_sync > 0 && std::chrono::steady_clock::now() - mLastSync >=
+				std::chrono::seconds(config::edit_journal_sync)))
+	{
+		sync();
+	}
+}
+
+
+//------------------------------------------------------------------------
+//  REPLAYING
+//------------------------------------------------------------------------
+
+//
+// Reads the records of a journal into the level. The string numbers
+// of this run are looked up from the ones in the file.
+//
+class EditJournal::Replayer
+{
+public:
+	Replayer(Document &doc, Basis &basis) : doc(doc), basis(basis)
+	{
+	}
+
+	bool level(Reader &r, uint32_t &earlier);
+	bool edit(Reader &r, bool aborted);
+
+private:
+	bool string(Reader &r);
+	bool readObject(Reader &r, ObjType type, std::vector<int> &fields);
+	bool readType(Reader &r, ObjType &type);
+	int stash(ObjType type, const int *fields);
+
+	template<typename T>
+	static void restore(ObjectPool<T> &pool, const std::vector<int> &fields, int count);
+
+	Document &doc;
+	Basis &basis;
+
+	std::vector<int> mStrings;	// from the number in the file, -1 for unknown
+};
+
+bool EditJournal::Replayer::string(Reader &r)
+{
+	int id;
+	SString text;
+	if (! r.s32(id) || id < 0 || ! r.string(text))
+		return false;
+
+	if (id >= (int)mStrings.size())
+		mStrings.resize(id + 1, -1);
+
+	mStrings[id] = BA_InternaliseString(text).get();
+	return true;
+}
+
+bool EditJournal::Replayer::readType(Reader &r, ObjType &type)
+{
+	byte raw;
+	if (! r.u8(raw))
+		return false;
+
+	type = static_cast<ObjType>(raw);
+	return fieldCount(type) > 0;
+}
+
+bool EditJournal::Replayer::readObject(Reader &r, ObjType type, std::vector<int> &fields)
+{
+	int count = fieldCount(type);
+	fields.resize(count);
+
+	for (int i = 0 ; i < count ; i++)
+	{
+		if (! r.s32(fields[i]))
+			return false;
+
+		if (isStringField(type, i))
+		{
+			if (fields[i] < 0 || fields[i] >= (int)mStrings.size() || mStrings[fields[i]] < 0)
+				return false;
+			fields[i] = mStrings[fields[i]];
+		}
+	}
+	return true;
+}
+
+template<typename T>
+static int stashFields(ObjectStash<T> &stash, const int *fields)
+{
+	T object;
+	memcpy(static_cast<void *>(&object), fields, sizeof(T));
+	return stash.put(std::move(object));
+}
+
+int EditJournal::Replayer::stash(ObjType type, const int *fields)
+{
+	switch (type)
+	{
+	case ObjType::things:	return stashFields(basis.mDeletedThings, fields);
+	case ObjType::vertices:	return stashFields(basis.mDeletedVertices, fields);
+	case ObjType::sectors:	return stashFields(basis.mDeletedSectors, fields);
+	case ObjType::sidedefs:	return stashFields(basis.mDeletedSidedefs, fields);
+	case ObjType::linedefs:	return stashFields(basis.mDeletedLinedefs, fields);
+	default:
+		BugError("EditJournal: bad objtype %u\n", (unsigned)type);
+		return -1; /* NOT REACHED */
+	}
+}
+
+template<typename T>
+void EditJournal::Replayer::restore(ObjectPool<T> &pool, const std::vector<int> &fields, int count)
+{
+	pool.clear();
+	pool.reserve(count);
+
+	for (int n = 0 ; n < count ; n++)
+	{
+		T object;
+		memcpy(static_cast<void *>(&object), fields.data() + n * (sizeof(T) / sizeof(int)), sizeof(T));
+		pool.push_back(std::move(object));
+	}
+}
+
+//
+// The level block: the strings, then all the objects of each type
+//
+bool EditJournal::Replayer::level(Reader &r, uint32_t &earlier)
+{
+	byte kind;
+	if (! r.u8(kind) || ! r.u32(earlier))
+		return false;
+
+	// read it all before touching the level
+	std::vector<int> objects[5];
+	int counts[5] = {};
+	int found = 0;
+
+	byte record;
+	while (r.u8(record))
+	{
+		if (record == (byte)JournalRecord::string)
+		{
+			if (! string(r))
+				return false;
+			continue;
+		}
+
+		ObjType type;
+		uint32_t count;
+		if (record != (byte)JournalRecord::objects || ! readType(r, type) || ! r.u32(count))
+			return false;
+
+		auto place = std::find(std::begin(LEVEL_TYPES), std::end(LEVEL_TYPES), type);
+		int index = (int)(place - std::begin(LEVEL_TYPES));
+		if (place == std::end(LEVEL_TYPES) || (found & (1 << index)))
+			return false;
+		found |= 1 << index;
+
+		std::vector<int> fields;
+		for (uint32_t n = 0 ; n < count ; n++)
+		{
+			if (! readObject(r, type, fields))
+				return false;
+			objects[index].insert(objects[index].end(), fields.begin(), fields.end());
+		}
+		counts[index] = (int)count;
+	}
+
+	if (found != (1 << 5) - 1)
+		return false;
+
+	restore(doc.things, objects[0], counts[0]);
+	restore(doc.vertices, objects[1], counts[1]);
+	restore(doc.sectors, objects[2], counts[2]);
+	restore(doc.sidedefs, objects[3], counts[3]);
+	restore(doc.linedefs, objects[4], counts[4]);
+
+	basis.clear();
+	doc.incidence.invalidate();
+	doc.spatial.invalidate();
+	return true;
+}
+
+//
+// An edit block, done again as one undo group. If it doesn't make
+// sense for the level, it gets taken back.
+//
+bool EditJournal::Replayer::edit(Reader &r, bool aborted)
+{
+	basis.begin();
+
+	byte record;
+	while (r.u8(record))
+	{
+		ObjType type;
+		int objnum = 0;
+		std::vector<int> fields;
+
+		Basis::EditUnit op;
+
+		switch ((JournalRecord)record)
+		{
+		case JournalRecord::string:
+			if (! string(r))
+				break;
+			continue;
+
+		case JournalRecord::change:
+		{
+			byte field;
+			int value;
+			if (! readType(r, type) || ! r.u8(field) || ! r.s32(objnum) || ! r.s32(value))
+				break;
+			if (field >= fieldCount(type) || objnum < 0 || objnum >= doc.numObjects(type))
+				break;
+			if (isStringField(type, field))
+			{
+				if (value < 0 || value >= (int)mStrings.size() || mStrings[value] < 0)
+					break;
+				value = mStrings[value];
+			}
+			basis.change(type, objnum, field, value);
+			continue;
+		}
+
+		case JournalRecord::insertNew:
+		case JournalRecord::insert:
+			if (! readType(r, type) || ! r.s32(objnum) || objnum < 0 ||
+				objnum > doc.numObjects(type))
+			{
+				break;
+			}
+			op.action = Basis::EditType::insert;
+			op.objtype = type;
+			op.objnum = objnum;
+			if (record == (byte)JournalRecord::insert)
+			{
+				if (! readObject(r, type, fields))
+					break;
+				op.slot = stash(type, fields.data());
+			}
+			basis.mCurrentGroup.addApply(std::move(op), basis);
+			continue;
+
+		case JournalRecord::del:
+			if (! readType(r, type) || ! r.s32(objnum) || objnum < 0 ||
+				objnum >= doc.numObjects(type))
+			{
+				break;
+			}
+			op.action = Basis::EditType::del;
+			op.objtype = type;
+			op.objnum = objnum;
+			basis.mCurrentGroup.addApply(std::move(op), basis);
+			continue;
+
+		case JournalRecord::insertMany:
+		case JournalRecord::delMany:
+		{
+			uint32_t count;
+			if (! readType(r, type) || ! r.u32(count) || count == 0)
+				break;
+
+			bool inserting = record == (byte)JournalRecord::insertMany;
+			int limit = doc.numObjects(type) + (inserting ? (int)count : 0);
+
+			// all read before anything gets stashed
+			Basis::DeletedSet set;
+			std::vector<int> objects;
+			bool ok = true;
+			for (uint32_t n = 0 ; n < count && ok ; n++)
+			{
+				ok = r.s32(objnum) && objnum >= 0 && objnum < limit &&
+						(set.objnums.empty() || objnum > set.objnums.back());
+				if (ok && inserting)
+				{
+					ok = readObject(r, type, fields);
+					objects.insert(objects.end(), fields.begin(), fields.end());
+				}
+				if (ok)
+					set.objnums.push_back(objnum);
+			}
+			if (! ok)
+				break;
+
+			if (inserting)
+				for (size_t n = 0 ; n < set.objnums.size() ; n++)
+					set.slots.push_back(stash(type, objects.data() + n * fieldCount(type)));
+
+			op.action = inserting ? Basis::EditType::insertMany : Basis::EditType::delMany;
+			op.objtype = type;
+			op.slot = basis.mDeletedSets.put(std::move(set));
+			basis.mCurrentGroup.addApply(std::move(op), basis);
+			continue;
+		}
+
+		case JournalRecord::fill:
+			if (! readType(r, type) || ! r.s32(objnum) || objnum < 0 ||
+				objnum >= doc.numObjects(type) || ! readObject(r, type, fields))
+			{
+				break;
+			}
+			memcpy(objectFields(doc, type, objnum), fields.data(), fields.size() * sizeof(int));
+			continue;
+
+		case JournalRecord::end:
+		{
+			SString message;
+			if (! r.string(message) || ! r.atEnd())
+				break;
+
+			if (aborted)
+				basis.abort(true);
+			else
+			{
+				basis.setMessage("%s", message.c_str());
+				basis.end();
+			}
+			return true;
+		}
+
+		default:
+			break;
+		}
+
+		// a record which doesn't fit
+		break;
+	}
+
+	basis.abort(false);
+	return false;
+}
+
+int EditJournal::replay(const fs::path &wadPath, const SString &mapName)
+{
+	discard();
+
+	fs::path path = pathFor(wadPath, mapName);
+
+	std::vector<byte> data;
+	if (! readFile(path, data))
+		return -1;
+
+	std::vector<BlockSpan> blocks;
+	splitBlocks(data, blocks);
+
+	if (! checkStart(data, blocks, wadPath, mapName))
+		return -1;
+
+	mReplaying = true;
+
+	Replayer replayer(doc, doc.basis);
+	uint32_t earlier;
+
+	Reader first(data.data() + blocks[1].offset, blocks[1].size);
+	if (! replayer.level(first, earlier))
+	{
+		mReplaying = false;
+		return -1;
+	}
+
+	int edits = 0;
+	size_t used = 2;
+
+	for ( ; used < blocks.size() ; used++)
+	{
+		const BlockSpan &span = blocks[used];
+		Reader r(data.data() + span.offset, span.size);
+
+		byte kind = 0;
+		r.u8(kind);
+		if (kind != (byte)JournalBlock::edit && kind != (byte)JournalBlock::aborted)
+			break;
+
+		if (! replayer.edit(r, kind == (byte)JournalBlock::aborted))
+			break;
+
+		if (kind == (byte)JournalBlock::edit)
+			edits++;
+	}
+
+	mReplaying = false;
+
+	gLog.printf("Edit journal: replayed %d edits from %s\n", edits, path.u8string().c_str());
+
+	// go on from the last good block, dropping any unfinished one
+	size_t end = used < blocks.size() ? blocks[used].offset - BLOCK_HEADER_SIZE :
+			blocks.back().offset + blocks.back().size;
+
+	mPath = path;
+	mMapName = mapName.asUpper();
+	wadStamp(wadPath, mWadSize, mWadTime);
+	mEdits = edits;
+	mTotalEdits = (int)earlier + edits;
+	mWrittenStrings.clear();
+
+	std::error_code err;
+	fs::resize_file(path, end, err);
+	if (err)
+	{
+		gLog.printf("Edit journal: cannot write %s: %s\n", path.u8string().c_str(),
+				err.message().c_str());
+		mPath.clear();
+		return mTotalEdits;
+	}
+
+	mOutput = std::make_unique<Output>(path);
+	mLastSync = std::chrono::steady_clock::now();
+
+	return mTotalEdits;
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
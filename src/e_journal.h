@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------
+//  EDIT JOURNAL
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_E_JOURNAL_H__
+#define __EUREKA_E_JOURNAL_H__
+
+#include "DocumentModule.h"
+#include "m_strings.h"
+#include "objid.h"
+
+#include "filesystem.hpp"
+namespace fs = ghc::filesystem;
+
+#include <chrono>
+#include <memory>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+enum class JournalRecord : byte;
+
+//
+// Keeps the edits made to the level since it was loaded or saved in
+// a file next to the wad, so they can be recovered if the editor
+// crashes before they get saved.
+//
+// The file starts with a copy of the whole level, followed by one
+// block per edit (undo group) with its units, appended when the edit
+// ends. A block which didn't get fully written is ignored when
+// replaying. Every so many edits the file is written again from a
+// new copy of the level, so it doesn't grow without limit.
+//
+// The file is written by a thread of its own, so the editing doesn't
+// wait for the disk.
+//
+class EditJournal : public DocumentModule
+{
+public:
+	EditJournal(Document &doc);
+	~EditJournal();
+
+	EditJournal(const EditJournal &other) = delete;
+	EditJournal &operator = (const EditJournal &other) = delete;
+
+	static fs::path pathFor(const fs::path &wadPath, const SString &mapName);
+
+	void start(const fs::path &wadPath, const SString &mapName);
+
+	// the number of edits which a journal left for this map has, or
+	// -1 if there is none or it doesn't belong to the wad as it is now
+	static int countEdits(const fs::path &wadPath, const SString &mapName);
+
+	// puts the level as it was in the journal, then goes on keeping it.
+	// Returns the number of edits done again, or -1 if it couldn't.
+	int replay(const fs::path &wadPath, const SString &mapName);
+
+	// the editor wrote the wad again itself (like the nodes after a
+	// save, or the level under a new name): goes on with the journal,
+	// which would not match the wad anymore
+	void restamp(const fs::path &wadPath, const SString &mapName);
+
+	void close();
+	void discard();
+
+	// waits until what was kept so far is in the file
+	void flush();
+
+	bool isOpen() const
+	{
+		return mOutput != nullptr;
+	}
+
+	// called by the basis as it applies the units
+	void changed(ObjType type, int objnum, int field, int value);
+	void inserted(ObjType type, int objnum, bool fresh);
+	void deleted(ObjType type, int objnum);
+	void insertedMany(ObjType type, const std::vector<int> &objnums);
+	void deletedMany(ObjType type, const std::vector<int> &objnums);
+
+	// at the end of each group of units
+	void commit(const SString &message, bool aborted);
+
+private:
+	class Output;
+	class Replayer;
+
+	void writeCheckpoint();
+	void sync();
+
+	void putRecord(JournalRecord record);
+	void putStrings(ObjType type, const int *fields);
+	void putString(int id);
+	void putObject(ObjType type, int objnum);
+
+	fs::path mPath;
+	SString mMapName;
+	uint64_t mWadSize = 0;
+	int64_t mWadTime = 0;
+
+	std::unique_ptr<Output> mOutput;
+	int mEdits = 0;		// since the last copy of the level
+	int mTotalEdits = 0;	// since it was started
+	bool mReplaying = false;
+
+	// the records of the current group
+	std::vector<byte> mRecords;
+
+	// objects added in the current group, filled in at its end, since
+	// their fields get set directly after Basis::addNew()
+	std::vector<std::pair<ObjType, int>> mFresh;
+
+	// the strings already written since the last copy of the level
+	std::vector<bool> mWrittenStrings;
+
+	std::chrono::steady_clock::time_point mLastSync;
+	bool mUnsynced = false;
+};
+
+#endif  /* __EUREKA_E_JOURNAL_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
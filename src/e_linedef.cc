@@ -52,7 +52,7 @@ bool config::leave_offsets_alone = true;
 //
 bool LinedefModule::linedefAlreadyExists(int v1, int v2) const
 {
-	for (int n = 0 ; n < doc.numLinedefs() ; n++)
+	for (int n : doc.incidence.linedefsAt(v1))
 	{
 		const auto L = doc.linedefs[n];
 
@@ -72,7 +72,7 @@ bool LinedefModule::linedefAlreadyExists(int v1, int v2) const
 //
 inline const LineDef * LinedefModule::pointer(const Objid& obj) const
 {
-	return doc.linedefs[obj.num].get();
+	return doc.linedefs[obj.num];
 }
 
 //
@@ -84,7 +84,7 @@ inline const SideDef * LinedefModule::sidedefPointer(const Objid& obj) const
 
 	int sd = pointer(obj)->WhatSideDef(where);
 
-	return (sd >= 0) ? doc.sidedefs[sd].get() : nullptr;
+	return (sd >= 0) ? doc.sidedefs[sd] : nullptr;
 }
 
 
@@ -343,7 +343,7 @@ void LinedefModule::determineAdjoiner(Objid& result,
 	{
 		const auto N = doc.linedefs[n];
 
-		if (N.get() == L)
+		if (N == L)
 			continue;
 
 		if (doc.isZeroLength(*N))
@@ -1160,7 +1160,7 @@ void LinedefModule::removeSidedef(EditOperation &op, int ld, Side ld_side) const
 
 	// FIXME: if sidedef is shared, either don't modify it _OR_ duplicate it
 
-	const SideDef *SD = doc.sidedefs[other_sd].get();
+	const SideDef *SD = doc.sidedefs[other_sd];
 
 	StringID new_tex = BA_InternaliseString(inst.conf.default_wall_tex);
 
@@ -1171,7 +1171,7 @@ void LinedefModule::removeSidedef(EditOperation &op, int ld, Side ld_side) const
 		new_tex = SD->upper_tex;
 	else if (gone_sd >= 0)
 	{
-		SD = doc.sidedefs[gone_sd].get();
+		SD = doc.sidedefs[gone_sd];
 
 		if (! is_null_tex(SD->LowerTex()))
 			new_tex = SD->lower_tex;
@@ -420,6 +420,8 @@ void Instance::MapStuff_NotifyBegin()
 
 void Instance::MapStuff_NotifyInsert(ObjType type, int objnum)
 {
+	level.spatial.notifyInsert(type, objnum);
+
 	if (type == ObjType::vertices)
 	{
 		if (new_vertex_minimum < 0 || objnum < new_vertex_minimum)
@@ -429,6 +431,8 @@ void Instance::MapStuff_NotifyInsert(ObjType type, int objnum)
 
 void Instance::MapStuff_NotifyDelete(ObjType type, int objnum)
 {
+	level.spatial.notifyDelete(type, objnum);
+
 	if (type == ObjType::vertices)
 	{
 		recalc_map_bounds = true;
@@ -443,6 +447,8 @@ void Instance::MapStuff_NotifyDelete(ObjType type, int objnum)
 
 void Instance::MapStuff_NotifyChange(ObjType type, int objnum, int field)
 {
+	level.spatial.notifyChange(type, objnum, field);
+
 	if (type == ObjType::vertices)
 	{
 		// NOTE: for performance reasons we don't recalculate the
@@ -473,6 +479,8 @@ void Instance::MapStuff_NotifyChange(ObjType type, int objnum, int field)
 
 void Instance::MapStuff_NotifyEnd()
 {
+	level.spatial.notifyEnd();
+
 	if (recalc_map_bounds || moved_vertex_count > 10)  // TODO: CONFIG
 	{
 		level.CalculateLevelBounds();
@@ -505,7 +513,7 @@ void Instance::ObjectBox_NotifyInsert(ObjType type, int objnum)
 	if (type != edit.mode)
 		return;
 
-	if (objnum > main_win->GetPanelObjNum())
+	if (main_win && objnum > main_win->GetPanelObjNum())
 		return;
 
 	invalidated_panel_obj = true;
@@ -846,7 +854,7 @@ void SelectObjectsInBox(const Document &doc, selection_c *list, ObjType objtype,
 	switch (objtype)
 	{
 		case ObjType::things:
-			for (int n = 0 ; n < doc.numThings() ; n++)
+			for (int n : doc.spatial.query(ObjType::things, pos1, pos2))
 			{
 				const auto T = doc.things[n];
 
@@ -858,7 +866,7 @@ void SelectObjectsInBox(const Document &doc, selection_c *list, ObjType objtype,
 			break;
 
 		case ObjType::vertices:
-			for (int n = 0 ; n < doc.numVertices(); n++)
+			for (int n : doc.spatial.query(ObjType::vertices, pos1, pos2))
 			{
 				const auto V = doc.vertices[n];
 
@@ -870,7 +878,7 @@ void SelectObjectsInBox(const Document &doc, selection_c *list, ObjType objtype,
 			break;
 
 		case ObjType::linedefs:
-			for (int n = 0 ; n < doc.numLinedefs(); n++)
+			for (int n : doc.spatial.query(ObjType::linedefs, pos1, pos2))
 			{
 				const auto L = doc.linedefs[n];
 
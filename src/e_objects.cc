@@ -62,23 +62,10 @@ int  config::new_sector_size = 128;
 //
 void ObjectsModule::del(EditOperation &op, const selection_c &list) const
 {
-	// we need to process the object numbers from highest to lowest,
-	// because each deletion invalidates all higher-numbered refs
-	// in the selection.  Our selection iterator cannot give us
-	// what we need, hence put them into a vector for sorting.
+	// the Basis takes them all out in one go, which also keeps
+	// the higher-numbered refs in the selection valid.
 
-	if (list.empty())
-		return;
-
-	std::vector<int> objnums;
-
-	for (sel_iter_c it(list) ; !it.done() ; it.next())
-		objnums.push_back(*it);
-
-	std::sort(objnums.begin(), objnums.end());
-
-	for (int i = (int)objnums.size()-1 ; i >= 0 ; i--)
-		op.del(list.what_type(), objnums[i]);
+	op.del(list);
 }
 
 
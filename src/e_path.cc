@@ -111,7 +111,7 @@ static bool OtherLineDef(const Document &doc, int L, int V, int *L_other, int *V
 	*L_other = -1;
 	*V_other = -1;
 
-	for (int n = 0 ; n < doc.numLinedefs(); n++)
+	for (int n : doc.incidence.linedefsAt(V))
 	{
 		if (n == L)
 			continue;
@@ -0,0 +1,422 @@
+//------------------------------------------------------------------------
+//  SPATIAL INDEX
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_spatial.h"
+
+#include "Document.h"
+#include "LineDef.h"
+#include "Thing.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <math.h>
+
+// smallest cell, in map units
+static const double MIN_CELL_SIZE = 64;
+
+// most cells along either side of a grid
+static const int MAX_GRID_SIZE = 1024;
+
+
+int SpatialIndex::Grid::cellX(double x) const
+{
+	double cell = floor((x - origin.x) / cellSize);
+
+	if (cell < 0)
+		return 0;
+	if (cell >= width)
+		return width - 1;
+
+	return (int)cell;
+}
+
+
+int SpatialIndex::Grid::cellY(double y) const
+{
+	double cell = floor((y - origin.y) / cellSize);
+
+	if (cell < 0)
+		return 0;
+	if (cell >= height)
+		return height - 1;
+
+	return (int)cell;
+}
+
+
+SpatialIndex::CellBox SpatialIndex::Grid::cellBox(const v2double_t &lpos, const v2double_t &hpos) const
+{
+	CellBox box;
+
+	box.x1 = cellX(lpos.x);
+	box.y1 = cellY(lpos.y);
+	box.x2 = cellX(hpos.x);
+	box.y2 = cellY(hpos.y);
+
+	box.clamped = lpos.x < origin.x || lpos.y < origin.y ||
+				  hpos.x >= origin.x + width * cellSize || hpos.y >= origin.y + height * cellSize;
+
+	return box;
+}
+
+
+void SpatialIndex::Grid::place(int objnum, const CellBox &box)
+{
+	for (int y = box.y1 ; y <= box.y2 ; y++)
+		for (int x = box.x1 ; x <= box.x2 ; x++)
+			cells[y * width + x].push_back(objnum);
+
+	if (objnum == (int)boxes.size())
+		boxes.push_back(box);
+	else
+		boxes[objnum] = box;
+
+	if (box.clamped)
+		clampedCount++;
+}
+
+
+void SpatialIndex::Grid::unplace(int objnum)
+{
+	const CellBox &box = boxes[objnum];
+
+	for (int y = box.y1 ; y <= box.y2 ; y++)
+	{
+		for (int x = box.x1 ; x <= box.x2 ; x++)
+		{
+			std::vector<int> &cell = cells[y * width + x];
+
+			auto pos = std::find(cell.begin(), cell.end(), objnum);
+			if (pos != cell.end())
+				cell.erase(pos);
+		}
+	}
+
+	if (box.clamped)
+		clampedCount--;
+}
+
+
+//------------------------------------------------------------------------
+
+
+SpatialIndex::Grid *SpatialIndex::gridFor(ObjType type) const
+{
+	switch (type)
+	{
+	case ObjType::things:   return &things;
+	case ObjType::vertices: return &vertices;
+	case ObjType::linedefs: return &linedefs;
+
+	default:
+		return nullptr;
+	}
+}
+
+
+//
+// The bounding box of an object
+//
+void SpatialIndex::bounds(ObjType type, int objnum, v2double_t &lpos, v2double_t &hpos) const
+{
+	switch (type)
+	{
+	case ObjType::things:
+		lpos = hpos = doc.things[objnum]->xy();
+		return;
+
+	case ObjType::vertices:
+		lpos = hpos = doc.vertices[objnum]->xy();
+		return;
+
+	case ObjType::linedefs:
+	{
+		const auto L = doc.linedefs[objnum];
+
+		// a new linedef may not have its vertices yet
+		v2double_t pos1 = doc.isVertex(L->start) ? doc.vertices[L->start]->xy() : v2double_t();
+		v2double_t pos2 = doc.isVertex(L->end)   ? doc.vertices[L->end]  ->xy() : v2double_t();
+
+		lpos = v2double_t(std::min(pos1.x, pos2.x), std::min(pos1.y, pos2.y));
+		hpos = v2double_t(std::max(pos1.x, pos2.x), std::max(pos1.y, pos2.y));
+		return;
+	}
+
+	default:
+		return;
+	}
+}
+
+
+void SpatialIndex::build(ObjType type) const
+{
+	Grid &grid = *gridFor(type);
+
+	int total = doc.numObjects(type);
+
+	v2double_t low = {}, high = {};
+
+	for (int n = 0 ; n < total ; n++)
+	{
+		v2double_t lpos, hpos;
+		bounds(type, n, lpos, hpos);
+
+		if (n == 0 || lpos.x < low.x)  low.x  = lpos.x;
+		if (n == 0 || lpos.y < low.y)  low.y  = lpos.y;
+		if (n == 0 || hpos.x > high.x) high.x = hpos.x;
+		if (n == 0 || hpos.y > high.y) high.y = hpos.y;
+	}
+
+	// aim for a few objects in each cell
+	double span_x = high.x - low.x;
+	double span_y = high.y - low.y;
+
+	grid.cellSize = std::max(MIN_CELL_SIZE, 2 * sqrt((span_x + 1) * (span_y + 1) / std::max(total, 1)));
+	grid.cellSize = std::max(grid.cellSize, std::max(span_x, span_y) / (MAX_GRID_SIZE - 1));
+
+	grid.origin = low;
+	grid.width  = (int)(span_x / grid.cellSize) + 1;
+	grid.height = (int)(span_y / grid.cellSize) + 1;
+
+	grid.cells.clear();
+	grid.cells.resize(grid.width * grid.height);
+
+	grid.boxes.clear();
+	grid.boxes.reserve(total);
+	grid.count = 0;
+	grid.clampedCount = 0;
+	grid.built = true;
+
+	for (int n = 0 ; n < total ; n++)
+		append(type, n);
+}
+
+
+//
+// Put an object in the place it has now
+//
+void SpatialIndex::relocate(ObjType type, int objnum) const
+{
+	Grid &grid = *gridFor(type);
+
+	v2double_t lpos, hpos;
+	bounds(type, objnum, lpos, hpos);
+
+	CellBox box = grid.cellBox(lpos, hpos);
+
+	if (box == grid.boxes[objnum])
+		return;
+
+	grid.unplace(objnum);
+	grid.place(objnum, box);
+}
+
+
+//
+// Add the object after the last one in the grid
+//
+void SpatialIndex::append(ObjType type, int objnum) const
+{
+	Grid &grid = *gridFor(type);
+
+	v2double_t lpos, hpos;
+	bounds(type, objnum, lpos, hpos);
+
+	grid.place(objnum, grid.cellBox(lpos, hpos));
+	grid.count++;
+}
+
+
+//
+// The grid for the type, built if it needs to be
+//
+SpatialIndex::Grid *SpatialIndex::readyGrid(ObjType type) const
+{
+	Grid *grid = gridFor(type);
+	if (! grid)
+		return nullptr;
+
+	// some were removed without the notifications (like loading a level)
+	if (! grid->built || grid->count > doc.numObjects(type))
+		build(type);
+
+	return grid;
+}
+
+
+std::vector<int> SpatialIndex::query(ObjType type, const v2double_t &lpos, const v2double_t &hpos) const
+{
+	std::vector<int> result;
+
+	Grid *grid = readyGrid(type);
+	if (! grid)
+		return result;
+
+	int total = doc.numObjects(type);
+
+	CellBox box = grid->cellBox(lpos, hpos);
+
+	for (int y = box.y1 ; y <= box.y2 ; y++)
+	{
+		for (int x = box.x1 ; x <= box.x2 ; x++)
+		{
+			const std::vector<int> &cell = grid->cells[y * grid->width + x];
+
+			result.insert(result.end(), cell.begin(), cell.end());
+		}
+	}
+
+	// the ones not in the grid yet
+	for (int n = grid->count ; n < total ; n++)
+		result.push_back(n);
+
+	// linedefs can be in several cells
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+
+	return result;
+}
+
+
+double SpatialIndex::cellSize(ObjType type) const
+{
+	Grid *grid = readyGrid(type);
+
+	return grid ? grid->cellSize : MIN_CELL_SIZE;
+}
+
+
+void SpatialIndex::invalidate()
+{
+	for (Grid *grid : { &things, &vertices, &linedefs })
+	{
+		grid->built = false;
+		grid->addedFrom = INT_MAX;
+	}
+}
+
+
+void SpatialIndex::notifyInsert(ObjType type, int objnum)
+{
+	Grid *grid = gridFor(type);
+
+	if (! grid)
+		return;
+
+	// its fields are only final once the edit ends
+	grid->addedFrom = std::min(grid->addedFrom, objnum);
+
+	// the ones after it get renumbered
+	if (grid->built && objnum < grid->count)
+		grid->built = false;
+}
+
+
+//
+// Called while the object is still in the level
+//
+void SpatialIndex::notifyDelete(ObjType type, int objnum)
+{
+	Grid *grid = gridFor(type);
+
+	if (! grid || ! grid->built || objnum >= grid->count)
+		return;
+
+	if (objnum == grid->count - 1 && objnum == doc.numObjects(type) - 1)
+	{
+		grid->unplace(objnum);
+		grid->boxes.pop_back();
+		grid->count--;
+		return;
+	}
+
+	grid->built = false;
+}
+
+
+void SpatialIndex::notifyChange(ObjType type, int objnum, int field)
+{
+	switch (type)
+	{
+	case ObjType::things:
+		if (things.built && objnum < things.count && (field == Thing::F_X || field == Thing::F_Y))
+			relocate(type, objnum);
+		break;
+
+	case ObjType::vertices:
+		if (field != Vertex::F_X && field != Vertex::F_Y)
+			break;
+
+		if (vertices.built && objnum < vertices.count)
+			relocate(type, objnum);
+
+		if (linedefs.built)
+		{
+			for (int ld : doc.incidence.linedefsAt(objnum))
+				if (ld < linedefs.count)
+					relocate(ObjType::linedefs, ld);
+		}
+		break;
+
+	case ObjType::linedefs:
+		if (linedefs.built && objnum < linedefs.count && (field == LineDef::F_START || field == LineDef::F_END))
+			relocate(type, objnum);
+		break;
+
+	default:
+		break;
+	}
+}
+
+
+//
+// The fields of the new objects are final now, put them in the grids
+//
+void SpatialIndex::notifyEnd()
+{
+	for (ObjType type : { ObjType::things, ObjType::vertices, ObjType::linedefs })
+	{
+		Grid &grid = *gridFor(type);
+
+		if (! grid.built)
+		{
+			grid.addedFrom = INT_MAX;
+			continue;
+		}
+
+		int total = doc.numObjects(type);
+
+		// added earlier in the edit, then caught by a rebuild
+		for (int n = grid.addedFrom ; n < grid.count && n < total ; n++)
+			relocate(type, n);
+
+		for (int n = grid.count ; n < total ; n++)
+			append(type, n);
+
+		grid.addedFrom = INT_MAX;
+
+		// the level has grown well past the grid
+		if (grid.clampedCount > grid.count / 4 + 64)
+			grid.built = false;
+	}
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
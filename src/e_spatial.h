@@ -0,0 +1,121 @@
+//------------------------------------------------------------------------
+//  SPATIAL INDEX
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_E_SPATIAL_H__
+#define __EUREKA_E_SPATIAL_H__
+
+#include "DocumentModule.h"
+#include "m_vector.h"
+#include "objid.h"
+
+#include <limits.h>
+#include <vector>
+
+//
+// Uniform grids of the things, vertices and linedefs, for finding
+// the ones near a place without looking at all of them. Each grid
+// is built when first asked for, and the map notifications keep it
+// up to date as the level gets edited.
+//
+// Objects added during an edit are only put in the grid once the
+// edit ends, since their fields get set right after Basis::addNew().
+// Until then every query returns them.
+//
+class SpatialIndex : public DocumentModule
+{
+public:
+	SpatialIndex(Document &doc) : DocumentModule(doc)
+	{
+	}
+
+	// The objects which can be in the box, in ascending order: things
+	// and vertices at a place inside it, and linedefs whose bounding
+	// box meets it. A few more may be returned, never fewer.
+	std::vector<int> query(ObjType type, const v2double_t &lpos, const v2double_t &hpos) const;
+
+	// The size of the cells for this type of object, in map units.
+	// Boxes smaller than this only look at a few cells.
+	double cellSize(ObjType type) const;
+
+	void invalidate();
+
+	// called from the MapStuff notifications
+	void notifyInsert(ObjType type, int objnum);
+	void notifyDelete(ObjType type, int objnum);
+	void notifyChange(ObjType type, int objnum, int field);
+	void notifyEnd();
+
+private:
+	struct CellBox
+	{
+		int x1, y1, x2, y2;
+		bool clamped;	// the object goes past the edge of the grid
+
+		bool operator == (const CellBox &other) const
+		{
+			return x1 == other.x1 && y1 == other.y1 && x2 == other.x2 && y2 == other.y2;
+		}
+	};
+
+	struct Grid
+	{
+		bool built = false;
+
+		v2double_t origin = {};
+		double cellSize = 1;
+		int width = 0;
+		int height = 0;
+
+		std::vector<std::vector<int>> cells;
+
+		// where each object from 0 to count-1 is; the ones past
+		// those are not in the grid yet
+		std::vector<CellBox> boxes;
+		int count = 0;
+		int clampedCount = 0;
+
+		// the first object added during the current edit
+		int addedFrom = INT_MAX;
+
+		int cellX(double x) const;
+		int cellY(double y) const;
+		CellBox cellBox(const v2double_t &lpos, const v2double_t &hpos) const;
+
+		void place(int objnum, const CellBox &box);
+		void unplace(int objnum);
+	};
+
+	Grid *gridFor(ObjType type) const;
+	void bounds(ObjType type, int objnum, v2double_t &lpos, v2double_t &hpos) const;
+
+	Grid *readyGrid(ObjType type) const;
+	void build(ObjType type) const;
+	void relocate(ObjType type, int objnum) const;
+	void append(ObjType type, int objnum) const;
+
+	mutable Grid things;
+	mutable Grid vertices;
+	mutable Grid linedefs;
+};
+
+#endif  /* __EUREKA_E_SPATIAL_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -66,9 +66,9 @@ int VertexModule::findDragOther(int v_num) const
 
 	int fallback = -1;
 
-	for (int i = 0 ; i < doc.numLinedefs() ; i++)
+	for (int ld : doc.incidence.linedefsAt(v_num))
 	{
-		const auto L = doc.linedefs[i];
+		const auto L = doc.linedefs[ld];
 
 		if (L->end == v_num)
 			return L->start;
@@ -83,17 +83,7 @@ int VertexModule::findDragOther(int v_num) const
 
 int VertexModule::howManyLinedefs(int v_num) const
 {
-	int count = 0;
-
-	for (int n = 0 ; n < doc.numLinedefs() ; n++)
-	{
-		const auto L = doc.linedefs[n];
-
-		if (L->start == v_num || L->end == v_num)
-			count++;
-	}
-
-	return count;
+	return (int)doc.incidence.linedefsAt(v_num).size();
 }
 
 
@@ -474,7 +464,7 @@ void VertexModule::doDisconnectVertex(EditOperation &op, int v_num, int num_line
 		if (L->start == v_num || L->end == v_num)
 		{
 			double new_x, new_y;
-			calcDisconnectCoord(L.get(), v_num, &new_x, &new_y);
+			calcDisconnectCoord(L, v_num, &new_x, &new_y);
 
 			// the _LAST_ linedef keeps the current vertex, the rest
 			// need a new one.
@@ -572,7 +562,7 @@ void VertexModule::doDisconnectLinedef(EditOperation &op, int ld, int which_vert
 		return;
 
 	double new_x, new_y;
-	calcDisconnectCoord(doc.linedefs[ld].get(), v_num, &new_x, &new_y);
+	calcDisconnectCoord(doc.linedefs[ld], v_num, &new_x, &new_y);
 
 	int new_v = op.addNew(ObjType::vertices);
 
@@ -736,7 +726,7 @@ void VertexModule::DETSEC_SeparateLine(EditOperation &op, int ld_num, int start2
 
 	StringID tex = BA_InternaliseString(inst.conf.default_wall_tex);
 
-	const SideDef * SD = doc.sidedefs[L1->right].get();
+	const SideDef * SD = doc.sidedefs[L1->right];
 
 	if (! is_null_tex(SD->LowerTex()))
 		tex = SD->lower_tex;
@@ -748,7 +738,7 @@ void VertexModule::DETSEC_SeparateLine(EditOperation &op, int ld_num, int start2
 
 	// now fix the second line's textures
 
-	SD = doc.sidedefs[lost_sd].get();
+	SD = doc.sidedefs[lost_sd];
 
 	if (! is_null_tex(SD->LowerTex()))
 		tex = SD->lower_tex;
@@ -994,7 +984,7 @@ void Instance::CMD_VT_ShapeLine()
 	{
 		const auto V = level.vertices[*it];
 
-		double weight = WeightForVertex(V.get(), pos1.x,pos1.y, pos2.x,pos2.y, width,height, -1);
+		double weight = WeightForVertex(V, pos1.x,pos1.y, pos2.x,pos2.y, width,height, -1);
 
 		if (weight > 0)
 		{
@@ -1004,7 +994,7 @@ void Instance::CMD_VT_ShapeLine()
 			a_total += weight;
 		}
 
-		weight = WeightForVertex(V.get(), pos1.x,pos1.y, pos2.x,pos2.y, width,height, +1);
+		weight = WeightForVertex(V, pos1.x,pos1.y, pos2.x,pos2.y, width,height, +1);
 
 		if (weight > 0)
 		{
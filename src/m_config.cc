@@ -105,12 +105,76 @@ const opt_desc_t options[] =
 
 	{	"quiet",
 		"q",
-		OptFlag_pass1,
+		OptFlag_pass1 | OptFlag_helpNewline,
 		"Quiet mode (no messages on stdout)",
 		NULL,
 		&global::Quiet
 	},
 
+	{	"build-nodes",
+		0,
+		OptFlag_pass1,
+		"Build the nodes of a wad (without the GUI) and exit",
+		"<file>",
+		&global::build_nodes_file
+	},
+
+	{	"output",
+		"o",
+		OptFlag_pass1,
+		"Where --build-nodes writes the wad (default: in place)",
+		"<file>",
+		&global::build_nodes_output
+	},
+
+	{	"jobs",
+		0,
+		OptFlag_pass1,
+		"Number of threads for --build-nodes (0 = one per core)",
+		"<num>",
+		&global::build_nodes_jobs
+	},
+
+	{	"fast",
+		0,
+		OptFlag_pass1,
+		"Fast (but worse) node building for --build-nodes",
+		NULL,
+		&global::build_nodes_fast
+	},
+
+	{	"budget",
+		0,
+		OptFlag_pass1,
+		"Most partition candidates tried at each node by --build-nodes",
+		"<num>",
+		&global::build_nodes_budget
+	},
+
+	{	"factor",
+		0,
+		OptFlag_pass1,
+		"Seg split factor (1-31) for --build-nodes",
+		"<num>",
+		&global::build_nodes_factor
+	},
+
+	{	"portfolio",
+		0,
+		OptFlag_pass1,
+		"Split factors tried at once by --build-nodes, keeping the best tree",
+		"<num,...>",
+		&global::build_nodes_portfolio
+	},
+
+	{	"portfolio-height",
+		0,
+		OptFlag_pass1 | OptFlag_helpNewline,
+		"Keep the lowest tree of the --portfolio, not the fewest segs",
+		NULL,
+		&global::build_nodes_portfolio_height
+	},
+
 	//
 	// Normal options from here on....
 	//
@@ -221,6 +285,14 @@ const opt_desc_t options[] =
 		&config::bsp_on_save
 	},
 
+	{	"bsp_background",
+		0,
+		OptFlag_preference,
+		"Node building: build the nodes after saving while editing goes on",
+		NULL,
+		&config::bsp_background
+	},
+
 	{	"bsp_fast",
 		0,
 		OptFlag_preference,
@@ -245,6 +317,38 @@ const opt_desc_t options[] =
 		&config::bsp_split_factor
 	},
 
+	{	"bsp_portfolio",
+		0,
+		OptFlag_preference,
+		"Node building: split factors to try at once, keeping the best tree (e.g. 3,11,23)",
+		NULL,
+		&config::bsp_portfolio
+	},
+
+	{	"bsp_portfolio_height",
+		0,
+		OptFlag_preference,
+		"Node building: keep the lowest tree of the portfolio, not the fewest segs",
+		NULL,
+		&config::bsp_portfolio_height
+	},
+
+	{	"bsp_pick_budget",
+		0,
+		OptFlag_preference,
+		"Node building: most partition candidates tried at each node (0 = all of them)",
+		NULL,
+		&config::bsp_pick_budget
+	},
+
+	{	"bsp_pick_time",
+		0,
+		OptFlag_preference,
+		"Node building: seconds after which fewer partition candidates are tried (0 = no limit)",
+		NULL,
+		&config::bsp_pick_time
+	},
+
 	{	"bsp_gl_nodes",
 		0,
 		OptFlag_preference,
@@ -277,6 +381,78 @@ const opt_desc_t options[] =
 		&config::bsp_compressed
 	},
 
+	{	"bsp_threads",
+		0,
+		OptFlag_preference,
+		"Node building: number of threads (0 = one per CPU core, 1 = none)",
+		NULL,
+		&config::bsp_threads
+	},
+
+	{	"bsp_task_depth",
+		0,
+		OptFlag_preference,
+		"Node building: deepest subtree built by a separate thread",
+		NULL,
+		&config::bsp_task_depth
+	},
+
+	{	"bsp_task_segs",
+		0,
+		OptFlag_preference,
+		"Node building: fewest segs of a subtree built by a separate thread",
+		NULL,
+		&config::bsp_task_segs
+	},
+
+	{	"bsp_cache",
+		0,
+		OptFlag_preference,
+		"Node building: re-use the nodes of unchanged levels when saving",
+		NULL,
+		&config::bsp_cache
+	},
+
+	{	"bsp_cache_size",
+		0,
+		OptFlag_preference,
+		"Node building: number of levels kept in the node cache",
+		NULL,
+		&config::bsp_cache_size
+	},
+
+	{	"bsp_incremental",
+		0,
+		OptFlag_preference,
+		"Node building: when saving, keep the partitions of the last build away from the changes",
+		NULL,
+		&config::bsp_incremental
+	},
+
+	{	"bsp_blockmap_search",
+		0,
+		OptFlag_preference,
+		"Node building: move the blockmap origin to where the BLOCKMAP lump is smallest",
+		NULL,
+		&config::bsp_blockmap_search
+	},
+
+	{	"bsp_full_reject",
+		0,
+		OptFlag_preference,
+		"Node building: work out which sectors can see each other for the REJECT lump",
+		NULL,
+		&config::bsp_full_reject
+	},
+
+	{	"bsp_reject_time",
+		0,
+		OptFlag_preference,
+		"Node building: most seconds spent on the full REJECT lump (0 = no limit)",
+		NULL,
+		&config::bsp_reject_time
+	},
+
 	{	"default_gamma",
 		0,
 		OptFlag_preference,
@@ -333,6 +509,30 @@ const opt_desc_t options[] =
 		&config::dotty_point_col
 	},
 
+	{	"edit_journal",
+		0,
+		OptFlag_preference,
+		"Keep the unsaved edits in a journal next to the wad, for recovering them after a crash",
+		NULL,
+		&config::edit_journal
+	},
+
+	{	"edit_journal_sync",
+		0,
+		OptFlag_preference,
+		"Edit journal: most seconds before the edits are forced onto the disk (0 = every edit, -1 = never)",
+		NULL,
+		&config::edit_journal_sync
+	},
+
+	{	"edit_journal_checkpoint",
+		0,
+		OptFlag_preference,
+		"Edit journal: edits before it is written again from the whole level (0 = never)",
+		NULL,
+		&config::edit_journal_checkpoint
+	},
+
 	{	"floor_bump_small",
 		0,
 		OptFlag_preference,
@@ -661,6 +861,14 @@ const opt_desc_t options[] =
 		&config::transparent_col
 	},
 
+	{	"undo_max_space",
+		0,
+		OptFlag_preference,
+		"Maximum memory to use (in MB) for the undo history, 0 for no limit",
+		NULL,
+		&config::undo_max_space
+	},
+
 	{	"swap_sidedefs",
 		0,
 		OptFlag_preference,
@@ -144,15 +144,42 @@ extern bool render_unknown_bright;
 extern rgb_color_t transparent_col;
 
 extern bool bsp_on_save;
+extern bool bsp_background;
 extern bool bsp_fast;
 extern bool bsp_warnings;
 extern int  bsp_split_factor;
 
+extern SString bsp_portfolio;
+extern bool bsp_portfolio_height;
+
+extern int  bsp_pick_budget;
+extern int  bsp_pick_time;
+
 extern bool bsp_gl_nodes;
 extern bool bsp_force_v5;
 extern bool bsp_force_zdoom;
 extern bool bsp_compressed;
 
+extern int  bsp_threads;
+extern int  bsp_task_depth;
+extern int  bsp_task_segs;
+
+extern bool bsp_cache;
+extern int  bsp_cache_size;
+
+extern bool bsp_incremental;
+
+extern bool bsp_blockmap_search;
+
+extern bool bsp_full_reject;
+extern int  bsp_reject_time;
+
+extern int undo_max_space;
+
+extern bool edit_journal;
+extern int  edit_journal_sync;
+extern int  edit_journal_checkpoint;
+
 extern LoadingData preloading;
 }
 
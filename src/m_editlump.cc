@@ -478,6 +478,8 @@ void Instance::CMD_EditLump()
 		else
 		{
 			editor.SaveLump(wad, lump_name);
+
+			level.journal.restamp(wad->PathName(), loaded.levelName);
 		}
 	}
 	
@@ -61,41 +61,36 @@ static const char overwrite_message[] =
 static Document makeFreshDocument(Instance &inst, const ConfigData &config, MapFormat levelFormat)
 {
 	Document doc(inst);
-	auto sec = std::make_unique<Sector>();
+	Sector *sec = doc.sectors.append();
 
 	sec->SetDefaults(config);
-	doc.sectors.push_back(std::move(sec));
 
 	for (int i = 0 ; i < 4 ; i++)
 	{
-		auto v = std::make_shared<Vertex>();
+		Vertex *v = doc.vertices.append();
 
 		v->SetRawX(levelFormat, (i >= 2) ? 256 : -256);
 		v->SetRawY(levelFormat, (i==1 || i==2) ? 256 :-256);
-		doc.vertices.push_back(std::move(v));
 
-		auto sd = std::make_shared<SideDef>();
+		SideDef *sd = doc.sidedefs.append();
 		sd->SetDefaults(config, false);
-		doc.sidedefs.push_back(std::move(sd));
 
-		auto ld = std::make_shared<LineDef>();
+		LineDef *ld = doc.linedefs.append();
 		ld->start = i;
 		ld->end   = (i+1) % 4;
 		ld->flags = MLF_Blocking;
 		ld->right = i;
-		doc.linedefs.push_back(std::move(ld));
 	}
 
 	for (int pl = 1 ; pl <= 4 ; pl++)
 	{
-		auto th = std::make_unique<Thing>();
+		Thing *th = doc.things.append();
 
 		th->type  = pl;
 		th->angle = 90;
 
 		th->SetRawX(levelFormat, (pl == 1) ? 0 : (pl - 3) * 48);
 		th->SetRawY(levelFormat, (pl == 1) ? 48 : (pl == 3) ? -48 : 0);
-		doc.things.push_back(std::move(th));
 	}
 
 	doc.CalculateLevelBounds();
@@ -456,12 +451,10 @@ void Document::LoadVertices(int loading_level, const Wad_file *load_wad)
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading vertices.\n");
 
-		auto vert = std::make_unique<Vertex>();
+		Vertex *vert = vertices.append();
 
 		vert->raw_x = FFixedPoint(LE_S16(raw.x));
 		vert->raw_y = FFixedPoint(LE_S16(raw.y));
-
-		vertices.push_back(std::move(vert));
 	}
 }
 
@@ -488,7 +481,7 @@ void Document::LoadSectors(int loading_level, const Wad_file *load_wad)
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading sectors.\n");
 
-		auto sec = std::make_shared<Sector>();
+		Sector *sec = sectors.append();
 
 		sec->floorh = LE_S16(raw.floorh);
 		sec->ceilh  = LE_S16(raw.ceilh);
@@ -502,8 +495,6 @@ void Document::LoadSectors(int loading_level, const Wad_file *load_wad)
 		sec->light = LE_U16(raw.light);
 		sec->type  = LE_U16(raw.type);
 		sec->tag   = LE_S16(raw.tag);
-
-		sectors.push_back(std::move(sec));
 	}
 }
 
@@ -512,11 +503,9 @@ void Document::CreateFallbackSector(const ConfigData &config)
 {
 	gLog.printf("Creating a fallback sector.\n");
 
-	auto sec = std::make_shared<Sector>();
+	Sector *sec = sectors.append();
 
 	sec->SetDefaults(config);
-
-	sectors.push_back(std::move(sec));
 }
 
 void Document::CreateFallbackSideDef(const ConfigData &config)
@@ -527,19 +516,17 @@ void Document::CreateFallbackSideDef(const ConfigData &config)
 
 	gLog.printf("Creating a fallback sidedef.\n");
 
-	auto sd = std::make_shared<SideDef>();
+	SideDef *sd = sidedefs.append();
 
 	sd->SetDefaults(config, false);
-
-	sidedefs.push_back(std::move(sd));
 }
 
 void Document::CreateFallbackVertices()
 {
 	gLog.printf("Creating two fallback vertices.\n");
 
-	auto v1 = std::make_unique<Vertex>();
-	auto v2 = std::make_unique<Vertex>();
+	Vertex *v1 = vertices.append();
+	Vertex *v2 = vertices.append();
 
 	v1->raw_x = FFixedPoint(-777);
 	v1->raw_y = FFixedPoint(-777);
@@ -547,8 +534,6 @@ void Document::CreateFallbackVertices()
 	v2->raw_x = FFixedPoint(555);
 	v2->raw_y = FFixedPoint(555);
 
-	vertices.push_back(std::move(v1));
-	vertices.push_back(std::move(v2));
 }
 
 void Document::ValidateSidedefRefs(LineDef & ld, int num, const ConfigData &config, BadCount &bad)
@@ -659,7 +644,7 @@ void Document::LoadThings(int loading_level, const Wad_file *load_wad)
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading things.\n");
 
-		auto th = std::make_unique<Thing>();
+		Thing *th = things.append();
 
 		th->raw_x = FFixedPoint(LE_S16(raw.x));
 		th->raw_y = FFixedPoint(LE_S16(raw.y));
@@ -667,8 +652,6 @@ void Document::LoadThings(int loading_level, const Wad_file *load_wad)
 		th->angle   = LE_U16(raw.angle);
 		th->type    = LE_U16(raw.type);
 		th->options = LE_U16(raw.options);
-
-		things.push_back(std::move(th));
 	}
 }
 
@@ -695,7 +678,7 @@ void Document::LoadThings_Hexen(int loading_level, const Wad_file *load_wad)
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading things.\n");
 
-		auto th = std::make_unique<Thing>();
+		Thing *th = things.append();
 
 		th->tid = LE_S16(raw.tid);
 		th->raw_x = FFixedPoint(LE_S16(raw.x));
@@ -712,8 +695,6 @@ void Document::LoadThings_Hexen(int loading_level, const Wad_file *load_wad)
 		th->arg3 = raw.args[2];
 		th->arg4 = raw.args[3];
 		th->arg5 = raw.args[4];
-
-		things.push_back(std::move(th));
 	}
 }
 
@@ -739,7 +720,7 @@ void Document::LoadSideDefs(int loading_level, const Wad_file *load_wad, const C
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading sidedefs.\n");
 
-		auto sd = std::make_shared<SideDef>();
+		SideDef *sd = sidedefs.append();
 
 		sd->x_offset = LE_S16(raw.x_offset);
 		sd->y_offset = LE_S16(raw.y_offset);
@@ -755,8 +736,6 @@ void Document::LoadSideDefs(int loading_level, const Wad_file *load_wad, const C
 		sd->sector = LE_U16(raw.sector);
 
 		ValidateSectorRef(*sd, i, config, bad);
-
-		sidedefs.push_back(std::move(sd));
 	}
 }
 
@@ -785,7 +764,7 @@ void Document::LoadLineDefs(int loading_level, const Wad_file *load_wad, const C
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading linedefs.\n");
 
-		auto ld = std::make_shared<LineDef>();
+		LineDef *ld = linedefs.append();
 
 		ld->start = LE_U16(raw.start);
 		ld->end   = LE_U16(raw.end);
@@ -802,8 +781,6 @@ void Document::LoadLineDefs(int loading_level, const Wad_file *load_wad, const C
 
 		ValidateVertexRefs(*ld, i, bad);
 		ValidateSidedefRefs(*ld, i, config, bad);
-
-		linedefs.push_back(std::move(ld));
 	}
 }
 
@@ -833,7 +810,7 @@ void Document::LoadLineDefs_Hexen(int loading_level, const Wad_file *load_wad, c
 		if (! stream.read(&raw, sizeof(raw)))
 			ThrowException("Error reading linedefs.\n");
 
-		auto ld = std::make_shared<LineDef>();
+		LineDef *ld = linedefs.append();
 
 		ld->start = LE_U16(raw.start);
 		ld->end   = LE_U16(raw.end);
@@ -854,8 +831,6 @@ void Document::LoadLineDefs_Hexen(int loading_level, const Wad_file *load_wad, c
 
 		ValidateVertexRefs(*ld, i, bad);
 		ValidateSidedefRefs(*ld, i, config, bad);
-
-		linedefs.push_back(std::move(ld));
 	}
 }
 
@@ -955,6 +930,8 @@ void Instance::LoadLevel(const Wad_file *wad, const SString &level) noexcept(fal
 	Status_Set("Loaded %s", loaded.levelName.c_str());
 
 	RedrawMap();
+
+	recoverJournal(wad);
 }
 
 NewDocument Instance::openDocument(const LoadingData &inLoading, const Wad_file &wad, int level)
@@ -1058,6 +1035,50 @@ void Instance::refreshViewAfterLoad(const BadCount& bad, const Wad_file *wad, co
 		// TODO: only call this when the IWAD has changed
 		main_win->propsLoadValues();
 	}
+
+	recoverJournal(wad);
+}
+
+//
+// After loading a map from the PWAD, offers to get back the edits
+// left in its journal when the editor last went down without saving
+// them. Then goes on keeping the journal.
+//
+void Instance::recoverJournal(const Wad_file *wad)
+{
+	if (! config::edit_journal || ! wad || wad != this->wad.master.editWad().get() ||
+		wad->IsReadOnly())
+	{
+		return;
+	}
+
+	int edits = EditJournal::countEdits(wad->PathName(), loaded.levelName);
+
+	if (edits > 0 && main_win &&
+		DLG_Confirm({ "&Discard", "&Recover" },
+				"The editor was closed with %d unsaved edits of %s.\n"
+				"Do you want to recover them?", edits, loaded.levelName.c_str()) == 1)
+	{
+		Editor_ClearAction();
+		edit.Selected->clear_all();
+		edit.highlight.clear();
+
+		if (level.journal.replay(wad->PathName(), loaded.levelName) >= 0)
+		{
+			level.MadeChanges = true;
+			level.CalculateLevelBounds();
+			Subdiv_InvalidateAll();
+			main_win->UpdateTotals(level);
+			main_win->InvalidatePanelObj();
+			Status_Set("Recovered %d edits of %s", edits, loaded.levelName.c_str());
+			RedrawMap();
+			return;
+		}
+
+		DLG_Notify("Could not recover the edits of %s.", loaded.levelName.c_str());
+	}
+
+	level.journal.start(wad->PathName(), loaded.levelName);
 }
 
 
@@ -1688,6 +1709,9 @@ void Instance::ConfirmLevelSaveSuccess(const LoadingData &loading, const Wad_fil
 
 	Status_Set("Saved %s", loading.levelName.c_str());
 
+	// the edits are in the wad now
+	this->level.journal.start(wad.PathName(), loading.levelName);
+
 	if (main_win)
 	{
 		main_win->SetTitle(wad.PathName().u8string(), loading.levelName, false);
@@ -2030,6 +2054,8 @@ void Instance::CMD_RenameMap()
 
 			wad.master.editWad()->RenameLump(level_lump, new_name.c_str());
 			wad.master.editWad()->writeToDisk();
+
+			level.journal.restamp(wad.master.editWad()->PathName(), new_name);
 		}
 
 		loaded.levelName = new_name.asUpper();
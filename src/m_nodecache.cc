@@ -0,0 +1,344 @@
+//------------------------------------------------------------------------
+//  NODE BUILDING CACHE
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "m_nodecache.h"
+
+#include "Document.h"
+#include "Errors.h"
+#include "lib_file.h"
+#include "m_game.h"
+#include "sys_debug.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// bump this whenever the node builder output changes
+static const uint32_t NODE_CACHE_VERSION = 5;
+
+static const char NODE_CACHE_MAGIC[4] = { 'E', 'N', 'O', 'D' };
+
+
+//
+// Little-endian serialization of the cache files
+//
+namespace
+{
+
+class Writer
+{
+public:
+	explicit Writer(std::vector<byte> &out) : out(out)
+	{
+	}
+
+	void u32(uint32_t value)
+	{
+		for (int i = 0 ; i < 4 ; i++)
+			out.push_back(static_cast<byte>(value >> (i * 8)));
+	}
+
+	void s32(int value)
+	{
+		u32(static_cast<uint32_t>(value));
+	}
+
+	void bytes(const void *data, size_t size)
+	{
+		const byte *p = static_cast<const byte *>(data);
+		out.insert(out.end(), p, p + size);
+	}
+
+	void string(const SString &str)
+	{
+		u32(static_cast<uint32_t>(str.size()));
+		bytes(str.c_str(), str.size());
+	}
+
+private:
+	std::vector<byte> &out;
+};
+
+class Reader
+{
+public:
+	Reader(const std::vector<byte> &in) : in(in)
+	{
+	}
+
+	bool u32(uint32_t &value)
+	{
+		if (pos + 4 > in.size())
+			return false;
+
+		value = 0;
+		for (int i = 0 ; i < 4 ; i++)
+			value |= static_cast<uint32_t>(in[pos++]) << (i * 8);
+		return true;
+	}
+
+	bool bytes(std::vector<byte> &data, uint32_t size)
+	{
+		if (size > in.size() - pos)
+			return false;
+
+		data.assign(in.begin() + pos, in.begin() + pos + size);
+		pos += size;
+		return true;
+	}
+
+	bool atEnd() const
+	{
+		return pos == in.size();
+	}
+
+private:
+	const std::vector<byte> &in;
+	size_t pos = 0;
+};
+
+}
+
+
+std::vector<byte> NodeCache::makeKey(const Document &doc, const ConfigData &config,
+		MapFormat format, const SString &level_name, const nodebuildinfo_t &info)
+{
+	std::vector<byte> key;
+	Writer w(key);
+
+	w.u32(NODE_CACHE_VERSION);
+	w.s32(static_cast<int>(format));
+	w.string(level_name.asUpper());
+
+	// options which make a difference to the output
+	w.s32(info.factor);
+	w.s32(info.fast);
+	w.s32(info.pick_budget);
+	w.s32(info.pick_time);
+	w.s32(info.gl_nodes);
+	w.s32(info.do_blockmap);
+	w.s32(info.blockmap_search);
+	w.s32(info.do_reject);
+	w.s32(info.force_v5);
+	w.s32(info.force_xnod);
+	w.s32(info.force_compress);
+	w.s32(info.full_reject);
+	w.s32(info.reject_time);
+
+	w.s32((int)info.portfolio.size());
+	for (int factor : info.portfolio)
+		w.s32(factor);
+	w.s32(info.portfolio_height);
+
+	// the size of the REJECT lump
+	w.s32(doc.numSectors());
+
+	w.s32(doc.numVertices());
+	for (const auto &vertex : doc.vertices)
+	{
+		w.s32(vertex->raw_x.raw());
+		w.s32(vertex->raw_y.raw());
+	}
+
+	w.s32(doc.numLinedefs());
+	for (const auto &line : doc.linedefs)
+	{
+		w.s32(line->start);
+		w.s32(line->end);
+		w.s32(line->right);
+		w.s32(line->left);
+		w.s32(line->flags);
+		w.s32(line->type);
+		w.s32(line->tag);
+		w.s32(line->arg2);
+		w.s32(line->arg3);
+		w.s32(line->arg4);
+		w.s32(line->arg5);
+
+		// whether it starts a polyobject depends on the game definition
+		const linetype_t *type = get(config.line_types, line->type);
+		w.s32(type && type->isPolyObjectSpecial());
+	}
+
+	w.s32(doc.numSidedefs());
+	for (const auto &side : doc.sidedefs)
+		w.s32(side->sector);
+
+	// polyobject spawn spots are the only things the node builder uses
+	for (const auto &thing : doc.things)
+	{
+		const thingtype_t *type = get(config.thing_types, thing->type);
+
+		if (type && (type->flags & THINGDEF_POLYSPOT))
+		{
+			w.s32(thing->raw_x.raw());
+			w.s32(thing->raw_y.raw());
+		}
+	}
+
+	return key;
+}
+
+
+fs::path NodeCache::entryPath(const std::vector<byte> &key) const
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (byte b : key)
+	{
+		hash ^= b;
+		hash *= 0x100000001b3ULL;
+	}
+
+	return mDir / SString::printf("%016llx.nod", static_cast<unsigned long long>(hash)).get();
+}
+
+
+bool NodeCache::fetch(const std::vector<byte> &key, std::vector<node_lump_t> &lumps) const
+{
+	fs::path path = entryPath(key);
+
+	std::vector<byte> data;
+
+	if (! FileLoad(path, data))
+		return false;
+
+	Reader r(data);
+
+	std::vector<byte> magic;
+	std::vector<byte> stored_key;
+	uint32_t key_size;
+
+	if (! r.bytes(magic, 4) || memcmp(magic.data(), NODE_CACHE_MAGIC, 4) != 0 ||
+		! r.u32(key_size) || ! r.bytes(stored_key, key_size))
+	{
+		gLog.printf("Node cache: bad file %s\n", path.u8string().c_str());
+		return false;
+	}
+
+	// a different level with the same hash?
+	if (stored_key != key)
+		return false;
+
+	uint32_t count;
+	if (! r.u32(count))
+		return false;
+
+	lumps.clear();
+
+	for (uint32_t i = 0 ; i < count ; i++)
+	{
+		std::vector<byte> name;
+		uint32_t name_size, size;
+		node_lump_t lump;
+
+		if (! r.u32(name_size) || ! r.bytes(name, name_size) ||
+			! r.u32(size) || ! r.bytes(lump.data, size))
+		{
+			gLog.printf("Node cache: bad file %s\n", path.u8string().c_str());
+			return false;
+		}
+
+		lump.name = SString(reinterpret_cast<const char *>(name.data()), (int)name.size());
+		lumps.push_back(std::move(lump));
+	}
+
+	if (! r.atEnd())
+		return false;
+
+	// keep it as recently used
+	std::error_code err;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), err);
+
+	return true;
+}
+
+
+void NodeCache::store(const std::vector<byte> &key, const std::vector<node_lump_t> &lumps) const
+{
+	std::vector<byte> data;
+	Writer w(data);
+
+	w.bytes(NODE_CACHE_MAGIC, 4);
+	w.u32(static_cast<uint32_t>(key.size()));
+	w.bytes(key.data(), key.size());
+
+	w.u32(static_cast<uint32_t>(lumps.size()));
+	for (const node_lump_t &lump : lumps)
+	{
+		w.string(lump.name);
+		w.u32(static_cast<uint32_t>(lump.data.size()));
+		w.bytes(lump.data.data(), lump.data.size());
+	}
+
+	fs::path path = entryPath(key);
+
+	// written under another name first, so nobody sees half an entry
+	fs::path temp_path = path;
+	temp_path += ".tmp";
+
+	{
+		std::ofstream os(temp_path, std::ios::binary | std::ios::trunc);
+		if (! os.is_open() ||
+			! os.write(reinterpret_cast<const char *>(data.data()), data.size()))
+		{
+			gLog.printf("Node cache: cannot write %s: %s\n", temp_path.u8string().c_str(),
+					GetErrorMessage(errno).c_str());
+			return;
+		}
+	}
+
+	std::error_code err;
+	fs::rename(temp_path, path, err);
+	if (err)
+	{
+		gLog.printf("Node cache: cannot write %s: %s\n", path.u8string().c_str(),
+				err.message().c_str());
+		FileDelete(temp_path);
+		return;
+	}
+
+	prune();
+}
+
+
+void NodeCache::prune() const
+{
+	std::vector<std::pair<fs::file_time_type, fs::path>> entries;
+
+	std::error_code err;
+	for (const fs::directory_entry &entry : fs::directory_iterator(mDir, err))
+	{
+		if (entry.path().extension() == ".nod")
+			entries.emplace_back(entry.last_write_time(err), entry.path());
+	}
+
+	if ((int)entries.size() <= mMaxFiles)
+		return;
+
+	std::sort(entries.begin(), entries.end());
+
+	for (size_t i = 0 ; i + mMaxFiles < entries.size() ; i++)
+		FileDelete(entries[i].second);
+}
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------
+//  NODE BUILDING CACHE
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef __EUREKA_M_NODECACHE_H__
+#define __EUREKA_M_NODECACHE_H__
+
+#include "bsp.h"
+
+#include "filesystem.hpp"
+namespace fs = ghc::filesystem;
+
+struct ConfigData;
+struct Document;
+
+//
+// Keeps the node lumps of recently built levels on disk, so saving a
+// level whose geometry did not change (e.g. only things or textures were
+// edited) can copy them instead of building the nodes again.
+//
+// An entry is found by a hash of everything the node builder looks at,
+// and that data is kept in the entry too and compared in full, so a
+// hash collision can never give the wrong nodes.
+//
+class NodeCache
+{
+public:
+	// at most 'max_files' entries are kept, the least recently used go
+	NodeCache(const fs::path &dir, int max_files) : mDir(dir), mMaxFiles(max_files)
+	{
+	}
+
+	// all the node builder inputs of the level, with the options
+	static std::vector<byte> makeKey(const Document &doc, const ConfigData &config,
+			MapFormat format, const SString &level_name, const nodebuildinfo_t &info);
+
+	bool fetch(const std::vector<byte> &key, std::vector<node_lump_t> &lumps) const;
+	void store(const std::vector<byte> &key, const std::vector<node_lump_t> &lumps) const;
+
+	fs::path entryPath(const std::vector<byte> &key) const;
+
+private:
+	void prune() const;
+
+	const fs::path mDir;
+	const int mMaxFiles;
+};
+
+#endif  /* __EUREKA_M_NODECACHE_H__ */
+
+//--- editor settings ---
+// vi:ts=4:sw=4:noexpandtab
@@ -23,26 +23,55 @@
 #include "main.h"
 #include "m_config.h"
 #include "m_loadsave.h"
+#include "m_nodecache.h"
 #include "e_main.h"
 #include "w_wad.h"
 
 #include "ui_window.h"
 
 #include "bsp.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <thread>
+#include <tuple>
 
 
 // config items
 bool config::bsp_on_save	= true;
+bool config::bsp_background	= true;
 bool config::bsp_fast		= false;
 bool config::bsp_warnings	= false;
 
 int  config::bsp_split_factor	= DEFAULT_FACTOR;
 
+SString config::bsp_portfolio;
+bool config::bsp_portfolio_height	= false;
+
+int  config::bsp_pick_budget	= 0;
+int  config::bsp_pick_time		= 0;
+
 bool config::bsp_gl_nodes		= true;
 bool config::bsp_force_v5		= false;
 bool config::bsp_force_zdoom	= false;
 bool config::bsp_compressed		= false;
 
+int  config::bsp_threads		= 1;
+int  config::bsp_task_depth		= 16;
+int  config::bsp_task_segs		= 64;
+
+bool config::bsp_cache			= true;
+int  config::bsp_cache_size		= 100;
+
+bool config::bsp_incremental	= false;
+
+bool config::bsp_blockmap_search	= false;
+
+bool config::bsp_full_reject	= false;
+int  config::bsp_reject_time	= 30;
+
 
 #define NODE_PROGRESS_COLOR  fl_color_cube(2,6,2)
 
@@ -241,6 +270,39 @@ void Instance::GB_PrintMsg(EUR_FORMAT_STRING(const char *str), ...)
 }
 
 
+//
+// The split factors of a portfolio, like "3,11,23".  Anything which is
+// not a number separates them, and bad factors are left out.
+//
+static std::vector<int> ParsePortfolio(const SString &text)
+{
+	std::vector<int> factors;
+
+	const char *pos = text.c_str();
+
+	while (*pos)
+	{
+		if (! isdigit((unsigned char)*pos))
+		{
+			pos++;
+			continue;
+		}
+
+		char *end;
+		long factor = strtol(pos, &end, 10);
+		pos = end;
+
+		if (factor >= 1 && factor <= 31 &&
+			std::find(factors.begin(), factors.end(), (int)factor) == factors.end())
+		{
+			factors.push_back((int)factor);
+		}
+	}
+
+	return factors;
+}
+
+
 static void PrepareInfo(nodebuildinfo_t *info)
 {
 	info->factor	= clamp(1, config::bsp_split_factor, 31);
@@ -249,10 +311,25 @@ static void PrepareInfo(nodebuildinfo_t *info)
 	info->fast		= config::bsp_fast;
 	info->warnings	= config::bsp_warnings;
 
+	info->pick_budget	= std::max(0, config::bsp_pick_budget);
+	info->pick_time		= std::max(0, config::bsp_pick_time);
+
 	info->force_v5			= config::bsp_force_v5;
 	info->force_xnod		= config::bsp_force_zdoom;
 	info->force_compress	= config::bsp_compressed;
 
+	info->blockmap_search	= config::bsp_blockmap_search;
+
+	info->full_reject	= config::bsp_full_reject;
+	info->reject_time	= std::max(0, config::bsp_reject_time);
+
+	info->jobs			= std::max(0, config::bsp_threads);
+	info->task_depth	= config::bsp_task_depth;
+	info->task_min_segs	= std::max(1, config::bsp_task_segs);
+
+	info->portfolio			= ParsePortfolio(config::bsp_portfolio);
+	info->portfolio_height	= config::bsp_portfolio_height;
+
 	info->total_failed_maps		= 0;
 	info->total_warnings		= 0;
 
@@ -261,60 +338,465 @@ static void PrepareInfo(nodebuildinfo_t *info)
 }
 
 
-build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
+//
+// A copy of a level and the game config it was saved with, which stays
+// the same while the level is edited further.
+//
+struct level_snapshot_t
 {
-	gLog.printf("\n");
+	Document doc;
+	ConfigData conf;
+	MapFormat format;
 
-	// sanity check
+	level_snapshot_t(Instance &inst, const Document &level, MapFormat format) :
+		doc(inst), conf(inst.conf), format(format)
+	{
+		for (const Thing *thing : level.things)
+			doc.things.push_back(*thing);
+		for (const Vertex *vertex : level.vertices)
+			doc.vertices.push_back(*vertex);
+		for (const Sector *sector : level.sectors)
+			doc.sectors.push_back(*sector);
+		for (const SideDef *side : level.sidedefs)
+			doc.sidedefs.push_back(*side);
+		for (const LineDef *line : level.linedefs)
+			doc.linedefs.push_back(*line);
+
+		doc.headerData   = level.headerData;
+		doc.behaviorData = level.behaviorData;
+		doc.scriptsData  = level.scriptsData;
+
+		doc.Map_bound1 = level.Map_bound1;
+		doc.Map_bound2 = level.Map_bound2;
+	}
+};
 
-	SYS_ASSERT(1 <= info->factor && info->factor <= 32);
 
-	int num_levels = wad.master.editWad()->LevelCount();
-	SYS_ASSERT(num_levels > 0);
+//
+// Everything about building one level on a worker thread
+//
+struct level_build_t
+{
+	std::shared_ptr<Wad_file> wad;
 
-	GB_PrintMsg("\n");
+	// when set, the level is built from this instead of the lumps.
+	// The builds of a portfolio share it, the node builder only reads
+	// the document.
+	const level_snapshot_t *snapshot = NULL;
 
-	nodeialog->SetProg(0);
+	nodebuildinfo_t info;
 
-	build_result_e ret;
+	// messages are only shown when the level is merged back
+	std::vector<SString> messages;
 
-	// loop over each level in the wad
-	for (int n = 0 ; n < num_levels ; n++)
+	build_result_e ret = BUILD_OK;
+	bool failed = false;
+	SString failure;
+
+	std::exception_ptr error;
+	std::atomic<bool> done = false;
+};
+
+
+static build_result_e BuildPortfolio(Instance &inst, nodebuildinfo_t *info, Wad_file &wad,
+		int lev_idx, std::vector<SString> &messages, const level_snapshot_t *snapshot = NULL);
+
+
+//
+// Builds level 'n' of the wad, which the build has a copy of
+//
+static void BuildLevelCopy(Instance &inst, level_build_t *build, int n)
+{
+	try
 	{
-		// load level
-		try
+		auto report = [build](const SString &message)
+		{
+			build->messages.push_back(message);
+		};
+
+		if (! build->info.portfolio.empty())
+		{
+			build->ret = BuildPortfolio(inst, &build->info, *build->wad, 0, build->messages, build->snapshot);
+		}
+		else if (build->snapshot)
 		{
-			NewDocument newdoc = openDocument(loaded, *wad.master.editWad(), n);
-			
-			ret = AJBSP_BuildLevel(info, n, *this, newdoc.doc, newdoc.loading, *wad.master.editWad());
+			const level_snapshot_t &snap = *build->snapshot;
+
+			ajbsp::LevelData lev_data(snap.format, *build->wad, snap.doc, snap.conf, report);
+
+			build->ret = lev_data.BuildLevel(&build->info, 0);
 		}
-		catch(const std::runtime_error &e)
+		else
+		{
+			NewDocument newdoc = inst.openDocument(inst.loaded, *build->wad, 0);
+
+			ajbsp::LevelData lev_data(newdoc.loading.levelFormat, *build->wad, newdoc.doc, inst.conf, report);
+
+			build->ret = lev_data.BuildLevel(&build->info, 0);
+		}
+	}
+	catch (const std::runtime_error &e)
+	{
+		build->messages.push_back(SString::printf("Failed building nodes for level %d: %s\n", n, e.what()));
+		build->failed = true;
+		build->failure = e.what();
+	}
+	catch (...)
+	{
+		build->error = std::current_exception();
+	}
+
+	build->done = true;
+}
+
+
+//
+// Build level 'lev_idx' of the wad once for each factor of the portfolio,
+// with both normal and fast partition picking, each build on its own
+// copy of the level and all at the same time.  The best tree is put into
+// the wad, and its stats are left in 'info'.
+//
+static build_result_e BuildPortfolio(Instance &inst, nodebuildinfo_t *info, Wad_file &wad,
+		int lev_idx, std::vector<SString> &messages, const level_snapshot_t *snapshot)
+{
+	std::unique_ptr<ThreadPool> own_pool;
+
+	ThreadPool *pool = info->pool;
+
+	if (! pool)
+	{
+		if (info->jobs > 1)
+			own_pool = std::make_unique<ThreadPool>(info->jobs - 1);
+
+		pool = own_pool ? own_pool.get() : &ThreadPool::shared();
+	}
+
+	std::vector<std::unique_ptr<level_build_t>> builds;
+
+	for (int factor : info->portfolio)
+	{
+		for (bool fast : { false, true })
 		{
-			GB_PrintMsg("Failed building nodes for level %d: %s\n", n, e.what());
+			auto build = std::make_unique<level_build_t>();
+
+			build->wad = wad.CopyLevel(lev_idx);
+			build->snapshot = snapshot;
+			build->info.CopyOptions(*info);
+			build->info.pool = pool;
+			build->info.factor = factor;
+			build->info.fast = fast;
+			build->info.portfolio.clear();
+			build->info.cancelled = info->cancelled.load();
+
+			builds.push_back(std::move(build));
+		}
+	}
+
+	// declared last, so its destructor waits for the tasks first
+	TaskGroup group(*pool);
+
+	for (auto &build : builds)
+	{
+		level_build_t *copy = build.get();
+
+		if (info->jobs == 1)
+		{
+			copy->info.cancelled = info->cancelled.load();
+
+			BuildLevelCopy(inst, copy, lev_idx);
 			continue;
 		}
 
-		// don't fail on maps with overflows
-		// [ Note that 'total_failed_maps' keeps a tally of these ]
-		if (ret == BUILD_LumpOverflow)
-			ret = BUILD_OK;
+		group.run([&inst, copy, lev_idx]()
+		{
+			BuildLevelCopy(inst, copy, lev_idx);
+		});
+	}
 
-		if (ret != BUILD_OK)
-			break;
+	// pass on a cancel while waiting
+	for (auto &build : builds)
+	{
+		while (! build->done)
+		{
+			if (info->cancelled)
+				for (auto &other : builds)
+					other->info.cancelled = true;
+
+			int progress = 0;
+			for (auto &other : builds)
+				progress += other->info.progress;
+			info->progress = progress / (int)builds.size();
+
+			// lend a hand, or wait a bit when there is nothing to do
+			if (! pool->runPending())
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
 
-		nodeialog->SetProg(100 * (n + 1) / num_levels);
+	group.wait();
+
+	for (const auto &build : builds)
+	{
+		if (build->error)
+			std::rethrow_exception(build->error);
+
+		if (build->ret == BUILD_Cancelled)
+			return BUILD_Cancelled;
+	}
+
+	// the first fitting the limits of the normal formats, then the one
+	// with the fewest segs or lowest height, then the earliest
+	auto rank = [info](const level_build_t &build)
+	{
+		const build_stats_t &stats = build.info.stats;
+
+		bool over = stats.forced_v5 || stats.forced_xnod || stats.overflows != 0;
+
+		if (info->portfolio_height)
+			return std::make_tuple(over, stats.height, stats.segs);
+		else
+			return std::make_tuple(over, stats.segs, stats.height);
+	};
+
+	level_build_t *best = NULL;
+
+	for (const auto &build : builds)
+	{
+		const build_stats_t &stats = build->info.stats;
+
+		gLog.debugPrintf("BSP: portfolio factor %d%s: %s, %d segs, height %d%s\n",
+				build->info.factor, build->info.fast ? " fast" : "",
+				build->failed ? "failed" : build_ErrorString(build->ret), stats.segs, stats.height,
+				(stats.forced_v5 || stats.forced_xnod || stats.overflows) ? " (over the limits)" : "");
+
+		if (build->failed || (build->ret != BUILD_OK && build->ret != BUILD_LumpOverflow))
+			continue;
+
+		if (! best || rank(*build) < rank(*best))
+			best = build.get();
+	}
+
+	if (! best)
+	{
+		messages.insert(messages.end(), builds[0]->messages.begin(), builds[0]->messages.end());
+
+		if (builds[0]->failed)
+			throw std::runtime_error(builds[0]->failure.c_str());
+
+		return builds[0]->ret;
+	}
+
+	wad.ReplaceLevel(lev_idx, *best->wad);
+
+	messages.insert(messages.end(), best->messages.begin(), best->messages.end());
+
+	messages.push_back(SString::printf("Kept the tree of factor %d%s out of %d builds: %d segs, height %d\n",
+			best->info.factor, best->info.fast ? " (fast)" : "", (int)builds.size(),
+			best->info.stats.segs, best->info.stats.height));
+
+	info->stats = best->info.stats;
+
+	info->total_failed_maps += best->info.total_failed_maps;
+	info->total_warnings    += best->info.total_warnings;
+
+	return best->ret;
+}
+
+
+//
+// Build the nodes of all levels at the same time.  Each level is built
+// in a copy of its own lumps, and these are put back into the wad in
+// level order, so the wad ends up just like from the serial loop.
+//
+build_result_e Instance::BuildAllNodesParallel(nodebuildinfo_t *info)
+{
+	Wad_file &edit_wad = *wad.master.editWad();
+
+	int num_levels = edit_wad.LevelCount();
+
+	std::unique_ptr<ThreadPool> own_pool;
+
+	if (info->jobs > 1)
+		own_pool = std::make_unique<ThreadPool>(info->jobs - 1);
+
+	ThreadPool &pool = own_pool ? *own_pool : ThreadPool::shared();
+
+	std::vector<std::unique_ptr<level_build_t>> builds;
+
+	for (int n = 0 ; n < num_levels ; n++)
+	{
+		auto build = std::make_unique<level_build_t>();
+
+		build->wad = edit_wad.CopyLevel(n);
+		build->info.CopyOptions(*info);
+		build->info.pool = &pool;
+
+		builds.push_back(std::move(build));
+	}
+
+	auto cancel_all = [&builds]()
+	{
+		for (auto &build : builds)
+			build->info.cancelled = true;
+	};
+
+	// declared last, so its destructor waits for the tasks first
+	TaskGroup group(pool);
+
+	for (int n = 0 ; n < num_levels ; n++)
+	{
+		level_build_t *build = builds[n].get();
+
+		group.run([this, build, n]()
+		{
+			BuildLevelCopy(*this, build, n);
+		});
+	}
+
+	build_result_e ret = BUILD_OK;
+
+	int n = 0;
+
+	while (n < num_levels)
+	{
+		level_build_t *build = builds[n].get();
+
+		if (! build->done)
+		{
+			// lend a hand, or wait a bit when there is nothing to do
+			if (! pool.runPending())
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+		else
+		{
+			for (const SString &message : build->messages)
+				GB_PrintMsg("%s", message.c_str());
+
+			info->total_failed_maps += build->info.total_failed_maps;
+			info->total_warnings    += build->info.total_warnings;
+
+			if (build->error)
+			{
+				cancel_all();
+				std::rethrow_exception(build->error);
+			}
+
+			// whatever happened to the copy happens to the real thing
+			edit_wad.ReplaceLevel(n, *build->wad);
+
+			build->wad.reset();
+
+			if (! build->failed)
+			{
+				ret = build->ret;
+
+				// don't fail on maps with overflows
+				// [ Note that 'total_failed_maps' keeps a tally of these ]
+				if (ret == BUILD_LumpOverflow)
+					ret = BUILD_OK;
+
+				if (ret != BUILD_OK)
+				{
+					cancel_all();
+					break;
+				}
+			}
+
+			n++;
+
+			nodeialog->SetProg(100 * n / num_levels);
+		}
 
 		Fl::check();
 
 		if (nodeialog->WantCancel())
 		{
-			nb_info->cancelled = true;
+			info->cancelled = true;
+			cancel_all();
+		}
+	}
+
+	group.wait();
+
+	return ret;
+}
+
+
+build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
+{
+	gLog.printf("\n");
+
+	// sanity check
+
+	SYS_ASSERT(1 <= info->factor && info->factor <= 32);
+
+	int num_levels = wad.master.editWad()->LevelCount();
+	SYS_ASSERT(num_levels > 0);
+
+	GB_PrintMsg("\n");
+
+	nodeialog->SetProg(0);
+
+	build_result_e ret = BUILD_OK;
+
+	if (info->jobs != 1)
+	{
+		ret = BuildAllNodesParallel(info);
+	}
+	else
+	{
+		// loop over each level in the wad
+		for (int n = 0 ; n < num_levels ; n++)
+		{
+			// load level
+			try
+			{
+				if (! info->portfolio.empty())
+				{
+					std::vector<SString> messages;
+
+					ret = BuildPortfolio(*this, info, *wad.master.editWad(), n, messages);
+
+					for (const SString &message : messages)
+						GB_PrintMsg("%s", message.c_str());
+				}
+				else
+				{
+					NewDocument newdoc = openDocument(loaded, *wad.master.editWad(), n);
+
+					ret = AJBSP_BuildLevel(info, n, *this, newdoc.doc, newdoc.loading, *wad.master.editWad());
+				}
+			}
+			catch(const std::runtime_error &e)
+			{
+				GB_PrintMsg("Failed building nodes for level %d: %s\n", n, e.what());
+				continue;
+			}
+
+			// don't fail on maps with overflows
+			// [ Note that 'total_failed_maps' keeps a tally of these ]
+			if (ret == BUILD_LumpOverflow)
+				ret = BUILD_OK;
+
+			if (ret != BUILD_OK)
+				break;
+
+			nodeialog->SetProg(100 * (n + 1) / num_levels);
+
+			Fl::check();
+
+			if (nodeialog->WantCancel())
+			{
+				info->cancelled = true;
+			}
 		}
 	}
 	
 	try
 	{
 		wad.master.editWad()->writeToDisk();
+
+		level.journal.restamp(wad.master.editWad()->PathName(), loaded.levelName);
 	}
 	catch(const std::runtime_error &e)
 	{
@@ -350,15 +832,161 @@ build_result_e Instance::BuildAllNodes(nodebuildinfo_t *info)
 }
 
 
+//
+// The nodes of a saved level being built on a thread of its own, so that
+// editing can go on meanwhile.  The thread works on a copy of the saved
+// lumps and a snapshot of the level, and when it is done the main loop
+// puts the new lumps into the wad and writes it, but only when the level
+// in there is still the one which was saved.
+//
+struct background_build_t
+{
+	level_snapshot_t snapshot;
+	level_build_t build;
+
+	// the wad it was saved into, and the level just as it was saved
+	const Wad_file *target;
+	std::shared_ptr<Wad_file> saved;
+
+	SString level_name;
+
+	// for the node cache, when it is used
+	std::vector<byte> cache_key;
+
+	std::chrono::steady_clock::time_point start_time;
+	int shown_progress = -1;
+
+	std::thread thread;
+
+	background_build_t(Instance &inst, const LoadingData &loading, Wad_file &wad, int lev_idx) :
+		snapshot(inst, inst.level, loading.levelFormat), target(&wad),
+		saved(wad.CopyLevel(lev_idx)), level_name(loading.levelName),
+		start_time(std::chrono::steady_clock::now())
+	{
+		build.wad = wad.CopyLevel(lev_idx);
+		build.snapshot = &snapshot;
+	}
+
+	~background_build_t()
+	{
+		build.info.cancelled = true;
+
+		if (thread.joinable())
+			thread.join();
+	}
+};
+
+
+//
+// Whether level 'lev_idx' of the wad still has the very same lumps as
+// the copy made of it
+//
+static bool SameLevel(const Wad_file &wad, int lev_idx, const Wad_file &copy)
+{
+	int start  = wad.LevelHeader(lev_idx);
+	int finish = wad.LevelLastLump(lev_idx);
+
+	if (finish - start + 1 != copy.NumLumps())
+		return false;
+
+	for (int k = 0 ; k < copy.NumLumps() ; k++)
+	{
+		const Lump_c *lump  = wad.GetLump(start + k);
+		const Lump_c *other = copy.GetLump(k);
+
+		if (lump->Name() != other->Name() || lump->getData() != other->getData())
+			return false;
+	}
+
+	return true;
+}
+
+
 void Instance::BuildNodesAfterSave(int lev_idx, const LoadingData& loading, Wad_file &wad)
 {
 	nodeialog.reset();
 
+	// a build of an earlier save is of no use now
+	nodeBuild.reset();
+
 	nodebuildinfo_t nb_info;
 
 	PrepareInfo(&nb_info);
 
-	build_result_e ret = AJBSP_BuildLevel(&nb_info, lev_idx, *this, level, loading, wad);
+	// nodes of a level with the same geometry are simply copied
+	std::optional<NodeCache> cache;
+	std::vector<byte> key;
+
+	if (config::bsp_cache && config::bsp_cache_size > 0 && !global::cache_dir.empty())
+	{
+		cache.emplace(global::cache_dir / "nodes", config::bsp_cache_size);
+
+		key = NodeCache::makeKey(level, conf, loading.levelFormat, loading.levelName, nb_info);
+
+		std::vector<node_lump_t> lumps;
+
+		if (cache->fetch(key, lumps))
+		{
+			gLog.printf("Using cached nodes for %s\n", loading.levelName.c_str());
+
+			AJBSP_PutNodeLumps(&nb_info, lev_idx, *this, level, loading, wad, lumps);
+			return;
+		}
+	}
+
+	if (config::bsp_background)
+	{
+		auto bg = std::make_shared<background_build_t>(*this, loading, wad, lev_idx);
+
+		bg->build.info.CopyOptions(nb_info);
+		bg->cache_key = std::move(key);
+
+		// only this build uses the history, until it is done
+		if (config::bsp_incremental)
+			bg->build.info.history = &nodeHistory;
+
+		gLog.printf("Building the nodes of %s in the background\n", loading.levelName.c_str());
+
+		background_build_t *raw = bg.get();
+
+		bg->thread = std::thread([this, raw, lev_idx]()
+		{
+			BuildLevelCopy(*this, &raw->build, lev_idx);
+		});
+
+		nodeBuild = std::move(bg);
+		return;
+	}
+
+	if (config::bsp_incremental)
+		nb_info.history = &nodeHistory;
+
+	build_result_e ret;
+
+	if (! nb_info.portfolio.empty())
+	{
+		std::vector<SString> messages;
+
+		try
+		{
+			ret = BuildPortfolio(*this, &nb_info, wad, lev_idx, messages);
+		}
+		catch (const std::runtime_error &e)
+		{
+			messages.push_back(SString::printf("Failed building nodes: %s\n", e.what()));
+			ret = BUILD_BadFile;
+		}
+
+		for (const SString &message : messages)
+			GB_PrintMsg("%s", message.c_str());
+	}
+	else
+	{
+		ret = AJBSP_BuildLevel(&nb_info, lev_idx, *this, level, loading, wad);
+	}
+
+	if (ret == BUILD_OK && cache)
+		cache->store(key, AJBSP_GetNodeLumps(wad, lev_idx, loading.levelFormat));
 
 	// TODO : maybe print # of serious/minor warnings
 
@@ -367,6 +995,399 @@ void Instance::BuildNodesAfterSave(int lev_idx, const LoadingData& loading, Wad_
 }
 
 
+//
+// Called regularly by the main loop: shows how the background build is
+// going, and when it is done puts the nodes into the wad.
+//
+void Instance::PollBackgroundNodes()
+{
+	if (! nodeBuild)
+		return;
+
+	background_build_t &bg = *nodeBuild;
+
+	if (! bg.build.done)
+	{
+		int progress = bg.build.info.progress;
+
+		if (progress != bg.shown_progress)
+		{
+			bg.shown_progress = progress;
+
+			Status_Set("Building nodes of %s: %d%%", bg.level_name.c_str(), progress);
+		}
+		return;
+	}
+
+	// it is removed first, whatever happens next
+	std::shared_ptr<background_build_t> finished = std::move(nodeBuild);
+
+	if (bg.thread.joinable())
+		bg.thread.join();
+
+	for (const SString &message : bg.build.messages)
+		GB_PrintMsg("%s", message.c_str());
+
+	if (bg.build.error || bg.build.failed ||
+		(bg.build.ret != BUILD_OK && bg.build.ret != BUILD_LumpOverflow))
+	{
+		gLog.printf("NODES FAILED TO FAILED.\n");
+		Status_Set("Error building nodes of %s", bg.level_name.c_str());
+		return;
+	}
+
+	Wad_file *edit_wad = wad.master.editWad().get();
+
+	int lev_idx = (edit_wad == bg.target) ? edit_wad->LevelFind(bg.level_name) : -1;
+
+	if (lev_idx < 0 || ! SameLevel(*edit_wad, lev_idx, *bg.saved))
+	{
+		gLog.printf("Dropped the nodes of %s: the level in the wad has changed\n", bg.level_name.c_str());
+		Status_Set("Dropped the nodes of %s", bg.level_name.c_str());
+		return;
+	}
+
+	edit_wad->ReplaceLevel(lev_idx, *bg.build.wad);
+
+	try
+	{
+		edit_wad->writeToDisk();
+	}
+	catch (const std::runtime_error &e)
+	{
+		gLog.printf("ERROR: could not save %s: %s\n", edit_wad->PathName().u8string().c_str(), e.what());
+		Status_Set("Could not save the nodes of %s", bg.level_name.c_str());
+		return;
+	}
+
+	level.journal.restamp(edit_wad->PathName(), bg.level_name);
+
+	if (bg.build.ret == BUILD_OK && ! bg.cache_key.empty() && !global::cache_dir.empty())
+	{
+		NodeCache cache(global::cache_dir / "nodes", config::bsp_cache_size);
+
+		cache.store(bg.cache_key, AJBSP_GetNodeLumps(*bg.build.wad, 0, bg.snapshot.format));
+	}
+
+	std::chrono::duration<double> secs = std::chrono::steady_clock::now() - bg.start_time;
+
+	gLog.printf("Built the nodes of %s in %1.2f seconds\n", bg.level_name.c_str(), secs.count());
+
+	Status_Set("Built nodes of %s", bg.level_name.c_str());
+}
+
+
+//
+// Waits for the background build to finish, and puts its nodes into the
+// wad.  For when the nodes are needed now, like for testing the map or
+// when quitting.
+//
+void Instance::FinishBackgroundNodes()
+{
+	if (! nodeBuild)
+		return;
+
+	if (! nodeBuild->build.done)
+	{
+		Status_Set("Waiting for the nodes of %s", nodeBuild->level_name.c_str());
+
+		if (main_win)
+			Fl::check();
+
+		nodeBuild->thread.join();
+	}
+
+	PollBackgroundNodes();
+}
+
+
+static SString OverflowNames(int flags)
+{
+	static const struct { int flag; const char *name; } lumps[] =
+	{
+		{ LIMIT_VERTEXES, "VERTEXES" },
+		{ LIMIT_SECTORS,  "SECTORS"  },
+		{ LIMIT_SIDEDEFS, "SIDEDEFS" },
+		{ LIMIT_LINEDEFS, "LINEDEFS" },
+		{ LIMIT_SEGS,     "SEGS"     },
+		{ LIMIT_SSECTORS, "SSECTORS" },
+		{ LIMIT_NODES,    "NODES"    },
+		{ LIMIT_GL_VERT,  "GL_VERT"  },
+		{ LIMIT_GL_SEGS,  "GL_SEGS"  },
+		{ LIMIT_GL_SSECT, "GL_SSECT" },
+		{ LIMIT_GL_NODES, "GL_NODES" },
+		{ LIMIT_BLOCKMAP, "BLOCKMAP" },
+	};
+
+	SString names;
+
+	for (const auto &lump : lumps)
+	{
+		if (flags & lump.flag)
+		{
+			if (! names.empty())
+				names += " ";
+			names += lump.name;
+		}
+	}
+
+	return names;
+}
+
+
+//
+// Loads the game and port definitions for --build-nodes, from the
+// --iwad and --port options, or else the usual ones for the format.
+// The node builder looks at them for the polyobjects.
+//
+static void LoadBuildDefinitions(MapFormat format, ConfigData &config) noexcept(false)
+{
+	LoadingData loading;
+
+	loading.levelFormat = format;
+
+	if (! config::preloading.iwadName.empty())
+		loading.gameName = GameNameFromIWAD(config::preloading.iwadName);
+	else
+		loading.gameName = (format == MapFormat::hexen) ? "hexen" : "doom2";
+
+	if (! config::preloading.portName.empty())
+		loading.portName = config::preloading.portName;
+	else
+		loading.portName = (format == MapFormat::udmf) ? "zdoom" : config::default_port;
+
+	gLog.printf("Game name: '%s'\n", loading.gameName.c_str());
+	gLog.printf("Port name: '%s'\n", loading.portName.c_str());
+
+	std::unordered_map<SString, SString> parseVars = loading.prepareConfigVariables();
+
+	readConfiguration(parseVars, GAMES_DIR, loading.gameName, config);
+	readConfiguration(parseVars, PORTS_DIR, loading.portName, config);
+}
+
+
+//
+// Build the nodes of every level in a wad, for the --build-nodes option.
+// This never opens a window, and only uses the node builder's defaults
+// plus the options given with it.  Returns the exit code.
+//
+int Instance::BuildNodesFromCommandLine()
+{
+	fs::path in_path  = global::build_nodes_file;
+	fs::path out_path = global::build_nodes_output.empty() ? in_path : global::build_nodes_output;
+
+	if (! fs::is_regular_file(in_path))
+	{
+		gLog.printf("ERROR: no such file: %s\n", in_path.u8string().c_str());
+		return 2;
+	}
+
+	if (out_path != in_path)
+	{
+		std::error_code ec;
+
+		fs::copy_file(in_path, out_path, fs::copy_options::overwrite_existing, ec);
+
+		if (ec)
+		{
+			gLog.printf("ERROR: could not copy %s to %s: %s\n", in_path.u8string().c_str(),
+					out_path.u8string().c_str(), ec.message().c_str());
+			return 2;
+		}
+	}
+
+	std::shared_ptr<Wad_file> edit_wad = Wad_file::Open(out_path, WadOpenMode::append);
+
+	if (! edit_wad || edit_wad->IsReadOnly())
+	{
+		gLog.printf("ERROR: could not open %s for writing\n", out_path.u8string().c_str());
+		return 2;
+	}
+
+	int num_levels = edit_wad->LevelCount();
+
+	if (num_levels == 0)
+	{
+		gLog.printf("ERROR: no levels in %s\n", in_path.u8string().c_str());
+		return 2;
+	}
+
+	// polyobjects are only found with the definitions
+	MapFormat format = MapFormat::doom;
+
+	for (int n = 0 ; n < num_levels ; n++)
+	{
+		if (edit_wad->LevelFormat(n) != MapFormat::doom)
+		{
+			format = edit_wad->LevelFormat(n);
+			break;
+		}
+	}
+
+	try
+	{
+		ConfigData config;
+		LoadBuildDefinitions(format, config);
+		conf = std::move(config);
+	}
+	catch (const std::runtime_error &e)
+	{
+		if (format != MapFormat::doom)
+		{
+			gLog.printf("ERROR: cannot build Hexen or UDMF levels without the definitions: %s\n", e.what());
+			return 2;
+		}
+
+		gLog.printf("WARNING: %s\n", e.what());
+	}
+
+	nodebuildinfo_t info;
+
+	info.fast = global::build_nodes_fast;
+	info.pick_budget = std::max(0, global::build_nodes_budget);
+	info.jobs = std::max(0, global::build_nodes_jobs);
+
+	if (global::build_nodes_factor > 0)
+		info.factor = clamp(1, global::build_nodes_factor, 31);
+
+	info.portfolio = ParsePortfolio(global::build_nodes_portfolio);
+	info.portfolio_height = global::build_nodes_portfolio_height;
+
+	if (! global::build_nodes_portfolio.empty() && info.portfolio.empty())
+	{
+		gLog.printf("ERROR: bad --portfolio factors: %s\n", global::build_nodes_portfolio.c_str());
+		return 2;
+	}
+
+	std::unique_ptr<ThreadPool> own_pool;
+
+	if (info.jobs > 1)
+		own_pool = std::make_unique<ThreadPool>(info.jobs - 1);
+
+	ThreadPool &pool = own_pool ? *own_pool : ThreadPool::shared();
+
+	std::vector<std::unique_ptr<level_build_t>> builds;
+
+	for (int n = 0 ; n < num_levels ; n++)
+	{
+		auto build = std::make_unique<level_build_t>();
+
+		build->wad = edit_wad->CopyLevel(n);
+		build->info.CopyOptions(info);
+		build->info.pool = &pool;
+
+		builds.push_back(std::move(build));
+	}
+
+	gLog.printf("Building nodes of %d levels in %s\n\n", num_levels, in_path.u8string().c_str());
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	// declared last, so its destructor waits for the tasks first
+	TaskGroup group(pool);
+
+	for (int n = 0 ; n < num_levels ; n++)
+	{
+		level_build_t *build = builds[n].get();
+
+		if (info.jobs == 1)
+		{
+			BuildLevelCopy(*this, build, n);
+			continue;
+		}
+
+		group.run([this, build, n]()
+		{
+			BuildLevelCopy(*this, build, n);
+		});
+	}
+
+	int failed = 0;
+	int overflowed = 0;
+
+	for (int n = 0 ; n < num_levels ; n++)
+	{
+		level_build_t *build = builds[n].get();
+
+		// lend a hand, or wait a bit when there is nothing to do
+		while (! build->done)
+			if (! pool.runPending())
+				std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		if (build->error)
+		{
+			for (auto &other : builds)
+				other->info.cancelled = true;
+
+			std::rethrow_exception(build->error);
+		}
+
+		const build_stats_t &stats = build->info.stats;
+
+		SString level_name = build->wad->GetLump(build->wad->LevelHeader(0))->Name();
+
+		const char *result = "OK";
+
+		if (build->failed || (build->ret != BUILD_OK && build->ret != BUILD_LumpOverflow))
+		{
+			result = "FAILED";
+			failed++;
+		}
+		else if (build->ret == BUILD_LumpOverflow)
+		{
+			result = "OVERFLOW";
+			overflowed++;
+		}
+
+		SString format = stats.xgl3 ? "XGL3" : stats.xnod ? "XNOD" : stats.gl_v5 ? "GL v5" : "normal";
+
+		if (stats.forced_xnod || stats.forced_v5)
+			format += " (forced)";
+
+		gLog.printf("%-8s %-8s %7.2fs  %6d segs  %6d subsecs  %6d nodes  %s\n",
+				level_name.c_str(), result, stats.time, stats.segs, stats.subsecs,
+				stats.nodes, format.c_str());
+
+		if (stats.overflows)
+			gLog.printf("         overflowed: %s\n", OverflowNames(stats.overflows).c_str());
+
+		for (SString message : build->messages)
+		{
+			message.trimTrailingSpaces();
+
+			if (! message.empty())
+				gLog.printf("         %s\n", message.c_str());
+		}
+
+		info.total_warnings += build->info.total_warnings;
+
+		// whatever happened to the copy happens to the real thing
+		edit_wad->ReplaceLevel(n, *build->wad);
+
+		build->wad.reset();
+	}
+
+	group.wait();
+
+	std::chrono::duration<double> total_time = std::chrono::steady_clock::now() - start_time;
+
+	try
+	{
+		edit_wad->writeToDisk();
+	}
+	catch (const std::runtime_error &e)
+	{
+		gLog.printf("ERROR: could not save %s: %s\n", out_path.u8string().c_str(), e.what());
+		return 2;
+	}
+
+	gLog.printf("\n%d levels in %1.2f seconds: %d failed, %d overflowed, %d warnings\n",
+			num_levels, total_time.count(), failed, overflowed, info.total_warnings);
+
+	return (failed > 0 || overflowed > 0) ? 1 : 0;
+}
+
+
 void Instance::CMD_BuildAllNodes()
 {
 
@@ -407,6 +1428,9 @@ void Instance::CMD_BuildAllNodes()
 	}
 
 
+	// every level is built again anyway
+	nodeBuild.reset();
+
 	// remember current level
 	SString CurLevel(loaded.levelName);
 
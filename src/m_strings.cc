@@ -394,6 +394,8 @@ size_t SString::findDigit() const
 //
 StringID StringTable::add(const SString &text)
 {
+	std::lock_guard<std::mutex> lock(mMutex);
+
 	int index = 0;
 	for(const SString &string : mStrings)
 	{
@@ -410,6 +412,8 @@ StringID StringTable::add(const SString &text)
 //
 SString StringTable::get(StringID offset) const noexcept
 {
+	std::lock_guard<std::mutex> lock(mMutex);
+
 	// this should never happen
 	// [ but handle it gracefully, for the sake of robustness ]
 	if(offset.isInvalid() || offset.get() >= (int)mStrings.size())
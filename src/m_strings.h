@@ -25,6 +25,7 @@
 
 #include <string.h>
 
+#include <mutex>
 #include <ostream>
 #include <string>
 #include <vector>
@@ -483,6 +484,9 @@ public:
 private:
 	// Must start with an empty string, so get(0) gets "".
 	std::vector<SString> mStrings = { "" };	
+
+	// levels may be loaded by several threads at once
+	mutable std::mutex mMutex;
 };
 
 #ifdef _WIN32
@@ -596,6 +596,9 @@ void Instance::CMD_TestMap()
 				return;
 		}
 
+		// the game needs the nodes of the last save
+		FinishBackgroundNodes();
+
 
 		// check if we know the executable path, if not then ask
 		const fs::path* info = global::recent.queryPortPath(QueryName(loaded.portName,
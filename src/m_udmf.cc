@@ -543,42 +543,32 @@ static void UDMF_ParseObject(Document &doc, Udmf_Parser& parser, const Udmf_Toke
 	if (name.Match("thing"))
 	{
 		kind = Objid(ObjType::things, 1);
-		auto addedThing = std::make_unique<Thing>();
-		addedThing->options = MTF_Not_SP | MTF_Not_COOP | MTF_Not_DM;
-		doc.things.push_back(std::move(addedThing));
-		new_T = doc.things.back().get();
+		new_T = doc.things.append();
+		new_T->options = MTF_Not_SP | MTF_Not_COOP | MTF_Not_DM;
 	}
 	else if (name.Match("vertex"))
 	{
 		kind = Objid(ObjType::vertices, 1);
-		auto addedVertex = std::make_unique<Vertex>();
-		doc.vertices.push_back(std::move(addedVertex));
-		new_V = doc.vertices.back().get();
+		new_V = doc.vertices.append();
 	}
 	else if (name.Match("linedef"))
 	{
 		kind = Objid(ObjType::linedefs, 1);
-		auto addedLine = std::make_shared<LineDef>();
-		doc.linedefs.push_back(std::move(addedLine));
-		new_LD = doc.linedefs.back().get();
+		new_LD = doc.linedefs.append();
 	}
 	else if (name.Match("sidedef"))
 	{
 		kind = Objid(ObjType::sidedefs, 1);
-		auto addedSide = std::make_shared<SideDef>();
-		addedSide->mid_tex = BA_InternaliseString("-");
-		addedSide->lower_tex = addedSide->mid_tex;
-		addedSide->upper_tex = addedSide->mid_tex;
-		doc.sidedefs.push_back(std::move(addedSide));
-		new_SD = doc.sidedefs.back().get();
+		new_SD = doc.sidedefs.append();
+		new_SD->mid_tex = BA_InternaliseString("-");
+		new_SD->lower_tex = new_SD->mid_tex;
+		new_SD->upper_tex = new_SD->mid_tex;
 	}
 	else if (name.Match("sector"))
 	{
 		kind = Objid(ObjType::sectors, 1);
-		auto addedSector = std::make_shared<Sector>();
-		addedSector->light = 160;
-		doc.sectors.push_back(std::move(addedSector));
-		new_S = doc.sectors.back().get();
+		new_S = doc.sectors.append();
+		new_S->light = 160;
 	}
 
 	if (!kind.valid())
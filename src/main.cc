@@ -141,6 +141,17 @@ static ProgressStatus init_progress;
 bool global::show_help;
 bool global::show_version;
 
+fs::path global::build_nodes_file;
+fs::path global::build_nodes_output;
+
+int  global::build_nodes_jobs;
+bool global::build_nodes_fast;
+int  global::build_nodes_budget;
+int  global::build_nodes_factor;
+
+SString global::build_nodes_portfolio;
+bool global::build_nodes_portfolio_height;
+
 
 static void RemoveSingleNewlines(SString &buffer)
 {
@@ -241,7 +252,7 @@ static void CreateHomeDirs()
 	static const fs::path subdirs[] =
 	{
 		// these under $cache_dir
-		"cache", "backups",
+		"cache", "backups", "nodes",
 
 		// these under $home_dir
 		"iwads", "games", "ports"
@@ -249,7 +260,7 @@ static void CreateHomeDirs()
 
 	for (int i = 0 ; i < (int)lengthof(subdirs) ; i++)
 	{
-		dir_name = (i < 2 ? global::cache_dir : global::home_dir) / subdirs[i];
+		dir_name = (i < 3 ? global::cache_dir : global::home_dir) / subdirs[i];
 		FileMakeDir(dir_name);
 	}
 }
@@ -874,7 +885,11 @@ void Main_Loop()
 		if (global::want_quit)
 		{
 			if (gInstance->level.Main_ConfirmQuit("quit"))
+			{
+				// the unsaved edits were let go
+				gInstance->level.journal.discard();
 				break;
+			}
 
 			global::want_quit = false;
 		}
@@ -890,6 +905,8 @@ void Main_Loop()
 			gInstance->edit.error_mode = false;
 
 		updateStatusByChildProcesses(*gInstance);
+
+		gInstance->PollBackgroundNodes();
 	}
 }
 
@@ -1210,6 +1227,24 @@ int EurekaMain(int argc, char *argv[])
 			ShowVersion();
 			return 0;
 		}
+		if (!global::build_nodes_file.empty())
+		{
+			// no window, no config files: just the node builder, with the
+			// definitions of the --iwad and --port given
+			try
+			{
+				Determine_InstallPath(argv[0]);
+				Determine_HomeDir(argv[0]);
+			}
+			catch (const std::runtime_error &e)
+			{
+				gLog.printf("WARNING: %s", e.what());
+			}
+
+			M_ParseCommandLine(argc - 1, argv + 1, CommandLinePass::normal, global::Pwad_list, options);
+
+			return instance.BuildNodesFromCommandLine();
+		}
 
 		init_progress = ProgressStatus::early;
 
@@ -1351,6 +1386,9 @@ int EurekaMain(int argc, char *argv[])
 
 		Main_Loop();
 
+		// the nodes of the last save still belong in the wad
+		gInstance->FinishBackgroundNodes();
+
 	quit:
 		/* that's all folks! */
 
@@ -146,6 +146,21 @@ namespace global
 	extern bool   show_version;	// Print version info and exit.
 }
 
+namespace global
+{
+	// --build-nodes: build the nodes of this wad without the GUI, and exit
+	extern fs::path build_nodes_file;
+	extern fs::path build_nodes_output;	// where to write it, when not in place
+
+	extern int  build_nodes_jobs;	// 0 for one thread per CPU core
+	extern bool build_nodes_fast;
+	extern int  build_nodes_budget;	// 0 to try every seg
+	extern int  build_nodes_factor;	// 0 for the default
+
+	extern SString build_nodes_portfolio;	// split factors, e.g. "3,11,23"
+	extern bool build_nodes_portfolio_height;
+}
+
 
 struct LoadingData;
 struct NewResources;
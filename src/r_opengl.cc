@@ -1011,7 +1011,7 @@ public:
 		{
 			sector_3dfloors_c *ex = inst.Subdiv_3DFloorsForSector(sd->sector);
 
-			DrawSide('W', ld.get(), sd, sd->MidTex(), front, NULL, false,
+			DrawSide('W', ld, sd, sd->MidTex(), front, NULL, false,
 				ld_len, x1, y1, &ex->f_plane, x2, y2, &ex->c_plane);
 		}
 		else
@@ -1050,17 +1050,17 @@ public:
 
 			// lower part
 			if ((back->floorh > front->floorh || f_sloped) && !self_ref && !invis_back)
-				DrawSide('L', ld.get(), sd, sd->LowerTex(), front, back, sky_upper,
+				DrawSide('L', ld, sd, sd->LowerTex(), front, back, sky_upper,
 					ld_len, x1, y1, f_floorp, x2, y2, &b_ex->f_plane);
 
 			// upper part
 			if ((back->ceilh < front->ceilh || c_sloped) && !self_ref && !sky_upper)
-				DrawSide('U', ld.get(), sd, sd->UpperTex(), front, back, sky_upper,
+				DrawSide('U', ld, sd, sd->UpperTex(), front, back, sky_upper,
 					ld_len, x1, y1, &b_ex->c_plane, x2, y2, &f_ex->c_plane);
 
 			// railing tex
 			if (!is_null_tex(sd->MidTex()) && inst.r_view.texturing)
-				DrawMidMasker(ld.get(), sd, front, back, sky_upper,
+				DrawMidMasker(ld, sd, front, back, sky_upper,
 					ld_len, x1, y1, x2, y2);
 
 			// draw sides of extrafloors
@@ -1095,7 +1095,7 @@ public:
 					slope_plane_c p1; p1.Init(static_cast<float>(bottom_h));
 					slope_plane_c p2; p2.Init(static_cast<float>(top_h));
 
-					DrawSide('E', ld.get(), sd, tex, front, back, false,
+					DrawSide('E', ld, sd, tex, front, back, false,
 						ld_len, x1, y1, &p1, x2, y2, &p2);
 				}
 			}
@@ -1113,7 +1113,7 @@ public:
 			slope_plane_c p1; p1.Init(static_cast<float>(front->ceilh));
 			slope_plane_c p2; p2.Init(static_cast<float>(front->ceilh + 16384.0));
 
-			DrawSide('U', ld.get(), sd, "-", front, NULL, true /* sky_upper */,
+			DrawSide('U', ld, sd, "-", front, NULL, true /* sky_upper */,
 				ld_len, x1, y1, &p1, x2, y2, &p2);
 		}
 	}
@@ -1139,45 +1139,45 @@ public:
 			if (dummy->floorh > sec->floorh && inst.r_view.z < dummy->floorh)
 			{
 				// space C : underwater
-				DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(dummy->floorh), dummy->CeilTex());
-				DrawSectorPolygons(sec.get(), subdiv, NULL, +1, static_cast<float>(sec->floorh), dummy->FloorTex());
+				DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(dummy->floorh), dummy->CeilTex());
+				DrawSectorPolygons(sec, subdiv, NULL, +1, static_cast<float>(sec->floorh), dummy->FloorTex());
 
 				// this helps the view to not look weird when clipping around
 				if (dummy->ceilh > sec->floorh)
-					DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(dummy->ceilh), sec->CeilTex());
+					DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(dummy->ceilh), sec->CeilTex());
 			}
 			else if (dummy->ceilh < sec->ceilh && inst.r_view.z > dummy->ceilh)
 			{
 				// space A : head over ceiling
-				DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(dummy->ceilh), dummy->FloorTex());
-				DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(sec->ceilh), dummy->CeilTex());
+				DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(dummy->ceilh), dummy->FloorTex());
+				DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(sec->ceilh), dummy->CeilTex());
 
 				if (dummy->floorh < sec->ceilh)
-					DrawSectorPolygons(sec.get(), subdiv, NULL, +1, static_cast<float>(dummy->floorh), sec->FloorTex());
+					DrawSectorPolygons(sec, subdiv, NULL, +1, static_cast<float>(dummy->floorh), sec->FloorTex());
 			}
 			else if (dummy->floorh < sec->floorh)
 			{
 				// invisible platform
-				DrawSectorPolygons(sec.get(), subdiv, NULL, +1, static_cast<float>(dummy->floorh), sec->FloorTex());
+				DrawSectorPolygons(sec, subdiv, NULL, +1, static_cast<float>(dummy->floorh), sec->FloorTex());
 
 				if (!inst.is_sky(sec->CeilTex()))
-					DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(dummy->ceilh), sec->CeilTex());
+					DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(dummy->ceilh), sec->CeilTex());
 			}
 			else
 			{
 				// space B : normal
-				DrawSectorPolygons(sec.get(), subdiv, NULL, +1, static_cast<float>(dummy->floorh), sec->FloorTex());
+				DrawSectorPolygons(sec, subdiv, NULL, +1, static_cast<float>(dummy->floorh), sec->FloorTex());
 
 				if (!inst.is_sky(sec->CeilTex()))
-					DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(dummy->ceilh), sec->CeilTex());
+					DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(dummy->ceilh), sec->CeilTex());
 			}
 		} else {
 
 			// normal sector
-			DrawSectorPolygons(sec.get(), subdiv, &exfloor->f_plane, +1, static_cast<float>(sec->floorh), sec->FloorTex());
+			DrawSectorPolygons(sec, subdiv, &exfloor->f_plane, +1, static_cast<float>(sec->floorh), sec->FloorTex());
 
 			if (!inst.is_sky(sec->CeilTex()))
-				DrawSectorPolygons(sec.get(), subdiv, &exfloor->c_plane, -1, static_cast<float>(sec->ceilh), sec->CeilTex());
+				DrawSectorPolygons(sec, subdiv, &exfloor->c_plane, -1, static_cast<float>(sec->ceilh), sec->CeilTex());
 		}
 
 		// draw planes of 3D floors
@@ -1207,8 +1207,8 @@ public:
 				std::swap(top_tex, bottom_tex);
 			}
 
-			DrawSectorPolygons(sec.get(), subdiv, NULL, +1, static_cast<float>(top_h), top_tex);
-			DrawSectorPolygons(sec.get(), subdiv, NULL, -1, static_cast<float>(bottom_h), bottom_tex);
+			DrawSectorPolygons(sec, subdiv, NULL, +1, static_cast<float>(top_h), top_tex);
+			DrawSectorPolygons(sec, subdiv, NULL, -1, static_cast<float>(bottom_h), bottom_tex);
 		}
 	}
 
@@ -1373,7 +1373,7 @@ public:
 			{
 				int zi1, zi2;
 
-				if (! inst.LD_RailHeights(zi1, zi2, L.get(), sd, front, back))
+				if (! inst.LD_RailHeights(zi1, zi2, L, sd, front, back))
 					return;
 
 				z1 = static_cast<float>(zi1); z2 = static_cast<float>(zi2);
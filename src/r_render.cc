@@ -88,6 +88,41 @@ namespace thing_sec_cache
 		invalid_high = doc.numThings() - (upcomingDelete ? 2 : 1);
 	}
 
+	// the cached sectors only line up with the things while the
+	// sizes match, otherwise Update() will look for them all.
+	bool InStep(const Instance &inst)
+	{
+		return inst.level.numThings() == (int)inst.r_view.thing_sectors.size();
+	}
+
+	// called before the thing is added
+	void InsertThing(Instance &inst, int th)
+	{
+		if (InStep(inst))
+			inst.r_view.thing_sectors.insert(inst.r_view.thing_sectors.begin() + th, -1);
+
+		if (invalid_low <= invalid_high)
+		{
+			if (th <= invalid_low)  invalid_low++;
+			if (th <= invalid_high) invalid_high++;
+		}
+
+		InvalidateThing(th);
+	}
+
+	// called before the thing is removed
+	void DeleteThing(Instance &inst, int th)
+	{
+		if (InStep(inst))
+			inst.r_view.thing_sectors.erase(inst.r_view.thing_sectors.begin() + th);
+
+		if (invalid_low <= invalid_high)
+		{
+			if (th < invalid_low)   invalid_low--;
+			if (th <= invalid_high) invalid_high--;
+		}
+	}
+
 	void Update(Instance &inst);
 };
 
@@ -199,7 +234,7 @@ static const Thing *FindPlayer(const Document &doc, int typenum)
 
 	for ( int i = doc.numThings()-1 ; i >= 0 ; i--)
 		if (doc.things[i]->type == typenum)
-			return doc.things[i].get();
+			return doc.things[i];
 
 	return nullptr;  // not found
 }
@@ -219,6 +254,10 @@ namespace thing_sec_cache
 			thing_sec_cache::InvalidateAll(inst.level, false);
 		}
 
+		// several things deleted at once leave the range too long
+		if (invalid_high >= inst.level.numThings())
+			invalid_high = inst.level.numThings() - 1;
+
 		// nothing changed?
 		if (invalid_low > invalid_high)
 			return;
@@ -239,16 +278,19 @@ void Render3D_NotifyBegin()
 	thing_sec_cache::ResetRange();
 }
 
-void Render3D_NotifyInsert(ObjType type, int objnum)
+void Render3D_NotifyInsert(Instance &inst, ObjType type, int objnum)
 {
 	if (type == ObjType::things)
-		thing_sec_cache::InvalidateThing(objnum);
+		thing_sec_cache::InsertThing(inst, objnum);
 }
 
-void Render3D_NotifyDelete(const Document &doc, ObjType type, int objnum)
+void Render3D_NotifyDelete(Instance &inst, ObjType type, int objnum)
 {
-	if (type == ObjType::things || type == ObjType::sectors)
-		thing_sec_cache::InvalidateAll(doc, true);
+	// the other things keep their sectors
+	if (type == ObjType::things)
+		thing_sec_cache::DeleteThing(inst, objnum);
+	else if (type == ObjType::sectors)
+		thing_sec_cache::InvalidateAll(inst.level, false);
 }
 
 void Render3D_NotifyChange(ObjType type, int objnum, int field)
@@ -374,19 +416,19 @@ private:
 		switch (type)
 		{
 			case ObjType::things:
-				return reinterpret_cast<int*>(inst.level.things[objnum].get());
+				return reinterpret_cast<int*>(inst.level.things[objnum]);
 
 			case ObjType::vertices:
-				return reinterpret_cast<int *>(inst.level.vertices[objnum].get());
+				return reinterpret_cast<int *>(inst.level.vertices[objnum]);
 
 			case ObjType::sectors:
-				return reinterpret_cast<int *>(inst.level.sectors[objnum].get());
+				return reinterpret_cast<int *>(inst.level.sectors[objnum]);
 
 			case ObjType::sidedefs:
-				return reinterpret_cast<int *>(inst.level.sidedefs[objnum].get());
+				return reinterpret_cast<int *>(inst.level.sidedefs[objnum]);
 
 			case ObjType::linedefs:
-				return reinterpret_cast<int *>(inst.level.linedefs[objnum].get());
+				return reinterpret_cast<int *>(inst.level.linedefs[objnum]);
 
 			default:
 				BugError("SaveBucket with bad mode\n");
@@ -1204,7 +1246,7 @@ StringID Instance::GrabSelectedFlat()
 
 		const auto S = level.sectors[edit.highlight.num];
 
-		result = SEC_GrabFlat(S.get(), edit.highlight.parts);
+		result = SEC_GrabFlat(S, edit.highlight.parts);
 	}
 	else
 	{
@@ -1213,7 +1255,7 @@ StringID Instance::GrabSelectedFlat()
 			const auto S = level.sectors[*it];
 			byte parts = edit.Selected->get_ext(*it);
 
-			StringID tex = SEC_GrabFlat(S.get(), parts & ~1);
+			StringID tex = SEC_GrabFlat(S, parts & ~1);
 
 			if (result.isValid() && tex != result)
 			{
@@ -1350,7 +1392,7 @@ StringID Instance::GrabSelectedTexture()
 
 		const auto L = level.linedefs[edit.highlight.num];
 
-		result = LD_GrabTex(L.get(), edit.highlight.parts);
+		result = LD_GrabTex(L, edit.highlight.parts);
 	}
 	else
 	{
@@ -1359,7 +1401,7 @@ StringID Instance::GrabSelectedTexture()
 			const auto L = level.linedefs[*it];
 			byte parts = edit.Selected->get_ext(*it);
 
-			StringID tex = LD_GrabTex(L.get(), parts & ~1);
+			StringID tex = LD_GrabTex(L, parts & ~1);
 
 			if (result.isValid() && tex != result)
 			{
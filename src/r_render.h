@@ -108,8 +108,8 @@ void Render3D_DragThings(Instance &inst);
 void Render3D_DragSectors(Instance &inst);
 
 void Render3D_NotifyBegin();
-void Render3D_NotifyInsert(ObjType type, int objnum);
-void Render3D_NotifyDelete(const Document &doc, ObjType type, int objnum);
+void Render3D_NotifyInsert(Instance &inst, ObjType type, int objnum);
+void Render3D_NotifyDelete(Instance &inst, ObjType type, int objnum);
 void Render3D_NotifyChange(ObjType type, int objnum, int field);
 void Render3D_NotifyEnd(Instance &inst);
 
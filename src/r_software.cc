@@ -379,7 +379,7 @@ public:
 
 		SideDef *back_sd = (side == Side::left) ? inst.level.getRight(*ld) : inst.level.getLeft(*ld);
 		if (back_sd)
-			back = inst.level.sectors[back_sd->sector].get();
+			back = inst.level.sectors[back_sd->sector];
 
 		// support for BOOM's 242 "transfer heights" line type
 		Sector temp_front;
@@ -389,7 +389,7 @@ public:
 		if (exfloor->heightsec >= 0)
 		{
 			const auto dummy = inst.level.sectors[exfloor->heightsec];
-			front = Boom242Sector(front, &temp_front, dummy.get());
+			front = Boom242Sector(front, &temp_front, dummy);
 		}
 
 		if (back != NULL)
@@ -398,7 +398,7 @@ public:
 			if (exfloor->heightsec >= 0)
 			{
 				const auto dummy = inst.level.sectors[exfloor->heightsec];
-				back = Boom242Sector(back, &temp_back, dummy.get());
+				back = Boom242Sector(back, &temp_back, dummy);
 			}
 		}
 
@@ -498,7 +498,7 @@ public:
 			return;
 
 		front = sec;
-		back  = inst.level.sectors[back_sd->sector].get();
+		back  = inst.level.sectors[back_sd->sector];
 
 		int c_h = std::min(front->ceilh,  back->ceilh);
 		int f_h = std::max(front->floorh, back->floorh);
@@ -835,7 +835,7 @@ public:
 		DrawWall *dw = new DrawWall(inst);
 
 		dw->th = -1;
-		dw->ld = ld.get();
+		dw->ld = ld;
 		dw->ld_index = ld_index;
 
 		dw->sd = sd;
@@ -175,9 +175,9 @@ void sector_info_cache_c::Rebuild()
 	{
 		const auto L = inst.level.linedefs[n];
 
-		CheckBoom242(L.get());
-		CheckExtraFloor(L.get(), n);
-		CheckLineSlope(L.get());
+		CheckBoom242(L);
+		CheckExtraFloor(L, n);
+		CheckLineSlope(L);
 
 		for (int side = 0 ; side < 2 ; side++)
 		{
@@ -198,16 +198,16 @@ void sector_info_cache_c::Rebuild()
 
 	for (const auto &thing : inst.level.things)
 	{
-		CheckSlopeThing(thing.get());
+		CheckSlopeThing(thing);
 	}
 	for (const auto &thing : inst.level.things)
 	{
-		CheckSlopeCopyThing(thing.get());
+		CheckSlopeCopyThing(thing);
 	}
 
 	for (const auto &linedef : inst.level.linedefs)
 	{
-		CheckPlaneCopy(linedef.get());
+		CheckPlaneCopy(linedef);
 	}
 }
 
@@ -700,7 +700,7 @@ fprintf(stderr, "R_SubdivideSector %d\n", num);
 		if (edge.y1 == edge.y2)
 			continue;
 
-		edge.line = L.get();
+		edge.line = L;
 		edge.flipped = 0;
 
 		if (edge.y1 > edge.y2)
@@ -102,6 +102,8 @@ void Log::printf(EUR_FORMAT_STRING(const char *str), ...)
 	SString buffer = SString::vprintf(str, args);
 	va_end(args);
 
+	std::lock_guard<std::mutex> lock(mutex);
+
 	if (log_fp)
 	{
 		fputs(buffer.c_str(), log_fp);
@@ -132,6 +134,8 @@ void Log::debugPrintf(EUR_FORMAT_STRING(const char *str), ...)
 		SString buffer = SString::vprintf(str, args);
 		va_end(args);
 
+		std::lock_guard<std::mutex> lock(mutex);
+
 		// prefix each debugging line with a special symbol
 
 		size_t index = 0;
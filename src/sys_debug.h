@@ -27,6 +27,7 @@ namespace fs = ghc::filesystem;
 
 #include <stdio.h>
 #include "PrintfMacros.h"
+#include <mutex>
 #include <ostream>
 #include <vector>
 
@@ -79,6 +80,9 @@ private:
 
 	bool inFatalError = false;
 
+	// the node builder may print from several threads
+	std::mutex mutex;
+
 	bool log_window_open = false;
 	FILE *log_fp = nullptr;
 	std::vector<SString> kept_messages;
@@ -1673,7 +1673,7 @@ void UI_Canvas::DrawTagged(ObjType objtype, int objnum)
             const auto line = inst.level.linedefs[m];
             assert(line);
             SpecialTagInfo info;
-            if(!getSpecialTagInfo(ObjType::linedefs, m, line->type, line.get(), inst.conf, info))
+            if(!getSpecialTagInfo(ObjType::linedefs, m, line->type, line, inst.conf, info))
                 continue;
 
             for(int i = 0; i < info.*numtags; ++i)
@@ -1692,7 +1692,7 @@ void UI_Canvas::DrawTagged(ObjType objtype, int objnum)
             const auto thing = inst.level.things[m];
             assert(thing);
             SpecialTagInfo info;
-            if(!getSpecialTagInfo(ObjType::things, m, thing->special, thing.get(), inst.conf, info))
+            if(!getSpecialTagInfo(ObjType::things, m, thing->special, thing, inst.conf, info))
                 continue;
 
             for(int i = 0; i < info.*numtags; ++i)
@@ -1709,7 +1709,7 @@ void UI_Canvas::DrawTagged(ObjType objtype, int objnum)
         const auto line = inst.level.linedefs[objnum];
         assert(line);
         SpecialTagInfo info;
-        if(getSpecialTagInfo(objtype, objnum, line->type, line.get(), inst.conf, info))
+        if(getSpecialTagInfo(objtype, objnum, line->type, line, inst.conf, info))
             highlightTaggedItems(info);
         if(inst.loaded.levelFormat == MapFormat::doom)
         {
@@ -1719,7 +1719,7 @@ void UI_Canvas::DrawTagged(ObjType objtype, int objnum)
         else
         {
             SpecialTagInfo linfo;
-            if(!getSpecialTagInfo(objtype, objnum, line->type, line.get(), inst.conf, linfo))
+            if(!getSpecialTagInfo(objtype, objnum, line->type, line, inst.conf, linfo))
                 return;
             // TODO: also UDMF line ID
             if(inst.loaded.levelFormat == MapFormat::hexen && linfo.selflineid > 0)
@@ -1734,7 +1734,7 @@ void UI_Canvas::DrawTagged(ObjType objtype, int objnum)
         const auto thing = inst.level.things[objnum];
         assert(thing);
         SpecialTagInfo info;
-        if(getSpecialTagInfo(objtype, objnum, thing->special, thing.get(), inst.conf, info))
+        if(getSpecialTagInfo(objtype, objnum, thing->special, thing, inst.conf, info))
             highlightTaggedItems(info);
         highlightTaggingTriggers(thing->tid, &SpecialTagInfo::tids, &SpecialTagInfo::numtids);
         const thingtype_t *type = get(inst.conf.thing_types, thing->type);
@@ -769,8 +769,8 @@ void UI_LineBox::UpdateField(int field)
 		{
 			const auto L = inst.level.linedefs[obj];
 
-			int right_mask = SolidMask(L.get(), Side::right);
-			int  left_mask = SolidMask(L.get(), Side::left);
+			int right_mask = SolidMask(L, Side::right);
+			int  left_mask = SolidMask(L, Side::left);
 
 			front->SetObj(L->right, right_mask, L->TwoSided());
 			 back->SetObj(L->left,   left_mask, L->TwoSided());
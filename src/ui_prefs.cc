@@ -718,6 +718,7 @@ public:
 	Fl_Check_Button *nod_on_save;
 	Fl_Check_Button *nod_fast;
 	Fl_Check_Button *nod_warn;
+	Fl_Check_Button *nod_threads;
 
 	Fl_Choice *nod_factor;
 
@@ -1070,6 +1071,8 @@ UI_Preferences::UI_Preferences(const opt_desc_t *options) :
 		}
 		{ nod_warn = new Fl_Check_Button(50, 140, 220, 30, " Warning messages in the logs");
 		}
+		{ nod_threads = new Fl_Check_Button(50, 170, 440, 30, " Use all CPU cores   (same nodes, built faster)");
+		}
 
 		{ Fl_Box* o = new Fl_Box(25, 205, 250, 30, "Advanced BSP Settings");
 		  o->labelfont(FL_BOLD);
@@ -1529,6 +1532,7 @@ void UI_Preferences::LoadValues()
 	nod_on_save->value(config::bsp_on_save ? 1 : 0);
 	nod_fast->value(config::bsp_fast ? 1 : 0);
 	nod_warn->value(config::bsp_warnings ? 1 : 0);
+	nod_threads->value(config::bsp_threads != 1 ? 1 : 0);
 
 	if (config::bsp_split_factor < 7)
 		nod_factor->value(2);	// Balanced BSP tree
@@ -1667,6 +1671,12 @@ void UI_Preferences::SaveValues()
 	config::bsp_fast = nod_fast->value() ? true : false;
 	config::bsp_warnings = nod_warn->value() ? true : false;
 
+	// keep a specific number of threads from the config file
+	if (! nod_threads->value())
+		config::bsp_threads = 1;
+	else if (config::bsp_threads == 1)
+		config::bsp_threads = 0;
+
 	if (nod_factor->value() == 1)			// Minimize Splits
 		config::bsp_split_factor = 29;
 	else if (nod_factor->value() == 2)		// Balanced BSP tree
@@ -1480,7 +1480,7 @@ bool UI_FindAndReplace::Match_LineDef(int idx)
 {
 	const auto L = inst.level.linedefs[idx];
 
-	if (! Filter_Tag(L->tag) || ! Filter_Sides(L.get()))
+	if (! Filter_Tag(L->tag) || ! Filter_Sides(L))
 		return false;
 
 	const char *pattern = find_match->value();
@@ -1550,7 +1550,7 @@ bool UI_FindAndReplace::Match_LineType(int idx)
 	if (! find_numbers->get(L->type))
 		return false;
 
-	if (! Filter_Tag(L->tag) || ! Filter_Sides(L.get()))
+	if (! Filter_Tag(L->tag) || ! Filter_Sides(L))
 		return false;
 
 	return true;
@@ -674,7 +674,7 @@ void UI_SectorBox::button_callback(Fl_Widget *w, void *data)
 
 void UI_SectorBox::UpdateField(int field)
 {
-	const Sector *sector = inst.level.isSector(obj) ? inst.level.sectors[obj].get() : nullptr;
+	const Sector *sector = inst.level.isSector(obj) ? inst.level.sectors[obj] : nullptr;
 	if (field < 0 || field == Sector::F_FLOORH || field == Sector::F_CEILH)
 	{
 		if (inst.level.isSector(obj))
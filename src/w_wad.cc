@@ -172,7 +172,9 @@ int64_t Lump_c::getName8() const noexcept
 
 Wad_file::~Wad_file()
 {
-	gLog.printf("Closing WAD file: %s\n", filename.u8string().c_str());
+	// in-memory copies have no name
+	if (! filename.empty())
+		gLog.printf("Closing WAD file: %s\n", filename.u8string().c_str());
 }
 
 
@@ -1071,6 +1073,53 @@ void Wad_file::RemoveZNodes(int lev_num)
 }
 
 
+std::shared_ptr<Wad_file> Wad_file::CopyLevel(int lev_num) const
+{
+	int start  = LevelHeader(lev_num);
+	int finish = LevelLastLump(lev_num);
+
+	auto copy = std::shared_ptr<Wad_file>(new Wad_file(fs::path(), WadOpenMode::write));
+
+	copy->AddLevel(directory[start].lump->name)->setData(
+			std::vector<byte>(directory[start].lump->getData()));
+
+	for (int i = start + 1 ; i <= finish ; i++)
+	{
+		const Lump_c &lump = *directory[i].lump;
+
+		copy->AddLump(lump.name).setData(std::vector<byte>(lump.getData()));
+	}
+
+	return copy;
+}
+
+
+void Wad_file::ReplaceLevel(int lev_num, const Wad_file &source)
+{
+	SYS_ASSERT(source.LevelCount() == 1 && source.LevelHeader(0) == 0);
+
+	int start  = LevelHeader(lev_num);
+	int finish = LevelLastLump(lev_num);
+
+	// the marker stays, so the level keeps its place in levels[]
+	if (finish > start)
+		RemoveLumps(start + 1, finish - start);
+
+	directory[start].lump->setData(std::vector<byte>(source.directory[0].lump->getData()));
+
+	InsertPoint(start + 1);
+
+	for (int i = 1 ; i < source.NumLumps() ; i++)
+	{
+		const Lump_c &lump = *source.directory[i].lump;
+
+		AddLump(lump.name).setData(std::vector<byte>(lump.getData()));
+	}
+
+	InsertPoint();
+}
+
+
 void Wad_file::FixLevelGroup(int index, int num_added, int num_removed)
 {
 	bool did_remove = false;
@@ -286,6 +286,14 @@ public:
 	// removes any ZNODES lump from a UDMF level.
 	void RemoveZNodes(int lev_num);
 
+	// makes a copy of a level, as the only level of a new wad which
+	// only lives in memory.
+	std::shared_ptr<Wad_file> CopyLevel(int lev_num) const;
+
+	// replaces all the lumps of a level with the ones of the (only)
+	// level in the given wad, e.g. one made by CopyLevel().
+	void ReplaceLevel(int lev_num, const Wad_file &source);
+
 	// insert a new lump.
 	// The second form is for a level marker.
 	// The 'max_size' parameter (if >= 0) specifies the most data
@@ -45,17 +45,17 @@ TEST_F(DocumentFixture, CheckObjects)
 	ASSERT_FALSE(doc.numLinedefs());
 
 	// Add some objects
-	doc.things.push_back(std::make_shared<Thing>());
-	doc.things.push_back(std::make_shared<Thing>());
-	doc.things.push_back(std::make_shared<Thing>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
+	doc.things.append();
+	doc.things.append();
+	doc.things.append();
+	doc.vertices.append();
+	doc.vertices.append();
+	doc.vertices.append();
+	doc.vertices.append();
 	// no sectors
-	doc.sidedefs.push_back(std::make_shared<SideDef>());
-	doc.sidedefs.push_back(std::make_shared<SideDef>());
-	doc.linedefs.push_back(std::make_shared<LineDef>());
+	doc.sidedefs.append();
+	doc.sidedefs.append();
+	doc.linedefs.append();
 
 	ASSERT_EQ(doc.numThings(), 3);
 	ASSERT_EQ(doc.numVertices(), 4);
@@ -97,17 +97,17 @@ TEST_F(DocumentFixture, CheckObjects)
 TEST_F(DocumentFixture, CRC)
 {
 	// Add some objects
-	doc.things.push_back(std::make_shared<Thing>());
-	doc.things.push_back(std::make_shared<Thing>());
-	doc.things.push_back(std::make_shared<Thing>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
-	doc.vertices.push_back(std::make_shared<Vertex>());
+	doc.things.append();
+	doc.things.append();
+	doc.things.append();
+	doc.vertices.append();
+	doc.vertices.append();
+	doc.vertices.append();
+	doc.vertices.append();
 	// no sectors
-	doc.sidedefs.push_back(std::make_shared<SideDef>());
-	doc.sidedefs.push_back(std::make_shared<SideDef>());
-	doc.linedefs.push_back(std::make_shared<LineDef>());
+	doc.sidedefs.append();
+	doc.sidedefs.append();
+	doc.linedefs.append();
 
 	crc32_c crc;
 	doc.getLevelChecksum(crc);
@@ -121,7 +121,7 @@ TEST_F(DocumentFixture, CRC)
 	ASSERT_NE(crc.getPath(), crc2.getPath());
 
 	// Now add back one thing
-	doc.things.push_back(std::make_shared<Thing>());
+	doc.things.append();
 
 	crc32_c crc3;
 	doc.getLevelChecksum(crc3);
@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "Instance.h"
+#include "ObjectPool.h"
+#include "gtest/gtest.h"
+
+#include <vector>
+
+TEST(ObjectPool, AppendKeepsObjectsInPlace)
+{
+	ObjectPool<Vertex> pool;
+
+	std::vector<Vertex *> added;
+	for(int i = 0; i < 5000; ++i)
+	{
+		Vertex *vertex = pool.append();
+		vertex->raw_x = FFixedPoint(i);
+		added.push_back(vertex);
+	}
+	ASSERT_EQ(pool.size(), 5000u);
+
+	int index = 0;
+	for(Vertex *vertex : pool)
+	{
+		ASSERT_EQ(vertex, added[index]);
+		ASSERT_EQ(vertex->raw_x, FFixedPoint(index));
+		++index;
+	}
+	ASSERT_EQ(index, 5000);
+}
+
+TEST(ObjectPool, InsertAndTakeShiftTheRest)
+{
+	ObjectPool<Thing> pool;
+	for(int i = 0; i < 2000; ++i)
+		pool.append()->type = i;
+
+	Thing thing;
+	thing.type = -1;
+	pool.insert(1023, std::move(thing));
+	ASSERT_EQ(pool.size(), 2001u);
+	ASSERT_EQ(pool[1022]->type, 1022);
+	ASSERT_EQ(pool[1023]->type, -1);
+	ASSERT_EQ(pool[1024]->type, 1023);
+	ASSERT_EQ(pool.back()->type, 1999);
+
+	thing = pool.take(0);
+	ASSERT_EQ(thing.type, 0);
+	ASSERT_EQ(pool[0]->type, 1);
+	ASSERT_EQ(pool[1022]->type, -1);
+	ASSERT_EQ(pool.size(), 2000u);
+
+	// the places past the end are left as new
+	pool.resize(10);
+	ASSERT_EQ(pool.append()->type, Thing().type);
+}
+
+TEST(ObjectStash, UsesFreedPlacesAgain)
+{
+	ObjectStash<Sector> stash;
+
+	Sector sector;
+	sector.tag = 1;
+	int first = stash.put(std::move(sector));
+	sector.tag = 2;
+	int second = stash.put(std::move(sector));
+	ASSERT_EQ(stash.size(), 2u);
+
+	stash.release(first);
+	ASSERT_EQ(stash.size(), 1u);
+	sector.tag = 3;
+	ASSERT_EQ(stash.put(std::move(sector)), first);
+
+	ASSERT_EQ(stash.take(second).tag, 2);
+	ASSERT_EQ(stash[first].tag, 3);
+}
+
+TEST(ObjectStash, TrimKeepsTheHeldObjects)
+{
+	ObjectStash<Sector> stash;
+
+	std::vector<int> slots;
+	for(int i = 0; i < 10; ++i)
+	{
+		Sector sector;
+		sector.tag = i;
+		slots.push_back(stash.put(std::move(sector)));
+	}
+	for(int i : {9, 2, 7, 8, 4})
+		stash.release(slots[i]);
+
+	stash.trim();
+	ASSERT_EQ(stash.size(), 5u);
+	for(int i : {0, 1, 3, 5, 6})
+		ASSERT_EQ(stash[slots[i]].tag, i);
+
+	// the lowest free places get used first
+	Sector sector;
+	ASSERT_EQ(stash.put(std::move(sector)), slots[2]);
+	ASSERT_EQ(stash.put(std::move(sector)), slots[4]);
+	ASSERT_EQ(stash.put(std::move(sector)), 7);
+}
+
+TEST(ObjectStash, UndoKeepsDeletedObjects)
+{
+	Instance inst;
+	Document &doc = inst.level;
+
+	for(int i = 0; i < 4; ++i)
+	{
+		Vertex *vertex = doc.vertices.append();
+		vertex->raw_x = FFixedPoint(i * 64);
+	}
+	for(int i = 0; i < 3; ++i)
+	{
+		LineDef *line = doc.linedefs.append();
+		line->start = i;
+		line->end = i + 1;
+		line->tag = 10 + i;
+	}
+
+	{
+		EditOperation op(doc.basis);
+		// also deletes the linedefs on it
+		op.del(ObjType::vertices, 1);
+	}
+	ASSERT_EQ(doc.numVertices(), 3);
+	ASSERT_EQ(doc.numLinedefs(), 1);
+	ASSERT_EQ(doc.linedefs[0]->start, 1);
+
+	ASSERT_TRUE(doc.basis.undo());
+	ASSERT_EQ(doc.numVertices(), 4);
+	ASSERT_EQ(doc.numLinedefs(), 3);
+	for(int i = 0; i < 3; ++i)
+	{
+		ASSERT_EQ(doc.linedefs[i]->start, i);
+		ASSERT_EQ(doc.linedefs[i]->tag, 10 + i);
+		ASSERT_EQ(doc.vertices[i]->raw_x, FFixedPoint(i * 64));
+	}
+
+	ASSERT_TRUE(doc.basis.redo());
+	ASSERT_EQ(doc.numLinedefs(), 1);
+	ASSERT_EQ(doc.linedefs[0]->tag, 12);
+
+	// a new edit drops the redo steps with the objects they kept
+	ASSERT_TRUE(doc.basis.undo());
+	{
+		EditOperation op(doc.basis);
+		int added = op.addNew(ObjType::sectors);
+		doc.sectors[added]->tag = 3001;
+	}
+	ASSERT_EQ(doc.numSectors(), 1);
+	ASSERT_TRUE(doc.basis.undo());
+	ASSERT_EQ(doc.numSectors(), 0);
+	ASSERT_TRUE(doc.basis.redo());
+	ASSERT_EQ(doc.sectors[0]->tag, 3001);
+}
@@ -0,0 +1,109 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+#include "gtest/gtest.h"
+
+#include <stdexcept>
+
+static void spawnTree(TaskGroup &group, std::atomic<int> &count, int depth)
+{
+	++count;
+	if(depth == 0)
+		return;
+	for(int i = 0; i < 2; ++i)
+		group.run([&group, &count, depth]()
+		{
+			spawnTree(group, count, depth - 1);
+		});
+}
+
+TEST(ThreadPool, RunsEverything)
+{
+	for(int threads : { 0, 1, 4 })
+	{
+		ThreadPool pool(threads);
+		ASSERT_EQ(pool.numThreads(), threads);
+
+		std::atomic<int> count = 0;
+		TaskGroup group(pool);
+		for(int i = 0; i < 1000; ++i)
+			group.run([&count]()
+			{
+				++count;
+			});
+		group.wait();
+		ASSERT_EQ(count.load(), 1000);
+	}
+}
+
+TEST(ThreadPool, NestedTasks)
+{
+	// tasks queueing more tasks of the same group
+	for(int threads : { 0, 3 })
+	{
+		ThreadPool pool(threads);
+		std::atomic<int> count = 0;
+		TaskGroup group(pool);
+		group.run([&group, &count]()
+		{
+			spawnTree(group, count, 10);
+		});
+		group.wait();
+		ASSERT_EQ(count.load(), (1 << 11) - 1);
+	}
+}
+
+TEST(ThreadPool, ExceptionReachesWaiter)
+{
+	ThreadPool pool(2);
+	std::atomic<int> count = 0;
+	TaskGroup group(pool);
+	group.run([]()
+	{
+		throw std::runtime_error("task failed");
+	});
+	group.run([&count]()
+	{
+		++count;
+	});
+
+	ASSERT_THROW(group.wait(), std::runtime_error);
+	ASSERT_TRUE(group.failed());
+	ASSERT_LE(count.load(), 1);
+
+	// the group is done by now, so waiting again just returns
+	group.wait();
+}
+
+TEST(ThreadPool, SharedPool)
+{
+	ThreadPool &pool = ThreadPool::shared();
+	ASSERT_EQ(&pool, &ThreadPool::shared());
+	ASSERT_EQ(pool.numThreads(), ThreadPool::hardwareThreads() - 1);
+
+	std::atomic<int> count = 0;
+	TaskGroup group(pool);
+	for(int i = 0; i < 100; ++i)
+		group.run([&count]()
+		{
+			++count;
+		});
+	group.wait();
+	ASSERT_EQ(count.load(), 100);
+}
@@ -0,0 +1,262 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "bsp.h"
+#include "Instance.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+#include "gtest/gtest.h"
+
+#include <climits>
+#include <random>
+#include <set>
+
+namespace
+{
+
+//
+// Rooms with slanted walls, scattered over a grid
+//
+class BspBlockmapTest : public ::testing::Test
+{
+protected:
+	void makeRooms(unsigned seed);
+	std::vector<byte> buildBlockmap(nodebuildinfo_t &info);
+
+	std::vector<int> expectedList(int minx, int miny) const;
+
+	Instance inst;
+};
+
+void BspBlockmapTest::makeRooms(unsigned seed)
+{
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<int> jitter(0, 90);
+
+	const int slot = 400;
+	const int left = -1203;
+	const int bottom = 517;
+
+	for(int row = 0; row < 6; ++row)
+		for(int col = 0; col < 6; ++col)
+		{
+			if(random() % 4 == 0)
+				continue;
+
+			int sec = inst.level.numSectors();
+			Sector *sector = inst.level.sectors.append();
+			sector->ceilh = 128;
+
+			int x = left + col * slot;
+			int y = bottom + row * slot;
+
+			// clockwise, so the right sides face inwards
+			int corners[4][2] =
+			{
+				{ x + jitter(random), y + jitter(random) },
+				{ x + jitter(random), y + 300 - jitter(random) },
+				{ x + 300 - jitter(random), y + 300 - jitter(random) },
+				{ x + 300 - jitter(random), y + jitter(random) },
+			};
+
+			int first = inst.level.numVertices();
+
+			for(const auto &c : corners)
+			{
+				Vertex *vertex = inst.level.vertices.append();
+				vertex->raw_x = FFixedPoint(c[0]);
+				vertex->raw_y = FFixedPoint(c[1]);
+			}
+
+			for(int k = 0; k < 4; ++k)
+			{
+				SideDef *side = inst.level.sidedefs.append();
+				side->sector = sec;
+
+				LineDef *line = inst.level.linedefs.append();
+				line->start = first + k;
+				line->end = first + (k + 1) % 4;
+				line->right = inst.level.numSidedefs() - 1;
+				line->flags = MLF_Blocking;
+			}
+		}
+}
+
+std::vector<byte> BspBlockmapTest::buildBlockmap(nodebuildinfo_t &info)
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+	wad->AddLevel("MAP01");
+	for(const char *name : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" })
+		wad->AddLump(name);
+
+	ajbsp::LevelData lev_data(MapFormat::doom, *wad, inst.level, inst.conf, nullptr);
+	EXPECT_EQ(lev_data.BuildLevel(&info, 0), BUILD_OK);
+
+	for(int i = 0; i < wad->NumLumps(); ++i)
+		if(wad->GetLump(i)->Name() == "BLOCKMAP")
+			return wad->GetLump(i)->getData();
+	return {};
+}
+
+//
+// The lines in the block, found the slow way
+//
+std::vector<int> BspBlockmapTest::expectedList(int minx, int miny) const
+{
+	std::vector<int> list;
+	for(int i = 0; i < inst.level.numLinedefs(); ++i)
+	{
+		const LineDef &line = *inst.level.linedefs[i];
+		const Vertex &a = *inst.level.vertices[line.start];
+		const Vertex &b = *inst.level.vertices[line.end];
+
+		if(ajbsp::CheckLinedefInsideBox(minx, miny, minx + 127, miny + 127,
+				(int)a.x(), (int)a.y(), (int)b.x(), (int)b.y()))
+		{
+			list.push_back(i);
+		}
+	}
+	return list;
+}
+
+} // namespace
+
+TEST_F(BspBlockmapTest, ListsMatchTheLines)
+{
+	makeRooms(99);
+
+	nodebuildinfo_t info;
+	info.blockmap_search = true;
+	std::vector<byte> lump = buildBlockmap(info);
+	ASSERT_GE(lump.size(), 8u);
+
+	auto word = [&lump](size_t index)
+	{
+		return (uint16_t)(lump[index * 2] | (lump[index * 2 + 1] << 8));
+	};
+
+	int x_origin = (int16_t)word(0);
+	int y_origin = (int16_t)word(1);
+	int width = word(2);
+	int height = word(3);
+
+	// the origin is moved back from the corner by whole steps
+	int minx = INT_MAX, miny = INT_MAX, maxx = INT_MIN, maxy = INT_MIN;
+	for(const auto &vertex : inst.level.vertices)
+	{
+		minx = std::min(minx, (int)vertex->x());
+		miny = std::min(miny, (int)vertex->y());
+		maxx = std::max(maxx, (int)vertex->x());
+		maxy = std::max(maxy, (int)vertex->y());
+	}
+	int base_x = minx - (minx & 7);
+	int base_y = miny - (miny & 7);
+
+	ASSERT_LE(x_origin, base_x);
+	ASSERT_LE(y_origin, base_y);
+	ASSERT_LT(base_x - x_origin, 128);
+	ASSERT_LT(base_y - y_origin, 128);
+	ASSERT_EQ((base_x - x_origin) % 8, 0);
+	ASSERT_EQ((base_y - y_origin) % 8, 0);
+
+	ASSERT_EQ(width, (maxx - x_origin) / 128 + 1);
+	ASSERT_EQ(height, (maxy - y_origin) / 128 + 1);
+
+	std::set<size_t> lists;
+
+	for(int by = 0; by < height; ++by)
+		for(int bx = 0; bx < width; ++bx)
+		{
+			size_t ptr = word(4 + by * width + bx);
+			ASSERT_LT(ptr * 2 + 2, lump.size());
+			ASSERT_EQ(word(ptr), 0);
+
+			std::vector<int> list;
+			for(size_t p = ptr + 1; word(p) != 0xFFFF; ++p)
+			{
+				list.push_back(word(p));
+				ASSERT_LT((p + 1) * 2, lump.size());
+			}
+
+			ASSERT_EQ(list, expectedList(x_origin + bx * 128, y_origin + by * 128))
+					<< "block " << bx << "," << by;
+
+			lists.insert(ptr);
+		}
+
+	// identical lists are stored once, and nothing else is stored
+	size_t used = 4 + width * height;
+	for(size_t ptr : lists)
+	{
+		size_t end = ptr + 1;
+		while(word(end) != 0xFFFF)
+			++end;
+		used += end + 1 - ptr;
+	}
+	ASSERT_EQ(used * 2, lump.size());
+
+	// no bigger than the blockmap at the corner
+	std::set<std::vector<int>> corner_lists;
+	int corner_w = (maxx - base_x) / 128 + 1;
+	int corner_h = (maxy - base_y) / 128 + 1;
+	size_t corner_size = 4 + corner_w * corner_h + 2;
+	for(int by = 0; by < corner_h; ++by)
+		for(int bx = 0; bx < corner_w; ++bx)
+		{
+			std::vector<int> list = expectedList(base_x + bx * 128, base_y + by * 128);
+			if(!list.empty() && corner_lists.insert(list).second)
+				corner_size += list.size() + 2;
+		}
+	ASSERT_LE(lump.size(), corner_size * 2);
+}
+
+TEST_F(BspBlockmapTest, SameWithThreads)
+{
+	makeRooms(7);
+
+	nodebuildinfo_t serial;
+	serial.jobs = 1;
+	serial.blockmap_search = true;
+	std::vector<byte> lump = buildBlockmap(serial);
+	ASSERT_FALSE(lump.empty());
+
+	nodebuildinfo_t threaded;
+	threaded.jobs = 4;
+	threaded.blockmap_search = true;
+	ASSERT_EQ(buildBlockmap(threaded), lump);
+}
+
+TEST_F(BspBlockmapTest, OriginAtTheCorner)
+{
+	makeRooms(99);
+
+	nodebuildinfo_t info;
+	std::vector<byte> lump = buildBlockmap(info);
+	ASSERT_GE(lump.size(), 8u);
+
+	int minx = INT_MAX, miny = INT_MAX;
+	for(const auto &vertex : inst.level.vertices)
+	{
+		minx = std::min(minx, (int)vertex->x());
+		miny = std::min(miny, (int)vertex->y());
+	}
+
+	// without the search the origin stays just below the corner
+	ASSERT_EQ((int16_t)(lump[0] | (lump[1] << 8)), minx - (minx & 7));
+	ASSERT_EQ((int16_t)(lump[2] | (lump[3] << 8)), miny - (miny & 7));
+}
@@ -0,0 +1,502 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+//
+// Benchmark of the whole node builder: builds a fixed corpus of generated
+// maps and writes what each build took and made as JSON, so the results
+// before and after a change can be compared on the same machine.  Not
+// part of the test run; start it by hand:
+//
+//   bsp_build_bench [--jobs N] [--fast] [--budget N] [--factor N]
+//                   [--compressed] [--repeat N] [--only MAP] [-o results.json]
+//
+// With --repeat, the fastest of the runs of each map is kept.  With
+// --compressed, the maps in the classic format get compressed ZDoom nodes.
+//
+
+#include "bsp.h"
+#include "Instance.h"
+#include "sys_debug.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace ajbsp;
+
+namespace
+{
+
+//
+// Makes a map out of polygons.  Each edge is a linedef, and an edge of
+// a polygon which another polygon already has (the other way around)
+// becomes the left side of that linedef.
+//
+class map_maker_c
+{
+public:
+	explicit map_maker_c(Document &doc) : doc(doc)
+	{
+	}
+
+	int addSector(int floorh, int ceilh)
+	{
+		Sector *sector = doc.sectors.append();
+		sector->floorh = floorh;
+		sector->ceilh = ceilh;
+		return doc.numSectors() - 1;
+	}
+
+	// the inside of the polygon is the sector
+	void addPolygon(std::vector<std::pair<int, int>> points, int sector)
+	{
+		if(area(points) > 0)
+			std::reverse(points.begin(), points.end());
+		addEdges(points, sector);
+	}
+
+	// the outside of the polygon is the sector, which nothing fills
+	void addHole(std::vector<std::pair<int, int>> points, int sector)
+	{
+		if(area(points) < 0)
+			std::reverse(points.begin(), points.end());
+		addEdges(points, sector);
+	}
+
+private:
+	static double area(const std::vector<std::pair<int, int>> &points)
+	{
+		double sum = 0;
+		for(size_t i = 0; i < points.size(); ++i)
+		{
+			const auto &a = points[i];
+			const auto &b = points[(i + 1) % points.size()];
+			sum += (double)a.first * b.second - (double)b.first * a.second;
+		}
+		return sum / 2;
+	}
+
+	int vertex(const std::pair<int, int> &point)
+	{
+		auto found = vertices.find(point);
+		if(found != vertices.end())
+			return found->second;
+
+		Vertex *vertex = doc.vertices.append();
+		vertex->raw_x = FFixedPoint(point.first);
+		vertex->raw_y = FFixedPoint(point.second);
+		return vertices[point] = doc.numVertices() - 1;
+	}
+
+	int side(int sector)
+	{
+		SideDef *side = doc.sidedefs.append();
+		side->sector = sector;
+		return doc.numSidedefs() - 1;
+	}
+
+	// clockwise edges have the sector on the right
+	void addEdges(const std::vector<std::pair<int, int>> &points, int sector)
+	{
+		for(size_t i = 0; i < points.size(); ++i)
+		{
+			int v1 = vertex(points[i]);
+			int v2 = vertex(points[(i + 1) % points.size()]);
+			if(v1 == v2)
+				continue;
+
+			auto other = lines.find({ v2, v1 });
+			if(other != lines.end())
+			{
+				LineDef &line = *doc.linedefs[other->second];
+				line.left = side(sector);
+				line.flags = MLF_TwoSided;
+				continue;
+			}
+
+			LineDef *line = doc.linedefs.append();
+			line->start = v1;
+			line->end = v2;
+			line->right = side(sector);
+			line->flags = MLF_Blocking;
+			lines[{ v1, v2 }] = doc.numLinedefs() - 1;
+		}
+	}
+
+	Document &doc;
+	std::map<std::pair<int, int>, int> vertices;
+	std::map<std::pair<int, int>, int> lines;
+};
+
+std::vector<std::pair<int, int>> regularPolygon(int cx, int cy, double radius, int sides,
+		double turn = 0)
+{
+	std::vector<std::pair<int, int>> points;
+	for(int i = 0; i < sides; ++i)
+	{
+		double angle = turn + 2 * M_PI * i / sides;
+		points.emplace_back(cx + (int)lround(radius * cos(angle)),
+				cy + (int)lround(radius * sin(angle)));
+	}
+	return points;
+}
+
+//
+// Square rooms with corridors to their neighbours, some with a pillar
+//
+void makeRooms(Document &doc, std::mt19937 &random)
+{
+	map_maker_c maker(doc);
+
+	const int count = 24;
+	const int size = 256;
+	const int gap = 64;
+	const int step = size + gap;
+
+	std::vector<int> rooms;
+	for(int i = 0; i < count * count; ++i)
+		rooms.push_back(maker.addSector((int)(random() % 5) * 8, 128 + (int)(random() % 4) * 16));
+
+	for(int j = 0; j < count; ++j)
+		for(int i = 0; i < count; ++i)
+		{
+			int x = i * step;
+			int y = j * step;
+			int lo = size / 2 - 32;
+			int hi = size / 2 + 32;
+
+			// with the corners of the corridors on its sides
+			std::vector<std::pair<int, int>> points;
+			points.emplace_back(x, y);
+			if(i > 0)
+			{
+				points.emplace_back(x, y + lo);
+				points.emplace_back(x, y + hi);
+			}
+			points.emplace_back(x, y + size);
+			if(j < count - 1)
+			{
+				points.emplace_back(x + lo, y + size);
+				points.emplace_back(x + hi, y + size);
+			}
+			points.emplace_back(x + size, y + size);
+			if(i < count - 1)
+			{
+				points.emplace_back(x + size, y + hi);
+				points.emplace_back(x + size, y + lo);
+			}
+			points.emplace_back(x + size, y);
+			if(j > 0)
+			{
+				points.emplace_back(x + hi, y);
+				points.emplace_back(x + lo, y);
+			}
+
+			int room = rooms[j * count + i];
+			maker.addPolygon(points, room);
+
+			if(random() % 2)
+				maker.addHole(regularPolygon(x + size / 2, y + size / 2, 24 + random() % 24,
+						4 + random() % 5, (random() % 90) * M_PI / 180), room);
+
+			int corridor_h = 104;
+			if(i < count - 1)
+				maker.addPolygon({ { x + size, y + lo }, { x + size, y + hi },
+						{ x + step, y + hi }, { x + step, y + lo } },
+						maker.addSector(0, corridor_h));
+			if(j < count - 1)
+				maker.addPolygon({ { x + lo, y + size }, { x + hi, y + size },
+						{ x + hi, y + step }, { x + lo, y + step } },
+						maker.addSector(0, corridor_h));
+		}
+}
+
+//
+// A corridor winding out from the middle, one sector for each step
+//
+void makeSpiral(Document &doc, std::mt19937 &random)
+{
+	map_maker_c maker(doc);
+
+	const int steps = 1500;
+	const double width = 128;
+
+	auto point = [](double angle, double radius)
+	{
+		return std::make_pair((int)lround(radius * cos(angle)), (int)lround(radius * sin(angle)));
+	};
+
+	for(int k = 0; k < steps; ++k)
+	{
+		double a1 = 0.05 * k;
+		double a2 = 0.05 * (k + 1);
+		double r1 = 96 + 48 * a1;
+		double r2 = 96 + 48 * a2;
+
+		maker.addPolygon({ point(a1, r1), point(a1, r1 + width), point(a2, r2 + width),
+				point(a2, r2) }, maker.addSector((int)(random() % 3) * 8, 128));
+	}
+}
+
+//
+// A big hall full of pillars and raised platforms
+//
+void makeDetail(Document &doc, std::mt19937 &random)
+{
+	map_maker_c maker(doc);
+
+	const int count = 40;
+	const int step = 128;
+	const int size = count * step;
+
+	int hall = maker.addSector(0, 256);
+	maker.addPolygon({ { 0, 0 }, { 0, size }, { size, size }, { size, 0 } }, hall);
+
+	for(int j = 0; j < count; ++j)
+		for(int i = 0; i < count; ++i)
+		{
+			int cx = i * step + step / 2 + (int)(random() % 33) - 16;
+			int cy = j * step + step / 2 + (int)(random() % 33) - 16;
+			auto points = regularPolygon(cx, cy, 16 + random() % 24, 5 + random() % 8,
+					(random() % 360) * M_PI / 180);
+
+			switch(random() % 3)
+			{
+			case 0:
+				maker.addHole(points, hall);
+				break;
+			case 1:
+				maker.addPolygon(points, maker.addSector(8 + (int)(random() % 4) * 8, 256));
+				break;
+			default:
+				// an empty space
+				break;
+			}
+		}
+}
+
+//
+// A UDMF map with 64k vertices: round rooms with very detailed walls
+//
+void makeStress(Document &doc, std::mt19937 &random)
+{
+	map_maker_c maker(doc);
+
+	const int count = 16;
+	const int step = 1024;
+
+	for(int j = 0; j < count; ++j)
+		for(int i = 0; i < count; ++i)
+		{
+			std::vector<std::pair<int, int>> points;
+			for(int k = 0; k < 256; ++k)
+			{
+				double angle = 2 * M_PI * k / 256;
+				double radius = 400 + (int)(random() % 64);
+				points.emplace_back(i * step + (int)lround(radius * cos(angle)),
+						j * step + (int)lround(radius * sin(angle)));
+			}
+			maker.addPolygon(points, maker.addSector(0, 128));
+		}
+}
+
+struct bench_map_t
+{
+	const char *name;
+	MapFormat format;
+	void (*make)(Document &doc, std::mt19937 &random);
+};
+
+const bench_map_t corpus[] =
+{
+	{ "rooms",  MapFormat::doom, makeRooms  },
+	{ "spiral", MapFormat::doom, makeSpiral },
+	{ "detail", MapFormat::doom, makeDetail },
+	{ "stress", MapFormat::udmf, makeStress },
+};
+
+long maxResidentKB()
+{
+#ifndef WIN32
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef __APPLE__
+		return usage.ru_maxrss / 1024;
+#else
+		return usage.ru_maxrss;
+#endif
+	}
+#endif
+	return -1;
+}
+
+const char *resultName(build_result_e ret)
+{
+	switch(ret)
+	{
+	case BUILD_OK:           return "ok";
+	case BUILD_Cancelled:    return "cancelled";
+	case BUILD_BadFile:      return "bad file";
+	case BUILD_LumpOverflow: return "overflow";
+	}
+	return "?";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	nodebuildinfo_t options;
+	int repeat = 1;
+	const char *only = nullptr;
+	const char *output = nullptr;
+
+	for(int i = 1; i < argc; ++i)
+	{
+		bool has_value = i + 1 < argc;
+
+		if(!strcmp(argv[i], "--jobs") && has_value)
+			options.jobs = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--fast"))
+			options.fast = true;
+		else if(!strcmp(argv[i], "--budget") && has_value)
+			options.pick_budget = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--factor") && has_value)
+			options.factor = atoi(argv[++i]);
+		else if(!strcmp(argv[i], "--compressed"))
+			options.force_xnod = options.force_compress = true;
+		else if(!strcmp(argv[i], "--repeat") && has_value)
+			repeat = std::max(1, atoi(argv[++i]));
+		else if(!strcmp(argv[i], "--only") && has_value)
+			only = argv[++i];
+		else if(!strcmp(argv[i], "-o") && has_value)
+			output = argv[++i];
+		else
+		{
+			fprintf(stderr, "usage: bsp_build_bench [--jobs N] [--fast] [--budget N] [--factor N] "
+					"[--compressed] [--repeat N] [--only MAP] [-o results.json]\n");
+			return 2;
+		}
+	}
+
+	// only the results go to stdout
+	global::Quiet = true;
+
+	FILE *out = output ? fopen(output, "w") : stdout;
+	if(!out)
+	{
+		fprintf(stderr, "cannot create %s\n", output);
+		return 2;
+	}
+
+	fprintf(out, "{\n  \"kernel\": \"%s\",\n  \"jobs\": %d,\n  \"fast\": %s,\n  \"budget\": %d,\n"
+			"  \"factor\": %d,\n  \"compressed\": %s,\n  \"maps\": [", SegKernelName(SegKernelInUse()),
+			options.jobs, options.fast ? "true" : "false", options.pick_budget, options.factor,
+			options.force_compress ? "true" : "false");
+
+	bool first = true;
+
+	for(const bench_map_t &map : corpus)
+	{
+		if(only && strcmp(only, map.name) != 0)
+			continue;
+
+		Instance inst;
+		std::mt19937 random(1234);
+		map.make(inst.level, random);
+
+		build_stats_t best;
+		build_result_e ret = BUILD_OK;
+
+		for(int run = 0; run < repeat; ++run)
+		{
+			std::shared_ptr<Wad_file> wad = Wad_file::Open("bench.wad", WadOpenMode::write);
+			wad->AddLevel("MAP01");
+			if(map.format == MapFormat::udmf)
+			{
+				wad->AddLump("TEXTMAP");
+				wad->AddLump("ENDMAP");
+			}
+			else
+			{
+				for(const char *name : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+						"SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP" })
+				{
+					wad->AddLump(name);
+				}
+			}
+
+			nodebuildinfo_t info;
+			info.CopyOptions(options);
+
+			LevelData lev_data(map.format, *wad, inst.level, inst.conf, nullptr);
+			ret = lev_data.BuildLevel(&info, 0);
+
+			if(run == 0 || info.stats.time < best.time)
+				best = info.stats;
+		}
+
+		fprintf(stderr, "%-8s %8.3fs  %6d segs  %6d splits  height %d\n", map.name, best.time,
+				best.segs, best.splits, best.height);
+
+		fprintf(out, "%s\n    {\n", first ? "" : ",");
+		fprintf(out, "      \"name\": \"%s\",\n", map.name);
+		fprintf(out, "      \"format\": \"%s\",\n", map.format == MapFormat::udmf ? "udmf" : "doom");
+		fprintf(out, "      \"result\": \"%s\",\n", resultName(ret));
+		fprintf(out, "      \"vertices\": %d,\n", inst.level.numVertices());
+		fprintf(out, "      \"linedefs\": %d,\n", inst.level.numLinedefs());
+		fprintf(out, "      \"sectors\": %d,\n", inst.level.numSectors());
+		fprintf(out, "      \"time\": { ");
+		for(int p = 0; p < NUM_BUILD_PHASES; ++p)
+			fprintf(out, "\"%s\": %.6f, ", BuildPhaseName((build_phase_e)p), best.phase_time[p]);
+		fprintf(out, "\"total\": %.6f },\n", best.time);
+		fprintf(out, "      \"memory_kb\": { \"builder\": %zu, \"max_resident\": %ld },\n",
+				best.memory / 1024, maxResidentKB());
+		fprintf(out, "      \"partitions\": %lld,\n", (long long)best.partitions);
+		fprintf(out, "      \"splits\": %d,\n", best.splits);
+		fprintf(out, "      \"minisegs\": %d,\n", best.minisegs);
+		fprintf(out, "      \"quadtrees\": %lld,\n", (long long)best.quadtrees);
+		fprintf(out, "      \"compressed\": { \"in\": %zu, \"out\": %zu, \"blocks\": %d, \"time\": %.6f },\n",
+				best.compress_in, best.compress_out, best.compress_blocks, best.compress_time);
+		fprintf(out, "      \"height\": %d,\n", best.height);
+		fprintf(out, "      \"segs\": %d,\n", best.segs);
+		fprintf(out, "      \"subsectors\": %d,\n", best.subsecs);
+		fprintf(out, "      \"nodes\": %d\n", best.nodes);
+		fprintf(out, "    }");
+
+		first = false;
+	}
+
+	fprintf(out, "\n  ]\n}\n");
+
+	if(output)
+		fclose(out);
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+//
+// Microbenchmark of the seg classifier: times each implementation this
+// machine supports on blocks of the sizes a quadtree node holds, against
+// many partition lines.  Not part of the test run; start it by hand:
+//
+//   bsp_kernel_bench [iterations]
+//
+
+#include "bsp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+using namespace ajbsp;
+
+int main(int argc, char **argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<double> coord(-4096, 4096);
+	std::uniform_real_distribution<double> delta(-256, 256);
+
+	// a real quadtree leaf is at most 320 units square
+	seg_block_t block;
+	for(int i = 0; i < 4096; ++i)
+	{
+		double x = coord(random), y = coord(random);
+		block.Add(nullptr, x, y, x + delta(random), y + delta(random), i, i % 4 != 0);
+	}
+
+	std::vector<partition_line_t> parts;
+	for(int i = 0; i < 256; ++i)
+	{
+		double x1 = coord(random), y1 = coord(random);
+		double dx = delta(random), dy = delta(random);
+		double len = hypot(dx, dy);
+		if(len < 1)
+			continue;
+		parts.push_back({ dx, dy, x1 * -dy + y1 * dx, len, -1 });
+	}
+
+	printf("classifier in use: %s\n\n", SegKernelName(SegKernelInUse()));
+	printf("%-8s %6s %12s %10s\n", "kernel", "block", "ns/block", "ns/seg");
+
+	for(seg_kernel_e kernel : { seg_kernel_e::scalar, seg_kernel_e::sse2, seg_kernel_e::avx2 })
+	{
+		if(!SegKernelSupported(kernel))
+			continue;
+
+		for(int size : { 4, 8, 16, 32, 64 })
+		{
+			double a[SEG_KERNEL_BATCH], b[SEG_KERNEL_BATCH];
+			uint64_t right, left;
+			uint64_t check = 0;
+
+			auto start = std::chrono::steady_clock::now();
+
+			for(int it = 0; it < iterations; ++it)
+			{
+				const partition_line_t &part = parts[it % parts.size()];
+				int first = (it * 61) % (block.Size() - size);
+
+				ClassifySegs(kernel, block, first, size, part, a, b, &right, &left);
+				check += right ^ left;
+			}
+
+			double ns = std::chrono::duration<double, std::nano>(
+					std::chrono::steady_clock::now() - start).count();
+
+			printf("%-8s %6d %12.1f %10.2f   (%llx)\n", SegKernelName(kernel), size,
+					ns / iterations, ns / iterations / size, (unsigned long long)(check & 0xFFFF));
+		}
+	}
+
+	return 0;
+}
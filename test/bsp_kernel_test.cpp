@@ -0,0 +1,222 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "bsp.h"
+#include "gtest/gtest.h"
+
+#include <cstring>
+#include <random>
+
+using namespace ajbsp;
+
+namespace
+{
+
+//
+// A seg from (x1,y1) to (x2,y2), with the precomputed fields filled in
+//
+struct TestSeg
+{
+	vertex_t start = {};
+	vertex_t end = {};
+	seg_t seg = {};
+
+	TestSeg(double x1, double y1, double x2, double y2, int source_line)
+	{
+		start.x = x1;
+		start.y = y1;
+		end.x = x2;
+		end.y = y2;
+		seg.start = &start;
+		seg.end = &end;
+		seg.linedef = source_line % 3 ? source_line : -1;
+		seg.source_line = source_line;
+		seg.Recompute();
+	}
+
+	partition_line_t line() const
+	{
+		return { seg.pdx, seg.pdy, seg.p_perp, seg.p_length, seg.source_line };
+	}
+};
+
+//
+// Random segs, some of them on or close to the partition line, and a
+// few from its own linedef
+//
+void makeBlock(std::mt19937 &random, const TestSeg &part, int size,
+		std::vector<std::unique_ptr<TestSeg>> &segs, seg_block_t &block)
+{
+	std::uniform_real_distribution<double> coord(-2000, 2000);
+	std::uniform_int_distribution<int> kind(0, 5);
+	std::uniform_real_distribution<double> along(-3, 3);
+	std::uniform_int_distribution<int> offset(-6, 6);
+
+	segs.clear();
+	block.Clear();
+
+	for(int i = 0; i < size; ++i)
+	{
+		double x1 = coord(random), y1 = coord(random);
+		double x2 = coord(random), y2 = coord(random);
+		int line = 10 + i;
+
+		switch(kind(random))
+		{
+		case 0:	// on the partition (or its own linedef)
+			x1 = part.start.x + along(random) * part.seg.pdx;
+			y1 = part.start.y + along(random) * part.seg.pdy;
+			x2 = part.start.x + along(random) * part.seg.pdx;
+			y2 = part.start.y + along(random) * part.seg.pdy;
+			if(i % 2)
+				line = part.seg.source_line;
+			break;
+		case 1:	// parallel, a few units off it
+		{
+			double len = part.seg.p_length;
+			double nx = part.seg.pdy / len, ny = -part.seg.pdx / len;
+			int dist = offset(random);
+			x1 = part.start.x + along(random) * part.seg.pdx + dist * nx;
+			y1 = part.start.y + along(random) * part.seg.pdy + dist * ny;
+			x2 = part.start.x + along(random) * part.seg.pdx + dist * nx;
+			y2 = part.start.y + along(random) * part.seg.pdy + dist * ny;
+			break;
+		}
+		default:
+			break;
+		}
+
+		segs.push_back(std::make_unique<TestSeg>(x1, y1, x2, y2, line));
+		const seg_t &seg = segs.back()->seg;
+		block.Add(&segs.back()->seg, seg.psx, seg.psy, seg.pex, seg.pey,
+				seg.source_line, seg.linedef >= 0);
+	}
+}
+
+} // namespace
+
+TEST(BspKernel, VectorMatchesScalar)
+{
+	std::mt19937 random(1234);
+	std::uniform_int_distribution<int> coord(-2000, 2000);
+
+	std::vector<std::unique_ptr<TestSeg>> segs;
+	seg_block_t block;
+
+	int checked = 0;
+
+	for(int round = 0; round < 200; ++round)
+	{
+		TestSeg part(coord(random), coord(random), coord(random), coord(random), 5);
+		if(part.seg.p_length < 1)
+			continue;
+
+		makeBlock(random, part, 150, segs, block);
+
+		for(seg_kernel_e kernel : { seg_kernel_e::sse2, seg_kernel_e::avx2 })
+		{
+			if(!SegKernelSupported(kernel))
+				continue;
+
+			for(int first : { 0, 1, 3, 64, 85 })
+				for(int count : { 0, 1, 2, 3, 5, 17, 63, 64 })
+				{
+					double a1[SEG_KERNEL_BATCH], b1[SEG_KERNEL_BATCH];
+					double a2[SEG_KERNEL_BATCH], b2[SEG_KERNEL_BATCH];
+					uint64_t right1, left1, right2, left2;
+
+					ClassifySegs(seg_kernel_e::scalar, block, first, count, part.line(),
+							a1, b1, &right1, &left1);
+					ClassifySegs(kernel, block, first, count, part.line(),
+							a2, b2, &right2, &left2);
+
+					ASSERT_EQ(right1, right2) << SegKernelName(kernel);
+					ASSERT_EQ(left1, left2) << SegKernelName(kernel);
+					ASSERT_EQ(memcmp(a1, a2, count * sizeof(double)), 0) << SegKernelName(kernel);
+					ASSERT_EQ(memcmp(b1, b2, count * sizeof(double)), 0) << SegKernelName(kernel);
+					++checked;
+				}
+		}
+	}
+
+	// nothing to compare against without any vector support
+	if(SegKernelInUse() != seg_kernel_e::scalar)
+	{
+		ASSERT_GT(checked, 0);
+	}
+}
+
+TEST(BspKernel, ScalarMatchesPerpDist)
+{
+	std::mt19937 random(99);
+
+	std::vector<std::unique_ptr<TestSeg>> segs;
+	seg_block_t block;
+
+	TestSeg part(-300, 100, 500, 731, 5);
+	makeBlock(random, part, 64, segs, block);
+
+	double a[SEG_KERNEL_BATCH], b[SEG_KERNEL_BATCH];
+	uint64_t right, left;
+	ClassifySegs(block, 0, 64, part.line(), a, b, &right, &left);
+
+	ASSERT_EQ(right & left, 0);
+
+	for(int k = 0; k < 64; ++k)
+	{
+		const seg_t &seg = segs[k]->seg;
+
+		if(seg.source_line == part.seg.source_line)
+		{
+			ASSERT_EQ(a[k], 0);
+			ASSERT_EQ(b[k], 0);
+			ASSERT_FALSE((right | left) & ((uint64_t)1 << k));
+			continue;
+		}
+
+		ASSERT_EQ(a[k], part.seg.PerpDist(seg.psx, seg.psy));
+		ASSERT_EQ(b[k], part.seg.PerpDist(seg.pex, seg.pey));
+
+		bool clear_right = a[k] >= IFFY_LEN && b[k] >= IFFY_LEN;
+		bool clear_left = a[k] <= -IFFY_LEN && b[k] <= -IFFY_LEN;
+		ASSERT_EQ(!!(right & ((uint64_t)1 << k)), clear_right);
+		ASSERT_EQ(!!(left & ((uint64_t)1 << k)), clear_left);
+	}
+}
+
+TEST(BspKernel, RealBits)
+{
+	seg_block_t block;
+
+	for(int i = 0; i < 200; ++i)
+		block.Add(nullptr, 0, 0, 0, 0, i, i % 3 == 0);
+
+	for(int first : { 0, 5, 63, 64, 100, 136 })
+		for(int count : { 1, 7, 64 })
+		{
+			uint64_t bits = block.RealBits(first, count);
+			for(int k = 0; k < 64; ++k)
+			{
+				bool expected = k < count && (first + k) % 3 == 0;
+				ASSERT_EQ(!!(bits & ((uint64_t)1 << k)), expected) << first << " " << count;
+			}
+		}
+
+	ASSERT_EQ(CountBits(0xF0F0), 8);
+	ASSERT_EQ(FirstBit(0x100), 8);
+}
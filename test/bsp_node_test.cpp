@@ -0,0 +1,744 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "bsp.h"
+#include "Instance.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+
+#include <zlib.h>
+
+namespace
+{
+
+//
+// Makes a grid of square rooms, each with a diamond pillar at an uneven
+// spot, so the node builder has splits and minisegs to deal with.
+//
+class BspNodeTest : public ::testing::Test
+{
+protected:
+	void makeRoomGrid(int size);
+
+	std::vector<std::pair<SString, std::vector<byte>>> build(MapFormat format,
+			nodebuildinfo_t &info);
+
+	void movePillar(int size, int x, int y, int dx, int dy);
+	void checkNodes(const std::vector<std::pair<SString, std::vector<byte>>> &lumps,
+			int size) const;
+
+	Instance inst;
+
+private:
+	int addVertex(int x, int y);
+	void addLine(int v1, int v2, int right_sector, int left_sector);
+	int addSide(int sector);
+};
+
+int BspNodeTest::addVertex(int x, int y)
+{
+	Vertex *vertex = inst.level.vertices.append();
+	vertex->raw_x = FFixedPoint(x);
+	vertex->raw_y = FFixedPoint(y);
+	return inst.level.numVertices() - 1;
+}
+
+int BspNodeTest::addSide(int sector)
+{
+	SideDef *side = inst.level.sidedefs.append();
+	side->sector = sector;
+	return inst.level.numSidedefs() - 1;
+}
+
+void BspNodeTest::addLine(int v1, int v2, int right_sector, int left_sector)
+{
+	if(right_sector < 0)
+	{
+		std::swap(v1, v2);
+		std::swap(right_sector, left_sector);
+	}
+
+	LineDef *line = inst.level.linedefs.append();
+	line->start = v1;
+	line->end = v2;
+	line->right = addSide(right_sector);
+	if(left_sector >= 0)
+	{
+		line->left = addSide(left_sector);
+		line->flags = MLF_TwoSided;
+	}
+	else
+		line->flags = MLF_Blocking;
+}
+
+void BspNodeTest::makeRoomGrid(int size)
+{
+	static const int cell = 256;
+
+	for(int i = 0; i < size * size; ++i)
+	{
+		Sector *sector = inst.level.sectors.append();
+		sector->floorh = 8 * (i % 5);
+		sector->ceilh = 128;
+	}
+
+	auto sectorAt = [size](int x, int y)
+	{
+		return (x < 0 || y < 0 || x >= size || y >= size) ? -1 : y * size + x;
+	};
+
+	for(int y = 0; y <= size; ++y)
+		for(int x = 0; x <= size; ++x)
+			addVertex(x * cell, y * cell);
+
+	for(int y = 0; y <= size; ++y)
+		for(int x = 0; x <= size; ++x)
+		{
+			int v = y * (size + 1) + x;
+			// walking east the right side is south, walking north it is east
+			if(x < size)
+				addLine(v, v + 1, sectorAt(x, y - 1), sectorAt(x, y));
+			if(y < size)
+				addLine(v, v + size + 1, sectorAt(x, y), sectorAt(x - 1, y));
+		}
+
+	for(int y = 0; y < size; ++y)
+		for(int x = 0; x < size; ++x)
+		{
+			int cx = x * cell + 96 + (x * 37 + y * 53) % 64;
+			int cy = y * cell + 96 + (x * 71 + y * 29) % 64;
+			int r = 24 + (x + y) % 3 * 8;
+
+			// anti-clockwise, so the room is on the right
+			int v[4] = { addVertex(cx + r, cy), addVertex(cx, cy + r),
+				addVertex(cx - r, cy), addVertex(cx, cy - r) };
+			for(int k = 0; k < 4; ++k)
+				addLine(v[k], v[(k + 1) % 4], sectorAt(x, y), -1);
+		}
+}
+
+//
+// Builds the nodes in a fresh wad, returning all its lumps
+//
+std::vector<std::pair<SString, std::vector<byte>>> BspNodeTest::build(
+		MapFormat format, nodebuildinfo_t &info)
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+	wad->AddLevel("MAP01");
+	if(format == MapFormat::udmf)
+	{
+		wad->AddLump("TEXTMAP");
+		wad->AddLump("ENDMAP");
+	}
+	else
+	{
+		for(const char *name : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" })
+			wad->AddLump(name);
+	}
+
+	ajbsp::LevelData lev_data(format, *wad, inst.level, inst.conf, nullptr);
+	EXPECT_EQ(lev_data.BuildLevel(&info, 0), BUILD_OK);
+
+	std::vector<std::pair<SString, std::vector<byte>>> result;
+	for(int i = 0; i < wad->NumLumps(); ++i)
+	{
+		const Lump_c *lump = wad->GetLump(i);
+		std::vector<byte> data = lump->getData();
+
+		// the GL marker has the build time, which may differ
+		if(lump->Name().startsWith("GL_"))
+		{
+			std::string text(data.begin(), data.end());
+			size_t pos = text.find("TIME=");
+			if(pos != std::string::npos)
+				text.erase(pos, text.find('\n', pos) + 1 - pos);
+			data.assign(text.begin(), text.end());
+		}
+		result.emplace_back(lump->Name(), data);
+	}
+	return result;
+}
+
+//
+// Moves the pillar of the room in column x, row y
+//
+void BspNodeTest::movePillar(int size, int x, int y, int dx, int dy)
+{
+	int first = (size + 1) * (size + 1) + 4 * (y * size + x);
+	for(int k = 0; k < 4; ++k)
+	{
+		Vertex &vertex = *inst.level.vertices[first + k];
+		vertex.raw_x = FFixedPoint(vertex.x() + dx);
+		vertex.raw_y = FFixedPoint(vertex.y() + dy);
+	}
+}
+
+template<typename T>
+static std::vector<T> lumpItems(const std::vector<std::pair<SString, std::vector<byte>>> &lumps,
+		const char *name)
+{
+	for(const auto &lump : lumps)
+		if(lump.first == name)
+		{
+			std::vector<T> items(lump.second.size() / sizeof(T));
+			memcpy(items.data(), lump.second.data(), items.size() * sizeof(T));
+			return items;
+		}
+	return {};
+}
+
+//
+// Checks the vanilla nodes of a room grid: every subsector is reached
+// once and lies on the proper side of all the partitions above it, the
+// segs cover every sidedef, and points in the rooms lead to a subsector
+// of the right sector.
+//
+void BspNodeTest::checkNodes(const std::vector<std::pair<SString, std::vector<byte>>> &lumps,
+		int size) const
+{
+	auto vertices = lumpItems<raw_vertex_t>(lumps, "VERTEXES");
+	auto segs = lumpItems<raw_seg_t>(lumps, "SEGS");
+	auto subsecs = lumpItems<raw_subsec_t>(lumps, "SSECTORS");
+	auto nodes = lumpItems<raw_node_t>(lumps, "NODES");
+	ASSERT_FALSE(nodes.empty());
+
+	struct Line
+	{
+		double x, y, dx, dy;
+		int side;	// 0 for the right one
+	};
+
+	std::vector<int> reached(subsecs.size());
+	std::vector<double> covered(inst.level.numLinedefs() * 2);
+
+	std::function<void(int, std::vector<Line> &)> walk = [&](int index, std::vector<Line> &above)
+	{
+		if(index & 0x8000)
+		{
+			index &= 0x7FFF;
+			ASSERT_LT(index, (int)subsecs.size());
+			reached[index]++;
+
+			const raw_subsec_t &sub = subsecs[index];
+			ASSERT_LE(sub.first + sub.num, (int)segs.size());
+			for(int i = sub.first; i < sub.first + sub.num; ++i)
+			{
+				const raw_vertex_t &start = vertices[segs[i].start];
+				const raw_vertex_t &end = vertices[segs[i].end];
+
+				// a little slack for rounding the vertices
+				for(const Line &line : above)
+					for(const raw_vertex_t *v : { &start, &end })
+					{
+						double dist = ((v->y - line.y) * line.dx - (v->x - line.x) * line.dy) /
+								hypot(line.dx, line.dy);
+						ASSERT_LT(line.side ? -dist : dist, 2.0);
+					}
+
+				covered[segs[i].linedef * 2 + segs[i].flip] += hypot(end.x - start.x,
+						end.y - start.y);
+			}
+			return;
+		}
+
+		ASSERT_LT(index, (int)nodes.size());
+		const raw_node_t &node = nodes[index];
+		for(int side = 0; side < 2; ++side)
+		{
+			above.push_back({ (double)node.x, (double)node.y, (double)node.dx, (double)node.dy,
+					side });
+			walk(side ? node.left : node.right, above);
+			above.pop_back();
+		}
+	};
+
+	std::vector<Line> above;
+	walk((int)nodes.size() - 1, above);
+
+	for(int count : reached)
+		ASSERT_EQ(count, 1);
+
+	for(int i = 0; i < inst.level.numLinedefs(); ++i)
+	{
+		const LineDef &line = *inst.level.linedefs[i];
+		double length = inst.level.calcLength(line);
+		ASSERT_NEAR(covered[i * 2], length, 2.0) << i;
+		ASSERT_NEAR(covered[i * 2 + 1], line.left >= 0 ? length : 0, 2.0) << i;
+	}
+
+	// near the corners of each room, away from its pillar
+	for(int y = 0; y < size; ++y)
+		for(int x = 0; x < size; ++x)
+			for(int corner : { 20, 236 })
+			{
+				int px = x * 256 + corner, py = y * 256 + corner;
+
+				int index = (int)nodes.size() - 1;
+				while(!(index & 0x8000))
+				{
+					const raw_node_t &node = nodes[index];
+					bool right = (py - node.y) * node.dx <= node.dy * (px - node.x);
+					index = right ? node.right : node.left;
+				}
+
+				const raw_seg_t &seg = segs[subsecs[index & 0x7FFF].first];
+				const LineDef &line = *inst.level.linedefs[seg.linedef];
+				int side = seg.flip ? line.left : line.right;
+				ASSERT_EQ(inst.level.sidedefs[side]->sector, y * size + x) << px << "," << py;
+			}
+}
+
+} // namespace
+
+TEST_F(BspNodeTest, ParallelBuildMatchesSerial)
+{
+	makeRoomGrid(12);
+
+	struct Setup
+	{
+		MapFormat format;
+		bool force_xnod;
+	};
+
+	for(const Setup &setup : { Setup{ MapFormat::doom, false }, Setup{ MapFormat::doom, true },
+		Setup{ MapFormat::udmf, false } })
+	{
+		nodebuildinfo_t serial;
+		serial.force_xnod = setup.force_xnod;
+		auto expected = build(setup.format, serial);
+		ASSERT_GT(expected.size(), 2);
+
+		// as many subtree tasks as possible, threaded partition picking
+		// only, and both; on a few threads or just the caller
+		struct Split
+		{
+			int task_depth;
+			int pick_min_segs;
+		};
+
+		for(const Split &split : { Split{ 1000, INT_MAX }, Split{ 0, 1 }, Split{ 1000, 1 } })
+			for(int jobs : { 4, 0 })
+			{
+				nodebuildinfo_t parallel;
+				parallel.force_xnod = setup.force_xnod;
+				parallel.jobs = jobs;
+				parallel.task_depth = split.task_depth;
+				parallel.task_min_segs = 1;
+				parallel.pick_min_segs = split.pick_min_segs;
+
+				auto lumps = build(setup.format, parallel);
+				ASSERT_EQ(lumps.size(), expected.size());
+				for(size_t i = 0; i < lumps.size(); ++i)
+				{
+					ASSERT_EQ(lumps[i].first, expected[i].first);
+					ASSERT_EQ(lumps[i].second, expected[i].second) << lumps[i].first.c_str();
+				}
+				ASSERT_EQ(parallel.total_warnings, serial.total_warnings);
+			}
+	}
+}
+
+TEST_F(BspNodeTest, SmallRightSidesWaitForTheLeft)
+{
+	// the precious lines give partitions along the two-sided lines, so
+	// the right sides too small for a task have partners of their segs
+	// in the tasks made by the left sides
+	makeRoomGrid(8);
+	for(int i = 0; i < inst.level.numLinedefs(); i += 5)
+		inst.level.linedefs[i]->tag = 950;
+
+	nodebuildinfo_t serial;
+	auto expected = build(MapFormat::doom, serial);
+
+	for(int jobs : { 2, 4, 0 })
+	{
+		nodebuildinfo_t parallel;
+		parallel.jobs = jobs;
+		auto lumps = build(MapFormat::doom, parallel);
+		ASSERT_EQ(lumps.size(), expected.size());
+		for(size_t i = 0; i < lumps.size(); ++i)
+			ASSERT_EQ(lumps[i].second, expected[i].second) << lumps[i].first.c_str() << " with " << jobs;
+	}
+}
+
+TEST_F(BspNodeTest, IncrementalBuild)
+{
+	const int size = 12;
+	makeRoomGrid(size);
+
+	for(int jobs : { 1, 4 })
+	{
+		bsp_history_t history;
+
+		nodebuildinfo_t full;
+		full.jobs = jobs;
+		full.history = &history;
+		checkNodes(build(MapFormat::doom, full), size);
+		ASSERT_FALSE(history.incremental);
+		ASSERT_FALSE(history.nodes.empty());
+
+		// the same again keeps every partition
+		nodebuildinfo_t again;
+		again.jobs = jobs;
+		again.history = &history;
+		auto expected = build(MapFormat::doom, again);
+		ASSERT_TRUE(history.incremental);
+		ASSERT_EQ(history.picked, 0);
+		ASSERT_EQ(history.reused, (int)history.nodes.size());
+		nodebuildinfo_t plain;
+		plain.jobs = jobs;
+		ASSERT_EQ(expected, build(MapFormat::doom, plain));
+
+		// a change in one corner, then in two far apart
+		movePillar(size, 2, 3, 12, -8);
+		nodebuildinfo_t moved;
+		moved.jobs = jobs;
+		moved.history = &history;
+		checkNodes(build(MapFormat::doom, moved), size);
+		ASSERT_TRUE(history.incremental);
+		ASSERT_GT(history.picked, 0);
+		ASSERT_GT(history.reused, history.picked);
+
+		movePillar(size, 0, 0, -16, 16);
+		movePillar(size, 11, 10, 4, 20);
+		nodebuildinfo_t twice;
+		twice.jobs = jobs;
+		twice.history = &history;
+		checkNodes(build(MapFormat::doom, twice), size);
+		ASSERT_TRUE(history.incremental);
+		ASSERT_GT(history.reused, history.picked);
+
+		// back where they were, for the next round
+		movePillar(size, 2, 3, -12, 8);
+		movePillar(size, 0, 0, 16, -16);
+		movePillar(size, 11, 10, -4, -20);
+	}
+}
+
+TEST_F(BspNodeTest, StatsAreCounted)
+{
+	makeRoomGrid(8);
+
+	nodebuildinfo_t serial;
+	serial.force_xnod = true;
+	serial.force_compress = true;
+	build(MapFormat::doom, serial);
+
+	const build_stats_t &stats = serial.stats;
+	ASSERT_GT(stats.partitions, 0);
+	ASSERT_GT(stats.splits, 0);
+	ASSERT_GT(stats.minisegs, 0);
+	ASSERT_GT(stats.quadtrees, 0);
+	ASSERT_GT(stats.compress_in, stats.compress_out);
+	ASSERT_GT(stats.compress_out, 0u);
+
+	double sum = 0;
+	for(double time : stats.phase_time)
+	{
+		ASSERT_GE(time, 0);
+		sum += time;
+	}
+	ASSERT_GT(stats.phase_time[PHASE_Nodes], 0);
+	ASSERT_LE(sum, stats.time);
+
+	// the same tree takes the same work, however it was shared out
+	nodebuildinfo_t parallel;
+	parallel.force_xnod = true;
+	parallel.force_compress = true;
+	parallel.jobs = 4;
+	build(MapFormat::doom, parallel);
+
+	ASSERT_EQ(parallel.stats.splits, stats.splits);
+	ASSERT_EQ(parallel.stats.minisegs, stats.minisegs);
+	ASSERT_EQ(parallel.stats.compress_in, stats.compress_in);
+}
+
+TEST_F(BspNodeTest, BuildsShareTheLevel)
+{
+	makeRoomGrid(8);
+
+	// some precious lines, which the builds must not mark in the level
+	for(int i = 0; i < inst.level.numLinedefs(); i += 5)
+		inst.level.linedefs[i]->tag = 950;
+
+	std::vector<int> flags;
+	for(const auto &line : inst.level.linedefs)
+		flags.push_back(line->flags);
+
+	nodebuildinfo_t serial;
+	auto expected = build(MapFormat::doom, serial);
+
+	// several builds of the same level at once, as in a portfolio
+	std::vector<decltype(expected)> results(4);
+	std::vector<std::thread> threads;
+	for(size_t k = 0; k < results.size(); ++k)
+		threads.emplace_back([this, &results, k]()
+		{
+			nodebuildinfo_t info;
+			info.jobs = 2;
+			results[k] = build(MapFormat::doom, info);
+		});
+	for(std::thread &thread : threads)
+		thread.join();
+
+	for(const auto &result : results)
+		ASSERT_EQ(result, expected);
+
+	for(int i = 0; i < inst.level.numLinedefs(); ++i)
+		ASSERT_EQ(inst.level.linedefs[i]->flags, flags[i]);
+}
+
+TEST_F(BspNodeTest, CompressedNodesInBlocks)
+{
+	makeRoomGrid(24);
+
+	auto nodesLump = [](const std::vector<std::pair<SString, std::vector<byte>>> &lumps)
+	{
+		for(const auto &lump : lumps)
+			if(lump.first == "NODES")
+				return lump.second;
+		return std::vector<byte>();
+	};
+
+	nodebuildinfo_t plain;
+	plain.force_xnod = true;
+	std::vector<byte> expected = nodesLump(build(MapFormat::doom, plain));
+	ASSERT_GT(expected.size(), 4u);
+	ASSERT_EQ(memcmp(expected.data(), "XNOD", 4), 0);
+
+	std::vector<byte> compressed[2];
+	for(int jobs : { 1, 4 })
+	{
+		nodebuildinfo_t info;
+		info.force_xnod = true;
+		info.force_compress = true;
+		info.jobs = jobs;
+
+		std::vector<byte> lump = nodesLump(build(MapFormat::doom, info));
+		ASSERT_GT(lump.size(), 4u);
+		ASSERT_EQ(memcmp(lump.data(), "ZNOD", 4), 0);
+
+		// big enough to take a few blocks, which make one plain zlib stream
+		ASSERT_GT(info.stats.compress_blocks, 1);
+		ASSERT_EQ(info.stats.compress_in, expected.size() - 4);
+
+		std::vector<byte> payload(expected.size() - 4);
+		uLongf length = (uLongf)payload.size();
+		ASSERT_EQ(uncompress(payload.data(), &length, lump.data() + 4, (uLong)lump.size() - 4), Z_OK);
+		ASSERT_EQ(length, payload.size());
+		ASSERT_TRUE(std::equal(payload.begin(), payload.end(), expected.begin() + 4));
+
+		compressed[jobs == 1 ? 0 : 1] = lump;
+	}
+
+	// the same, however many threads did it
+	ASSERT_EQ(compressed[0], compressed[1]);
+}
+
+TEST_F(BspNodeTest, BudgetedSearch)
+{
+	const int size = 12;
+	makeRoomGrid(size);
+
+	nodebuildinfo_t full;
+	checkNodes(build(MapFormat::doom, full), size);
+
+	nodebuildinfo_t serial;
+	serial.pick_budget = 8;
+	auto expected = build(MapFormat::doom, serial);
+	checkNodes(expected, size);
+	ASSERT_LT(serial.stats.partitions, full.stats.partitions);
+
+	// the same samples, whoever scores them
+	nodebuildinfo_t parallel;
+	parallel.pick_budget = 8;
+	parallel.jobs = 4;
+	parallel.pick_min_segs = 1;
+	ASSERT_EQ(build(MapFormat::doom, parallel), expected);
+
+	// out of time straight away still makes a good tree
+	nodebuildinfo_t hurried;
+	hurried.pick_budget = 1000;
+	hurried.pick_time = 1;
+	checkNodes(build(MapFormat::doom, hurried), size);
+}
+
+TEST(BspArena, AllocReuseAdopt)
+{
+	ajbsp::arena_c<ajbsp::vertex_t> arena;
+
+	std::vector<ajbsp::vertex_t *> list;
+	for(int i = 0; i < 100; ++i)
+	{
+		ajbsp::vertex_t *vertex = arena.Alloc();
+		ASSERT_EQ(vertex->x, 0);
+		ASSERT_EQ(vertex->tip_set, nullptr);
+		vertex->x = i;
+		vertex->index = i;
+		list.push_back(vertex);
+	}
+	for(int i = 0; i < 100; ++i)
+		ASSERT_EQ(list[i]->index, i);
+	ASSERT_LT(arena.NumBlocks(), 10);
+
+	// given back objects come out again, cleared
+	arena.Free(list[5]);
+	ajbsp::vertex_t *again = arena.Alloc();
+	ASSERT_EQ(again, list[5]);
+	ASSERT_EQ(again->index, 0);
+	ASSERT_EQ(arena.NumAllocs(), 101);
+	ASSERT_EQ(arena.NumReused(), 1);
+
+	ajbsp::arena_c<ajbsp::vertex_t> other;
+	other.Alloc()->index = 1234;
+	size_t blocks = arena.NumBlocks() + other.NumBlocks();
+
+	arena.Adopt(other);
+	ASSERT_EQ(arena.NumBlocks(), blocks);
+	ASSERT_EQ(arena.NumAllocs(), 102);
+	ASSERT_EQ(other.NumBlocks(), 0);
+	ASSERT_EQ(other.NumAllocs(), 0);
+
+	arena.Clear();
+	ASSERT_EQ(arena.NumBlocks(), 0);
+	ASSERT_EQ(arena.NumBytes(), 0);
+}
+
+TEST(BspQuadtree, BoxesHoldTheirSegs)
+{
+	std::mt19937 random(5);
+	std::uniform_int_distribution<int> coord(-3000, 3000);
+	std::uniform_int_distribution<int> length(1, 400);
+
+	ajbsp::arena_c<ajbsp::vertex_t> vertices;
+	ajbsp::arena_c<ajbsp::seg_t> segs;
+
+	ajbsp::seg_t *list = nullptr;
+	for(int i = 0; i < 2000; ++i)
+	{
+		ajbsp::vertex_t *start = vertices.Alloc();
+		ajbsp::vertex_t *end = vertices.Alloc();
+		start->x = coord(random);
+		start->y = coord(random);
+		end->x = start->x + length(random);
+		end->y = start->y + (i % 3 == 0 ? 0 : length(random));
+
+		ajbsp::seg_t *seg = segs.Alloc();
+		seg->start = start;
+		seg->end = end;
+		seg->linedef = (i % 5 == 0) ? -1 : i;
+		seg->Recompute();
+		seg->next = list;
+		list = seg;
+	}
+
+	ajbsp::bbox_t bounds;
+	ajbsp::FindLimits2(list, &bounds);
+
+	ajbsp::quadtree_c tree;
+
+	// twice, the second time in place
+	for(int round = 0; round < 2; ++round)
+	{
+		std::vector<ajbsp::seg_t *> in_list;
+		for(ajbsp::seg_t *seg = list; seg; seg = seg->next)
+			in_list.push_back(seg);
+
+		tree.Build(list, &bounds);
+
+		ASSERT_EQ(tree.block.Size(), 2000);
+		ASSERT_EQ(tree.RealNum(), 1600);
+
+		// every seg is there once
+		std::vector<ajbsp::seg_t *> in_tree = tree.block.segs;
+		std::sort(in_tree.begin(), in_tree.end());
+		std::sort(in_list.begin(), in_list.end());
+		ASSERT_EQ(in_tree, in_list);
+
+		std::function<void(int)> check = [&](int box)
+		{
+			const ajbsp::quadtree_c::box_t &B = tree.boxes[box];
+
+			int real = 0;
+			for(int i = B.first; i < B.end; ++i)
+			{
+				const ajbsp::seg_t *seg = tree.block.segs[i];
+				ASSERT_GE(std::min(seg->psx, seg->pex), B.x1);
+				ASSERT_LE(std::max(seg->psx, seg->pex), B.x2);
+				ASSERT_GE(std::min(seg->psy, seg->pey), B.y1);
+				ASSERT_LE(std::max(seg->psy, seg->pey), B.y2);
+				real += seg->linedef >= 0;
+			}
+			ASSERT_EQ(real, B.real_num);
+			ASSERT_EQ(B.end - B.first, B.real_num + B.mini_num);
+
+			if(B.leaf)
+			{
+				ASSERT_EQ(B.first + B.count, B.end);
+				return;
+			}
+			for(int c = 0; c < 2; ++c)
+			{
+				const ajbsp::quadtree_c::box_t &S = tree.boxes[ajbsp::quadtree_c::Sub(box, c)];
+				ASSERT_EQ(S.first, c == 0 ? B.first + B.count : tree.boxes[ajbsp::quadtree_c::Sub(box, 0)].end);
+				check(ajbsp::quadtree_c::Sub(box, c));
+			}
+		};
+		check(0);
+
+		// a box wholly on one side of a partition has all its segs there
+		for(int p = 0; p < 20; ++p)
+		{
+			const ajbsp::seg_t *part = tree.block.segs[p * 97];
+
+			for(int box = 0; box < (int)tree.boxes.size(); ++box)
+			{
+				if(box > 0 && tree.boxes[(box - 1) / 2].leaf)
+					continue;
+
+				Side side = tree.OnLineSide(box, part);
+				if(side == Side::neither)
+					continue;
+
+				const ajbsp::quadtree_c::box_t &B = tree.boxes[box];
+				for(int i = B.first; i < B.end; ++i)
+				{
+					const ajbsp::seg_t *seg = tree.block.segs[i];
+					ASSERT_EQ(part->PointOnLineSide(seg->psx, seg->psy), side);
+					ASSERT_EQ(part->PointOnLineSide(seg->pex, seg->pey), side);
+				}
+			}
+		}
+
+		// the list is broken up by building, put it back together
+		list = nullptr;
+		for(ajbsp::seg_t *seg : in_list)
+		{
+			seg->next = list;
+			list = seg;
+		}
+	}
+}
@@ -0,0 +1,284 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "bsp.h"
+#include "Instance.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+namespace
+{
+
+//
+// Square cells of a grid, each one a sector.  Sides between two cells
+// are two-sided linedefs, the others are walls.
+//
+class BspRejectTest : public ::testing::Test
+{
+protected:
+	static const int cell = 256;
+
+	void makeCells(const std::vector<std::vector<bool>> &used);
+	std::vector<byte> buildReject(nodebuildinfo_t &info);
+
+	bool rejected(const std::vector<byte> &reject, int view, int target) const
+	{
+		int p = view * inst.level.numSectors() + target;
+		return (reject[p >> 3] >> (p & 7)) & 1;
+	}
+
+	int sectorAt(int x, int y) const
+	{
+		return sectors[y][x];
+	}
+
+	bool blocked(double x1, double y1, double x2, double y2) const;
+
+	Instance inst;
+	std::vector<std::vector<int>> sectors;
+};
+
+void BspRejectTest::makeCells(const std::vector<std::vector<bool>> &used)
+{
+	int rows = (int)used.size();
+	int cols = (int)used[0].size();
+
+	sectors.assign(rows, std::vector<int>(cols, -1));
+
+	for(int y = 0; y < rows; ++y)
+		for(int x = 0; x < cols; ++x)
+			if(used[y][x])
+			{
+				sectors[y][x] = inst.level.numSectors();
+				Sector *sector = inst.level.sectors.append();
+				sector->ceilh = 128;
+			}
+
+	for(int y = 0; y <= rows; ++y)
+		for(int x = 0; x <= cols; ++x)
+		{
+			Vertex *vertex = inst.level.vertices.append();
+			vertex->raw_x = FFixedPoint(x * cell);
+			vertex->raw_y = FFixedPoint(y * cell);
+		}
+
+	auto sector = [&](int x, int y)
+	{
+		return (x < 0 || y < 0 || x >= cols || y >= rows) ? -1 : sectors[y][x];
+	};
+
+	auto addSide = [this](int sec)
+	{
+		SideDef *side = inst.level.sidedefs.append();
+		side->sector = sec;
+		return inst.level.numSidedefs() - 1;
+	};
+
+	auto addLine = [&](int v1, int v2, int right, int left)
+	{
+		if(right < 0 && left < 0)
+			return;
+		if(right < 0)
+		{
+			std::swap(v1, v2);
+			std::swap(right, left);
+		}
+		LineDef *line = inst.level.linedefs.append();
+		line->start = v1;
+		line->end = v2;
+		line->right = addSide(right);
+		if(left >= 0)
+		{
+			line->left = addSide(left);
+			line->flags = MLF_TwoSided;
+		}
+		else
+			line->flags = MLF_Blocking;
+	};
+
+	for(int y = 0; y <= rows; ++y)
+		for(int x = 0; x <= cols; ++x)
+		{
+			int v = y * (cols + 1) + x;
+			// walking east the right side is south, walking north it is east
+			if(x < cols)
+				addLine(v, v + 1, sector(x, y - 1), sector(x, y));
+			if(y < rows)
+				addLine(v, v + cols + 1, sector(x, y), sector(x - 1, y));
+		}
+}
+
+std::vector<byte> BspRejectTest::buildReject(nodebuildinfo_t &info)
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+	wad->AddLevel("MAP01");
+	for(const char *name : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SECTORS" })
+		wad->AddLump(name);
+
+	ajbsp::LevelData lev_data(MapFormat::doom, *wad, inst.level, inst.conf, nullptr);
+	EXPECT_EQ(lev_data.BuildLevel(&info, 0), BUILD_OK);
+
+	for(int i = 0; i < wad->NumLumps(); ++i)
+		if(wad->GetLump(i)->Name() == "REJECT")
+			return wad->GetLump(i)->getData();
+	return {};
+}
+
+//
+// Whether the line crosses a wall
+//
+bool BspRejectTest::blocked(double x1, double y1, double x2, double y2) const
+{
+	for(const auto &line : inst.level.linedefs)
+	{
+		if(line->left >= 0)
+			continue;
+
+		const Vertex &a = *inst.level.vertices[line->start];
+		const Vertex &b = *inst.level.vertices[line->end];
+
+		auto side = [](double px, double py, double qx, double qy, double x, double y)
+		{
+			return (qx - px) * (y - py) - (qy - py) * (x - px);
+		};
+
+		double d1 = side(a.x(), a.y(), b.x(), b.y(), x1, y1);
+		double d2 = side(a.x(), a.y(), b.x(), b.y(), x2, y2);
+		double d3 = side(x1, y1, x2, y2, a.x(), a.y());
+		double d4 = side(x1, y1, x2, y2, b.x(), b.y());
+
+		if(((d1 < 0 && d2 > 0) || (d1 > 0 && d2 < 0)) && ((d3 < 0 && d4 > 0) || (d3 > 0 && d4 < 0)))
+			return true;
+	}
+	return false;
+}
+
+} // namespace
+
+TEST_F(BspRejectTest, Corridor)
+{
+	// a corridor along the bottom which turns north at the end:
+	//
+	//   . . . G
+	//   . . . F
+	//   . . . E
+	//   A B C D
+	//
+	std::vector<std::vector<bool>> used(4, std::vector<bool>(4, false));
+	for(int x = 0; x < 4; ++x)
+		used[0][x] = true;
+	for(int y = 1; y < 4; ++y)
+		used[y][3] = true;
+	makeCells(used);
+
+	nodebuildinfo_t simple;
+	std::vector<byte> reject = buildReject(simple);
+	ASSERT_EQ(reject.size(), (7 * 7 + 7) / 8);
+	for(byte b : reject)
+		ASSERT_EQ(b, 0);
+
+	nodebuildinfo_t full;
+	full.full_reject = true;
+	reject = buildReject(full);
+	ASSERT_EQ(reject.size(), (7 * 7 + 7) / 8);
+
+	int A = sectorAt(0, 0), B = sectorAt(1, 0), D = sectorAt(3, 0);
+	int E = sectorAt(3, 1), F = sectorAt(3, 2), G = sectorAt(3, 3);
+
+	for(int s = 0; s < 7; ++s)
+		ASSERT_FALSE(rejected(reject, s, s));
+
+	ASSERT_FALSE(rejected(reject, A, D));
+	ASSERT_FALSE(rejected(reject, A, E));
+	ASSERT_FALSE(rejected(reject, E, A));
+	ASSERT_FALSE(rejected(reject, B, F));
+
+	ASSERT_TRUE(rejected(reject, A, G));
+	ASSERT_TRUE(rejected(reject, G, A));
+	ASSERT_TRUE(rejected(reject, A, F));
+	ASSERT_TRUE(rejected(reject, F, A));
+}
+
+TEST_F(BspRejectTest, NeverRejectsWhatCanBeSeen)
+{
+	std::mt19937 random(4321);
+
+	const int size = 10;
+	std::vector<std::vector<bool>> used(size, std::vector<bool>(size));
+	for(auto &row : used)
+		for(int x = 0; x < size; ++x)
+			row[x] = random() % 10 < 7;
+	makeCells(used);
+
+	int num_sectors = inst.level.numSectors();
+
+	nodebuildinfo_t simple;
+	std::vector<byte> simple_reject = buildReject(simple);
+
+	nodebuildinfo_t full;
+	full.full_reject = true;
+	full.reject_time = 0;
+	std::vector<byte> reject = buildReject(full);
+	ASSERT_EQ(reject.size(), simple_reject.size());
+
+	// the same with threads
+	nodebuildinfo_t threaded;
+	threaded.full_reject = true;
+	threaded.jobs = 4;
+	ASSERT_EQ(buildReject(threaded), reject);
+
+	// points in each cell
+	std::uniform_real_distribution<double> inside(1, cell - 1);
+	std::vector<std::vector<std::pair<double, double>>> points(num_sectors);
+	for(int y = 0; y < size; ++y)
+		for(int x = 0; x < size; ++x)
+			if(sectorAt(x, y) >= 0)
+				for(int k = 0; k < 6; ++k)
+					points[sectorAt(x, y)].emplace_back(x * cell + inside(random),
+							y * cell + inside(random));
+
+	int extra = 0;
+
+	for(int view = 0; view < num_sectors; ++view)
+		for(int target = 0; target < num_sectors; ++target)
+		{
+			// anything rejected before still is
+			if(rejected(simple_reject, view, target))
+			{
+				ASSERT_TRUE(rejected(reject, view, target));
+				continue;
+			}
+
+			ASSERT_EQ(rejected(reject, view, target), rejected(reject, target, view));
+
+			if(!rejected(reject, view, target))
+				continue;
+
+			++extra;
+
+			for(const auto &p : points[view])
+				for(const auto &q : points[target])
+					ASSERT_TRUE(blocked(p.first, p.second, q.first, q.second))
+							<< view << " sees " << target;
+		}
+
+	ASSERT_GT(extra, 0);
+}
@@ -0,0 +1,303 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_basis.h"
+#include "Instance.h"
+#include "m_config.h"
+#include "m_select.h"
+#include "testUtils/LevelMaker.hpp"
+#include "gtest/gtest.h"
+
+#include <random>
+
+TEST(EBasis, BulkDeleteMatchesOneByOne)
+{
+	for(ObjType type : {ObjType::vertices, ObjType::sectors, ObjType::sidedefs, ObjType::linedefs})
+	{
+		Instance bulkInst;
+		Instance singleInst;
+		Document &bulk = bulkInst.level;
+		Document &single = singleInst.level;
+
+		makeLevel(bulk, 99);
+		makeLevel(single, 99);
+		const std::vector<int> original = levelFields(bulk);
+
+		std::mt19937 random(7);
+		selection_c list(type);
+		for(int n = 0; n < bulk.numObjects(type); ++n)
+			if(random() % 4 == 0)
+				list.set(n);
+
+		{
+			EditOperation op(bulk.basis);
+			op.del(list);
+		}
+		{
+			EditOperation op(single.basis);
+			for(int n = single.numObjects(type) - 1; n >= 0; --n)
+				if(list.get(n))
+					op.del(type, n);
+		}
+		const std::vector<int> deleted = levelFields(single);
+		ASSERT_EQ(levelFields(bulk), deleted) << NameForObjectType(type);
+
+		// undo puts everything back in its place
+		ASSERT_TRUE(bulk.basis.undo());
+		ASSERT_EQ(levelFields(bulk), original) << NameForObjectType(type);
+
+		ASSERT_TRUE(bulk.basis.redo());
+		ASSERT_EQ(levelFields(bulk), deleted) << NameForObjectType(type);
+
+		// dropping the redo step gives back the kept objects
+		ASSERT_TRUE(bulk.basis.undo());
+		{
+			EditOperation op(bulk.basis);
+			op.changeLinedef(0, LineDef::F_TAG, 12345);
+		}
+		ASSERT_TRUE(bulk.basis.undo());
+		ASSERT_EQ(levelFields(bulk), original) << NameForObjectType(type);
+	}
+}
+
+TEST(EBasis, AbortedBulkDeleteRestoresLevel)
+{
+	Instance inst;
+	Document &doc = inst.level;
+	makeLevel(doc, 5);
+	const std::vector<int> original = levelFields(doc);
+	const int numVertices = doc.numVertices();
+
+	selection_c list(ObjType::vertices);
+	for(int n = 0; n < doc.numVertices(); n += 3)
+		list.set(n);
+
+	{
+		EditOperation op(doc.basis);
+		op.del(list);
+		ASSERT_LT(doc.numVertices(), numVertices);
+		op.setAbort(false);
+	}
+	ASSERT_EQ(levelFields(doc), original);
+	ASSERT_FALSE(doc.basis.undo());
+}
+
+TEST(EBasis, RepeatedChangesAreKeptOnce)
+{
+	Instance onceInst;
+	Instance manyInst;
+	Document &once = onceInst.level;
+	Document &many = manyInst.level;
+
+	makeLevel(once, 5);
+	makeLevel(many, 5);
+	const std::vector<int> original = levelFields(many);
+
+	{
+		EditOperation op(once.basis);
+		op.changeVertex(3, Vertex::F_X, FFixedPoint(900));
+		op.changeLinedef(7, LineDef::F_TAG, 55);
+	}
+	{
+		// like a drag going back and forth, with other edits between
+		EditOperation op(many.basis);
+		for(int i = 0; i < 100; ++i)
+		{
+			op.changeVertex(3, Vertex::F_X, FFixedPoint(i));
+			op.changeLinedef(7, LineDef::F_TAG, i);
+		}
+		op.changeVertex(3, Vertex::F_X, FFixedPoint(900));
+		op.changeLinedef(7, LineDef::F_TAG, 55);
+	}
+	ASSERT_EQ(levelFields(many), levelFields(once));
+	ASSERT_EQ(many.basis.getHistoryMemory(), once.basis.getHistoryMemory());
+
+	ASSERT_TRUE(many.basis.undo());
+	ASSERT_EQ(levelFields(many), original);
+	ASSERT_TRUE(many.basis.redo());
+	ASSERT_EQ(levelFields(many), levelFields(once));
+
+	// a delete between renumbers the objects, so both changes stay
+	{
+		EditOperation op(many.basis);
+		op.changeVertex(10, Vertex::F_Y, FFixedPoint(1));
+		op.del(ObjType::vertices, 9);
+		op.changeVertex(10, Vertex::F_Y, FFixedPoint(2));
+	}
+	ASSERT_TRUE(many.basis.undo());
+	ASSERT_EQ(levelFields(many), levelFields(once));
+}
+
+class EBasisMemoryLimit : public ::testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		oldLimit = config::undo_max_space;
+		config::undo_max_space = 1;
+	}
+
+	void TearDown() override
+	{
+		config::undo_max_space = oldLimit;
+	}
+
+	int oldLimit = 0;
+};
+
+TEST_F(EBasisMemoryLimit, HistoryKeepsUnderMemoryLimit)
+{
+	Instance inst;
+	Document &doc = inst.level;
+	makeLevel(doc, 11);
+	std::vector<std::vector<int>> states = { levelFields(doc) };
+
+	// values which don't pack well
+	std::mt19937 random(17);
+
+	for(int i = 0; i < 300; ++i)
+	{
+		EditOperation op(doc.basis);
+		for(int n = 0; n < doc.numSidedefs(); ++n)
+			for(int field : {SideDef::F_X_OFFSET, SideDef::F_Y_OFFSET})
+				op.changeSidedef(n, (SideDef::IntAddress)field, (int)random());
+		op.del(ObjType::linedefs, i % doc.numLinedefs());
+		states.push_back(levelFields(doc));
+	}
+
+	ASSERT_LE(doc.basis.getHistoryMemory(), (size_t)1 << 20);
+	int count = doc.basis.getUndoCount();
+	ASSERT_GT(count, 0);
+	ASSERT_LT(count, 300);
+
+	// the steps kept still undo to where they were
+	for(int i = 0; i < count; ++i)
+	{
+		ASSERT_TRUE(doc.basis.undo());
+		ASSERT_EQ(levelFields(doc), states[states.size() - 2 - i]);
+	}
+	ASSERT_FALSE(doc.basis.undo());
+}
+
+TEST(EBasis, DeepHistoryUndoesThroughPackedGroups)
+{
+	Instance inst;
+	Document &doc = inst.level;
+	makeLevel(doc, 23);
+
+	std::mt19937 random(31);
+	auto pick = [&random](int count)
+	{
+		return std::uniform_int_distribution<int>(0, count - 1)(random);
+	};
+
+	std::vector<std::vector<int>> states = { levelFields(doc) };
+
+	auto edit = [&]()
+	{
+		EditOperation op(doc.basis);
+		switch(pick(4))
+		{
+		case 0:
+			for(int i = 0; i < 50; ++i)
+				op.changeVertex(pick(doc.numVertices()), Vertex::F_Y, FFixedPoint(pick(5000) - 2500));
+			break;
+		case 1:
+			op.del(ObjType::sidedefs, pick(doc.numSidedefs()));
+			op.changeSector(pick(doc.numSectors()), Sector::F_TAG, -pick(100));
+			break;
+		case 2:
+		{
+			selection_c list(pick(2) ? ObjType::linedefs : ObjType::vertices);
+			for(int i = 0; i < 8; ++i)
+				list.set(pick(doc.numObjects(list.what_type())));
+			op.del(list);
+			break;
+		}
+		case 3:
+		{
+			int v = op.addNew(ObjType::vertices);
+			doc.vertices[v]->raw_x = FFixedPoint(pick(1000));
+			op.changeLinedef(pick(doc.numLinedefs()), LineDef::F_START, v);
+			break;
+		}
+		}
+	};
+
+	for(int i = 0; i < 40; ++i)
+	{
+		edit();
+		states.push_back(levelFields(doc));
+	}
+
+	for(int i = 39; i >= 0; --i)
+	{
+		ASSERT_TRUE(doc.basis.undo());
+		ASSERT_EQ(levelFields(doc), states[i]) << i;
+	}
+	ASSERT_FALSE(doc.basis.undo());
+
+	for(int i = 1; i <= 40; ++i)
+	{
+		ASSERT_TRUE(doc.basis.redo());
+		ASSERT_EQ(levelFields(doc), states[i]) << i;
+	}
+	ASSERT_FALSE(doc.basis.redo());
+
+	// go back some and branch off
+	for(int i = 0; i < 15; ++i)
+		ASSERT_TRUE(doc.basis.undo());
+	states.resize(26);
+	for(int i = 0; i < 10; ++i)
+	{
+		edit();
+		states.push_back(levelFields(doc));
+	}
+	for(int i = (int)states.size() - 2; i >= 0; --i)
+	{
+		ASSERT_TRUE(doc.basis.undo());
+		ASSERT_EQ(levelFields(doc), states[i]) << i;
+	}
+}
+
+TEST(EBasis, PackedGroupsTakeLessMemory)
+{
+	Instance inst;
+	Document &doc = inst.level;
+	makeLevel(doc, 3);
+
+	auto edit = [&doc](int i)
+	{
+		EditOperation op(doc.basis);
+		for(int n = 0; n < doc.numSidedefs(); ++n)
+			op.changeSidedef(n, SideDef::F_X_OFFSET, i);
+		selection_c list(ObjType::linedefs);
+		for(int n = 0; n < 20; ++n)
+			list.set(n * 3);
+		op.del(list);
+	};
+
+	edit(0);
+	size_t one = doc.basis.getHistoryMemory();
+
+	for(int i = 1; i < 20; ++i)
+		edit(i);
+
+	// all but the latest four are packed, to a tenth or less
+	ASSERT_LT(doc.basis.getHistoryMemory(), 4 * one + 16 * one / 10);
+}
@@ -52,9 +52,8 @@ TEST(EChecks, FindFreeTag)
 		inst.level.linedefs.clear();
 		for(LineDef &line : lines)
 		{
-			auto addedLine = std::make_shared<LineDef>();
+			LineDef *addedLine = inst.level.linedefs.append();
 			*addedLine = line;
-			inst.level.linedefs.push_back(std::move(addedLine));
 		}
 	};
 	std::vector<Sector> sectors;
@@ -63,9 +62,8 @@ TEST(EChecks, FindFreeTag)
 		inst.level.sectors.clear();
 		for(Sector &sector : sectors)
 		{
-			auto newSector = std::make_shared<Sector>();
+			Sector *newSector = inst.level.sectors.append();
 			*newSector = sector;
-			inst.level.sectors.push_back(std::move(newSector));
 		}
 	};
 
@@ -206,15 +204,13 @@ TEST(EChecks, TagsApplyNewValue)
 
 	for(LineDef &line : lines)
 	{
-		auto newLine = std::make_shared<LineDef>();
+		LineDef *newLine = inst.level.linedefs.append();
 		*newLine = line;
-		inst.level.linedefs.push_back(std::move(newLine));
 	}
 	for(Sector &sector : sectors)
 	{
-		auto newSector = std::make_shared<Sector>();
+		Sector *newSector = inst.level.sectors.append();
 		*newSector = sector;
-		inst.level.sectors.push_back(std::move(newSector));
 	}
 
 	// Start with linedefs
@@ -254,7 +250,7 @@ TEST(EChecks, TagsApplyNewValue)
 		else
 			ASSERT_EQ(line->tag, 0);
 	for(const auto &sector : inst.level.sectors)
-		if(sector.get() == inst.level.sectors[2].get() || sector.get() == inst.level.sectors[4].get())
+		if(sector == inst.level.sectors[2] || sector == inst.level.sectors[4])
 			ASSERT_EQ(sector->tag, 2);
 		else
 			ASSERT_EQ(sector->tag, 0);
@@ -268,7 +264,7 @@ TEST(EChecks, TagsApplyNewValue)
 		else
 			ASSERT_EQ(line->tag, 0);
 	for(const auto &sector : inst.level.sectors)
-		if(sector.get() == inst.level.sectors[2].get())
+		if(sector == inst.level.sectors[2])
 			ASSERT_EQ(sector->tag, 1);
 		else if(sector == inst.level.sectors[4])
 			ASSERT_EQ(sector->tag, 2);
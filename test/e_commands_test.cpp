@@ -46,43 +46,39 @@ protected:
 
 void SelectNeighbor::addVertex(int x, int y)
 {
-    Vertex *vertex = new Vertex;
+    Vertex *vertex = doc.vertices.append();
     vertex->SetRawXY(MapFormat::doom, v2double_t{ (double)x, (double)y });
-    doc.vertices.emplace_back(vertex);
 }
 
 void SelectNeighbor::addSector(int floorh, int ceilh)
 {
-    Sector *sector = new Sector;
+    Sector *sector = doc.sectors.append();
     sector->floorh = floorh;
     sector->ceilh = ceilh;
     sector->floor_tex = BA_InternaliseString("FLOOR");
     sector->ceil_tex = BA_InternaliseString("CEIL");
     sector->light = 160;
     sector->type = sector->tag = 0;
-    doc.sectors.emplace_back(sector);
 }
 
 void SelectNeighbor::addSide(const SString &upper, const SString &middle, const SString &lower,
     int sector, int yoffset)
 {
-    SideDef *side = new SideDef{};
+    SideDef *side = doc.sidedefs.append();
     side->upper_tex = BA_InternaliseString(upper);
     side->mid_tex = BA_InternaliseString(middle);
     side->lower_tex = BA_InternaliseString(lower);
     side->sector = sector;
 	side->y_offset = yoffset;
-    doc.sidedefs.emplace_back(side);
 }
 
 void SelectNeighbor::addLine(int v1, int v2, int s1, int s2)
 {
-    LineDef *line = new LineDef{};
+    LineDef *line = doc.linedefs.append();
     line->start = v1;
     line->end = v2;
     line->right = s1;
     line->left = s2;
-    doc.linedefs.emplace_back(line);
 }
 
 class SelectNeighborTexture : public SelectNeighbor
@@ -37,153 +37,127 @@ void ECutPasteFixture::addArea()
 {
 	Vertex *vertex;
 	
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(0);
 	vertex->raw_y = FFixedPoint(0);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(0);
 	vertex->raw_y = FFixedPoint(256);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(256);
 	vertex->raw_y = FFixedPoint(256);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(256);
 	vertex->raw_y = FFixedPoint(0);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
 	
 	Sector *sector;
-	sector = new Sector;
+	sector = inst.level.sectors.append();
 	sector->floorh = 0;
 	sector->ceilh = 128;
-	inst.level.sectors.push_back(std::shared_ptr<Sector>(sector));
 	
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(new SideDef));
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(new SideDef));
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(new SideDef));
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(new SideDef));
+	inst.level.sidedefs.append();
+	inst.level.sidedefs.append();
+	inst.level.sidedefs.append();
+	inst.level.sidedefs.append();
 	
 	LineDef *line;
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 0;
 	line->end = 1;
 	line->right = 0;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 1;
 	line->end = 2;
 	line->right = 1;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 2;
 	line->end = 3;
 	line->right = 2;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 3;
 	line->end = 0;
 	line->right = 3;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
 	
 	Thing *thing;
-	thing = new Thing;
+	thing = inst.level.things.append();
 	thing->raw_x = FFixedPoint(192);
 	thing->raw_y = FFixedPoint(128);
 	thing->type = 1;
 	thing->angle = 0;
-	inst.level.things.push_back(std::shared_ptr<Thing>(thing));
-	thing = new Thing;
+	thing = inst.level.things.append();
 	thing->raw_x = FFixedPoint(128);
 	thing->raw_y = FFixedPoint(192);
 	thing->type = 2;
 	thing->angle = 90;
-	inst.level.things.push_back(std::shared_ptr<Thing>(thing));
-	thing = new Thing;
+	thing = inst.level.things.append();
 	thing->raw_x = FFixedPoint(64);
 	thing->raw_y = FFixedPoint(128);
 	thing->type = 3;
 	thing->angle = 180;
-	inst.level.things.push_back(std::shared_ptr<Thing>(thing));
-	thing = new Thing;
+	thing = inst.level.things.append();
 	thing->raw_x = FFixedPoint(128);
 	thing->raw_y = FFixedPoint(64);
 	thing->type = 4;
 	thing->angle = 270;
-	inst.level.things.push_back(std::shared_ptr<Thing>(thing));
 }
 
 void ECutPasteFixture::addSecondArea()
 {
 	Vertex *vertex;
 	
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(320);
 	vertex->raw_y = FFixedPoint(192);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(320);
 	vertex->raw_y = FFixedPoint(256);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(384);
 	vertex->raw_y = FFixedPoint(256);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(384);
 	vertex->raw_y = FFixedPoint(192);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
 	
 	Sector *sector;
-	sector = new Sector;
+	sector = inst.level.sectors.append();
 	sector->floorh = 0;
 	sector->ceilh = 128;
-	inst.level.sectors.push_back(std::shared_ptr<Sector>(sector));
 	
 	SideDef *side;
-	side = new SideDef;
+	side = inst.level.sidedefs.append();
 	side->sector = 1;
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(side));
-	side = new SideDef;
+	side = inst.level.sidedefs.append();
 	side->sector = 1;
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(side));
-	side = new SideDef;
+	side = inst.level.sidedefs.append();
 	side->sector = 1;
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(side));
-	side = new SideDef;
+	side = inst.level.sidedefs.append();
 	side->sector = 1;
-	inst.level.sidedefs.push_back(std::shared_ptr<SideDef>(side));
 	
 	LineDef *line;
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 4;
 	line->end = 5;
 	line->right = 4;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 5;
 	line->end = 6;
 	line->right = 5;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 6;
 	line->end = 7;
 	line->right = 6;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
-	line = new LineDef;
+	line = inst.level.linedefs.append();
 	line->start = 7;
 	line->end = 4;
 	line->right = 7;
 	line->left = -1;
-	inst.level.linedefs.push_back(std::shared_ptr<LineDef>(line));
 }
 
 TEST_F(ECutPasteFixture, DeletingAllPlayersWillNotCrash)
@@ -0,0 +1,152 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_incidence.h"
+#include "Instance.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+//
+// Compares the index with a look through all the linedefs
+//
+static void checkIncidence(const Document &doc)
+{
+	for(int v = 0; v < doc.numVertices(); ++v)
+	{
+		std::vector<int> expected;
+		for(int n = 0; n < doc.numLinedefs(); ++n)
+			if(doc.linedefs[n]->TouchesVertex(v))
+				expected.push_back(n);
+
+		ASSERT_EQ(doc.incidence.linedefsAt(v), expected) << "vertex " << v;
+	}
+	ASSERT_TRUE(doc.incidence.linedefsAt(doc.numVertices()).empty());
+	ASSERT_TRUE(doc.incidence.linedefsAt(-1).empty());
+}
+
+TEST(EIncidence, FollowsBasisEdits)
+{
+	Instance inst;
+	Document &doc = inst.level;
+
+	// a row of vertices, each joined to the next two
+	for(int i = 0; i < 12; ++i)
+	{
+		Vertex *vertex = doc.vertices.append();
+		vertex->raw_x = FFixedPoint(i * 64);
+	}
+	for(int i = 0; i + 1 < 12; ++i)
+	{
+		for(int j = i + 1; j <= i + 2 && j < 12; ++j)
+		{
+			LineDef *line = doc.linedefs.append();
+			line->start = i;
+			line->end = j;
+		}
+	}
+	checkIncidence(doc);
+
+	std::mt19937 random(1234);
+	auto pick = [&random](int count)
+	{
+		return std::uniform_int_distribution<int>(0, count - 1)(random);
+	};
+
+	for(int step = 0; step < 200; ++step)
+	{
+		switch(pick(6))
+		{
+		case 0:
+		{
+			// new lines get their vertices right after being added
+			EditOperation op(doc.basis);
+			int v = op.addNew(ObjType::vertices);
+			int ld = op.addNew(ObjType::linedefs);
+			doc.linedefs[ld]->start = v;
+			doc.linedefs[ld]->end = pick(doc.numVertices());
+			break;
+		}
+		case 1:
+			if(doc.numLinedefs() > 0)
+			{
+				EditOperation op(doc.basis);
+				op.changeLinedef(pick(doc.numLinedefs()), pick(2) ? LineDef::F_START :
+								 LineDef::F_END, pick(doc.numVertices()));
+			}
+			break;
+		case 2:
+			if(doc.numLinedefs() > 0)
+			{
+				EditOperation op(doc.basis);
+				op.del(ObjType::linedefs, pick(doc.numLinedefs()));
+			}
+			break;
+		case 3:
+			if(doc.numVertices() > 2)
+			{
+				EditOperation op(doc.basis);
+				op.del(ObjType::vertices, pick(doc.numVertices()));
+			}
+			break;
+		case 4:
+			doc.basis.undo();
+			break;
+		case 5:
+			doc.basis.redo();
+			break;
+		}
+		checkIncidence(doc);
+	}
+
+	// undoing everything gets back the first level
+	while(doc.basis.undo())
+		;
+	ASSERT_EQ(doc.numVertices(), 12);
+	ASSERT_EQ(doc.numLinedefs(), 21);
+	checkIncidence(doc);
+}
+
+TEST(EIncidence, VertexModuleQueries)
+{
+	Instance inst;
+	Document &doc = inst.level;
+
+	for(int i = 0; i < 4; ++i)
+		doc.vertices.append();
+
+	// 0 -> 1 -> 2, and 3 -> 1
+	for(auto ends : {std::make_pair(0, 1), std::make_pair(1, 2), std::make_pair(3, 1)})
+	{
+		LineDef *line = doc.linedefs.append();
+		line->start = ends.first;
+		line->end = ends.second;
+	}
+
+	ASSERT_EQ(doc.vertmod.howManyLinedefs(1), 3);
+	ASSERT_EQ(doc.vertmod.howManyLinedefs(2), 1);
+	ASSERT_EQ(doc.vertmod.findDragOther(1), 0);
+	ASSERT_EQ(doc.vertmod.findDragOther(0), 1);
+	ASSERT_TRUE(doc.linemod.linedefAlreadyExists(2, 1));
+	ASSERT_FALSE(doc.linemod.linedefAlreadyExists(0, 2));
+
+	// a level replaced from outside the Basis is picked up again
+	doc.clear();
+	ASSERT_TRUE(doc.incidence.linedefsAt(1).empty());
+	ASSERT_EQ(doc.vertmod.howManyLinedefs(1), 0);
+}
@@ -0,0 +1,367 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_journal.h"
+#include "Instance.h"
+#include "m_config.h"
+#include "m_select.h"
+#include "testUtils/LevelMaker.hpp"
+#include "testUtils/TempDirContext.hpp"
+#include "gtest/gtest.h"
+
+#include <fstream>
+#include <random>
+
+class EditJournalTest : public TempDirContext
+{
+protected:
+	void SetUp() override
+	{
+		TempDirContext::SetUp();
+
+		wadPath = getChildPath("test.wad");
+		std::ofstream os(wadPath.u8string(), std::ios::binary);
+		os << "PWAD and some data";
+		os.close();
+		mDeleteList.push(wadPath);
+
+		journalPath = EditJournal::pathFor(wadPath, "MAP01");
+		mDeleteList.push(journalPath);
+	}
+
+	void TearDown() override
+	{
+		config::edit_journal_checkpoint = 1000;
+		TempDirContext::TearDown();
+	}
+
+	void edit(Document &doc, std::mt19937 &random, int &edits);
+
+	fs::path wadPath;
+	fs::path journalPath;
+};
+
+//
+// One random edit of the kinds the editor does, counting the ones
+// which stay in the history
+//
+void EditJournalTest::edit(Document &doc, std::mt19937 &random, int &edits)
+{
+	auto pick = [&random](int count)
+	{
+		return std::uniform_int_distribution<int>(0, count - 1)(random);
+	};
+
+	// don't run out of anything
+	for(ObjType type : {ObjType::things, ObjType::vertices, ObjType::sectors,
+			ObjType::sidedefs, ObjType::linedefs})
+	{
+		if(doc.numObjects(type) < 10)
+		{
+			ASSERT_TRUE(doc.basis.undo());
+			edits++;
+			return;
+		}
+	}
+
+	const int before = doc.basis.getUndoCount();
+
+	switch(pick(9))
+	{
+	case 0:
+	{
+		EditOperation op(doc.basis);
+		op.changeVertex(pick(doc.numVertices()), Vertex::F_X, FFixedPoint(pick(5000)));
+		op.changeLinedef(pick(doc.numLinedefs()), LineDef::F_TAG, pick(100));
+		break;
+	}
+	case 1:
+	{
+		EditOperation op(doc.basis);
+		op.changeSidedef(pick(doc.numSidedefs()), SideDef::F_UPPER_TEX,
+				BA_InternaliseString(SString::printf("NEWTEX%d", pick(1000))));
+		op.changeSector(pick(doc.numSectors()), Sector::F_FLOOR_TEX,
+				BA_InternaliseString(SString::printf("NEWFLAT%d", pick(1000))));
+		break;
+	}
+	case 2:
+	{
+		// new objects, filled in after being added, then other objects
+		// deleted before them
+		EditOperation op(doc.basis);
+		int t = op.addNew(ObjType::things);
+		doc.things[t]->type = 2001 + pick(10);
+		doc.things[t]->raw_y = FFixedPoint(pick(1000));
+
+		int s = op.addNew(ObjType::sidedefs);
+		doc.sidedefs[s]->sector = pick(doc.numSectors());
+		doc.sidedefs[s]->lower_tex = BA_InternaliseString(SString::printf("LOW%d", pick(50)));
+
+		int l = op.addNew(ObjType::linedefs);
+		doc.linedefs[l]->start = pick(doc.numVertices());
+		doc.linedefs[l]->end = pick(doc.numVertices());
+		doc.linedefs[l]->right = s;
+
+		op.del(ObjType::things, pick(t));
+		op.del(ObjType::linedefs, pick(l));
+		doc.linedefs[doc.numLinedefs() - 1]->flags = pick(64);
+		break;
+	}
+	case 3:
+	{
+		EditOperation op(doc.basis);
+		op.del(ObjType::vertices, pick(doc.numVertices()));
+		break;
+	}
+	case 4:
+	{
+		EditOperation op(doc.basis);
+		op.del(ObjType::sectors, pick(doc.numSectors()));
+		break;
+	}
+	case 5:
+	{
+		ObjType type = pick(2) ? ObjType::things : ObjType::sidedefs;
+		selection_c list(type);
+		for(int n = 0; n < doc.numObjects(type); ++n)
+			if(pick(8) == 0)
+				list.set(n);
+		EditOperation op(doc.basis);
+		op.del(list);
+		break;
+	}
+	case 6:
+		if(doc.basis.undo())
+			edits++;
+		return;
+	case 7:
+		if(doc.basis.redo())
+			edits++;
+		return;
+	case 8:
+	{
+		EditOperation op(doc.basis);
+		op.changeThing(pick(doc.numThings()), Thing::F_TYPE, 1);
+		op.del(ObjType::things, pick(doc.numThings()));
+		op.setAbort(false);
+		return;
+	}
+	}
+
+	// empty ones are not kept
+	if(doc.basis.getUndoCount() > before)
+		edits++;
+}
+
+TEST_F(EditJournalTest, ReplayGivesTheSameLevel)
+{
+	Instance inst;
+	makeLevel(inst.level, 3);
+	inst.level.journal.start(wadPath, "map01");
+	ASSERT_TRUE(inst.level.journal.isOpen());
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 0);
+
+	std::mt19937 random(11);
+	int edits = 0;
+	for(int i = 0; i < 300; ++i)
+		edit(inst.level, random, edits);
+
+	const std::vector<int> edited = levelFields(inst.level);
+
+	// as if the editor went down here
+	inst.level.journal.close();
+	ASSERT_TRUE(fs::exists(journalPath));
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), edits);
+
+	Instance other;
+	makeLevel(other.level, 3);
+	ASSERT_EQ(other.level.journal.replay(wadPath, "MAP01"), edits);
+	ASSERT_EQ(levelFields(other.level), edited);
+
+	// the edits can be undone
+	ASSERT_TRUE(other.level.basis.undo());
+	ASSERT_TRUE(other.level.basis.redo());
+	ASSERT_EQ(levelFields(other.level), edited);
+	edits += 2;
+
+	// and the journal goes on after them
+	for(int i = 0; i < 50; ++i)
+		edit(other.level, random, edits);
+	const std::vector<int> more = levelFields(other.level);
+	other.level.journal.close();
+
+	Instance third;
+	ASSERT_EQ(third.level.journal.replay(wadPath, "MAP01"), edits);
+	ASSERT_EQ(levelFields(third.level), more);
+
+	// until it gets let go
+	third.level.journal.discard();
+	ASSERT_FALSE(fs::exists(journalPath));
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), -1);
+}
+
+TEST_F(EditJournalTest, UnfinishedEditIsDropped)
+{
+	Instance inst;
+	makeLevel(inst.level, 8);
+	inst.level.journal.start(wadPath, "MAP01");
+
+	std::mt19937 random(2);
+	int edits = 0;
+	while(edits < 10)
+		edit(inst.level, random, edits);
+	const std::vector<int> kept = levelFields(inst.level);
+	inst.level.journal.flush();
+	const uintmax_t keptSize = fs::file_size(journalPath);
+
+	{
+		EditOperation op(inst.level.basis);
+		op.changeVertex(0, Vertex::F_Y, FFixedPoint(-77));
+	}
+	inst.level.journal.close();
+
+	// cut the last block short, like a crash while writing it
+	fs::resize_file(journalPath, fs::file_size(journalPath) - 3);
+
+	Instance other;
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 10);
+	ASSERT_EQ(other.level.journal.replay(wadPath, "MAP01"), 10);
+	ASSERT_EQ(levelFields(other.level), kept);
+	ASSERT_EQ(fs::file_size(journalPath), keptSize);
+
+	{
+		EditOperation op(other.level.basis);
+		op.changeVertex(0, Vertex::F_Y, FFixedPoint(-77));
+	}
+	const std::vector<int> edited = levelFields(other.level);
+	other.level.journal.close();
+
+	Instance third;
+	ASSERT_EQ(third.level.journal.replay(wadPath, "MAP01"), 11);
+	ASSERT_EQ(levelFields(third.level), edited);
+}
+
+TEST_F(EditJournalTest, CheckpointsKeepTheFileSmall)
+{
+	config::edit_journal_checkpoint = 5;
+
+	Instance inst;
+	makeLevel(inst.level, 4);
+	inst.level.journal.start(wadPath, "MAP01");
+	inst.level.journal.flush();
+	const uintmax_t startSize = fs::file_size(journalPath);
+
+	for(int i = 0; i < 103; ++i)
+	{
+		EditOperation op(inst.level.basis);
+		op.changeLinedef(i % inst.level.numLinedefs(), LineDef::F_TAG, i);
+		op.changeSidedef(i, SideDef::F_MID_TEX, BA_InternaliseString(SString::printf("CP%d", i % 4)));
+	}
+	inst.level.journal.flush();
+	ASSERT_LT(fs::file_size(journalPath), startSize + 1000);
+
+	const std::vector<int> edited = levelFields(inst.level);
+	inst.level.journal.close();
+
+	Instance other;
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 103);
+	ASSERT_EQ(other.level.journal.replay(wadPath, "MAP01"), 103);
+	ASSERT_EQ(levelFields(other.level), edited);
+}
+
+TEST_F(EditJournalTest, SavingStartsAfresh)
+{
+	Instance inst;
+	makeLevel(inst.level, 5);
+	inst.level.journal.start(wadPath, "MAP01");
+	{
+		EditOperation op(inst.level.basis);
+		op.changeThing(0, Thing::F_TYPE, 9);
+	}
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 1);
+
+	// saving writes the wad, then starts the journal again
+	inst.level.journal.start(wadPath, "MAP01");
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 0);
+
+	{
+		EditOperation op(inst.level.basis);
+		op.changeThing(0, Thing::F_TYPE, 10);
+	}
+	inst.level.journal.close();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 1);
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP02"), -1);
+
+	// a wad changed since then doesn't match anymore
+	{
+		std::ofstream os(wadPath.u8string(), std::ios::binary | std::ios::app);
+		os << "more";
+	}
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), -1);
+
+	Instance other;
+	ASSERT_EQ(other.level.journal.replay(wadPath, "MAP01"), -1);
+	ASSERT_FALSE(other.level.journal.isOpen());
+}
+
+TEST_F(EditJournalTest, RestampFollowsTheWad)
+{
+	Instance inst;
+	makeLevel(inst.level, 6);
+	inst.level.journal.start(wadPath, "MAP01");
+	{
+		EditOperation op(inst.level.basis);
+		op.changeThing(0, Thing::F_TYPE, 9);
+	}
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 1);
+
+	// written again by the editor
+	{
+		std::ofstream os(wadPath.u8string(), std::ios::binary | std::ios::app);
+		os << "nodes";
+	}
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), -1);
+	inst.level.journal.restamp(wadPath, "MAP01");
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 1);
+
+	// a journal of another wad is left alone
+	inst.level.journal.restamp(getChildPath("other.wad"), "MAP01");
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP01"), 1);
+
+	// the level got a new name
+	fs::path renamedPath = EditJournal::pathFor(wadPath, "MAP03");
+	mDeleteList.push(renamedPath);
+
+	inst.level.journal.restamp(wadPath, "map03");
+	ASSERT_FALSE(fs::exists(journalPath));
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP03"), 1);
+
+	{
+		EditOperation op(inst.level.basis);
+		op.changeThing(0, Thing::F_TYPE, 10);
+	}
+	inst.level.journal.close();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP03"), 2);
+}
@@ -24,18 +24,15 @@ TEST(ELinedef, MoveCoordOntoLinedef)
 {
 	Instance inst;
 	Vertex* vertex;
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(0);
 	vertex->raw_y = FFixedPoint(0);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
-	vertex = new Vertex;
+	vertex = inst.level.vertices.append();
 	vertex->raw_x = FFixedPoint(64);
 	vertex->raw_y = FFixedPoint(64);
-	inst.level.vertices.push_back(std::shared_ptr<Vertex>(vertex));
 
 
-	inst.level.linedefs.push_back(std::make_shared<LineDef>());
-	auto& L = inst.level.linedefs.back();
+	LineDef *L = inst.level.linedefs.append();
 	L->start = 0;
 	L->end = 1;
 
@@ -0,0 +1,312 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "e_spatial.h"
+#include "e_hover.h"
+#include "e_main.h"
+#include "Instance.h"
+#include "m_select.h"
+#include "testUtils/LevelMaker.hpp"
+#include "gtest/gtest.h"
+
+#include <random>
+
+// lots of things and lines, over few sectors
+static const LevelCounts spatialCounts = { 300, 400, 20, 500, 500 };
+
+class ESpatialFixture : public ::testing::Test
+{
+protected:
+	ESpatialFixture() : random(4321)
+	{
+		// keep the object box out of the way of new things
+		inst.edit.mode = ObjType::sectors;
+	}
+
+	int pick(int count)
+	{
+		return std::uniform_int_distribution<int>(0, count - 1)(random);
+	}
+	FFixedPoint coord()
+	{
+		return FFixedPoint(pick(4096) - 1024);
+	}
+
+	void edit();
+	void checkBox(const v2double_t &pos1, const v2double_t &pos2);
+	void checkCast(const v2double_t &pos);
+
+	Instance inst;
+	std::mt19937 random;
+};
+
+//
+// Some random change to the level
+//
+void ESpatialFixture::edit()
+{
+	Document &doc = inst.level;
+
+	EditOperation op(doc.basis);
+
+	switch(pick(7))
+	{
+	case 0:
+		op.changeThing(pick(doc.numThings()), Thing::F_X, coord());
+		break;
+	case 1:
+		// some go far off the first bounds
+		op.changeVertex(pick(doc.numVertices()), Vertex::F_Y, pick(4) ? coord() : coord() * 8);
+		break;
+	case 2:
+		op.changeLinedef(pick(doc.numLinedefs()), LineDef::F_END, pick(doc.numVertices()));
+		break;
+	case 3:
+	{
+		int t = op.addNew(ObjType::things);
+		doc.things[t]->raw_x = coord();
+		doc.things[t]->raw_y = coord();
+
+		int v = op.addNew(ObjType::vertices);
+		doc.vertices[v]->raw_x = coord();
+		doc.vertices[v]->raw_y = coord();
+
+		int ld = op.addNew(ObjType::linedefs);
+		doc.linedefs[ld]->start = v;
+		doc.linedefs[ld]->end = pick(doc.numVertices());
+		break;
+	}
+	case 4:
+		op.del(ObjType::things, pick(doc.numThings()));
+		op.del(ObjType::vertices, pick(doc.numVertices()));
+		break;
+	case 5:
+	{
+		selection_c list(ObjType::linedefs);
+		for(int i = 0; i < 10; ++i)
+			list.set(pick(doc.numLinedefs()));
+		op.del(list);
+		break;
+	}
+	case 6:
+		op.setAbort(false);
+		op.changeVertex(pick(doc.numVertices()), Vertex::F_X, coord());
+		break;
+	}
+}
+
+//
+// The index must give every object a linear look finds in the box
+//
+void ESpatialFixture::checkBox(const v2double_t &pos1, const v2double_t &pos2)
+{
+	const Document &doc = inst.level;
+
+	for(ObjType type : {ObjType::things, ObjType::vertices, ObjType::linedefs})
+	{
+		std::vector<int> found = doc.spatial.query(type, pos1, pos2);
+
+		ASSERT_TRUE(std::is_sorted(found.begin(), found.end()));
+		ASSERT_EQ(std::adjacent_find(found.begin(), found.end()), found.end());
+		if(!found.empty())
+		{
+			ASSERT_LT(found.back(), doc.numObjects(type));
+		}
+
+		for(int n = 0; n < doc.numObjects(type); ++n)
+		{
+			bool inside;
+			if(type == ObjType::things)
+				inside = doc.things[n]->xy().inbounds(pos1, pos2);
+			else if(type == ObjType::vertices)
+				inside = doc.vertices[n]->xy().inbounds(pos1, pos2);
+			else
+			{
+				v2double_t start = doc.getStart(*doc.linedefs[n]).xy();
+				v2double_t end = doc.getEnd(*doc.linedefs[n]).xy();
+				inside = std::max(start.x, end.x) >= pos1.x && std::min(start.x, end.x) <= pos2.x &&
+						 std::max(start.y, end.y) >= pos1.y && std::min(start.y, end.y) <= pos2.y;
+			}
+			if(inside)
+			{
+				ASSERT_TRUE(std::binary_search(found.begin(), found.end(), n)) << NameForObjectType(type) << " " << n;
+			}
+		}
+
+		// same selection as looking at everything
+		selection_c list(type);
+		SelectObjectsInBox(doc, &list, type, pos1, pos2);
+
+		for(int n = 0; n < doc.numObjects(type); ++n)
+		{
+			bool inside;
+			if(type == ObjType::things)
+				inside = doc.things[n]->xy().inbounds(pos1, pos2);
+			else if(type == ObjType::vertices)
+				inside = doc.vertices[n]->xy().inbounds(pos1, pos2);
+			else
+				inside = doc.getStart(*doc.linedefs[n]).xy().inbounds(pos1, pos2) &&
+						 doc.getEnd(*doc.linedefs[n]).xy().inbounds(pos1, pos2);
+			ASSERT_EQ(list.get(n), inside) << NameForObjectType(type) << " " << n;
+		}
+	}
+}
+
+//
+// Casting from the point must hit the same line as trying every one
+//
+void ESpatialFixture::checkCast(const v2double_t &pos)
+{
+	const Document &doc = inst.level;
+
+	int    best_match = -1;
+	double best_dist = 9e9;
+	Side   best_side = Side::neither;
+
+	double y = pos.y + 0.04;
+
+	for(int n = 0; n < doc.numLinedefs(); ++n)
+	{
+		v2double_t pos1 = doc.getStart(*doc.linedefs[n]).xy();
+		v2double_t pos2 = doc.getEnd(*doc.linedefs[n]).xy();
+
+		if(pos1.y == pos2.y || std::min(pos1.y, pos2.y) >= y || std::max(pos1.y, pos2.y) <= y)
+			continue;
+
+		double dist = pos1.x - pos.x + (pos2.x - pos1.x) * (y - pos1.y) / (pos2.y - pos1.y);
+
+		if(fabs(dist) < best_dist)
+		{
+			best_match = n;
+			best_dist = fabs(dist);
+
+			if(best_dist < 0.01)
+				best_side = Side::neither;
+			else if((pos1.y > pos2.y) == (dist > 0))
+				best_side = Side::right;
+			else
+				best_side = Side::left;
+		}
+	}
+
+	Side side = Side::neither;
+	ASSERT_EQ(hover::getClosestLine_CastingHoriz(doc, pos, &side), best_match);
+	if(best_match >= 0)
+	{
+		ASSERT_EQ(side, best_side);
+	}
+}
+
+TEST_F(ESpatialFixture, QueriesFindEverythingInBox)
+{
+	makeLevel(inst.level, 1234, spatialCounts);
+
+	for(int step = 0; step < 150; ++step)
+	{
+		if(step > 0)
+		{
+			if(step % 20 == 0)
+				inst.level.basis.undo();
+			else
+				edit();
+		}
+
+		v2double_t pos1(pick(5000) - 1500, pick(5000) - 1500);
+		v2double_t pos2 = pos1 + v2double_t(pick(600), pick(600));
+		checkBox(pos1, pos2);
+
+		// a single point and a whole row
+		checkBox(pos1, pos1);
+		checkBox(v2double_t(-HUGE_VAL, pos1.y), v2double_t(HUGE_VAL, pos1.y));
+	}
+}
+
+TEST_F(ESpatialFixture, NewLevelIsPickedUp)
+{
+	makeLevel(inst.level, 1234, spatialCounts);
+	checkBox(v2double_t(-100, -100), v2double_t(900, 900));
+
+	inst.level.clear();
+	ASSERT_TRUE(inst.level.spatial.query(ObjType::things, v2double_t(-1e6, -1e6), v2double_t(1e6, 1e6)).empty());
+
+	makeLevel(inst.level, 1234, spatialCounts);
+	checkBox(v2double_t(-100, -100), v2double_t(900, 900));
+}
+
+TEST_F(ESpatialFixture, CastsHitTheClosestLine)
+{
+	makeLevel(inst.level, 1234, spatialCounts);
+
+	for(int step = 0; step < 100; ++step)
+	{
+		if(step > 0)
+			edit();
+
+		for(int i = 0; i < 20; ++i)
+		{
+			// mostly on the level, a few far away
+			v2double_t pos(pick(5000) - 1500, pick(5000) - 1500);
+			if(i == 0)
+				pos *= 100;
+			checkCast(pos);
+		}
+	}
+}
+
+TEST_F(ESpatialFixture, ThingSectorsFollowEdits)
+{
+	makeLevel(inst.level, 1234, spatialCounts);
+	Document &doc = inst.level;
+
+	for(int step = 0; step < 60; ++step)
+	{
+		if(step % 10 == 9)
+			doc.basis.undo();
+		else if(step % 3 == 0)
+		{
+			selection_c list(ObjType::things);
+			for(int i = 0; i < 5; ++i)
+				list.set(pick(doc.numThings()));
+			EditOperation op(doc.basis);
+			op.del(list);
+		}
+		else
+			edit();
+
+		// the cache only knows of thing and sector edits
+		inst.r_view.thing_sectors.clear();
+		Render3D_NotifyEnd(inst);
+
+		for(int step2 = 0; step2 < 3; ++step2)
+		{
+			EditOperation op(doc.basis);
+			op.del(ObjType::things, pick(doc.numThings()));
+			int t = op.addNew(ObjType::things);
+			doc.things[t]->raw_x = coord();
+			doc.things[t]->raw_y = coord();
+		}
+		// puts one back in the middle
+		doc.basis.undo();
+
+		ASSERT_EQ((int)inst.r_view.thing_sectors.size(), doc.numThings());
+		for(int n = 0; n < doc.numThings(); ++n)
+		{
+			ASSERT_EQ(inst.r_view.thing_sectors[n], hover::getNearestSector(doc, doc.things[n]->xy()).num) << n;
+		}
+	}
+}
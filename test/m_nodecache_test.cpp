@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "m_nodecache.h"
+
+#include "Instance.h"
+#include "m_loadsave.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+#include "testUtils/TempDirContext.hpp"
+#include "gtest/gtest.h"
+
+//
+// A square room with a square pillar, and a second room next to it
+//
+class NodeCacheTest : public TempDirContext
+{
+protected:
+	void SetUp() override;
+
+	std::shared_ptr<Wad_file> savedWad(MapFormat format) const;
+
+	Instance inst;
+	LoadingData loading;
+};
+
+void NodeCacheTest::SetUp()
+{
+	TempDirContext::SetUp();
+
+	static const int coords[][2] =
+	{
+		{ 0, 0 }, { 512, 0 }, { 512, 512 }, { 0, 512 },
+		{ 200, 200 }, { 200, 300 }, { 300, 300 }, { 300, 200 },
+		{ 1024, 0 }, { 1024, 512 }
+	};
+	for(const auto &coord : coords)
+	{
+		Vertex *vertex = inst.level.vertices.append();
+		vertex->raw_x = FFixedPoint(coord[0]);
+		vertex->raw_y = FFixedPoint(coord[1]);
+	}
+
+	for(int i = 0; i < 2; ++i)
+		inst.level.sectors.append();
+
+	auto addLine = [this](int v1, int v2, int right, int left)
+	{
+		LineDef *line = inst.level.linedefs.append();
+		line->start = v1;
+		line->end = v2;
+		line->flags = left < 0 ? MLF_Blocking : MLF_TwoSided;
+		for(int sector : { right, left })
+		{
+			if(sector < 0)
+				continue;
+			SideDef *side = inst.level.sidedefs.append();
+			side->sector = sector;
+			(sector == right ? line->right : line->left) = inst.level.numSidedefs() - 1;
+		}
+	};
+
+	addLine(1, 0, 0, -1);
+	addLine(0, 3, 0, -1);
+	addLine(3, 2, 0, -1);
+	addLine(2, 1, 0, 1);
+	addLine(4, 5, 0, -1);
+	addLine(5, 6, 0, -1);
+	addLine(6, 7, 0, -1);
+	addLine(7, 4, 0, -1);
+	addLine(8, 1, 1, -1);
+	addLine(2, 9, 1, -1);
+	addLine(9, 8, 1, -1);
+
+	Thing *thing = inst.level.things.append();
+	thing->raw_x = FFixedPoint(100);
+	thing->raw_y = FFixedPoint(100);
+	thing->type = 1;
+
+	loading.levelName = "MAP01";
+}
+
+//
+// A wad with the level as the editor has just saved it
+//
+std::shared_ptr<Wad_file> NodeCacheTest::savedWad(MapFormat format) const
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open("dummy.wad", WadOpenMode::write);
+	wad->AddLevel("MAP01");
+	if(format == MapFormat::udmf)
+	{
+		wad->AddLump("TEXTMAP");
+		wad->AddLump("ENDMAP");
+	}
+	else
+	{
+		for(const char *name : { "THINGS", "LINEDEFS", "SIDEDEFS", "VERTEXES", "SEGS",
+				"SSECTORS", "NODES", "SECTORS", "REJECT", "BLOCKMAP" })
+		{
+			wad->AddLump(name);
+		}
+	}
+	return wad;
+}
+
+TEST_F(NodeCacheTest, KeyIgnoresThingsAndTextures)
+{
+	nodebuildinfo_t info;
+	auto key = NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP01", info);
+
+	inst.level.things[0]->raw_x = FFixedPoint(150);
+	inst.level.sidedefs[0]->mid_tex = StringID(12);
+	ASSERT_EQ(NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP01", info), key);
+
+	inst.level.vertices[4]->raw_x = FFixedPoint(190);
+	auto moved = NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP01", info);
+	ASSERT_NE(moved, key);
+
+	inst.level.sidedefs[0]->sector = 1;
+	ASSERT_NE(NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP01", info), moved);
+
+	info.factor = 20;
+	ASSERT_NE(NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP01", info), moved);
+	info.factor = DEFAULT_FACTOR;
+	info.force_xnod = true;
+	ASSERT_NE(NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP01", info), moved);
+	ASSERT_NE(NodeCache::makeKey(inst.level, inst.conf, MapFormat::doom, "MAP02", info), moved);
+}
+
+TEST_F(NodeCacheTest, StoreFetchPrune)
+{
+	NodeCache cache(mTempDir, 2);
+
+	std::vector<node_lump_t> lumps = { { "NODES", { 1, 2, 3 } }, { "GL_MAP01", {} } };
+	std::vector<byte> keys[3] = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+
+	std::vector<node_lump_t> fetched;
+	ASSERT_FALSE(cache.fetch(keys[0], fetched));
+
+	cache.store(keys[0], lumps);
+	ASSERT_TRUE(cache.fetch(keys[0], fetched));
+	ASSERT_EQ(fetched.size(), 2);
+	ASSERT_EQ(fetched[0].name, "NODES");
+	ASSERT_EQ(fetched[0].data, lumps[0].data);
+	ASSERT_EQ(fetched[1].name, "GL_MAP01");
+	ASSERT_TRUE(fetched[1].data.empty());
+
+	ASSERT_FALSE(cache.fetch(keys[1], fetched));
+
+	// only the two most recently used entries are kept
+	for(int i = 0; i < 3; ++i)
+	{
+		cache.store(keys[i], lumps);
+		fs::last_write_time(cache.entryPath(keys[i]), fs::file_time_type::clock::now() -
+				std::chrono::seconds(30 - 10 * i));
+		mDeleteList.push(cache.entryPath(keys[i]));
+	}
+
+	ASSERT_FALSE(cache.fetch(keys[0], fetched));
+	ASSERT_TRUE(cache.fetch(keys[1], fetched));
+	ASSERT_TRUE(cache.fetch(keys[2], fetched));
+}
+
+TEST_F(NodeCacheTest, CopiedLumpsMatchBuild)
+{
+	for(MapFormat format : { MapFormat::doom, MapFormat::udmf })
+		for(bool xnod : { false, true })
+		{
+			loading.levelFormat = format;
+
+			nodebuildinfo_t info;
+			info.force_xnod = xnod;
+
+			std::shared_ptr<Wad_file> built = savedWad(format);
+			ASSERT_EQ(AJBSP_BuildLevel(&info, 0, inst, inst.level, loading, *built), BUILD_OK);
+
+			std::vector<node_lump_t> lumps = AJBSP_GetNodeLumps(*built, 0, format);
+			ASSERT_FALSE(lumps.empty());
+
+			std::shared_ptr<Wad_file> copied = savedWad(format);
+			ASSERT_EQ(AJBSP_PutNodeLumps(&info, 0, inst, inst.level, loading, *copied, lumps),
+					BUILD_OK);
+
+			ASSERT_EQ(copied->NumLumps(), built->NumLumps());
+			for(int i = 0; i < built->NumLumps(); ++i)
+			{
+				ASSERT_EQ(copied->GetLump(i)->Name(), built->GetLump(i)->Name());
+				ASSERT_EQ(copied->GetLump(i)->getData(), built->GetLump(i)->getData())
+						<< built->GetLump(i)->Name().c_str();
+			}
+		}
+}
@@ -0,0 +1,409 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "Instance.h"
+#include "lib_file.h"
+#include "main.h"
+#include "m_config.h"
+#include "w_rawdef.h"
+#include "w_wad.h"
+#include "testUtils/TempDirContext.hpp"
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <fstream>
+
+//
+// A wad with two levels saved without nodes
+//
+class BuildNodesCommandLineTest : public TempDirContext
+{
+protected:
+	void SetUp() override;
+	void TearDown() override;
+
+	void addRoom(int size);
+	void saveLevel(Wad_file &wad, const SString &name, MapFormat format = MapFormat::doom) const;
+
+	// the size of a level's lump
+	static int lumpSize(const fs::path &path, int level, const char *name);
+	static int nodesSize(const fs::path &path, int level)
+	{
+		return lumpSize(path, level, "NODES");
+	}
+
+	Instance inst;
+	fs::path wadPath;
+
+private:
+	fs::path prevInstallDir;
+	fs::path prevHomeDir;
+	fs::path prevOldHomeDir;
+};
+
+void BuildNodesCommandLineTest::SetUp()
+{
+	TempDirContext::SetUp();
+
+	wadPath = getChildPath("maps.wad");
+
+	std::shared_ptr<Wad_file> wad = Wad_file::Open(wadPath, WadOpenMode::write);
+
+	addRoom(256);
+	saveLevel(*wad, "MAP01");
+
+	addRoom(600);
+	saveLevel(*wad, "MAP02");
+
+	wad->writeToDisk();
+
+	mDeleteList.push(wadPath);
+
+	prevInstallDir = global::install_dir;
+	prevHomeDir = global::home_dir;
+	prevOldHomeDir = global::old_linux_home_and_cache_dir;
+}
+
+void BuildNodesCommandLineTest::TearDown()
+{
+	global::build_nodes_file.clear();
+	global::build_nodes_output.clear();
+	global::build_nodes_jobs = 0;
+	global::build_nodes_factor = 0;
+	global::build_nodes_portfolio.clear();
+	global::build_nodes_portfolio_height = false;
+
+	config::bsp_background = true;
+
+	config::preloading.iwadName.clear();
+	config::preloading.portName.clear();
+
+	global::install_dir = prevInstallDir;
+	global::home_dir = prevHomeDir;
+	global::old_linux_home_and_cache_dir = prevOldHomeDir;
+
+	TempDirContext::TearDown();
+}
+
+//
+// A square room with a square pillar
+//
+void BuildNodesCommandLineTest::addRoom(int size)
+{
+	inst.level.clear();
+
+	const int coords[][2] =
+	{
+		{ 0, 0 }, { 0, size }, { size, size }, { size, 0 },
+		{ 100, 100 }, { 200, 100 }, { 200, 200 }, { 100, 200 },
+	};
+	for(const auto &coord : coords)
+	{
+		Vertex *vertex = inst.level.vertices.append();
+		vertex->raw_x = FFixedPoint(coord[0]);
+		vertex->raw_y = FFixedPoint(coord[1]);
+	}
+
+	inst.level.sectors.append();
+
+	for(int i = 0; i < 8; ++i)
+	{
+		SideDef *side = inst.level.sidedefs.append();
+		side->sector = 0;
+
+		LineDef *line = inst.level.linedefs.append();
+		line->start = i;
+		line->end = (i & ~3) + (i + 1) % 4;
+		line->right = i;
+		line->flags = MLF_Blocking;
+	}
+}
+
+//
+// Like the editor saves it, with nodes still to be built
+//
+void BuildNodesCommandLineTest::saveLevel(Wad_file &wad, const SString &name, MapFormat format) const
+{
+	inst.level.SaveHeader(wad, name);
+	if(format == MapFormat::hexen)
+	{
+		inst.level.SaveThings_Hexen(wad);
+		inst.level.SaveLineDefs_Hexen(wad);
+	}
+	else
+	{
+		inst.level.SaveThings(wad);
+		inst.level.SaveLineDefs(wad);
+	}
+	inst.level.SaveSideDefs(wad);
+	inst.level.SaveVertices(wad);
+	wad.AddLump("SEGS");
+	wad.AddLump("SSECTORS");
+	wad.AddLump("NODES");
+	inst.level.SaveSectors(wad);
+	wad.AddLump("REJECT");
+	wad.AddLump("BLOCKMAP");
+	if(format == MapFormat::hexen)
+		inst.level.SaveBehavior(wad);
+}
+
+int BuildNodesCommandLineTest::lumpSize(const fs::path &path, int level, const char *name)
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open(path, WadOpenMode::read);
+	if(!wad)
+		return -1;
+	int index = wad->LevelLookupLump(level, name);
+	return index < 0 ? -1 : wad->GetLump(index)->Length();
+}
+
+TEST_F(BuildNodesCommandLineTest, BuildsEveryLevel)
+{
+	fs::path output = getChildPath("built.wad");
+	mDeleteList.push(output);
+
+	global::build_nodes_file = wadPath;
+	global::build_nodes_output = output;
+	global::build_nodes_jobs = 4;
+
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+
+	// the input is left alone
+	ASSERT_EQ(nodesSize(wadPath, 0), 0);
+	ASSERT_EQ(nodesSize(wadPath, 1), 0);
+
+	ASSERT_GT(nodesSize(output, 0), 0);
+	ASSERT_GT(nodesSize(output, 1), 0);
+
+	// the same in place, on one thread
+	global::build_nodes_output.clear();
+	global::build_nodes_jobs = 1;
+
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+	ASSERT_EQ(nodesSize(wadPath, 0), nodesSize(output, 0));
+	ASSERT_EQ(nodesSize(wadPath, 1), nodesSize(output, 1));
+}
+
+TEST_F(BuildNodesCommandLineTest, MissingWadFails)
+{
+	global::build_nodes_file = getChildPath("missing.wad");
+
+	ASSERT_NE(inst.BuildNodesFromCommandLine(), 0);
+}
+
+TEST_F(BuildNodesCommandLineTest, PortfolioKeepsFewestSegs)
+{
+	global::build_nodes_file = wadPath;
+	global::build_nodes_jobs = 4;
+
+	// each factor on its own, then all of them together
+	fs::path single = getChildPath("single.wad");
+	mDeleteList.push(single);
+
+	std::vector<int> segs[2];
+	for(int factor : { 1, 11, 31 })
+	{
+		global::build_nodes_output = single;
+		global::build_nodes_factor = factor;
+		ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+
+		for(int level = 0; level < 2; ++level)
+			segs[level].push_back(lumpSize(single, level, "SEGS"));
+	}
+
+	fs::path output = getChildPath("portfolio.wad");
+	mDeleteList.push(output);
+
+	global::build_nodes_output = output;
+	global::build_nodes_factor = 0;
+	global::build_nodes_portfolio = "1,11,31";
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+
+	for(int level = 0; level < 2; ++level)
+	{
+		int size = lumpSize(output, level, "SEGS");
+		ASSERT_GT(size, 0);
+		ASSERT_LE(size, *std::min_element(segs[level].begin(), segs[level].end()));
+	}
+
+	// the same on one thread
+	fs::path serial = getChildPath("serial.wad");
+	mDeleteList.push(serial);
+
+	global::build_nodes_output = serial;
+	global::build_nodes_jobs = 1;
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+
+	for(int level = 0; level < 2; ++level)
+		ASSERT_EQ(lumpSize(serial, level, "SEGS"), lumpSize(output, level, "SEGS"));
+
+	global::build_nodes_portfolio = "0,99";
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 2);
+}
+
+TEST_F(BuildNodesCommandLineTest, HexenLevelsNeedTheDefinitions)
+{
+	fs::path hexenPath = getChildPath("hexen.wad");
+	mDeleteList.push(hexenPath);
+	{
+		std::shared_ptr<Wad_file> wad = Wad_file::Open(hexenPath, WadOpenMode::write);
+		addRoom(256);
+		saveLevel(*wad, "MAP01", MapFormat::hexen);
+		wad->writeToDisk();
+	}
+	ASSERT_EQ(Wad_file::Open(hexenPath, WadOpenMode::read)->LevelFormat(0), MapFormat::hexen);
+
+	fs::path defsPath = getChildPath("defs");
+	ASSERT_TRUE(FileMakeDir(defsPath));
+	mDeleteList.push(defsPath);
+	global::install_dir = global::home_dir = global::old_linux_home_and_cache_dir = defsPath;
+
+	global::build_nodes_file = hexenPath;
+
+	// the polyobjects could not be found
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 2);
+	ASSERT_EQ(nodesSize(hexenPath, 0), 0);
+
+	for(const char *dir : { "games", "ports" })
+	{
+		ASSERT_TRUE(FileMakeDir(defsPath / dir));
+		mDeleteList.push(defsPath / dir);
+	}
+	const char *const files[][2] =
+	{
+		{ "games/hexen.ugh", "base_game hexen\n" },
+		{ "games/heretic.ugh", "base_game heretic\n" },
+		{ "ports/vanilla.ugh", "" },
+	};
+	for(const auto &file : files)
+	{
+		std::ofstream os((defsPath / file[0]).u8string());
+		os << file[1];
+		mDeleteList.push(defsPath / file[0]);
+	}
+
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+	ASSERT_GT(nodesSize(hexenPath, 0), 0);
+
+	// the game given with --iwad is used
+	config::preloading.iwadName = "doom2.wad";
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 2);
+	config::preloading.iwadName = "heretic.wad";
+	ASSERT_EQ(inst.BuildNodesFromCommandLine(), 0);
+}
+
+//
+// The same wad, with its last level just saved in the editor
+//
+using BackgroundNodesTest = BuildNodesCommandLineTest;
+
+TEST_F(BackgroundNodesTest, NodesGoIntoTheWad)
+{
+	// what building them right away gives
+	std::shared_ptr<Wad_file> wad = Wad_file::Open(wadPath, WadOpenMode::append);
+	inst.wad.master.ReplaceEditWad(wad);
+
+	LoadingData loading;
+	loading.levelName = "MAP02";
+
+	config::bsp_background = false;
+	inst.BuildNodesAfterSave(1, loading, *wad);
+
+	int size = wad->GetLump(wad->LevelLookupLump(1, "NODES"))->Length();
+	ASSERT_GT(size, 0);
+
+	// now in the background
+	wad = Wad_file::Open(wadPath, WadOpenMode::append);
+	inst.wad.master.ReplaceEditWad(wad);
+
+	config::bsp_background = true;
+	inst.BuildNodesAfterSave(1, loading, *wad);
+
+	// the level can be edited meanwhile
+	inst.level.vertices[0]->raw_x = FFixedPoint(-300);
+
+	ASSERT_TRUE(inst.nodeBuild);
+	inst.FinishBackgroundNodes();
+	ASSERT_FALSE(inst.nodeBuild);
+
+	ASSERT_EQ(nodesSize(wadPath, 1), size);
+	ASSERT_EQ(nodesSize(wadPath, 0), 0);
+}
+
+TEST_F(BackgroundNodesTest, ChangedLevelIsLeftAlone)
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open(wadPath, WadOpenMode::append);
+	inst.wad.master.ReplaceEditWad(wad);
+
+	LoadingData loading;
+	loading.levelName = "MAP02";
+
+	inst.BuildNodesAfterSave(1, loading, *wad);
+
+	// saved again meanwhile, with nodes still to be built
+	inst.level.vertices[0]->raw_x = FFixedPoint(-300);
+
+	wad->GetLump(wad->LevelLookupLump(1, "VERTEXES"))->setData({ 1, 2, 3, 4 });
+	wad->writeToDisk();
+
+	inst.FinishBackgroundNodes();
+	ASSERT_FALSE(inst.nodeBuild);
+
+	ASSERT_EQ(nodesSize(wadPath, 1), 0);
+
+	// another wad is being edited
+	inst.BuildNodesAfterSave(1, loading, *wad);
+	inst.wad.master.ReplaceEditWad(Wad_file::Open(getChildPath("other.wad"), WadOpenMode::write));
+
+	inst.FinishBackgroundNodes();
+	ASSERT_EQ(nodesSize(wadPath, 1), 0);
+}
+
+TEST_F(BackgroundNodesTest, JournalKeepsUpWithTheNodes)
+{
+	std::shared_ptr<Wad_file> wad = Wad_file::Open(wadPath, WadOpenMode::append);
+	inst.wad.master.ReplaceEditWad(wad);
+
+	LoadingData loading;
+	loading.levelName = "MAP02";
+
+	mDeleteList.push(EditJournal::pathFor(wadPath, "MAP02"));
+
+	// as the save leaves it
+	inst.BuildNodesAfterSave(1, loading, *wad);
+	inst.level.journal.start(wadPath, "MAP02");
+
+	{
+		EditOperation op(inst.level.basis);
+		op.changeVertex(0, Vertex::F_X, FFixedPoint(-300));
+	}
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP02"), 1);
+
+	// the nodes change the wad, but the edit can still be recovered
+	inst.FinishBackgroundNodes();
+	ASSERT_GT(nodesSize(wadPath, 1), 0);
+	inst.level.journal.flush();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP02"), 1);
+
+	{
+		EditOperation op(inst.level.basis);
+		op.changeVertex(0, Vertex::F_Y, FFixedPoint(-300));
+	}
+	inst.level.journal.close();
+	ASSERT_EQ(EditJournal::countEdits(wadPath, "MAP02"), 2);
+}
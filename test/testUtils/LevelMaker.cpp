@@ -0,0 +1,101 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#include "LevelMaker.hpp"
+#include "Document.h"
+
+#include <random>
+
+//
+// Makes a level with the objects placed and referring to each other
+// at random. Most lines are short, going to the next vertex.
+//
+void makeLevel(Document &doc, unsigned seed, const LevelCounts &counts)
+{
+	std::mt19937 random(seed);
+	auto pick = [&random](int count)
+	{
+		return std::uniform_int_distribution<int>(0, count - 1)(random);
+	};
+	auto coord = [&pick]()
+	{
+		return FFixedPoint(pick(4096) - 1024);
+	};
+
+	for(int i = 0; i < counts.things; ++i)
+	{
+		Thing *thing = doc.things.append();
+		thing->type = 3000 + i;
+		thing->raw_x = coord();
+		thing->raw_y = coord();
+	}
+	for(int i = 0; i < counts.vertices; ++i)
+	{
+		Vertex *vertex = doc.vertices.append();
+		vertex->raw_x = coord();
+		vertex->raw_y = coord();
+	}
+	for(int i = 0; i < counts.sectors; ++i)
+	{
+		Sector *sector = doc.sectors.append();
+		sector->tag = i;
+		sector->floor_tex = BA_InternaliseString(SString::printf("FLAT%d", i % 7));
+		sector->ceil_tex = BA_InternaliseString("CEIL1");
+	}
+	for(int i = 0; i < counts.sidedefs; ++i)
+	{
+		SideDef *side = doc.sidedefs.append();
+		side->sector = pick(doc.numSectors());
+		side->x_offset = i;
+		side->mid_tex = BA_InternaliseString(SString::printf("WALL%d", i % 11));
+	}
+	for(int i = 0; i < counts.linedefs; ++i)
+	{
+		LineDef *line = doc.linedefs.append();
+		line->start = pick(doc.numVertices());
+		line->end = pick(8) ? (line->start + 1) % doc.numVertices() : pick(doc.numVertices());
+		line->right = pick(doc.numSidedefs());
+		line->left = pick(3) ? -1 : pick(doc.numSidedefs());
+		line->tag = i;
+	}
+}
+
+//
+// Every field of every object, to compare levels with
+//
+std::vector<int> levelFields(const Document &doc)
+{
+	std::vector<int> fields;
+	auto add = [&fields](const void *object, size_t size)
+	{
+		const int *p = static_cast<const int *>(object);
+		fields.insert(fields.end(), p, p + size / sizeof(int));
+		fields.push_back(-1000);
+	};
+	for(const Thing *thing : doc.things)
+		add(thing, sizeof(Thing));
+	for(const Vertex *vertex : doc.vertices)
+		add(vertex, sizeof(Vertex));
+	for(const Sector *sector : doc.sectors)
+		add(sector, sizeof(Sector));
+	for(const SideDef *side : doc.sidedefs)
+		add(side, sizeof(SideDef));
+	for(const LineDef *line : doc.linedefs)
+		add(line, sizeof(LineDef));
+	return fields;
+}
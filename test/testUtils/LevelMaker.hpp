@@ -0,0 +1,41 @@
+//------------------------------------------------------------------------
+//
+//  Eureka DOOM Editor
+//
+//  Copyright (C) 2026 The Eureka contributors
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 2
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//------------------------------------------------------------------------
+
+#ifndef LEVELMAKER_HPP_
+#define LEVELMAKER_HPP_
+
+#include <vector>
+
+class Document;
+
+//
+// How many objects of each kind makeLevel() puts in
+//
+struct LevelCounts
+{
+	int things = 50;
+	int vertices = 300;
+	int sectors = 30;
+	int sidedefs = 400;
+	int linedefs = 500;
+};
+
+void makeLevel(Document &doc, unsigned seed, const LevelCounts &counts = LevelCounts());
+std::vector<int> levelFields(const Document &doc);
+
+#endif
@@ -433,6 +433,62 @@ TEST_F(WadFileTest, LevelQuery)
 	ASSERT_EQ(read->LevelLastLump(1), 11);
 }
 
+TEST_F(WadFileTest, CopyAndReplaceLevel)
+{
+	auto wad = Wad_file::Open(getChildPath("wad.wad"), WadOpenMode::write);
+	ASSERT_TRUE(wad);
+
+	wad->AddLevel("MAP01");
+	wad->AddLump("THINGS").Printf("things");
+	wad->AddLump("LINEDEFS");
+	wad->AddLump("GL_MAP01");
+	wad->AddLevel("MAP02");
+	wad->AddLump("THINGS");
+	wad->AddLump("LINEDEFS");
+	wad->AddLump("DEHACKED");
+
+	auto copy = wad->CopyLevel(0);
+	ASSERT_TRUE(copy);
+	ASSERT_EQ(copy->LevelCount(), 1);
+	ASSERT_EQ(copy->NumLumps(), 4);
+	ASSERT_EQ(copy->GetLump(1)->Name(), "THINGS");
+	assertVecString(copy->GetLump(1)->getData(), "things");
+	ASSERT_EQ(copy->GetLump(3)->Name(), "GL_MAP01");
+
+	// the copy is on its own
+	copy->GetLump(1)->clearData();
+	assertVecString(wad->GetLump(1)->getData(), "things");
+
+	// grow the level, the next one must follow
+	copy->RemoveGLNodes(0);
+	copy->AddLump("NODES").Printf("nodes");
+	copy->AddLump("GL_MAP01");
+	copy->AddLump("GL_VERT");
+
+	wad->ReplaceLevel(0, *copy);
+	ASSERT_EQ(wad->LevelCount(), 2);
+	ASSERT_EQ(wad->LevelHeader(0), 0);
+	ASSERT_EQ(wad->LevelLastLump(0), 5);
+	ASSERT_EQ(wad->LevelHeader(1), 6);
+	ASSERT_EQ(wad->LevelLastLump(1), 8);
+	ASSERT_EQ(wad->NumLumps(), 10);
+
+	const char *names[] = { "MAP01", "THINGS", "LINEDEFS", "NODES", "GL_MAP01", "GL_VERT",
+		"MAP02", "THINGS", "LINEDEFS", "DEHACKED" };
+	for(int i = 0; i < wad->NumLumps(); ++i)
+		ASSERT_EQ(wad->GetLump(i)->Name(), names[i]);
+	ASSERT_EQ(wad->GetLump(1)->Length(), 0);
+	assertVecString(wad->GetLump(3)->getData(), "nodes");
+
+	// and shrink the last one
+	copy = wad->CopyLevel(1);
+	copy->RemoveLumps(2);
+	wad->ReplaceLevel(1, *copy);
+	ASSERT_EQ(wad->LevelLastLump(1), 7);
+	ASSERT_EQ(wad->NumLumps(), 9);
+	ASSERT_EQ(wad->GetLump(8)->Name(), "DEHACKED");
+}
+
 //
 // Tests that the backup will write exactly like writeToDisk.
 //